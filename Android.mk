@@ -28,4 +28,5 @@ include $(MY_WEBRTC_ROOT_PATH)/android-webrtc.mk
 
 # build test apps
 include $(MY_WEBRTC_ROOT_PATH)/src/modules/audio_processing/main/test/process_test/Android.mk
+include $(MY_WEBRTC_ROOT_PATH)/src/modules/audio_processing/main/test/load_test/Android.mk
 
@@ -81,6 +81,18 @@ public:
     int Pull(WebRtc_Word16* samplesOut, int desiredLen, int &outLen);
 
 private:
+    // Checks that |lengthIn| samples per channel can be resampled in the
+    // current mode and that the result fits in |maxLen| samples
+    bool ValidPushLength(int lengthIn, int maxLen) const;
+
+    // Resamples at most block_size_ mono samples, returns the output length
+    int ResampleBlock(const WebRtc_Word16* samplesIn, int lengthIn,
+                      WebRtc_Word16* samplesOut);
+
+    // Synchronous resampling of interleaved stereo
+    int PushStereo(const WebRtc_Word16* samplesIn, int lengthIn,
+                   WebRtc_Word16* samplesOut, int maxLen, int &outLen);
+
     // Generic pointers since we don't know what states we'll need
     void* state1_;
     void* state2_;
@@ -94,13 +106,22 @@ private:
     int in_buffer_size_max_;
     int out_buffer_size_max_;
 
+    // Scratch memory, allocated in Reset() so that Push() never has to.
+    // Push() works through its input in blocks of block_size_ samples per
+    // channel, producing at most block_size_out_ samples per channel each.
+    WebRtc_Word16* tmp_buffer_;
+    WebRtc_Word32* tmp_mem_;
+    WebRtc_Word16* stereo_buffer_;
+    int block_size_;
+    int block_size_out_;
+
     // State
     int my_in_frequency_khz_;
     int my_out_frequency_khz_;
     ResamplerMode my_mode_;
     ResamplerType my_type_;
 
-    // Extra instance for stereo
+    // Extra instances for stereo modes that are not filtered interleaved
     Resampler* slave_left_;
     Resampler* slave_right_;
 };
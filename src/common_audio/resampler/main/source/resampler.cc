@@ -23,6 +23,18 @@
 namespace webrtc
 {
 
+namespace
+{
+// Number of input samples per channel that Push() hands to the resampling
+// routines at a time. Both are multiples of the block lengths the
+// fractional resamplers require.
+enum
+{
+    kBlockSize = 480,
+    kBlockSize11kHz = 440
+};
+} // namespace
+
 Resampler::Resampler()
 {
     state1_ = NULL;
@@ -34,6 +46,11 @@ Resampler::Resampler()
     out_buffer_size_ = 0;
     in_buffer_size_max_ = 0;
     out_buffer_size_max_ = 0;
+    tmp_buffer_ = NULL;
+    tmp_mem_ = NULL;
+    stereo_buffer_ = NULL;
+    block_size_ = 0;
+    block_size_out_ = 0;
     // we need a reset before we will work
     my_in_frequency_khz_ = 0;
     my_out_frequency_khz_ = 0;
@@ -54,6 +71,11 @@ Resampler::Resampler(int inFreq, int outFreq, ResamplerType type)
     out_buffer_size_ = 0;
     in_buffer_size_max_ = 0;
     out_buffer_size_max_ = 0;
+    tmp_buffer_ = NULL;
+    tmp_mem_ = NULL;
+    stereo_buffer_ = NULL;
+    block_size_ = 0;
+    block_size_out_ = 0;
     // we need a reset before we will work
     my_in_frequency_khz_ = 0;
     my_out_frequency_khz_ = 0;
@@ -88,6 +110,18 @@ Resampler::~Resampler()
     {
         free(out_buffer_);
     }
+    if (tmp_buffer_)
+    {
+        free(tmp_buffer_);
+    }
+    if (tmp_mem_)
+    {
+        free(tmp_mem_);
+    }
+    if (stereo_buffer_)
+    {
+        free(stereo_buffer_);
+    }
     if (slave_left_)
     {
         delete slave_left_;
@@ -141,6 +175,21 @@ int Resampler::Reset(int inFreq, int outFreq, ResamplerType type)
         free(out_buffer_);
         out_buffer_ = NULL;
     }
+    if (tmp_buffer_)
+    {
+        free(tmp_buffer_);
+        tmp_buffer_ = NULL;
+    }
+    if (tmp_mem_)
+    {
+        free(tmp_mem_);
+        tmp_mem_ = NULL;
+    }
+    if (stereo_buffer_)
+    {
+        free(stereo_buffer_);
+        stereo_buffer_ = NULL;
+    }
     if (slave_left_)
     {
         delete slave_left_;
@@ -182,13 +231,7 @@ int Resampler::Reset(int inFreq, int outFreq, ResamplerType type)
     outFreq = outFreq / b;
 
     // Do we need stereo?
-    if ((my_type_ & 0xf0) == 0x20)
-    {
-        // Change type to mono
-        type = (ResamplerType)((int)type & 0x0f + 0x10);
-        slave_left_ = new Resampler(inFreq, outFreq, type);
-        slave_right_ = new Resampler(inFreq, outFreq, type);
-    }
+    bool stereo = ((my_type_ & 0xf0) == 0x20);
 
     if (inFreq == outFreq)
     {
@@ -269,6 +312,46 @@ int Resampler::Reset(int inFreq, int outFreq, ResamplerType type)
         return -1;
     }
 
+    if (inFreq == 11)
+    {
+        block_size_ = kBlockSize11kHz;
+    } else
+    {
+        block_size_ = kBlockSize;
+    }
+    block_size_out_ = (block_size_ * outFreq) / inFreq;
+
+    // The allpass based modes filter stereo directly on the interleaved
+    // samples. All other modes split the channels and use one slave each.
+    int num_channels = 1;
+    if (stereo)
+    {
+        switch (my_mode_)
+        {
+            case kResamplerMode1To1:
+            case kResamplerMode1To2:
+            case kResamplerMode1To4:
+            case kResamplerMode2To1:
+            case kResamplerMode4To1:
+                num_channels = 2;
+                break;
+            default:
+                // Change type to mono
+                type = (ResamplerType)(((int)type & 0x0f) + 0x10);
+                slave_left_ = new Resampler(inFreq, outFreq, type);
+                slave_right_ = new Resampler(inFreq, outFreq, type);
+
+                // Deinterleaved input and output blocks of both channels
+                stereo_buffer_ = (WebRtc_Word16*)malloc(
+                        2 * (block_size_ + block_size_out_) * sizeof(WebRtc_Word16));
+                return 0;
+        }
+    }
+
+    // Scratch memory needed by Push(), in samples and words respectively
+    int tmp_buffer_size = 0;
+    int tmp_mem_size = 0;
+
     // Now create the states we need
     switch (my_mode_)
     {
@@ -276,20 +359,22 @@ int Resampler::Reset(int inFreq, int outFreq, ResamplerType type)
             // No state needed;
             break;
         case kResamplerMode1To2:
-            state1_ = malloc(8 * sizeof(WebRtc_Word32));
-            memset(state1_, 0, 8 * sizeof(WebRtc_Word32));
+            state1_ = malloc(8 * num_channels * sizeof(WebRtc_Word32));
+            memset(state1_, 0, 8 * num_channels * sizeof(WebRtc_Word32));
             break;
         case kResamplerMode1To3:
             state1_ = malloc(sizeof(WebRtcSpl_State16khzTo48khz));
             WebRtcSpl_ResetResample16khzTo48khz((WebRtcSpl_State16khzTo48khz *)state1_);
+            tmp_mem_size = 336;
             break;
         case kResamplerMode1To4:
             // 1:2
-            state1_ = malloc(8 * sizeof(WebRtc_Word32));
-            memset(state1_, 0, 8 * sizeof(WebRtc_Word32));
+            state1_ = malloc(8 * num_channels * sizeof(WebRtc_Word32));
+            memset(state1_, 0, 8 * num_channels * sizeof(WebRtc_Word32));
             // 2:4
-            state2_ = malloc(8 * sizeof(WebRtc_Word32));
-            memset(state2_, 0, 8 * sizeof(WebRtc_Word32));
+            state2_ = malloc(8 * num_channels * sizeof(WebRtc_Word32));
+            memset(state2_, 0, 8 * num_channels * sizeof(WebRtc_Word32));
+            tmp_buffer_size = 2 * block_size_ * num_channels;
             break;
         case kResamplerMode1To6:
             // 1:2
@@ -298,6 +383,8 @@ int Resampler::Reset(int inFreq, int outFreq, ResamplerType type)
             // 2:6
             state2_ = malloc(sizeof(WebRtcSpl_State16khzTo48khz));
             WebRtcSpl_ResetResample16khzTo48khz((WebRtcSpl_State16khzTo48khz *)state2_);
+            tmp_buffer_size = 2 * block_size_;
+            tmp_mem_size = 336;
             break;
         case kResamplerMode2To3:
             // 2:6
@@ -306,6 +393,8 @@ int Resampler::Reset(int inFreq, int outFreq, ResamplerType type)
             // 6:3
             state2_ = malloc(8 * sizeof(WebRtc_Word32));
             memset(state2_, 0, 8 * sizeof(WebRtc_Word32));
+            tmp_buffer_size = 3 * block_size_;
+            tmp_mem_size = 336;
             break;
         case kResamplerMode2To11:
             state1_ = malloc(8 * sizeof(WebRtc_Word32));
@@ -313,14 +402,18 @@ int Resampler::Reset(int inFreq, int outFreq, ResamplerType type)
 
             state2_ = malloc(sizeof(WebRtcSpl_State8khzTo22khz));
             WebRtcSpl_ResetResample8khzTo22khz((WebRtcSpl_State8khzTo22khz *)state2_);
+            tmp_buffer_size = 2 * block_size_;
+            tmp_mem_size = 98;
             break;
         case kResamplerMode4To11:
             state1_ = malloc(sizeof(WebRtcSpl_State8khzTo22khz));
             WebRtcSpl_ResetResample8khzTo22khz((WebRtcSpl_State8khzTo22khz *)state1_);
+            tmp_mem_size = 98;
             break;
         case kResamplerMode8To11:
             state1_ = malloc(sizeof(WebRtcSpl_State16khzTo22khz));
             WebRtcSpl_ResetResample16khzTo22khz((WebRtcSpl_State16khzTo22khz *)state1_);
+            tmp_mem_size = 88;
             break;
         case kResamplerMode11To16:
             state1_ = malloc(8 * sizeof(WebRtc_Word32));
@@ -328,6 +421,8 @@ int Resampler::Reset(int inFreq, int outFreq, ResamplerType type)
 
             state2_ = malloc(sizeof(WebRtcSpl_State22khzTo16khz));
             WebRtcSpl_ResetResample22khzTo16khz((WebRtcSpl_State22khzTo16khz *)state2_);
+            tmp_buffer_size = 2 * block_size_;
+            tmp_mem_size = 104;
             break;
         case kResamplerMode11To32:
             // 11 -> 22
@@ -342,22 +437,26 @@ int Resampler::Reset(int inFreq, int outFreq, ResamplerType type)
             state3_ = malloc(8 * sizeof(WebRtc_Word32));
             memset(state3_, 0, 8 * sizeof(WebRtc_Word32));
 
+            tmp_buffer_size = (block_size_ * 16) / 11;
+            tmp_mem_size = 104;
             break;
         case kResamplerMode2To1:
-            state1_ = malloc(8 * sizeof(WebRtc_Word32));
-            memset(state1_, 0, 8 * sizeof(WebRtc_Word32));
+            state1_ = malloc(8 * num_channels * sizeof(WebRtc_Word32));
+            memset(state1_, 0, 8 * num_channels * sizeof(WebRtc_Word32));
             break;
         case kResamplerMode3To1:
             state1_ = malloc(sizeof(WebRtcSpl_State48khzTo16khz));
             WebRtcSpl_ResetResample48khzTo16khz((WebRtcSpl_State48khzTo16khz *)state1_);
+            tmp_mem_size = 496;
             break;
         case kResamplerMode4To1:
             // 4:2
-            state1_ = malloc(8 * sizeof(WebRtc_Word32));
-            memset(state1_, 0, 8 * sizeof(WebRtc_Word32));
+            state1_ = malloc(8 * num_channels * sizeof(WebRtc_Word32));
+            memset(state1_, 0, 8 * num_channels * sizeof(WebRtc_Word32));
             // 2:1
-            state2_ = malloc(8 * sizeof(WebRtc_Word32));
-            memset(state2_, 0, 8 * sizeof(WebRtc_Word32));
+            state2_ = malloc(8 * num_channels * sizeof(WebRtc_Word32));
+            memset(state2_, 0, 8 * num_channels * sizeof(WebRtc_Word32));
+            tmp_buffer_size = (block_size_ / 2) * num_channels;
             break;
         case kResamplerMode6To1:
             // 6:2
@@ -366,6 +465,8 @@ int Resampler::Reset(int inFreq, int outFreq, ResamplerType type)
             // 2:1
             state2_ = malloc(8 * sizeof(WebRtc_Word32));
             memset(state2_, 0, 8 * sizeof(WebRtc_Word32));
+            tmp_buffer_size = block_size_ / 3;
+            tmp_mem_size = 496;
             break;
         case kResamplerMode3To2:
             // 3:6
@@ -374,6 +475,8 @@ int Resampler::Reset(int inFreq, int outFreq, ResamplerType type)
             // 6:2
             state2_ = malloc(sizeof(WebRtcSpl_State48khzTo16khz));
             WebRtcSpl_ResetResample48khzTo16khz((WebRtcSpl_State48khzTo16khz *)state2_);
+            tmp_buffer_size = 2 * block_size_;
+            tmp_mem_size = 496;
             break;
         case kResamplerMode11To2:
             state1_ = malloc(sizeof(WebRtcSpl_State22khzTo8khz));
@@ -382,18 +485,31 @@ int Resampler::Reset(int inFreq, int outFreq, ResamplerType type)
             state2_ = malloc(8 * sizeof(WebRtc_Word32));
             memset(state2_, 0, 8 * sizeof(WebRtc_Word32));
 
+            tmp_buffer_size = (block_size_ * 4) / 11;
+            tmp_mem_size = 126;
             break;
         case kResamplerMode11To4:
             state1_ = malloc(sizeof(WebRtcSpl_State22khzTo8khz));
             WebRtcSpl_ResetResample22khzTo8khz((WebRtcSpl_State22khzTo8khz *)state1_);
+            tmp_mem_size = 126;
             break;
         case kResamplerMode11To8:
             state1_ = malloc(sizeof(WebRtcSpl_State22khzTo16khz));
             WebRtcSpl_ResetResample22khzTo16khz((WebRtcSpl_State22khzTo16khz *)state1_);
+            tmp_mem_size = 104;
             break;
 
     }
 
+    if (tmp_buffer_size > 0)
+    {
+        tmp_buffer_ = (WebRtc_Word16*)malloc(tmp_buffer_size * sizeof(WebRtc_Word16));
+    }
+    if (tmp_mem_size > 0)
+    {
+        tmp_mem_ = (WebRtc_Word32*)malloc(tmp_mem_size * sizeof(WebRtc_Word32));
+    }
+
     return 0;
 }
 
@@ -410,58 +526,174 @@ int Resampler::Push(const WebRtc_Word16 * samplesIn, int lengthIn, WebRtc_Word16
     // Do we have a stereo signal?
     if ((my_type_ & 0xf0) == 0x20)
     {
+        return PushStereo(samplesIn, lengthIn, samplesOut, maxLen, outLen);
+    }
 
-        // Split up the signal and call the slave object for each channel
+    if (!ValidPushLength(lengthIn, maxLen))
+    {
+        return -1;
+    }
 
-        WebRtc_Word16* left = (WebRtc_Word16*)malloc(lengthIn * sizeof(WebRtc_Word16) / 2);
-        WebRtc_Word16* right = (WebRtc_Word16*)malloc(lengthIn * sizeof(WebRtc_Word16) / 2);
-        WebRtc_Word16* out_left = (WebRtc_Word16*)malloc(maxLen / 2 * sizeof(WebRtc_Word16));
-        WebRtc_Word16* out_right =
-                (WebRtc_Word16*)malloc(maxLen / 2 * sizeof(WebRtc_Word16));
-        int res = 0;
-        for (int i = 0; i < lengthIn; i += 2)
+    outLen = 0;
+    for (int i = 0; i < lengthIn; i += block_size_)
+    {
+        outLen += ResampleBlock(samplesIn + i, WEBRTC_SPL_MIN(block_size_, lengthIn - i),
+                                samplesOut + outLen);
+    }
+    return 0;
+}
+
+int Resampler::PushStereo(const WebRtc_Word16* samplesIn, int lengthIn,
+                          WebRtc_Word16* samplesOut, int maxLen, int &outLen)
+{
+    // From here on, lengths are in samples per channel.
+    lengthIn = lengthIn / 2;
+    maxLen = maxLen / 2;
+
+    if (!ValidPushLength(lengthIn, maxLen))
+    {
+        return -1;
+    }
+
+    outLen = 0;
+    if (slave_left_ == NULL)
+    {
+        // Filter both channels directly on the interleaved signal
+        for (int i = 0; i < lengthIn; i += block_size_)
         {
-            left[i >> 1] = samplesIn[i];
-            right[i >> 1] = samplesIn[i + 1];
+            const WebRtc_Word16* in = samplesIn + 2 * i;
+            WebRtc_Word16* out = samplesOut + outLen;
+            int len = WEBRTC_SPL_MIN(block_size_, lengthIn - i);
+
+            switch (my_mode_)
+            {
+                case kResamplerMode1To1:
+                    memcpy(out, in, 2 * len * sizeof(WebRtc_Word16));
+                    outLen += 2 * len;
+                    break;
+                case kResamplerMode1To2:
+                    WebRtcSpl_UpsampleBy2Stereo(in, len, out, (WebRtc_Word32*)state1_);
+                    outLen += 2 * len * 2;
+                    break;
+                case kResamplerMode1To4:
+                    // 1:2
+                    WebRtcSpl_UpsampleBy2Stereo(in, len, tmp_buffer_, (WebRtc_Word32*)state1_);
+                    // 2:4
+                    WebRtcSpl_UpsampleBy2Stereo(tmp_buffer_, len * 2, out,
+                                                (WebRtc_Word32*)state2_);
+                    outLen += 2 * len * 4;
+                    break;
+                case kResamplerMode2To1:
+                    WebRtcSpl_DownsampleBy2Stereo(in, len, out, (WebRtc_Word32*)state1_);
+                    outLen += 2 * (len / 2);
+                    break;
+                case kResamplerMode4To1:
+                    // 4:2
+                    WebRtcSpl_DownsampleBy2Stereo(in, len, tmp_buffer_, (WebRtc_Word32*)state1_);
+                    // 2:1
+                    WebRtcSpl_DownsampleBy2Stereo(tmp_buffer_, len / 2, out,
+                                                  (WebRtc_Word32*)state2_);
+                    outLen += 2 * (len / 4);
+                    break;
+                default:
+                    return -1;
+            }
         }
+        return 0;
+    }
 
-        // It's OK to overwrite the local parameter, since it's just a copy
-        lengthIn = lengthIn / 2;
+    // Split up the signal and call the slave object for each channel, one
+    // block at a time
+    WebRtc_Word16* left = stereo_buffer_;
+    WebRtc_Word16* right = left + block_size_;
+    WebRtc_Word16* out_left = right + block_size_;
+    WebRtc_Word16* out_right = out_left + block_size_out_;
 
+    for (int i = 0; i < lengthIn; i += block_size_)
+    {
+        int len = WEBRTC_SPL_MIN(block_size_, lengthIn - i);
+        for (int j = 0; j < len; j++)
+        {
+            left[j] = samplesIn[2 * (i + j)];
+            right[j] = samplesIn[2 * (i + j) + 1];
+        }
+
+        int res = 0;
         int actualOutLen_left = 0;
         int actualOutLen_right = 0;
-        // Do resampling for right channel
-        res |= slave_left_->Push(left, lengthIn, out_left, maxLen / 2, actualOutLen_left);
-        res |= slave_right_->Push(right, lengthIn, out_right, maxLen / 2, actualOutLen_right);
+        res |= slave_left_->Push(left, len, out_left, block_size_out_, actualOutLen_left);
+        res |= slave_right_->Push(right, len, out_right, block_size_out_,
+                                  actualOutLen_right);
         if (res || (actualOutLen_left != actualOutLen_right))
         {
-            free(left);
-            free(right);
-            free(out_left);
-            free(out_right);
             return -1;
         }
 
         // Reassemble the signal
-        for (int i = 0; i < actualOutLen_left; i++)
+        for (int j = 0; j < actualOutLen_left; j++)
         {
-            samplesOut[i * 2] = out_left[i];
-            samplesOut[i * 2 + 1] = out_right[i];
+            samplesOut[outLen + j * 2] = out_left[j];
+            samplesOut[outLen + j * 2 + 1] = out_right[j];
         }
-        outLen = 2 * actualOutLen_left;
+        outLen += 2 * actualOutLen_left;
+    }
 
-        free(left);
-        free(right);
-        free(out_left);
-        free(out_right);
+    return 0;
+}
 
-        return 0;
+bool Resampler::ValidPushLength(int lengthIn, int maxLen) const
+{
+    // The fractional resamplers work on fixed size blocks only.
+    // Can be fixed, but I don't think it's needed
+    switch (my_mode_)
+    {
+        case kResamplerMode1To1:
+            return true;
+        case kResamplerMode1To2:
+            return (maxLen >= (lengthIn * 2));
+        case kResamplerMode1To3:
+            return ((lengthIn % 160) == 0) && (maxLen >= (lengthIn * 3));
+        case kResamplerMode1To4:
+            return (maxLen >= (lengthIn * 4));
+        case kResamplerMode1To6:
+            return ((lengthIn % 80) == 0) && (maxLen >= (lengthIn * 6));
+        case kResamplerMode2To3:
+            return ((lengthIn % 160) == 0) && (maxLen >= (lengthIn * 3 / 2));
+        case kResamplerMode2To11:
+            return ((lengthIn % 80) == 0) && (maxLen >= ((lengthIn * 11) / 2));
+        case kResamplerMode4To11:
+            return ((lengthIn % 80) == 0) && (maxLen >= ((lengthIn * 11) / 4));
+        case kResamplerMode8To11:
+            return ((lengthIn % 160) == 0) && (maxLen >= ((lengthIn * 11) / 8));
+        case kResamplerMode11To16:
+            return ((lengthIn % 110) == 0) && (maxLen >= ((lengthIn * 16) / 11));
+        case kResamplerMode11To32:
+            return ((lengthIn % 110) == 0) && (maxLen >= ((lengthIn * 32) / 11));
+        case kResamplerMode2To1:
+            return (maxLen >= (lengthIn / 2));
+        case kResamplerMode3To1:
+            return ((lengthIn % 480) == 0) && (maxLen >= (lengthIn / 3));
+        case kResamplerMode4To1:
+            return (maxLen >= (lengthIn / 4));
+        case kResamplerMode6To1:
+            return ((lengthIn % 480) == 0) && (maxLen >= (lengthIn / 6));
+        case kResamplerMode3To2:
+            // 3:6 followed by 6:2 in blocks of 480 samples
+            return (((lengthIn * 2) % 480) == 0) && (maxLen >= (lengthIn * 2 / 3));
+        case kResamplerMode11To2:
+            return ((lengthIn % 220) == 0) && (maxLen >= ((lengthIn * 2) / 11));
+        case kResamplerMode11To4:
+            return ((lengthIn % 220) == 0) && (maxLen >= ((lengthIn * 4) / 11));
+        case kResamplerMode11To8:
+            return ((lengthIn % 220) == 0) && (maxLen >= ((lengthIn * 8) / 11));
     }
+    return false;
+}
 
-    // Container for temp samples
-    WebRtc_Word16* tmp;
-    // tmp data for resampling routines
-    WebRtc_Word32* tmp_mem;
+int Resampler::ResampleBlock(const WebRtc_Word16* samplesIn, int lengthIn,
+                             WebRtc_Word16* samplesOut)
+{
+    int outLen = 0;
 
     switch (my_mode_)
     {
@@ -470,423 +702,191 @@ int Resampler::Push(const WebRtc_Word16 * samplesIn, int lengthIn, WebRtc_Word16
             outLen = lengthIn;
             break;
         case kResamplerMode1To2:
-            if (maxLen < (lengthIn * 2))
-            {
-                return -1;
-            }
             WebRtcSpl_UpsampleBy2(samplesIn, lengthIn, samplesOut, (WebRtc_Word32*)state1_);
             outLen = lengthIn * 2;
-            return 0;
+            break;
         case kResamplerMode1To3:
-
-            // We can only handle blocks of 160 samples
-            // Can be fixed, but I don't think it's needed
-            if ((lengthIn % 160) != 0)
-            {
-                return -1;
-            }
-            if (maxLen < (lengthIn * 3))
-            {
-                return -1;
-            }
-            tmp_mem = (WebRtc_Word32*)malloc(336 * sizeof(WebRtc_Word32));
-
             for (int i = 0; i < lengthIn; i += 160)
             {
                 WebRtcSpl_Resample16khzTo48khz(samplesIn + i, samplesOut + i * 3,
                                                (WebRtcSpl_State16khzTo48khz *)state1_,
-                                               tmp_mem);
+                                               tmp_mem_);
             }
             outLen = lengthIn * 3;
-            free(tmp_mem);
-            return 0;
+            break;
         case kResamplerMode1To4:
-            if (maxLen < (lengthIn * 4))
-            {
-                return -1;
-            }
-
-            tmp = (WebRtc_Word16*)malloc(sizeof(WebRtc_Word16) * 2 * lengthIn);
             // 1:2
-            WebRtcSpl_UpsampleBy2(samplesIn, lengthIn, tmp, (WebRtc_Word32*)state1_);
+            WebRtcSpl_UpsampleBy2(samplesIn, lengthIn, tmp_buffer_, (WebRtc_Word32*)state1_);
             // 2:4
-            WebRtcSpl_UpsampleBy2(tmp, lengthIn * 2, samplesOut, (WebRtc_Word32*)state2_);
+            WebRtcSpl_UpsampleBy2(tmp_buffer_, lengthIn * 2, samplesOut,
+                                  (WebRtc_Word32*)state2_);
             outLen = lengthIn * 4;
-            free(tmp);
-            return 0;
+            break;
         case kResamplerMode1To6:
-            // We can only handle blocks of 80 samples
-            // Can be fixed, but I don't think it's needed
-            if ((lengthIn % 80) != 0)
-            {
-                return -1;
-            }
-            if (maxLen < (lengthIn * 6))
-            {
-                return -1;
-            }
-
             //1:2
-
-            tmp_mem = (WebRtc_Word32*)malloc(336 * sizeof(WebRtc_Word32));
-            tmp = (WebRtc_Word16*)malloc(sizeof(WebRtc_Word16) * 2 * lengthIn);
-
-            WebRtcSpl_UpsampleBy2(samplesIn, lengthIn, tmp, (WebRtc_Word32*)state1_);
+            WebRtcSpl_UpsampleBy2(samplesIn, lengthIn, tmp_buffer_, (WebRtc_Word32*)state1_);
             outLen = lengthIn * 2;
 
             for (int i = 0; i < outLen; i += 160)
             {
-                WebRtcSpl_Resample16khzTo48khz(tmp + i, samplesOut + i * 3,
+                WebRtcSpl_Resample16khzTo48khz(tmp_buffer_ + i, samplesOut + i * 3,
                                                (WebRtcSpl_State16khzTo48khz *)state2_,
-                                               tmp_mem);
+                                               tmp_mem_);
             }
             outLen = outLen * 3;
-            free(tmp_mem);
-            free(tmp);
-
-            return 0;
+            break;
         case kResamplerMode2To3:
-            if (maxLen < (lengthIn * 3 / 2))
-            {
-                return -1;
-            }
             // 2:6
-            // We can only handle blocks of 160 samples
-            // Can be fixed, but I don't think it's needed
-            if ((lengthIn % 160) != 0)
-            {
-                return -1;
-            }
-            tmp = static_cast<WebRtc_Word16*> (malloc(sizeof(WebRtc_Word16) * lengthIn * 3));
-            tmp_mem = (WebRtc_Word32*)malloc(336 * sizeof(WebRtc_Word32));
             for (int i = 0; i < lengthIn; i += 160)
             {
-                WebRtcSpl_Resample16khzTo48khz(samplesIn + i, tmp + i * 3,
+                WebRtcSpl_Resample16khzTo48khz(samplesIn + i, tmp_buffer_ + i * 3,
                                                (WebRtcSpl_State16khzTo48khz *)state1_,
-                                               tmp_mem);
+                                               tmp_mem_);
             }
             lengthIn = lengthIn * 3;
             // 6:3
-            WebRtcSpl_DownsampleBy2(tmp, lengthIn, samplesOut, (WebRtc_Word32*)state2_);
+            WebRtcSpl_DownsampleBy2(tmp_buffer_, lengthIn, samplesOut, (WebRtc_Word32*)state2_);
             outLen = lengthIn / 2;
-            free(tmp);
-            free(tmp_mem);
-            return 0;
+            break;
         case kResamplerMode2To11:
-
-            // We can only handle blocks of 80 samples
-            // Can be fixed, but I don't think it's needed
-            if ((lengthIn % 80) != 0)
-            {
-                return -1;
-            }
-            if (maxLen < ((lengthIn * 11) / 2))
-            {
-                return -1;
-            }
-            tmp = (WebRtc_Word16*)malloc(sizeof(WebRtc_Word16) * 2 * lengthIn);
             // 1:2
-            WebRtcSpl_UpsampleBy2(samplesIn, lengthIn, tmp, (WebRtc_Word32*)state1_);
+            WebRtcSpl_UpsampleBy2(samplesIn, lengthIn, tmp_buffer_, (WebRtc_Word32*)state1_);
             lengthIn *= 2;
 
-            tmp_mem = (WebRtc_Word32*)malloc(98 * sizeof(WebRtc_Word32));
-
             for (int i = 0; i < lengthIn; i += 80)
             {
-                WebRtcSpl_Resample8khzTo22khz(tmp + i, samplesOut + (i * 11) / 4,
+                WebRtcSpl_Resample8khzTo22khz(tmp_buffer_ + i, samplesOut + (i * 11) / 4,
                                               (WebRtcSpl_State8khzTo22khz *)state2_,
-                                              tmp_mem);
+                                              tmp_mem_);
             }
             outLen = (lengthIn * 11) / 4;
-            free(tmp_mem);
-            free(tmp);
-            return 0;
+            break;
         case kResamplerMode4To11:
-
-            // We can only handle blocks of 80 samples
-            // Can be fixed, but I don't think it's needed
-            if ((lengthIn % 80) != 0)
-            {
-                return -1;
-            }
-            if (maxLen < ((lengthIn * 11) / 4))
-            {
-                return -1;
-            }
-            tmp_mem = (WebRtc_Word32*)malloc(98 * sizeof(WebRtc_Word32));
-
             for (int i = 0; i < lengthIn; i += 80)
             {
                 WebRtcSpl_Resample8khzTo22khz(samplesIn + i, samplesOut + (i * 11) / 4,
                                               (WebRtcSpl_State8khzTo22khz *)state1_,
-                                              tmp_mem);
+                                              tmp_mem_);
             }
             outLen = (lengthIn * 11) / 4;
-            free(tmp_mem);
-            return 0;
+            break;
         case kResamplerMode8To11:
-            // We can only handle blocks of 160 samples
-            // Can be fixed, but I don't think it's needed
-            if ((lengthIn % 160) != 0)
-            {
-                return -1;
-            }
-            if (maxLen < ((lengthIn * 11) / 8))
-            {
-                return -1;
-            }
-            tmp_mem = (WebRtc_Word32*)malloc(88 * sizeof(WebRtc_Word32));
-
             for (int i = 0; i < lengthIn; i += 160)
             {
                 WebRtcSpl_Resample16khzTo22khz(samplesIn + i, samplesOut + (i * 11) / 8,
                                                (WebRtcSpl_State16khzTo22khz *)state1_,
-                                               tmp_mem);
+                                               tmp_mem_);
             }
             outLen = (lengthIn * 11) / 8;
-            free(tmp_mem);
-            return 0;
-
+            break;
         case kResamplerMode11To16:
-            // We can only handle blocks of 110 samples
-            if ((lengthIn % 110) != 0)
-            {
-                return -1;
-            }
-            if (maxLen < ((lengthIn * 16) / 11))
-            {
-                return -1;
-            }
-
-            tmp_mem = (WebRtc_Word32*)malloc(104 * sizeof(WebRtc_Word32));
-            tmp = (WebRtc_Word16*)malloc((sizeof(WebRtc_Word16) * lengthIn * 2));
-
-            WebRtcSpl_UpsampleBy2(samplesIn, lengthIn, tmp, (WebRtc_Word32*)state1_);
+            WebRtcSpl_UpsampleBy2(samplesIn, lengthIn, tmp_buffer_, (WebRtc_Word32*)state1_);
 
             for (int i = 0; i < (lengthIn * 2); i += 220)
             {
-                WebRtcSpl_Resample22khzTo16khz(tmp + i, samplesOut + (i / 220) * 160,
+                WebRtcSpl_Resample22khzTo16khz(tmp_buffer_ + i, samplesOut + (i / 220) * 160,
                                                (WebRtcSpl_State22khzTo16khz *)state2_,
-                                               tmp_mem);
+                                               tmp_mem_);
             }
 
             outLen = (lengthIn * 16) / 11;
-
-            free(tmp_mem);
-            free(tmp);
-            return 0;
-
+            break;
         case kResamplerMode11To32:
-
-            // We can only handle blocks of 110 samples
-            if ((lengthIn % 110) != 0)
-            {
-                return -1;
-            }
-            if (maxLen < ((lengthIn * 32) / 11))
-            {
-                return -1;
-            }
-
-            tmp_mem = (WebRtc_Word32*)malloc(104 * sizeof(WebRtc_Word32));
-            tmp = (WebRtc_Word16*)malloc((sizeof(WebRtc_Word16) * lengthIn * 2));
-
             // 11 -> 22 kHz in samplesOut
             WebRtcSpl_UpsampleBy2(samplesIn, lengthIn, samplesOut, (WebRtc_Word32*)state1_);
 
             // 22 -> 16 in tmp
             for (int i = 0; i < (lengthIn * 2); i += 220)
             {
-                WebRtcSpl_Resample22khzTo16khz(samplesOut + i, tmp + (i / 220) * 160,
+                WebRtcSpl_Resample22khzTo16khz(samplesOut + i, tmp_buffer_ + (i / 220) * 160,
                                                (WebRtcSpl_State22khzTo16khz *)state2_,
-                                               tmp_mem);
+                                               tmp_mem_);
             }
 
             // 16 -> 32 in samplesOut
-            WebRtcSpl_UpsampleBy2(tmp, (lengthIn * 16) / 11, samplesOut,
+            WebRtcSpl_UpsampleBy2(tmp_buffer_, (lengthIn * 16) / 11, samplesOut,
                                   (WebRtc_Word32*)state3_);
 
             outLen = (lengthIn * 32) / 11;
-
-            free(tmp_mem);
-            free(tmp);
-            return 0;
-
+            break;
         case kResamplerMode2To1:
-            if (maxLen < (lengthIn / 2))
-            {
-                return -1;
-            }
             WebRtcSpl_DownsampleBy2(samplesIn, lengthIn, samplesOut, (WebRtc_Word32*)state1_);
             outLen = lengthIn / 2;
-            return 0;
+            break;
         case kResamplerMode3To1:
-            // We can only handle blocks of 480 samples
-            // Can be fixed, but I don't think it's needed
-            if ((lengthIn % 480) != 0)
-            {
-                return -1;
-            }
-            if (maxLen < (lengthIn / 3))
-            {
-                return -1;
-            }
-            tmp_mem = (WebRtc_Word32*)malloc(496 * sizeof(WebRtc_Word32));
-
             for (int i = 0; i < lengthIn; i += 480)
             {
                 WebRtcSpl_Resample48khzTo16khz(samplesIn + i, samplesOut + i / 3,
                                                (WebRtcSpl_State48khzTo16khz *)state1_,
-                                               tmp_mem);
+                                               tmp_mem_);
             }
             outLen = lengthIn / 3;
-            free(tmp_mem);
-            return 0;
+            break;
         case kResamplerMode4To1:
-            if (maxLen < (lengthIn / 4))
-            {
-                return -1;
-            }
-            tmp = (WebRtc_Word16*)malloc(sizeof(WebRtc_Word16) * lengthIn / 2);
             // 4:2
-            WebRtcSpl_DownsampleBy2(samplesIn, lengthIn, tmp, (WebRtc_Word32*)state1_);
+            WebRtcSpl_DownsampleBy2(samplesIn, lengthIn, tmp_buffer_, (WebRtc_Word32*)state1_);
             // 2:1
-            WebRtcSpl_DownsampleBy2(tmp, lengthIn / 2, samplesOut, (WebRtc_Word32*)state2_);
+            WebRtcSpl_DownsampleBy2(tmp_buffer_, lengthIn / 2, samplesOut,
+                                    (WebRtc_Word32*)state2_);
             outLen = lengthIn / 4;
-            free(tmp);
-            return 0;
-
+            break;
         case kResamplerMode6To1:
-            // We can only handle blocks of 480 samples
-            // Can be fixed, but I don't think it's needed
-            if ((lengthIn % 480) != 0)
-            {
-                return -1;
-            }
-            if (maxLen < (lengthIn / 6))
-            {
-                return -1;
-            }
-
-            tmp_mem = (WebRtc_Word32*)malloc(496 * sizeof(WebRtc_Word32));
-            tmp = (WebRtc_Word16*)malloc((sizeof(WebRtc_Word16) * lengthIn) / 3);
-
             for (int i = 0; i < lengthIn; i += 480)
             {
-                WebRtcSpl_Resample48khzTo16khz(samplesIn + i, tmp + i / 3,
+                WebRtcSpl_Resample48khzTo16khz(samplesIn + i, tmp_buffer_ + i / 3,
                                                (WebRtcSpl_State48khzTo16khz *)state1_,
-                                               tmp_mem);
+                                               tmp_mem_);
             }
             outLen = lengthIn / 3;
-            free(tmp_mem);
-            WebRtcSpl_DownsampleBy2(tmp, outLen, samplesOut, (WebRtc_Word32*)state2_);
-            free(tmp);
+            WebRtcSpl_DownsampleBy2(tmp_buffer_, outLen, samplesOut, (WebRtc_Word32*)state2_);
             outLen = outLen / 2;
-            return 0;
+            break;
         case kResamplerMode3To2:
-            if (maxLen < (lengthIn * 2 / 3))
-            {
-                return -1;
-            }
             // 3:6
-            tmp = static_cast<WebRtc_Word16*> (malloc(sizeof(WebRtc_Word16) * lengthIn * 2));
-            WebRtcSpl_UpsampleBy2(samplesIn, lengthIn, tmp, (WebRtc_Word32*)state1_);
+            WebRtcSpl_UpsampleBy2(samplesIn, lengthIn, tmp_buffer_, (WebRtc_Word32*)state1_);
             lengthIn *= 2;
             // 6:2
-            // We can only handle blocks of 480 samples
-            // Can be fixed, but I don't think it's needed
-            if ((lengthIn % 480) != 0)
-            {
-                free(tmp);
-                return -1;
-            }
-            tmp_mem = (WebRtc_Word32*)malloc(496 * sizeof(WebRtc_Word32));
             for (int i = 0; i < lengthIn; i += 480)
             {
-                WebRtcSpl_Resample48khzTo16khz(tmp + i, samplesOut + i / 3,
+                WebRtcSpl_Resample48khzTo16khz(tmp_buffer_ + i, samplesOut + i / 3,
                                                (WebRtcSpl_State48khzTo16khz *)state2_,
-                                               tmp_mem);
+                                               tmp_mem_);
             }
             outLen = lengthIn / 3;
-            free(tmp);
-            free(tmp_mem);
-            return 0;
+            break;
         case kResamplerMode11To2:
-            // We can only handle blocks of 220 samples
-            // Can be fixed, but I don't think it's needed
-            if ((lengthIn % 220) != 0)
-            {
-                return -1;
-            }
-            if (maxLen < ((lengthIn * 2) / 11))
-            {
-                return -1;
-            }
-            tmp_mem = (WebRtc_Word32*)malloc(126 * sizeof(WebRtc_Word32));
-            tmp = (WebRtc_Word16*)malloc((lengthIn * 4) / 11 * sizeof(WebRtc_Word16));
-
             for (int i = 0; i < lengthIn; i += 220)
             {
-                WebRtcSpl_Resample22khzTo8khz(samplesIn + i, tmp + (i * 4) / 11,
+                WebRtcSpl_Resample22khzTo8khz(samplesIn + i, tmp_buffer_ + (i * 4) / 11,
                                               (WebRtcSpl_State22khzTo8khz *)state1_,
-                                              tmp_mem);
+                                              tmp_mem_);
             }
             lengthIn = (lengthIn * 4) / 11;
 
-            WebRtcSpl_DownsampleBy2(tmp, lengthIn, samplesOut, (WebRtc_Word32*)state2_);
+            WebRtcSpl_DownsampleBy2(tmp_buffer_, lengthIn, samplesOut, (WebRtc_Word32*)state2_);
             outLen = lengthIn / 2;
-
-            free(tmp_mem);
-            free(tmp);
-            return 0;
+            break;
         case kResamplerMode11To4:
-            // We can only handle blocks of 220 samples
-            // Can be fixed, but I don't think it's needed
-            if ((lengthIn % 220) != 0)
-            {
-                return -1;
-            }
-            if (maxLen < ((lengthIn * 4) / 11))
-            {
-                return -1;
-            }
-            tmp_mem = (WebRtc_Word32*)malloc(126 * sizeof(WebRtc_Word32));
-
             for (int i = 0; i < lengthIn; i += 220)
             {
                 WebRtcSpl_Resample22khzTo8khz(samplesIn + i, samplesOut + (i * 4) / 11,
                                               (WebRtcSpl_State22khzTo8khz *)state1_,
-                                              tmp_mem);
+                                              tmp_mem_);
             }
             outLen = (lengthIn * 4) / 11;
-            free(tmp_mem);
-            return 0;
+            break;
         case kResamplerMode11To8:
-            // We can only handle blocks of 160 samples
-            // Can be fixed, but I don't think it's needed
-            if ((lengthIn % 220) != 0)
-            {
-                return -1;
-            }
-            if (maxLen < ((lengthIn * 8) / 11))
-            {
-                return -1;
-            }
-            tmp_mem = (WebRtc_Word32*)malloc(104 * sizeof(WebRtc_Word32));
-
             for (int i = 0; i < lengthIn; i += 220)
             {
                 WebRtcSpl_Resample22khzTo16khz(samplesIn + i, samplesOut + (i * 8) / 11,
                                                (WebRtcSpl_State22khzTo16khz *)state1_,
-                                               tmp_mem);
+                                               tmp_mem_);
             }
             outLen = (lengthIn * 8) / 11;
-            free(tmp_mem);
-            return 0;
             break;
 
     }
-    return 0;
+    return outLen;
 }
 
 // Asynchronous resampling, input
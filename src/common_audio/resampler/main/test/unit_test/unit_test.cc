@@ -0,0 +1,225 @@
+/*
+ *  Copyright (c) 2011 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+
+/*
+ * This file contains the resampler unit_test.
+ *
+ */
+
+#include <string.h>
+
+#include "unit_test.h"
+#include "resampler.h"
+#include "signal_processing_library.h"
+
+using webrtc::Resampler;
+
+namespace
+{
+// 60 ms at any of the rates below, which is longer than the blocks Push()
+// works through.
+const int kFrameMs = 60;
+const int kMaxFrameLen = 48 * kFrameMs;
+const int kNumFrames = 5;
+
+// Resamples one channel the way Push() did before it processed its input in
+// fixed blocks, i.e. with each SPL routine running over the whole frame.
+class ReferenceResampler
+{
+public:
+    ReferenceResampler(int inFreq, int outFreq)
+        : in_freq_(inFreq),
+          out_freq_(outFreq)
+    {
+        memset(state1_, 0, sizeof(state1_));
+        memset(state2_, 0, sizeof(state2_));
+        WebRtcSpl_ResetResample16khzTo48khz(&state16To48_);
+        WebRtcSpl_ResetResample48khzTo16khz(&state48To16_);
+        WebRtcSpl_ResetResample8khzTo22khz(&state8To22_);
+        WebRtcSpl_ResetResample22khzTo16khz(&state22To16_);
+    }
+
+    // Returns the number of output samples, or -1 for an unsupported rate.
+    int Push(const WebRtc_Word16* in, int len, WebRtc_Word16* out)
+    {
+        int i;
+        if (in_freq_ * 2 == out_freq_)
+        {
+            WebRtcSpl_UpsampleBy2(in, len, out, state1_);
+            return len * 2;
+        } else if (in_freq_ == out_freq_ * 2)
+        {
+            WebRtcSpl_DownsampleBy2(in, len, out, state1_);
+            return len / 2;
+        } else if (in_freq_ * 4 == out_freq_)
+        {
+            WebRtcSpl_UpsampleBy2(in, len, tmp_, state1_);
+            WebRtcSpl_UpsampleBy2(tmp_, len * 2, out, state2_);
+            return len * 4;
+        } else if (in_freq_ * 3 == out_freq_)
+        {
+            for (i = 0; i < len; i += 160)
+            {
+                WebRtcSpl_Resample16khzTo48khz(in + i, out + i * 3,
+                                               &state16To48_, tmp_mem_);
+            }
+            return len * 3;
+        } else if (in_freq_ * 3 == out_freq_ * 2)
+        {
+            for (i = 0; i < len; i += 160)
+            {
+                WebRtcSpl_Resample16khzTo48khz(in + i, tmp_ + i * 3,
+                                               &state16To48_, tmp_mem_);
+            }
+            WebRtcSpl_DownsampleBy2(tmp_, len * 3, out, state2_);
+            return len * 3 / 2;
+        } else if (in_freq_ * 2 == out_freq_ * 3)
+        {
+            WebRtcSpl_UpsampleBy2(in, len, tmp_, state1_);
+            for (i = 0; i < len * 2; i += 480)
+            {
+                WebRtcSpl_Resample48khzTo16khz(tmp_ + i, out + i / 3,
+                                               &state48To16_, tmp_mem_);
+            }
+            return len * 2 / 3;
+        } else if (in_freq_ * 11 == out_freq_ * 4)
+        {
+            for (i = 0; i < len; i += 80)
+            {
+                WebRtcSpl_Resample8khzTo22khz(in + i, out + (i * 11) / 4,
+                                              &state8To22_, tmp_mem_);
+            }
+            return (len * 11) / 4;
+        } else if (in_freq_ * 16 == out_freq_ * 11)
+        {
+            WebRtcSpl_UpsampleBy2(in, len, tmp_, state1_);
+            for (i = 0; i < len * 2; i += 220)
+            {
+                WebRtcSpl_Resample22khzTo16khz(tmp_ + i, out + (i / 220) * 160,
+                                               &state22To16_, tmp_mem_);
+            }
+            return (len * 16) / 11;
+        }
+        return -1;
+    }
+
+private:
+    int in_freq_;
+    int out_freq_;
+    WebRtc_Word32 state1_[8];
+    WebRtc_Word32 state2_[8];
+    WebRtcSpl_State16khzTo48khz state16To48_;
+    WebRtcSpl_State48khzTo16khz state48To16_;
+    WebRtcSpl_State8khzTo22khz state8To22_;
+    WebRtcSpl_State22khzTo16khz state22To16_;
+    WebRtc_Word16 tmp_[3 * kMaxFrameLen];
+    WebRtc_Word32 tmp_mem_[496];
+};
+}  // namespace
+
+class ResamplerEnvironment : public ::testing::Environment {
+ public:
+  virtual void SetUp() {
+  }
+  virtual void TearDown() {
+  }
+};
+
+ResamplerTest::ResamplerTest()
+{
+}
+
+void ResamplerTest::SetUp() {
+}
+
+void ResamplerTest::TearDown() {
+}
+
+TEST_F(ResamplerTest, BlockPushTest) {
+    // Rates in Hz, covering the allpass based modes that filter stereo
+    // interleaved as well as the fractional modes that use one slave per
+    // channel.
+    const int kRates[][2] = {
+        {8000, 16000},
+        {32000, 16000},
+        {8000, 32000},
+        {16000, 48000},
+        {32000, 48000},
+        {48000, 32000},
+        {8000, 22000},
+        {11000, 16000}
+    };
+    const int kNumRates = sizeof(kRates) / sizeof(*kRates);
+    WebRtc_Word16 in[2 * kMaxFrameLen];
+    WebRtc_Word16 inLeft[kMaxFrameLen];
+    WebRtc_Word16 inRight[kMaxFrameLen];
+    WebRtc_Word16 out[2 * 4 * kMaxFrameLen];
+    WebRtc_Word16 refLeft[4 * kMaxFrameLen];
+    WebRtc_Word16 refRight[4 * kMaxFrameLen];
+    WebRtc_UWord32 seed = 12345;
+
+    for (int k = 0; k < kNumRates; ++k) {
+        const int inFreq = kRates[k][0];
+        const int outFreq = kRates[k][1];
+        const int lengthIn = inFreq / 1000 * kFrameMs;
+        for (int channels = 1; channels <= 2; ++channels) {
+            Resampler resampler(inFreq, outFreq, channels == 1 ?
+                webrtc::kResamplerSynchronous :
+                webrtc::kResamplerSynchronousStereo);
+            ReferenceResampler refLeftResampler(inFreq, outFreq);
+            ReferenceResampler refRightResampler(inFreq, outFreq);
+
+            for (int frame = 0; frame < kNumFrames; ++frame) {
+                for (int kk = 0; kk < lengthIn; ++kk) {
+                    inLeft[kk] = (WebRtc_Word16) WebRtcSpl_RandN(&seed);
+                    inRight[kk] =
+                        (WebRtc_Word16) (WebRtcSpl_RandU(&seed) * 2 - 32768);
+                    if (channels == 1) {
+                        in[kk] = inLeft[kk];
+                    } else {
+                        in[2 * kk] = inLeft[kk];
+                        in[2 * kk + 1] = inRight[kk];
+                    }
+                }
+
+                int outLen = 0;
+                ASSERT_EQ(0, resampler.Push(in, channels * lengthIn, out,
+                                            sizeof(out) / sizeof(*out),
+                                            outLen));
+                const int refLen = refLeftResampler.Push(inLeft, lengthIn,
+                                                         refLeft);
+                ASSERT_EQ(channels * refLen, outLen)
+                    << inFreq << " -> " << outFreq;
+                if (channels == 1) {
+                    ASSERT_EQ(0, memcmp(refLeft, out,
+                                        refLen * sizeof(WebRtc_Word16)))
+                        << inFreq << " -> " << outFreq << ", frame " << frame;
+                } else {
+                    refRightResampler.Push(inRight, lengthIn, refRight);
+                    for (int kk = 0; kk < refLen; ++kk) {
+                        ASSERT_EQ(refLeft[kk], out[2 * kk])
+                            << inFreq << " -> " << outFreq << ", left " << kk;
+                        ASSERT_EQ(refRight[kk], out[2 * kk + 1])
+                            << inFreq << " -> " << outFreq << ", right " << kk;
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  ResamplerEnvironment* env = new ResamplerEnvironment;
+  ::testing::AddGlobalTestEnvironment(env);
+
+  return RUN_ALL_TESTS();
+}
@@ -25,11 +25,30 @@
 #include <Armintr.h> // intrinsic file for windows mobile
 #endif
 
-#ifdef WEBRTC_ANDROID
+// Inline the basic operations where the compiler supports it, see spl_inl.h.
+#if defined(__GNUC__) || defined(_MSC_VER)
 #define WEBRTC_SPL_INLINE_CALLS
 #define SPL_NO_DOUBLE_IMPLEMENTATIONS
 #endif
 
+// ARMv6 and later, except in Thumb-1 mode and on the M profile, which lack
+// the DSP instructions. Compilers older than __ARM_ARCH only define the
+// __ARM_ARCH_<version>__ macros.
+#if defined(__GNUC__) && defined(__arm__) && \
+    (!defined(__thumb__) || defined(__thumb2__))
+#if defined(__ARM_ARCH)
+#if __ARM_ARCH >= 6 && \
+    (!defined(__ARM_ARCH_PROFILE) || __ARM_ARCH_PROFILE != 'M')
+#define WEBRTC_SPL_ARCH_ARMV6
+#endif
+#elif defined(__ARM_ARCH_6__) || defined(__ARM_ARCH_6J__) || \
+      defined(__ARM_ARCH_6K__) || defined(__ARM_ARCH_6Z__) || \
+      defined(__ARM_ARCH_6ZK__) || defined(__ARM_ARCH_6T2__) || \
+      defined(__ARM_ARCH_7A__) || defined(__ARM_ARCH_7R__)
+#define WEBRTC_SPL_ARCH_ARMV6
+#endif
+#endif
+
 // Macros specific for the fixed point implementation
 #define WEBRTC_SPL_WORD16_MAX       32767
 #define WEBRTC_SPL_WORD16_MIN       -32768
@@ -65,10 +84,8 @@
       ((val) << (8 * ((index) & 0x1)))
 #endif
 
-#ifndef WEBRTC_ANDROID
 #define WEBRTC_SPL_MUL(a, b)                                    \
   ((WebRtc_Word32) ((WebRtc_Word32)(a) * (WebRtc_Word32)(b)))
-#endif
 
 #define WEBRTC_SPL_UMUL(a, b)                                           \
   ((WebRtc_UWord32) ((WebRtc_UWord32)(a) * (WebRtc_UWord32)(b)))
@@ -99,7 +116,8 @@
   ((WEBRTC_SPL_MUL_16_16(a, (b) >> 16) << 1)                            \
    + (((WEBRTC_SPL_MUL_16_U16(a, (WebRtc_UWord16)(b)) >> 1) + 0x2000) >> 14))
 
-#ifndef WEBRTC_ANDROID
+// On ARMv6 these are the smulwb, pkhbt and smmul instructions in spl_inl.h.
+#if !defined(WEBRTC_SPL_ARCH_ARMV6) || !defined(WEBRTC_SPL_INLINE_CALLS)
 #define WEBRTC_SPL_MUL_16_32_RSFT16(a, b)                               \
   (WEBRTC_SPL_MUL_16_16(a, b >> 16)                                     \
    + ((WEBRTC_SPL_MUL_16_16(a, (b & 0xffff) >> 1) + 0x4000) >> 15))
@@ -116,7 +134,7 @@
 #ifdef ARM_WINM
 #define WEBRTC_SPL_MUL_16_16(a, b)                      \
   _SmulLo_SW_SL((WebRtc_Word16)(a), (WebRtc_Word16)(b))
-#elif !defined (WEBRTC_ANDROID)
+#elif !defined(WEBRTC_SPL_ARCH_ARMV6) || !defined(WEBRTC_SPL_INLINE_CALLS)
 #define WEBRTC_SPL_MUL_16_16(a, b)                                      \
     ((WebRtc_Word32) (((WebRtc_Word16)(a)) * ((WebRtc_Word16)(b))))
 #endif
@@ -375,6 +393,10 @@ WebRtc_Word16 WebRtcSpl_RandN(WebRtc_UWord32* seed);
 WebRtc_Word16 WebRtcSpl_RandUArray(WebRtc_Word16* vector,
                                    WebRtc_Word16 vector_length,
                                    WebRtc_UWord32* seed);
+void WebRtcSpl_RandPhaseQ13(WebRtc_Word16* cos_vector,
+                            WebRtc_Word16* sin_vector,
+                            WebRtc_Word16 vector_length,
+                            WebRtc_UWord32* seed);
 // End: Randomization functions.
 
 // Math functions
@@ -426,6 +448,17 @@ int WebRtcSpl_DownsampleFast(WebRtc_Word16* in_vector,
                              WebRtc_Word16 ma_coef_length,
                              WebRtc_Word16 factor,
                              WebRtc_Word16 delay);
+void WebRtcSpl_BiquadFilterQ12(const WebRtc_Word16* in_vector,
+                               WebRtc_Word16* out_vector,
+                               int vector_length,
+                               const WebRtc_Word16* coefficients,
+                               int num_sections,
+                               WebRtc_Word16* state);
+void WebRtcSpl_BiquadFeedbackQ12(const WebRtc_Word16* coefficients,
+                                 WebRtc_Word16* state,
+                                 const WebRtc_Word32* feedforward,
+                                 WebRtc_Word16* out_vector,
+                                 int vector_length);
 // End: Filter operations.
 
 // FFT operations
@@ -614,6 +647,14 @@ void WebRtcSpl_DownsampleBy2(const WebRtc_Word16* in, const WebRtc_Word16 len,
 void WebRtcSpl_UpsampleBy2(const WebRtc_Word16* in, WebRtc_Word16 len, WebRtc_Word16* out,
                            WebRtc_Word32* filtState);
 
+// Interleaved stereo versions. |len| is the number of samples per channel and
+// |filtState| holds 16 words (the two mono states, interleaved).
+void WebRtcSpl_DownsampleBy2Stereo(const WebRtc_Word16* in, const WebRtc_Word16 len,
+                                   WebRtc_Word16* out, WebRtc_Word32* filtState);
+
+void WebRtcSpl_UpsampleBy2Stereo(const WebRtc_Word16* in, WebRtc_Word16 len,
+                                 WebRtc_Word16* out, WebRtc_Word32* filtState);
+
 /************************************************************
  * END OF RESAMPLING FUNCTIONS
  ************************************************************/
@@ -622,6 +663,13 @@ void WebRtcSpl_AnalysisQMF(const WebRtc_Word16* in_data,
                            WebRtc_Word16* high_band,
                            WebRtc_Word32* filter_state1,
                            WebRtc_Word32* filter_state2);
+void WebRtcSpl_AnalysisQMFBiquadQ12(const WebRtc_Word16* in_data,
+                                    WebRtc_Word16* low_band,
+                                    WebRtc_Word16* high_band,
+                                    WebRtc_Word32* filter_state1,
+                                    WebRtc_Word32* filter_state2,
+                                    const WebRtc_Word16* biquad_coefficients,
+                                    WebRtc_Word16* biquad_state);
 void WebRtcSpl_SynthesisQMF(const WebRtc_Word16* low_band,
                             const WebRtc_Word16* high_band,
                             WebRtc_Word16* out_data,
@@ -1298,6 +1346,23 @@ void WebRtcSpl_SynthesisQMF(const WebRtc_Word16* low_band,
 // Return value         : Number of samples in vector, i.e., |vector_length|
 //
 
+//
+// WebRtcSpl_RandPhaseQ13(...)
+//
+// Produces the cosine and sine of uniformly distributed random angles, looked
+// up in WebRtcSpl_kCosTable[] and WebRtcSpl_kSinTable[] at a resolution of one
+// degree. Used for the phase of comfort noise.
+//
+// Input:
+//      - vector_length : Number of angles wanted
+//      - seed          : Seed for random calculation
+//
+// Output:
+//      - cos_vector    : Cosine of the angles in Q13
+//      - sin_vector    : Sine of the angles in Q13
+//      - seed          : Updated seed value
+//
+
 //
 // WebRtcSpl_Sqrt(...)
 //
@@ -1513,6 +1578,51 @@ void WebRtcSpl_SynthesisQMF(const WebRtc_Word16* low_band,
 // Return value             : 0 if OK, -1 if |in_vector| is too short
 //
 
+//
+// WebRtcSpl_BiquadFilterQ12(...)
+//
+// Filters a vector through a cascade of biquad (second order IIR) sections,
+//   y[i] = b[0] * x[i] + b[1] * x[i-1] + b[2] * x[i-2]
+//          + -a[1] * y[i-1] + -a[2] * y[i-2],
+// with the output of each section kept in double precision (high and low
+// parts) in the state. The feedforward part of each section is computed in a
+// separate pass without dependencies between samples. May be done in place.
+//
+// Input:
+//      - in_vector         : Input samples
+//      - vector_length     : Number of samples to be filtered
+//      - coefficients      : {b[0], b[1], b[2], -a[1], -a[2]} (in Q12) for
+//                            each section
+//      - num_sections      : Number of sections
+//
+// Input & Output:
+//      - state             : Filter state, 6 words per section: the high and
+//                            low parts of y[i-1] and y[i-2], x[i-1] and x[i-2]
+//
+// Output:
+//      - out_vector        : Filtered samples
+//
+
+//
+// WebRtcSpl_BiquadFeedbackQ12(...)
+//
+// The recursive part of a WebRtcSpl_BiquadFilterQ12() section, for callers
+// which compute the feedforward part themselves, for instance while producing
+// the input as WebRtcSpl_AnalysisQMFBiquadQ12() does.
+//
+// Input:
+//      - coefficients      : Coefficients of the section
+//      - feedforward       : b[0] * x[i] + b[1] * x[i-1] + b[2] * x[i-2]
+//                            (in Q12)
+//      - vector_length     : Number of samples to be filtered
+//
+// Input & Output:
+//      - state             : The high and low parts of y[i-1] and y[i-2]
+//
+// Output:
+//      - out_vector        : Filtered samples
+//
+
 //
 // WebRtcSpl_DotProductWithScale(...)
 //
@@ -1738,6 +1848,19 @@ void WebRtcSpl_SynthesisQMF(const WebRtc_Word16* low_band,
 //                        domain), 160 samples (10 ms)
 //
 
+//
+// WebRtcSpl_AnalysisQMFBiquadQ12(...)
+//
+// As WebRtcSpl_AnalysisQMF(), but also filters the lower band through one
+// WebRtcSpl_BiquadFilterQ12() section in the same pass.
+//
+// Input:
+//      - biquad_coefficients : Coefficients of the section
+//
+// Input & Output:
+//      - biquad_state        : State of the section
+//
+
 //
 // WebRtcSpl_SynthesisQMF(...)
 //
@@ -11,27 +11,57 @@
 
 // This header file includes the inline functions in
 // the fix point signal processing library.
+//
+// The backend is chosen at compile time:
+//  - WEBRTC_SPL_ARCH_ARMV6: ARMv6 and later in ARM or Thumb-2 mode use the
+//    qadd/qsub, ssat, smulbb, smulwb and smmul instructions. The 16 x 32 bit
+//    and 32 x 32 bit multiplications truncate where the C macros round the
+//    low part, as in the original ARM build.
+//  - Count leading zeros uses __builtin_clz() with GCC, which is the clz
+//    instruction on ARMv5 and later, and _BitScanReverse() with MSVC.
+//  - Otherwise plain C.
+// Otherwise all backends are bit-exact with the reference implementations in
+// add_sat_w16.c, norm_w32.c etc.
 
 #ifndef WEBRTC_SPL_SPL_INL_H_
 #define WEBRTC_SPL_SPL_INL_H_
 
 #ifdef WEBRTC_SPL_INLINE_CALLS
 
-#ifdef WEBRTC_ANDROID
+#if defined(_MSC_VER)
+#include <intrin.h>
+#pragma intrinsic(_BitScanReverse)
+#endif
 
-__asm (
-   // On Android gcc compiler, the clz instruction is not supported with a
-   // target smaller than armv7, despite it being legal for armv5+.
-"   .arch armv7-a\n"
-//"   clz     %0, %1  \n"
-//"=r"    (leading_zeroes)
-//"r"     (data)
-);
+// Number of leading zeros of |n|, which must be non-zero.
+WEBRTC_INLINE int WebRtcSpl_CountLeadingZeros32(WebRtc_UWord32 n)
+{
+#if defined(__GNUC__)
+    return __builtin_clz(n);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, n);
+    return 31 - (int)index;
+#else
+    int zeros;
+
+    if (!(0xFFFF0000 & n)) zeros = 16; else zeros = 0;
+    if (!(0xFF000000 & (n << zeros))) zeros += 8;
+    if (!(0xF0000000 & (n << zeros))) zeros += 4;
+    if (!(0xC0000000 & (n << zeros))) zeros += 2;
+    if (!(0x80000000 & (n << zeros))) zeros += 1;
+
+    return zeros;
+#endif
+}
+
+#ifdef WEBRTC_SPL_ARCH_ARMV6
 
-WEBRTC_INLINE WebRtc_Word32 WEBRTC_SPL_MUL(WebRtc_Word32 a, WebRtc_Word32 b)
+WEBRTC_INLINE WebRtc_Word32 WEBRTC_SPL_MUL_16_16(WebRtc_Word16 a,
+                                                 WebRtc_Word16 b)
 {
     WebRtc_Word32 tmp;
-    __asm__("smmul %0, %1, %2":"=r"(tmp):"r"(a), "r"(b)); //changed mul to smmul.
+    __asm__("smulbb %0, %1, %2":"=r"(tmp):"r"(a), "r"(b));
     return tmp;
 }
 
@@ -44,8 +74,8 @@ WEBRTC_INLINE WebRtc_Word32 WEBRTC_SPL_MUL_16_32_RSFT16(WebRtc_Word16 a,
 }
 
 WEBRTC_INLINE WebRtc_Word32 WEBRTC_SPL_MUL_32_32_RSFT32(WebRtc_Word16 a,
-                                                      WebRtc_Word16 b,
-                                                      WebRtc_Word32 c)
+                                                        WebRtc_Word16 b,
+                                                        WebRtc_Word32 c)
 {
     WebRtc_Word32 tmp;
     __asm__("pkhbt %0, %1, %2, lsl #16" : "=r"(tmp) : "r"(b), "r"(a));
@@ -53,29 +83,20 @@ WEBRTC_INLINE WebRtc_Word32 WEBRTC_SPL_MUL_32_32_RSFT32(WebRtc_Word16 a,
     return tmp;
 }
 
-WEBRTC_INLINE WebRtc_Word32 WEBRTC_SPL_MUL_32_32_RSFT32BI(
-        WebRtc_Word32 a,
-        WebRtc_Word32 b)
+WEBRTC_INLINE WebRtc_Word32 WEBRTC_SPL_MUL_32_32_RSFT32BI(WebRtc_Word32 a,
+                                                          WebRtc_Word32 b)
 {
     WebRtc_Word32 tmp;
     __asm__("smmul %0, %1, %2":"=r"(tmp):"r"(a), "r"(b));
     return tmp;
 }
 
-WEBRTC_INLINE WebRtc_Word32 WEBRTC_SPL_MUL_16_16(WebRtc_Word16 a,
-                                                 WebRtc_Word16 b)
-{
-    WebRtc_Word32 tmp;
-    __asm__("smulbb %0, %1, %2":"=r"(tmp):"r"(a), "r"(b));
-    return tmp;
-}
-
 WEBRTC_INLINE WebRtc_Word16 WebRtcSpl_AddSatW16(WebRtc_Word16 a,
                                                 WebRtc_Word16 b)
 {
     WebRtc_Word32 s_sum;
 
-    __asm__("qadd %0, %1, %2":"=r"(s_sum):"r"(a), "r"(b));
+    __asm__("ssat %0, #16, %1":"=r"(s_sum):"r"((WebRtc_Word32)a + b));
 
     return (WebRtc_Word16) s_sum;
 }
@@ -95,7 +116,7 @@ WEBRTC_INLINE WebRtc_Word16 WebRtcSpl_SubSatW16(WebRtc_Word16 var1,
 {
     WebRtc_Word32 s_sub;
 
-    __asm__("qsub %0, %1, %2":"=r"(s_sub):"r"(var1), "r"(var2));
+    __asm__("ssat %0, #16, %1":"=r"(s_sub):"r"((WebRtc_Word32)var1 - var2));
 
     return (WebRtc_Word16)s_sub;
 }
@@ -110,51 +131,6 @@ WEBRTC_INLINE WebRtc_Word32 WebRtcSpl_SubSatW32(WebRtc_Word32 l_var1,
     return l_sub;
 }
 
-WEBRTC_INLINE WebRtc_Word16 WebRtcSpl_GetSizeInBits(WebRtc_UWord32 n)
-{
-    WebRtc_Word32 tmp;
-
-    __asm__("clz %0, %1":"=r"(tmp):"r"(n));
-
-    return (WebRtc_Word16)(32 - tmp);
-}
-
-WEBRTC_INLINE int WebRtcSpl_NormW32(WebRtc_Word32 a)
-{
-    WebRtc_Word32 tmp;
-
-    if (a <= 0) a ^= 0xFFFFFFFF;
-
-    __asm__("clz %0, %1":"=r"(tmp):"r"(a));
-
-    return tmp - 1;
-}
-
-WEBRTC_INLINE int WebRtcSpl_NormW16(WebRtc_Word16 a)
-{
-    int zeros;
-
-    if (a <= 0) a ^= 0xFFFF;
-
-    if (!(0xFF80 & a)) zeros = 8; else zeros = 0;
-    if (!(0xF800 & (a << zeros))) zeros += 4;
-    if (!(0xE000 & (a << zeros))) zeros += 2;
-    if (!(0xC000 & (a << zeros))) zeros += 1;
-
-    return zeros;
-}
-
-WEBRTC_INLINE int WebRtcSpl_NormU32(WebRtc_UWord32 a)
-{
-    int tmp;
-
-    if (a == 0) return 0;
-
-    __asm__("clz %0, %1":"=r"(tmp):"r"(a));
-
-    return tmp;
-}
-
 #else
 
 WEBRTC_INLINE WebRtc_Word16 WebRtcSpl_AddSatW16(WebRtc_Word16 a,
@@ -173,131 +149,80 @@ WEBRTC_INLINE WebRtc_Word16 WebRtcSpl_AddSatW16(WebRtc_Word16 a,
 WEBRTC_INLINE WebRtc_Word32 WebRtcSpl_AddSatW32(WebRtc_Word32 l_var1,
                                                 WebRtc_Word32 l_var2)
 {
-    WebRtc_Word32 l_sum;
+    // Compiles to a compare and conditional moves on x86.
+    WebRtc_Word64 l_sum = (WebRtc_Word64)l_var1 + l_var2;
 
-    // perform long addition
-    l_sum = l_var1 + l_var2;
-
-    // check for under or overflow
-    if (WEBRTC_SPL_IS_NEG (l_var1))
-    {
-        if (WEBRTC_SPL_IS_NEG (l_var2) && !WEBRTC_SPL_IS_NEG (l_sum))
-        {
-            l_sum = (WebRtc_Word32)0x80000000;
-        }
-    }
-    else
-    {
-        if (!WEBRTC_SPL_IS_NEG (l_var2) && WEBRTC_SPL_IS_NEG (l_sum))
-        {
-            l_sum = (WebRtc_Word32)0x7FFFFFFF;
-        }
-    }
+    if (l_sum > WEBRTC_SPL_WORD32_MAX)
+    l_sum = WEBRTC_SPL_WORD32_MAX;
+    else if (l_sum < WEBRTC_SPL_WORD32_MIN)
+    l_sum = WEBRTC_SPL_WORD32_MIN;
 
-    return l_sum;
+    return (WebRtc_Word32)l_sum;
 }
 
 WEBRTC_INLINE WebRtc_Word16 WebRtcSpl_SubSatW16( WebRtc_Word16 var1,
                                                  WebRtc_Word16 var2)
 {
-    WebRtc_Word32 l_diff;
-    WebRtc_Word16 s_diff;
-
-    // perform subtraction
-    l_diff = (WebRtc_Word32)var1 - (WebRtc_Word32)var2;
-
-    // default setting
-    s_diff = (WebRtc_Word16) l_diff;
+    WebRtc_Word32 l_diff = (WebRtc_Word32)var1 - (WebRtc_Word32)var2;
 
-    // check for overflow
-    if (l_diff > (WebRtc_Word32)32767)
-    s_diff = (WebRtc_Word16)32767;
+    if (l_diff > WEBRTC_SPL_WORD16_MAX)
+    l_diff = WEBRTC_SPL_WORD16_MAX;
+    else if (l_diff < WEBRTC_SPL_WORD16_MIN)
+    l_diff = WEBRTC_SPL_WORD16_MIN;
 
-    // check for underflow
-    if (l_diff < (WebRtc_Word32)-32768)
-    s_diff = (WebRtc_Word16)-32768;
-
-    return s_diff;
+    return (WebRtc_Word16)l_diff;
 }
 
 WEBRTC_INLINE WebRtc_Word32 WebRtcSpl_SubSatW32(WebRtc_Word32 l_var1,
                                                 WebRtc_Word32 l_var2)
 {
-    WebRtc_Word32 l_diff;
-
-    // perform subtraction
-    l_diff = l_var1 - l_var2;
+    WebRtc_Word64 l_diff = (WebRtc_Word64)l_var1 - l_var2;
 
-    // check for underflow
-    if ((l_var1 < 0) && (l_var2 > 0) && (l_diff > 0))
-    l_diff = (WebRtc_Word32)0x80000000;
-    // check for overflow
-    if ((l_var1 > 0) && (l_var2 < 0) && (l_diff < 0))
-    l_diff = (WebRtc_Word32)0x7FFFFFFF;
+    if (l_diff > WEBRTC_SPL_WORD32_MAX)
+    l_diff = WEBRTC_SPL_WORD32_MAX;
+    else if (l_diff < WEBRTC_SPL_WORD32_MIN)
+    l_diff = WEBRTC_SPL_WORD32_MIN;
 
-    return l_diff;
+    return (WebRtc_Word32)l_diff;
 }
 
+#endif // WEBRTC_SPL_ARCH_ARMV6
+
 WEBRTC_INLINE WebRtc_Word16 WebRtcSpl_GetSizeInBits(WebRtc_UWord32 n)
 {
+    if (n == 0) return 0;
 
-    int bits;
-
-    if ((0xFFFF0000 & n)) bits = 16; else bits = 0;
-    if ((0x0000FF00 & (n >> bits))) bits += 8;
-    if ((0x000000F0 & (n >> bits))) bits += 4;
-    if ((0x0000000C & (n >> bits))) bits += 2;
-    if ((0x00000002 & (n >> bits))) bits += 1;
-    if ((0x00000001 & (n >> bits))) bits += 1;
-
-    return bits;
+    return (WebRtc_Word16)(32 - WebRtcSpl_CountLeadingZeros32(n));
 }
 
 WEBRTC_INLINE int WebRtcSpl_NormW32(WebRtc_Word32 a)
 {
-    int zeros;
-
-    if (a <= 0) a ^= 0xFFFFFFFF;
-
-    if (!(0xFFFF8000 & a)) zeros = 16; else zeros = 0;
-    if (!(0xFF800000 & (a << zeros))) zeros += 8;
-    if (!(0xF8000000 & (a << zeros))) zeros += 4;
-    if (!(0xE0000000 & (a << zeros))) zeros += 2;
-    if (!(0xC0000000 & (a << zeros))) zeros += 1;
+    if (a == 0) return 0;
+    if (a < 0) a = ~a;
+    // |a| was -1.
+    if (a == 0) return 31;
 
-    return zeros;
+    return WebRtcSpl_CountLeadingZeros32((WebRtc_UWord32)a) - 1;
 }
 
 WEBRTC_INLINE int WebRtcSpl_NormW16(WebRtc_Word16 a)
 {
-    int zeros;
-
-    if (a <= 0) a ^= 0xFFFF;
+    WebRtc_Word32 a32 = a;
 
-    if (!(0xFF80 & a)) zeros = 8; else zeros = 0;
-    if (!(0xF800 & (a << zeros))) zeros += 4;
-    if (!(0xE000 & (a << zeros))) zeros += 2;
-    if (!(0xC000 & (a << zeros))) zeros += 1;
+    if (a32 == 0) return 0;
+    if (a32 < 0) a32 = ~a32;
+    // |a| was -1.
+    if (a32 == 0) return 15;
 
-    return zeros;
+    return WebRtcSpl_CountLeadingZeros32((WebRtc_UWord32)a32) - 17;
 }
 
 WEBRTC_INLINE int WebRtcSpl_NormU32(WebRtc_UWord32 a)
 {
-    int zeros;
-
     if (a == 0) return 0;
 
-    if (!(0xFFFF0000 & a)) zeros = 16; else zeros = 0;
-    if (!(0xFF000000 & (a << zeros))) zeros += 8;
-    if (!(0xF0000000 & (a << zeros))) zeros += 4;
-    if (!(0xC0000000 & (a << zeros))) zeros += 2;
-    if (!(0x80000000 & (a << zeros))) zeros += 1;
-
-    return zeros;
+    return WebRtcSpl_CountLeadingZeros32(a);
 }
 
-#endif // WEBRTC_ANDROID
 #endif // WEBRTC_SPL_INLINE_CALLS
 #endif // WEBRTC_SPL_SPL_INL_H_
-
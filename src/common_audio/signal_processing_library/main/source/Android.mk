@@ -19,6 +19,7 @@ LOCAL_SRC_FILES := add_sat_w16.c \
     add_sat_w32.c \
     auto_corr_to_refl_coef.c \
     auto_correlation.c \
+    biquad_filter.c \
     complex_fft.c \
     complex_ifft.c \
     complex_bit_reverse.c \
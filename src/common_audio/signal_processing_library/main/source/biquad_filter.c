@@ -0,0 +1,136 @@
+/*
+ *  Copyright (c) 2011 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+
+/*
+ * This file contains the functions WebRtcSpl_BiquadFilterQ12() and
+ * WebRtcSpl_BiquadFeedbackQ12().
+ * The description headers can be found in signal_processing_library.h
+ *
+ */
+
+#include "signal_processing_library.h"
+
+// Number of samples filtered per pass. Longer vectors are split into blocks.
+enum
+{
+    kBiquadBlockLength = 160
+};
+
+// Computes the feedforward part b[0] * x[i] + b[1] * x[i-1] + b[2] * x[i-2]
+// of one section into |out|, and updates the input state |x_state|. Apart from
+// the first two samples, the loop has no dependencies between iterations.
+static void WebRtcSpl_BiquadFeedforwardQ12(const WebRtc_Word16* coefficients,
+                                           WebRtc_Word16* x_state,
+                                           const WebRtc_Word16* in,
+                                           WebRtc_Word32* out, int length)
+{
+    const WebRtc_Word16 b0 = coefficients[0];
+    const WebRtc_Word16 b1 = coefficients[1];
+    const WebRtc_Word16 b2 = coefficients[2];
+    int i;
+
+    out[0] = WEBRTC_SPL_MUL_16_16(in[0], b0) + WEBRTC_SPL_MUL_16_16(x_state[0], b1)
+            + WEBRTC_SPL_MUL_16_16(x_state[1], b2);
+    if (length == 1)
+    {
+        x_state[1] = x_state[0];
+        x_state[0] = in[0];
+        return;
+    }
+    out[1] = WEBRTC_SPL_MUL_16_16(in[1], b0) + WEBRTC_SPL_MUL_16_16(in[0], b1)
+            + WEBRTC_SPL_MUL_16_16(x_state[0], b2);
+    for (i = 2; i < length; i++)
+    {
+        out[i] = WEBRTC_SPL_MUL_16_16(in[i], b0) + WEBRTC_SPL_MUL_16_16(in[i - 1], b1)
+                + WEBRTC_SPL_MUL_16_16(in[i - 2], b2);
+    }
+
+    x_state[0] = in[length - 1];
+    x_state[1] = in[length - 2];
+}
+
+void WebRtcSpl_BiquadFeedbackQ12(const WebRtc_Word16* coefficients,
+                                 WebRtc_Word16* state,
+                                 const WebRtc_Word32* feedforward,
+                                 WebRtc_Word16* out_vector,
+                                 int vector_length)
+{
+    const WebRtc_Word16 a1 = coefficients[3];
+    const WebRtc_Word16 a2 = coefficients[4];
+    // High and low parts of y[i-1] and y[i-2].
+    WebRtc_Word16 y1_hi = state[0];
+    WebRtc_Word16 y1_lo = state[1];
+    WebRtc_Word16 y2_hi = state[2];
+    WebRtc_Word16 y2_lo = state[3];
+    WebRtc_Word32 tmp;
+    int i;
+
+    for (i = 0; i < vector_length; i++)
+    {
+        tmp = WEBRTC_SPL_MUL_16_16(y1_lo, a1); // -a[1] * y[i-1] (low part)
+        tmp += WEBRTC_SPL_MUL_16_16(y2_lo, a2); // -a[2] * y[i-2] (low part)
+        tmp = (tmp >> 15);
+        tmp += WEBRTC_SPL_MUL_16_16(y1_hi, a1); // -a[1] * y[i-1] (high part)
+        tmp += WEBRTC_SPL_MUL_16_16(y2_hi, a2); // -a[2] * y[i-2] (high part)
+        tmp = (tmp << 1);
+
+        tmp += feedforward[i];
+
+        // Update state (filtered part)
+        y2_hi = y1_hi;
+        y2_lo = y1_lo;
+        y1_hi = (WebRtc_Word16)(tmp >> 13);
+        y1_lo = (WebRtc_Word16)((tmp - WEBRTC_SPL_LSHIFT_W32((WebRtc_Word32)y1_hi, 13)) << 2);
+
+        // Rounding in Q12, i.e. add 2^11
+        tmp += 2048;
+
+        // Saturate (to 2^27) so that the filtered signal does not overflow
+        tmp = WEBRTC_SPL_SAT((WebRtc_Word32)134217727, tmp, (WebRtc_Word32)-134217728);
+
+        // Convert back to Q0 and use rounding
+        out_vector[i] = (WebRtc_Word16)WEBRTC_SPL_RSHIFT_W32(tmp, 12);
+    }
+
+    state[0] = y1_hi;
+    state[1] = y1_lo;
+    state[2] = y2_hi;
+    state[3] = y2_lo;
+}
+
+void WebRtcSpl_BiquadFilterQ12(const WebRtc_Word16* in_vector,
+                               WebRtc_Word16* out_vector,
+                               int vector_length,
+                               const WebRtc_Word16* coefficients,
+                               int num_sections,
+                               WebRtc_Word16* state)
+{
+    WebRtc_Word32 feedforward[kBiquadBlockLength];
+    const WebRtc_Word16* in;
+    int block_length;
+    int n, k;
+
+    for (n = 0; n < vector_length; n += kBiquadBlockLength)
+    {
+        block_length = WEBRTC_SPL_MIN(kBiquadBlockLength, vector_length - n);
+        in = &in_vector[n];
+        for (k = 0; k < num_sections; k++)
+        {
+            // The feedforward part reads the whole block before it is
+            // overwritten, so the filtering can be done in place.
+            WebRtcSpl_BiquadFeedforwardQ12(&coefficients[5 * k], &state[6 * k + 4], in,
+                                           feedforward, block_length);
+            WebRtcSpl_BiquadFeedbackQ12(&coefficients[5 * k], &state[6 * k], feedforward,
+                                        &out_vector[n], block_length);
+            in = &out_vector[n];
+        }
+    }
+}
@@ -15,6 +15,7 @@
  * WebRtcSpl_RandU()
  * WebRtcSpl_RandN()
  * WebRtcSpl_RandUArray()
+ * WebRtcSpl_RandPhaseQ13()
  *
  * The description header can be found in signal_processing_library.h
  *
@@ -22,6 +23,16 @@
 
 #include "signal_processing_library.h"
 
+// The generator is seed = 69069 * seed + 1 (mod 2^31). Four steps at once are
+// seed = kRandMultiplier4 * seed + kRandIncrement4, which lets four interleaved
+// streams produce the same sequence without each value waiting for the last.
+enum
+{
+    kRandLanes = 4
+};
+static const WebRtc_UWord32 kRandMultiplier4 = 1790562961u; // 69069^4
+static const WebRtc_UWord32 kRandIncrement4 = 3277404108u; // 1 + ... + 69069^3
+
 WebRtc_UWord32 WebRtcSpl_IncreaseSeed(WebRtc_UWord32 *seed)
 {
     seed[0] = (seed[0] * ((WebRtc_Word32)69069) + 1) & (WEBRTC_SPL_MAX_SEED_USED - 1);
@@ -43,10 +54,58 @@ WebRtc_Word16 WebRtcSpl_RandUArray(WebRtc_Word16* vector,
                                    WebRtc_Word16 vector_length,
                                    WebRtc_UWord32* seed)
 {
-    int i;
-    for (i = 0; i < vector_length; i++)
+    WebRtc_UWord32 lane[kRandLanes];
+    int i = 0;
+    int j;
+
+    if (vector_length >= kRandLanes)
+    {
+        for (j = 0; j < kRandLanes; j++)
+        {
+            lane[j] = WebRtcSpl_IncreaseSeed(seed);
+        }
+        while (1)
+        {
+            for (j = 0; j < kRandLanes; j++)
+            {
+                vector[i + j] = (WebRtc_Word16)(lane[j] >> 16);
+            }
+            i += kRandLanes;
+            if (i + kRandLanes > vector_length)
+            {
+                break;
+            }
+            for (j = 0; j < kRandLanes; j++)
+            {
+                lane[j] = (lane[j] * kRandMultiplier4 + kRandIncrement4)
+                        & (WEBRTC_SPL_MAX_SEED_USED - 1);
+            }
+        }
+        // The last lane holds the state of the last value produced.
+        seed[0] = lane[kRandLanes - 1];
+    }
+    for (; i < vector_length; i++)
     {
         vector[i] = WebRtcSpl_RandU(seed);
     }
     return vector_length;
 }
+
+void WebRtcSpl_RandPhaseQ13(WebRtc_Word16* cos_vector,
+                            WebRtc_Word16* sin_vector,
+                            WebRtc_Word16 vector_length,
+                            WebRtc_UWord32* seed)
+{
+    WebRtc_Word16 index;
+    int i;
+
+    // Draw the random values into |cos_vector| and replace them in place.
+    WebRtcSpl_RandUArray(cos_vector, vector_length, seed);
+    for (i = 0; i < vector_length; i++)
+    {
+        // An angle in whole degrees over [0 358].
+        index = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT(359, cos_vector[i], 15);
+        cos_vector[i] = WebRtcSpl_kCosTable[index];
+        sin_vector[i] = WebRtcSpl_kSinTable[index];
+    }
+}
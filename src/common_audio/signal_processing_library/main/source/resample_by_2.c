@@ -133,3 +133,118 @@ void WebRtcSpl_UpsampleBy2(const WebRtc_Word16* in, WebRtc_Word16 len, WebRtc_Wo
             *outptr++ = (WebRtc_Word16)out32;
     }
 }
+
+// Stereo versions of the above, operating directly on interleaved (L, R)
+// samples. Both channels are filtered in lockstep, with the filter state
+// interleaved the same way (state[2 * k + channel], 16 words in total), so
+// that every allpass section runs on a pair of lanes.
+void WebRtcSpl_DownsampleBy2Stereo(const WebRtc_Word16* in, const WebRtc_Word16 len,
+                                   WebRtc_Word16* out, WebRtc_Word32* filtState)
+{
+    const WebRtc_Word16 *inptr;
+    WebRtc_Word16 *outptr;
+    WebRtc_Word32 *state;
+    WebRtc_Word32 tmp1, tmp2, diff, in32, out32;
+    WebRtc_Word16 i;
+    int ch;
+
+    inptr = in; // interleaved input array (len samples per channel)
+    outptr = out; // interleaved output array (len/2 samples per channel)
+    state = filtState; // filter state array; length = 16
+
+    for (i = (len >> 1); i > 0; i--)
+    {
+        for (ch = 0; ch < 2; ch++)
+        {
+            // lower allpass filter
+            in32 = (WebRtc_Word32)inptr[ch] << 10;
+            diff = in32 - state[2 + ch];
+            tmp1 = WEBRTC_SPL_SCALEDIFF32( kResampleAllpass2[0], diff, state[ch] );
+            state[ch] = in32;
+            diff = tmp1 - state[4 + ch];
+            tmp2 = WEBRTC_SPL_SCALEDIFF32( kResampleAllpass2[1], diff, state[2 + ch] );
+            state[2 + ch] = tmp1;
+            diff = tmp2 - state[6 + ch];
+            state[6 + ch] = WEBRTC_SPL_SCALEDIFF32( kResampleAllpass2[2], diff,
+                                                    state[4 + ch] );
+            state[4 + ch] = tmp2;
+
+            // upper allpass filter
+            in32 = (WebRtc_Word32)inptr[2 + ch] << 10;
+            diff = in32 - state[10 + ch];
+            tmp1 = WEBRTC_SPL_SCALEDIFF32( kResampleAllpass1[0], diff, state[8 + ch] );
+            state[8 + ch] = in32;
+            diff = tmp1 - state[12 + ch];
+            tmp2 = WEBRTC_SPL_SCALEDIFF32( kResampleAllpass1[1], diff, state[10 + ch] );
+            state[10 + ch] = tmp1;
+            diff = tmp2 - state[14 + ch];
+            state[14 + ch] = WEBRTC_SPL_SCALEDIFF32( kResampleAllpass1[2], diff,
+                                                     state[12 + ch] );
+            state[12 + ch] = tmp2;
+
+            // add two allpass outputs, divide by two and round
+            out32 = (state[6 + ch] + state[14 + ch] + 1024) >> 11;
+
+            // limit amplitude to prevent wrap-around, and write to output array
+            outptr[ch] = (WebRtc_Word16)WEBRTC_SPL_SAT(32767, out32, -32768);
+        }
+        inptr += 4;
+        outptr += 2;
+    }
+}
+
+void WebRtcSpl_UpsampleBy2Stereo(const WebRtc_Word16* in, WebRtc_Word16 len,
+                                 WebRtc_Word16* out, WebRtc_Word32* filtState)
+{
+    const WebRtc_Word16 *inptr;
+    WebRtc_Word16 *outptr;
+    WebRtc_Word32 *state;
+    WebRtc_Word32 tmp1, tmp2, diff, in32, out32;
+    WebRtc_Word16 i;
+    int ch;
+
+    inptr = in; // interleaved input array (len samples per channel)
+    outptr = out; // interleaved output array (len*2 samples per channel)
+    state = filtState; // filter state array; length = 16
+
+    for (i = len; i > 0; i--)
+    {
+        for (ch = 0; ch < 2; ch++)
+        {
+            // lower allpass filter
+            in32 = (WebRtc_Word32)inptr[ch] << 10;
+            diff = in32 - state[2 + ch];
+            tmp1 = WEBRTC_SPL_SCALEDIFF32( kResampleAllpass1[0], diff, state[ch] );
+            state[ch] = in32;
+            diff = tmp1 - state[4 + ch];
+            tmp2 = WEBRTC_SPL_SCALEDIFF32( kResampleAllpass1[1], diff, state[2 + ch] );
+            state[2 + ch] = tmp1;
+            diff = tmp2 - state[6 + ch];
+            state[6 + ch] = WEBRTC_SPL_SCALEDIFF32( kResampleAllpass1[2], diff,
+                                                    state[4 + ch] );
+            state[4 + ch] = tmp2;
+
+            // round; limit amplitude to prevent wrap-around; write to output array
+            out32 = (state[6 + ch] + 512) >> 10;
+            outptr[ch] = (WebRtc_Word16)WEBRTC_SPL_SAT(32767, out32, -32768);
+
+            // upper allpass filter
+            diff = in32 - state[10 + ch];
+            tmp1 = WEBRTC_SPL_SCALEDIFF32( kResampleAllpass2[0], diff, state[8 + ch] );
+            state[8 + ch] = in32;
+            diff = tmp1 - state[12 + ch];
+            tmp2 = WEBRTC_SPL_SCALEDIFF32( kResampleAllpass2[1], diff, state[10 + ch] );
+            state[10 + ch] = tmp1;
+            diff = tmp2 - state[14 + ch];
+            state[14 + ch] = WEBRTC_SPL_SCALEDIFF32( kResampleAllpass2[2], diff,
+                                                     state[12 + ch] );
+            state[12 + ch] = tmp2;
+
+            // round; limit amplitude to prevent wrap-around; write to output array
+            out32 = (state[14 + ch] + 512) >> 10;
+            outptr[2 + ch] = (WebRtc_Word16)WEBRTC_SPL_SAT(32767, out32, -32768);
+        }
+        inptr += 2;
+        outptr += 4;
+    }
+}
@@ -116,9 +116,17 @@ void WebRtcSpl_AllPassQMF(WebRtc_Word32* in_data, const WebRtc_Word16 data_lengt
     filter_state[5] = out_data[data_length - 1]; // y[N-1], becomes y[-1] next time
 }
 
-void WebRtcSpl_AnalysisQMF(const WebRtc_Word16* in_data, WebRtc_Word16* low_band,
-                           WebRtc_Word16* high_band, WebRtc_Word32* filter_state1,
-                           WebRtc_Word32* filter_state2)
+// Band split shared by WebRtcSpl_AnalysisQMF() and
+// WebRtcSpl_AnalysisQMFBiquadQ12(). If |biquad_coefficients| is not NULL, the
+// low band is also filtered by that biquad section, whose feedforward part is
+// computed as the band is split.
+static void WebRtcSpl_AnalysisQMFInternal(const WebRtc_Word16* in_data,
+                                          WebRtc_Word16* low_band,
+                                          WebRtc_Word16* high_band,
+                                          WebRtc_Word32* filter_state1,
+                                          WebRtc_Word32* filter_state2,
+                                          const WebRtc_Word16* biquad_coefficients,
+                                          WebRtc_Word16* biquad_state)
 {
     WebRtc_Word16 i;
     WebRtc_Word16 k;
@@ -127,6 +135,17 @@ void WebRtcSpl_AnalysisQMF(const WebRtc_Word16* in_data, WebRtc_Word16* low_band
     WebRtc_Word32 half_in2[kBandFrameLength];
     WebRtc_Word32 filter1[kBandFrameLength];
     WebRtc_Word32 filter2[kBandFrameLength];
+    WebRtc_Word32 feedforward[kBandFrameLength];
+    WebRtc_Word16 b0 = 0, b1 = 0, b2 = 0, x1 = 0, x2 = 0;
+
+    if (biquad_coefficients != NULL)
+    {
+        b0 = biquad_coefficients[0];
+        b1 = biquad_coefficients[1];
+        b2 = biquad_coefficients[2];
+        x1 = biquad_state[4];
+        x2 = biquad_state[5];
+    }
 
     // Split even and odd samples. Also shift them to Q10.
     for (i = 0, k = 0; i < kBandFrameLength; i++, k += 2)
@@ -154,9 +173,46 @@ void WebRtcSpl_AnalysisQMF(const WebRtc_Word16* in_data, WebRtc_Word16* low_band
         tmp = WEBRTC_SPL_RSHIFT_W32(tmp, 11);
         high_band[i] = (WebRtc_Word16)WEBRTC_SPL_SAT(WEBRTC_SPL_WORD16_MAX,
                 tmp, WEBRTC_SPL_WORD16_MIN);
+
+        if (biquad_coefficients != NULL)
+        {
+            // b[0] * x[i] + b[1] * x[i-1] + b[2] * x[i-2]
+            feedforward[i] = WEBRTC_SPL_MUL_16_16(low_band[i], b0)
+                    + WEBRTC_SPL_MUL_16_16(x1, b1) + WEBRTC_SPL_MUL_16_16(x2, b2);
+            x2 = x1;
+            x1 = low_band[i];
+        }
+    }
+
+    if (biquad_coefficients != NULL)
+    {
+        biquad_state[4] = x1;
+        biquad_state[5] = x2;
+        WebRtcSpl_BiquadFeedbackQ12(biquad_coefficients, biquad_state, feedforward,
+                                    low_band, kBandFrameLength);
     }
 }
 
+void WebRtcSpl_AnalysisQMF(const WebRtc_Word16* in_data, WebRtc_Word16* low_band,
+                           WebRtc_Word16* high_band, WebRtc_Word32* filter_state1,
+                           WebRtc_Word32* filter_state2)
+{
+    WebRtcSpl_AnalysisQMFInternal(in_data, low_band, high_band, filter_state1,
+                                  filter_state2, NULL, NULL);
+}
+
+void WebRtcSpl_AnalysisQMFBiquadQ12(const WebRtc_Word16* in_data,
+                                    WebRtc_Word16* low_band,
+                                    WebRtc_Word16* high_band,
+                                    WebRtc_Word32* filter_state1,
+                                    WebRtc_Word32* filter_state2,
+                                    const WebRtc_Word16* biquad_coefficients,
+                                    WebRtc_Word16* biquad_state)
+{
+    WebRtcSpl_AnalysisQMFInternal(in_data, low_band, high_band, filter_state1,
+                                  filter_state2, biquad_coefficients, biquad_state);
+}
+
 void WebRtcSpl_SynthesisQMF(const WebRtc_Word16* low_band, const WebRtc_Word16* high_band,
                             WebRtc_Word16* out_data, WebRtc_Word32* filter_state1,
                             WebRtc_Word32* filter_state2)
@@ -30,7 +30,7 @@ WebRtc_Word32 WebRtcSpl_SubSatW32(WebRtc_Word32 var1, WebRtc_Word32 var2)
     if ((var1 < 0) && (var2 > 0) && (l_diff > 0))
         l_diff = (WebRtc_Word32)0x80000000;
     // check for overflow
-    if ((var1 > 0) && (var2 < 0) && (l_diff < 0))
+    if ((var1 >= 0) && (var2 < 0) && (l_diff < 0))
         l_diff = (WebRtc_Word32)0x7FFFFFFF;
 
     return l_diff;
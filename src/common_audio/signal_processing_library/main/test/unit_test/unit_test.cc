@@ -14,6 +14,8 @@
  *
  */
 
+#include <vector>
+
 #include "unit_test.h"
 #include "signal_processing_library.h"
 
@@ -131,6 +133,9 @@ TEST_F(SplTest, InlineTest) {
 
     EXPECT_EQ(109410, WebRtcSpl_AddSatW32(A, B));
     EXPECT_EQ(112832, WebRtcSpl_SubSatW32(A, B));
+    // Overflow from a zero minuend.
+    EXPECT_EQ(WEBRTC_SPL_WORD32_MAX,
+              WebRtcSpl_SubSatW32(0, WEBRTC_SPL_WORD32_MIN));
 
     EXPECT_EQ(17, WebRtcSpl_GetSizeInBits(A));
     EXPECT_EQ(14, WebRtcSpl_NormW32(A));
@@ -140,6 +145,83 @@ TEST_F(SplTest, InlineTest) {
     EXPECT_EQ(0, WebRtcSpl_get_version(bVersion, 8));
 }
 
+// Straightforward versions of the inline functions, to check whichever backend
+// spl_inl.h selected for bit-exactness.
+static WebRtc_Word32 SaturateRef(WebRtc_Word64 value, WebRtc_Word64 min_value,
+                                 WebRtc_Word64 max_value) {
+    return (WebRtc_Word32)(value < min_value ? min_value :
+                           value > max_value ? max_value : value);
+}
+
+static int NormRef(WebRtc_Word64 value, int bits) {
+    // Left shifts that keep the sign bit, within |bits| bits.
+    int zeros = 0;
+    if (value == 0) {
+        return 0;
+    }
+    while (zeros < bits - 1 &&
+           value * 2 < ((WebRtc_Word64)1 << (bits - 1)) &&
+           value * 2 >= -((WebRtc_Word64)1 << (bits - 1))) {
+        value *= 2;
+        zeros++;
+    }
+    return zeros;
+}
+
+static int SizeInBitsRef(WebRtc_UWord32 value) {
+    int bits = 0;
+    while (value != 0) {
+        value >>= 1;
+        bits++;
+    }
+    return bits;
+}
+
+TEST_F(SplTest, InlineBitExactTest) {
+    const WebRtc_Word32 kEdges[] = {
+        0, 1, -1, 2, -2, 3, 0x3FFF, 0x4000, -0x4000, -0x4001, 0x7FFF, -0x8000,
+        0x8000, -0x8001, 0xFFFF, 0x10000, 0x3FFFFFFF, 0x40000000, -0x40000000,
+        -0x40000001, 0x7FFFFFFF, (WebRtc_Word32)0x80000000,
+        (WebRtc_Word32)0x80000001 };
+    const int kNumEdges = sizeof(kEdges) / sizeof(kEdges[0]);
+    const int kNumRandom = 100000;
+
+    std::vector<WebRtc_Word32> values(kEdges, kEdges + kNumEdges);
+    WebRtc_UWord32 seed = 1;
+    for (int i = 0; i < kNumRandom; i++) {
+        seed = seed * 1664525 + 1013904223;
+        // Vary the magnitude to cover all norms.
+        values.push_back((WebRtc_Word32)seed >> (seed & 31));
+    }
+
+    for (size_t i = 0; i < values.size(); i++) {
+        const WebRtc_Word32 A = values[i];
+        const WebRtc_Word16 a = (WebRtc_Word16)A;
+        const WebRtc_Word32 B = values[(i * 7919 + 1) % values.size()];
+        const WebRtc_Word16 b = (WebRtc_Word16)B;
+        SCOPED_TRACE(testing::Message() << "A " << A << ", B " << B);
+
+        EXPECT_EQ(SaturateRef((WebRtc_Word64)a + b, -32768, 32767),
+                  WebRtcSpl_AddSatW16(a, b));
+        EXPECT_EQ(SaturateRef((WebRtc_Word64)a - b, -32768, 32767),
+                  WebRtcSpl_SubSatW16(a, b));
+        EXPECT_EQ(SaturateRef((WebRtc_Word64)A + B, WEBRTC_SPL_WORD32_MIN,
+                              WEBRTC_SPL_WORD32_MAX),
+                  WebRtcSpl_AddSatW32(A, B));
+        EXPECT_EQ(SaturateRef((WebRtc_Word64)A - B, WEBRTC_SPL_WORD32_MIN,
+                              WEBRTC_SPL_WORD32_MAX),
+                  WebRtcSpl_SubSatW32(A, B));
+        EXPECT_EQ((WebRtc_Word32)a * b, WEBRTC_SPL_MUL_16_16(a, b));
+
+        EXPECT_EQ(SizeInBitsRef((WebRtc_UWord32)A),
+                  WebRtcSpl_GetSizeInBits((WebRtc_UWord32)A));
+        EXPECT_EQ(NormRef(A, 32), WebRtcSpl_NormW32(A));
+        EXPECT_EQ(NormRef(a, 16), WebRtcSpl_NormW16(a));
+        EXPECT_EQ(A == 0 ? 0 : 32 - SizeInBitsRef((WebRtc_UWord32)A),
+                  WebRtcSpl_NormU32((WebRtc_UWord32)A));
+    }
+}
+
 TEST_F(SplTest, MathOperationsTest) {
 
     int A = 117;
@@ -387,6 +469,72 @@ TEST_F(SplTest, FilterTest) {
 
 }
 
+TEST_F(SplTest, BiquadFilterTest) {
+    const int kLen = 160;
+    // The high-pass filter of the audio processing module, twice.
+    const WebRtc_Word16 kCoefficients[10] = {4012, -8024, 4012, 8002, -3913,
+                                             4012, -8024, 4012, 8002, -3913};
+    WebRtc_Word16 in[2 * kLen];
+    WebRtc_Word16 out[kLen];
+    WebRtc_Word16 outInPlace[kLen];
+    WebRtc_Word16 outTwice[kLen];
+    WebRtc_Word16 outCascade[kLen];
+    WebRtc_Word16 lowBand[kLen];
+    WebRtc_Word16 highBand[kLen];
+    WebRtc_Word16 lowBandFused[kLen];
+    WebRtc_Word16 highBandFused[kLen];
+    WebRtc_Word16 state[5][6];
+    WebRtc_Word16 stateCascade[12];
+    WebRtc_Word32 qmfState[4][6];
+    WebRtc_UWord32 seed = 12345;
+
+    for (int kk = 0; kk < 5; ++kk) {
+        WebRtcSpl_ZerosArrayW16(state[kk], 6);
+    }
+    WebRtcSpl_ZerosArrayW16(stateCascade, 12);
+    for (int kk = 0; kk < 4; ++kk) {
+        WebRtcSpl_ZerosArrayW32(qmfState[kk], 6);
+    }
+    for (int block = 0; block < 3; ++block) {
+        for (int kk = 0; kk < 2 * kLen; ++kk) {
+            in[kk] = (WebRtc_Word16) WebRtcSpl_RandN(&seed);
+        }
+
+        // Filtering in place, in pieces, must be the same as in one call.
+        WebRtcSpl_BiquadFilterQ12(in, out, kLen, kCoefficients, 1, state[0]);
+        WEBRTC_SPL_MEMCPY_W16(outInPlace, in, kLen);
+        WebRtcSpl_BiquadFilterQ12(outInPlace, outInPlace, 1, kCoefficients, 1,
+                                  state[1]);
+        WebRtcSpl_BiquadFilterQ12(&outInPlace[1], &outInPlace[1], kLen - 1,
+                                  kCoefficients, 1, state[1]);
+        for (int kk = 0; kk < kLen; ++kk) {
+            EXPECT_EQ(out[kk], outInPlace[kk]);
+        }
+
+        // A cascade of two sections must be the same as filtering twice.
+        WebRtcSpl_BiquadFilterQ12(out, outTwice, kLen, kCoefficients, 1,
+                                  state[2]);
+        WebRtcSpl_BiquadFilterQ12(in, outCascade, kLen, kCoefficients, 2,
+                                  stateCascade);
+        for (int kk = 0; kk < kLen; ++kk) {
+            EXPECT_EQ(outTwice[kk], outCascade[kk]);
+        }
+
+        // Filtering the lower band while splitting must be the same as
+        // filtering it afterwards.
+        WebRtcSpl_AnalysisQMF(in, lowBand, highBand, qmfState[0], qmfState[1]);
+        WebRtcSpl_BiquadFilterQ12(lowBand, lowBand, kLen, kCoefficients, 1,
+                                  state[3]);
+        WebRtcSpl_AnalysisQMFBiquadQ12(in, lowBandFused, highBandFused,
+                                       qmfState[2], qmfState[3], kCoefficients,
+                                       state[4]);
+        for (int kk = 0; kk < kLen; ++kk) {
+            EXPECT_EQ(lowBand[kk], lowBandFused[kk]);
+            EXPECT_EQ(highBand[kk], highBandFused[kk]);
+        }
+    }
+}
+
 TEST_F(SplTest, RandTest) {
 
 
@@ -404,6 +552,31 @@ TEST_F(SplTest, RandTest) {
     for (int kk = 0; kk < 4; ++kk) {
         EXPECT_EQ(BU[kk], b16[kk]);
     }
+
+    // The array is filled several values at a time, which must give the same
+    // sequence and final seed as repeated WebRtcSpl_RandU().
+    const int kMaxLength = 67;
+    WebRtc_Word16 randU[kMaxLength];
+    WebRtc_Word16 cosQ13[kMaxLength];
+    WebRtc_Word16 sinQ13[kMaxLength];
+    for (int length = 0; length <= kMaxLength; ++length) {
+        WebRtc_UWord32 seed = 777 + length;
+        WebRtc_UWord32 refSeed = seed;
+        EXPECT_EQ(length, WebRtcSpl_RandUArray(randU, length, &seed));
+        for (int kk = 0; kk < length; ++kk) {
+            EXPECT_EQ(WebRtcSpl_RandU(&refSeed), randU[kk]);
+        }
+        EXPECT_EQ(refSeed, seed);
+
+        seed = 777 + length;
+        WebRtcSpl_RandPhaseQ13(cosQ13, sinQ13, length, &seed);
+        EXPECT_EQ(refSeed, seed);
+        for (int kk = 0; kk < length; ++kk) {
+            int index = (359 * randU[kk]) >> 15;
+            EXPECT_EQ(WebRtcSpl_kCosTable[index], cosQ13[kk]);
+            EXPECT_EQ(WebRtcSpl_kSinTable[index], sinQ13[kk]);
+        }
+    }
 }
 
 TEST_F(SplTest, SignalProcessingTest) {
@@ -470,6 +643,60 @@ TEST_F(SplTest, FFTTest) {
     }
 }
 
+TEST_F(SplTest, ResampleStereoTest) {
+    const int kLen = 160;
+    WebRtc_Word16 stereo[2 * kLen];
+    WebRtc_Word16 left[kLen];
+    WebRtc_Word16 right[kLen];
+    WebRtc_Word16 stereoOut[4 * kLen];
+    WebRtc_Word16 leftOut[2 * kLen];
+    WebRtc_Word16 rightOut[2 * kLen];
+    WebRtc_Word32 stereoState[16];
+    WebRtc_Word32 leftState[8];
+    WebRtc_Word32 rightState[8];
+    WebRtc_UWord32 seed = 12345;
+
+    // The interleaved versions must be bit exact with the mono versions
+    // applied to each channel separately.
+    WebRtcSpl_ZerosArrayW32(stereoState, 16);
+    WebRtcSpl_ZerosArrayW32(leftState, 8);
+    WebRtcSpl_ZerosArrayW32(rightState, 8);
+    for (int block = 0; block < 3; ++block) {
+        for (int kk = 0; kk < kLen; ++kk) {
+            left[kk] = (WebRtc_Word16) WebRtcSpl_RandN(&seed);
+            right[kk] = (WebRtc_Word16) (WebRtcSpl_RandU(&seed) * 2 - 32768);
+            stereo[2 * kk] = left[kk];
+            stereo[2 * kk + 1] = right[kk];
+        }
+        WebRtcSpl_UpsampleBy2Stereo(stereo, kLen, stereoOut, stereoState);
+        WebRtcSpl_UpsampleBy2(left, kLen, leftOut, leftState);
+        WebRtcSpl_UpsampleBy2(right, kLen, rightOut, rightState);
+        for (int kk = 0; kk < 2 * kLen; ++kk) {
+            EXPECT_EQ(leftOut[kk], stereoOut[2 * kk]);
+            EXPECT_EQ(rightOut[kk], stereoOut[2 * kk + 1]);
+        }
+    }
+
+    WebRtcSpl_ZerosArrayW32(stereoState, 16);
+    WebRtcSpl_ZerosArrayW32(leftState, 8);
+    WebRtcSpl_ZerosArrayW32(rightState, 8);
+    for (int block = 0; block < 3; ++block) {
+        for (int kk = 0; kk < kLen; ++kk) {
+            left[kk] = (WebRtc_Word16) (WebRtcSpl_RandU(&seed) * 2 - 32768);
+            right[kk] = (WebRtc_Word16) WebRtcSpl_RandN(&seed);
+            stereo[2 * kk] = left[kk];
+            stereo[2 * kk + 1] = right[kk];
+        }
+        WebRtcSpl_DownsampleBy2Stereo(stereo, kLen, stereoOut, stereoState);
+        WebRtcSpl_DownsampleBy2(left, kLen, leftOut, leftState);
+        WebRtcSpl_DownsampleBy2(right, kLen, rightOut, rightState);
+        for (int kk = 0; kk < kLen / 2; ++kk) {
+            EXPECT_EQ(leftOut[kk], stereoOut[2 * kk]);
+            EXPECT_EQ(rightOut[kk], stereoOut[2 * kk + 1]);
+        }
+    }
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   SplEnvironment* env = new SplEnvironment;
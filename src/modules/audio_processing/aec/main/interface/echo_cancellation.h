@@ -11,6 +11,8 @@
 #ifndef WEBRTC_MODULES_AUDIO_PROCESSING_AEC_MAIN_INTERFACE_ECHO_CANCELLATION_H_
 #define WEBRTC_MODULES_AUDIO_PROCESSING_AEC_MAIN_INTERFACE_ECHO_CANCELLATION_H_
 
+#include <stdlib.h>
+
 #include "typedefs.h"
 
 // Errors
@@ -23,6 +25,9 @@
 // Warnings
 #define AEC_BAD_PARAMETER_WARNING       12050
 
+// Number of bins of the delay histogram, one per filter partition
+#define AEC_DELAY_HISTOGRAM_SIZE        12
+
 enum {
     kAecNlpConservative = 0,
     kAecNlpModerate,
@@ -55,6 +60,33 @@ typedef struct {
     AecLevel aNlp;
 } AecMetrics;
 
+// Echo delay estimated from the partition of the adaptive filter holding the
+// most energy, i.e. the delay remaining after the farend has been aligned by
+// |alignedDelay|. All values in ms.
+typedef struct {
+    WebRtc_Word16 median;         // -1 without an estimate
+    WebRtc_Word16 std;            // -1 without an estimate
+    WebRtc_Word16 alignedDelay;   // farend delay set from msInSndCardBuf
+    WebRtc_Word16 binWidth;       // delay covered by one histogram bin
+    WebRtc_UWord32 histogram[AEC_DELAY_HISTOGRAM_SIZE];
+} AecDelayMetrics;
+
+// Raw energies of one 64 sample block, from which the echo metrics are
+// aggregated. See WebRtcAec_GetMetricsBlocks().
+typedef struct {
+    float farEnergy;          // sum of squares of the farend
+    float nearEnergy;         // sum of squares of the nearend
+    float linearOutEnergy;    // sum of squares after the linear filter
+    float nlpOutEnergy;       // sum of squares of the output
+    WebRtc_Word16 echoState;  // as given by WebRtcAec_get_echo_status()
+} AecMetricsBlock;
+
+// Filter applied to the suppressed spectrum of every block. |real| and |imag|
+// hold |length| frequency bins of the L band and are modified in place. The
+// filter may set |*gainH| to scale the H band (SWB only).
+typedef int (*AecSpectrumFilter)(void *context, float *real, float *imag,
+                                 int length, float *gainH);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -108,7 +140,27 @@ WebRtc_Word32 WebRtcAec_Init(void *aecInst,
                              WebRtc_Word32 scSampFreq);
 
 /*
- * Inserts an 80 or 160 sample block of data into the farend buffer.
+ * Changes the sampling frequency of an initialized instance between 16000 and
+ * 32000 Hz. Both rates are processed at 16 kHz after the band split, so the
+ * adaptive filter, the delay estimate and the buffered farend are kept. Other
+ * changes need WebRtcAec_Init().
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           *aecInst      Pointer to the AEC instance
+ * WebRtc_Word32  sampFreq      New sampling frequency of data
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * WebRtc_Word32 return          0: OK
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_ChangeSampFreq(void *aecInst, WebRtc_Word32 sampFreq);
+
+/*
+ * Inserts an 80 or 160 sample block of data into the farend buffer. For
+ * block aligned processing, see WebRtcAec_Process(), 64 or 128 samples are
+ * accepted as well.
  *
  * Inputs                       Description
  * -------------------------------------------------------------------
@@ -129,6 +181,17 @@ WebRtc_Word32 WebRtcAec_BufferFarend(void *aecInst,
 /*
  * Runs the echo canceller on an 80 or 160 sample blocks of data.
  *
+ * Block aligned input of 64 or 128 samples, i.e. one or two of the internal
+ * partitions, is processed directly without the reframing buffers, which
+ * lowers the latency by up to one partition. The same block size should then
+ * be used for WebRtcAec_BufferFarend(), and the two framings should not be
+ * mixed on one instance without re-initialization. |msInSndCardBuf| has the
+ * same meaning for both: the reframing delays the farend and the nearend
+ * alike, so only the output latency changes, not the echo path delay. As
+ * for frames, the farend of a call should be buffered before the call.
+ *
+ * |nearendH| and |outH| are only used for SWB, and may be NULL otherwise.
+ *
  * Inputs                       Description
  * -------------------------------------------------------------------
  * void          *aecInst       Pointer to the AEC instance
@@ -161,6 +224,59 @@ WebRtc_Word32 WebRtcAec_Process(void *aecInst,
                                 WebRtc_Word16 msInSndCardBuf,
                                 WebRtc_Word32 skew);
 
+/*
+ * As WebRtcAec_Process(), for a nearend in float on the 16-bit scale. The
+ * nearend is processed without rounding to 16 bits, and the output is not
+ * limited to the 16-bit range. The farend is still given to
+ * WebRtcAec_BufferFarend().
+ */
+WebRtc_Word32 WebRtcAec_ProcessFloat(void *aecInst,
+                                     const float *nearend,
+                                     const float *nearendH,
+                                     float *out,
+                                     float *outH,
+                                     WebRtc_Word16 nrOfSamples,
+                                     WebRtc_Word16 msInSndCardBuf,
+                                     WebRtc_Word32 skew);
+
+/*
+ * Runs the echo canceller on a recording, with the farend and nearend
+ * available ahead of time and aligned by the caller. The farend is not
+ * buffered and no delay estimation or start up phase is applied. Once an
+ * instance has been used with WebRtcAec_BufferFarend() or WebRtcAec_Process(),
+ * this function fails with AEC_UNSUPPORTED_FUNCTION_ERROR until the instance
+ * is re-initialized, and vice versa.
+ *
+ * The farend spectra are computed in batches ahead of the sequential
+ * adaptation and suppression, which then only have to work on the nearend.
+ * May be called repeatedly to process a recording in parts.
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void          *aecInst       Pointer to the AEC instance
+ * WebRtc_Word16 *farend        In buffer containing the farend signal,
+ *                              aligned with the nearend, for L band
+ * WebRtc_Word16 *nearend       In buffer containing the nearend+echo
+ *                              signal for L band
+ * WebRtc_Word16 *nearendH      In buffer containing the nearend+echo
+ *                              signal for H band
+ * WebRtc_Word32 nrOfSamples    Number of samples per band, a multiple of 64
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * WebRtc_Word16  *out          Out buffer, for L band
+ * WebRtc_Word16  *outH         Out buffer, for H band
+ * WebRtc_Word32  return         0: OK
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_ProcessOffline(void *aecInst,
+                                       const WebRtc_Word16 *farend,
+                                       const WebRtc_Word16 *nearend,
+                                       const WebRtc_Word16 *nearendH,
+                                       WebRtc_Word16 *out,
+                                       WebRtc_Word16 *outH,
+                                       WebRtc_Word32 nrOfSamples);
+
 /*
  * This function enables the user to set certain parameters on-the-fly.
  *
@@ -193,6 +309,71 @@ WebRtc_Word32 WebRtcAec_set_config(void *aecInst, AecConfig config);
  */
 WebRtc_Word32 WebRtcAec_get_config(void *aecInst, AecConfig *config);
 
+/*
+ * Enables the dormant mode, off by default and after WebRtcAec_Init(). After
+ * one second of digitally silent farend given to WebRtcAec_BufferFarend(),
+ * the AEC then turns dormant and passes the nearend through at a fraction of
+ * the processing cost, skipping the buffering and block processing. Nothing
+ * is suppressed; the comfort noise of the last processed block is added. The
+ * adaptive filter and the estimates are held as they are, and the first
+ * non-zero farend resumes full processing with the same latency.
+ * The AEC does not turn dormant while a spectrum filter is set.
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           *aecInst      Pointer to the AEC instance
+ * WebRtc_Word16  enable        kAecTrue to enable, kAecFalse to disable
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * WebRtc_Word32  return         0: OK
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_set_dormant_mode(void *aecInst, WebRtc_Word16 enable);
+
+/*
+ * Sizes the buffers of the instance for the rate and the delay actually in
+ * use, rather than for the worst case. Off by default, and kept by
+ * WebRtcAec_Init(), where it takes effect: the farend buffer is then sized for
+ * soundcard buffers up to |maxDelayMs| at the rate given there, and the upper
+ * band buffers are only held at 32 kHz. Larger values of |msInSndCardBuf|
+ * given to WebRtcAec_Process() are limited to |maxDelayMs|.
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           *aecInst      Pointer to the AEC instance
+ * WebRtc_Word16  maxDelayMs    Largest soundcard buffer (ms), 1 - 500, or 0
+ *                              for the default sizes
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * WebRtc_Word32  return         0: OK
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_set_compact_memory(void *aecInst,
+                                           WebRtc_Word16 maxDelayMs);
+
+/*
+ * Sets a filter to run on the output spectrum of the AEC, after the echo
+ * suppression and before the synthesis. This allows a following spectral
+ * processor, e.g. a noise suppressor, to share the analysis and synthesis of
+ * the AEC. The filter is removed by WebRtcAec_Init().
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           *aecInst      Pointer to the AEC instance
+ * AecSpectrumFilter filter     The filter, or NULL to remove it
+ * void           *context      Passed to the filter as its first argument
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * WebRtc_Word32  return         0: OK
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_set_spectrum_filter(void *aecInst,
+                                            AecSpectrumFilter filter,
+                                            void *context);
+
 /*
  * Gets the current echo status of the nearend signal.
  *
@@ -225,6 +406,147 @@ WebRtc_Word32 WebRtcAec_get_echo_status(void *aecInst, WebRtc_Word16 *status);
  */
 WebRtc_Word32 WebRtcAec_GetMetrics(void *aecInst, AecMetrics *metrics);
 
+/*
+ * Gets the echo delay statistics since WebRtcAec_Init(). The delay is
+ * estimated every 80 ms of filter adaptation as part of the processing, so
+ * the statistics are always available.
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           *aecInst      Pointer to the AEC instance
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * AecDelayMetrics *metrics     Struct which will be filled out with the
+ *                              delay statistics
+ * WebRtc_Word32  return         0: OK
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_GetDelayMetrics(void *aecInst,
+                                        AecDelayMetrics *metrics);
+
+/*
+ * Defers the aggregation of the echo metrics. With metrics enabled, the
+ * instance then only stores the raw energies of each block, to be fetched
+ * with WebRtcAec_GetMetricsBlocks() and aggregated elsewhere, e.g. on another
+ * thread, with WebRtcAec_AggregateMetrics(). WebRtcAec_GetMetrics() does not
+ * include deferred blocks. Reset by WebRtcAec_Init().
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           *aecInst      Pointer to the AEC instance
+ * WebRtc_Word16  enable        kAecTrue to defer, kAecFalse to aggregate
+ *                              within WebRtcAec_Process()
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * WebRtc_Word32  return         0: OK
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_set_deferred_metrics(void *aecInst,
+                                             WebRtc_Word16 enable);
+
+/*
+ * Moves the deferred metrics blocks out of the instance, oldest first. Only a
+ * few blocks are held, more than one call to WebRtcAec_Process() produces;
+ * blocks beyond that are dropped until fetched.
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           *aecInst      Pointer to the AEC instance
+ * WebRtc_Word16  maxBlocks     Size of |blocks|
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * AecMetricsBlock *blocks      The fetched blocks
+ * WebRtc_Word32  return        >=0: Number of blocks fetched
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_GetMetricsBlocks(void *aecInst,
+                                         AecMetricsBlock *blocks,
+                                         WebRtc_Word16 maxBlocks);
+
+/*
+ * Allocates a metrics aggregator, which computes the echo metrics of
+ * WebRtcAec_GetMetrics() from deferred metrics blocks. It is independent of
+ * any AEC instance and initialized on creation.
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           **metricsInst Pointer to the aggregator to be created
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * WebRtc_Word32  return         0: OK
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_CreateMetricsAggregator(void **metricsInst);
+
+/*
+ * Releases the memory allocated by WebRtcAec_CreateMetricsAggregator().
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           *metricsInst  Pointer to the aggregator
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * WebRtc_Word32  return         0: OK
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_FreeMetricsAggregator(void *metricsInst);
+
+/*
+ * Resets the metrics of an aggregator.
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           *metricsInst  Pointer to the aggregator
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * WebRtc_Word32  return         0: OK
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_InitMetricsAggregator(void *metricsInst);
+
+/*
+ * Aggregates metrics blocks fetched by WebRtcAec_GetMetricsBlocks(), in the
+ * order they were fetched.
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           *metricsInst  Pointer to the aggregator
+ * AecMetricsBlock *blocks      The blocks to aggregate
+ * WebRtc_Word32  numBlocks     Number of blocks
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * WebRtc_Word32  return         0: OK
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_AggregateMetrics(void *metricsInst,
+                                         const AecMetricsBlock *blocks,
+                                         WebRtc_Word32 numBlocks);
+
+/*
+ * Gets the echo metrics of an aggregator, as WebRtcAec_GetMetrics() does for
+ * an AEC instance.
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           *metricsInst  Pointer to the aggregator
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * AecMetrics     *metrics      Struct which will be filled out with the
+ *                              aggregated echo metrics.
+ * WebRtc_Word32  return         0: OK
+ *                              -1: error
+ */
+WebRtc_Word32 WebRtcAec_GetAggregatedMetrics(void *metricsInst,
+                                             AecMetrics *metrics);
+
 /*
  * Gets the last error code.
  *
@@ -238,6 +560,19 @@ WebRtc_Word32 WebRtcAec_GetMetrics(void *aecInst, AecMetrics *metrics);
  */
 WebRtc_Word32 WebRtcAec_get_error_code(void *aecInst);
 
+/*
+ * Gets the heap memory held by an instance, including its buffers.
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void           *aecInst      Pointer to the AEC instance
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * size_t         return        Size in bytes
+ */
+size_t WebRtcAec_memory_usage_bytes(void *aecInst);
+
 /*
  * Gets a version string.
  *
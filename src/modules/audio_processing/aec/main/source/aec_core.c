@@ -117,13 +117,29 @@ const float WebRtcAec_overDriveCurve[65] = {
 
 // "Private" function prototypes.
 static void ProcessBlock(aec_t *aec, const short *farend,
-                              const short *nearend, const short *nearendH,
-                              short *out, short *outH);
+                              const far_spectrum_t *farSpectrum,
+                              const float *nearend, const float *nearendH,
+                              float *out, float *outH);
+static void ComputeFarSpectrum(const float *xBuf, far_spectrum_t *farSpectrum);
 
 static void BufferFar(aec_t *aec, const short *farend, int farLen);
 static void FetchFar(aec_t *aec, short *farend, int farLen, int knownDelay);
 
-static void NonLinearProcessing(aec_t *aec, short *output, short *outputH);
+static void NonLinearProcessing(aec_t *aec, const complex_t *farXfw,
+                                float *output, float *outputH);
+static void PassThroughBlock(aec_t *aec, const float *nearend,
+                             const float *nearendH, float *output,
+                             float *outputH);
+static int SuspendFrameBuffers(aec_t *aec);
+static void PassThroughFrame(aec_t *aec, const float *nearend,
+                             const float *nearendH, float *out, float *outH);
+static void ResumeFrameBuffers(aec_t *aec);
+static void DormantComfortNoise(aec_t *aec);
+static void AddDormantComfortNoise(aec_t *aec, float *out, float *outH,
+                                   int len);
+static short SaturateW16(float value);
+static void UpdatePowers(aec_t *aec, const float *farPow);
+static int IsSilent(const short *in, int length);
 
 static void GetHighbandGain(const float *lambda, float *nlpGainHband);
 
@@ -134,8 +150,7 @@ static void ComfortNoise(aec_t *aec, float efw[2][PART_LEN1],
 
 static void WebRtcAec_InitLevel(power_level_t *level);
 static void WebRtcAec_InitStats(stats_t *stats);
-static void UpdateLevel(power_level_t *level, const short *in);
-static void UpdateMetrics(aec_t *aec);
+static void UpdateLevel(power_level_t *level, float energy);
 
 __inline static float MulRe(float aRe, float aIm, float bRe, float bIm)
 {
@@ -169,30 +184,59 @@ int WebRtcAec_CreateAec(aec_t **aecInst)
         return -1;
     }
 
-    if (WebRtcApm_CreateBuffer(&aec->nearFrBuf, FRAME_LEN + PART_LEN) == -1) {
+    if (WebRtcApm_CreateFloatBuffer(&aec->nearFrBuf, FRAME_LEN + PART_LEN) == -1) {
         WebRtcAec_FreeAec(aec);
         aec = NULL;
         return -1;
     }
 
-    if (WebRtcApm_CreateBuffer(&aec->outFrBuf, FRAME_LEN + PART_LEN) == -1) {
+    if (WebRtcApm_CreateFloatBuffer(&aec->outFrBuf, FRAME_LEN + PART_LEN) == -1) {
         WebRtcAec_FreeAec(aec);
         aec = NULL;
         return -1;
     }
 
-    if (WebRtcApm_CreateBuffer(&aec->nearFrBufH, FRAME_LEN + PART_LEN) == -1) {
+    if (WebRtcApm_CreateFloatBuffer(&aec->nearFrBufH, FRAME_LEN + PART_LEN) == -1) {
         WebRtcAec_FreeAec(aec);
         aec = NULL;
         return -1;
     }
 
-    if (WebRtcApm_CreateBuffer(&aec->outFrBufH, FRAME_LEN + PART_LEN) == -1) {
+    if (WebRtcApm_CreateFloatBuffer(&aec->outFrBufH, FRAME_LEN + PART_LEN) == -1) {
         WebRtcAec_FreeAec(aec);
         aec = NULL;
         return -1;
     }
 
+    aec->compact = 0;
+
+    return 0;
+}
+
+// Creates the H band buffers where they are missing, or frees them in compact
+// mode below 32 kHz.
+static int SizeHighBandBuffers(aec_t *aec)
+{
+    if (aec->compact && aec->sampFreq != 32000) {
+        WebRtcApm_FreeBuffer(aec->nearFrBufH);
+        WebRtcApm_FreeBuffer(aec->outFrBufH);
+        aec->nearFrBufH = NULL;
+        aec->outFrBufH = NULL;
+        return 0;
+    }
+
+    if (aec->nearFrBufH == NULL &&
+        WebRtcApm_CreateFloatBuffer(&aec->nearFrBufH, FRAME_LEN + PART_LEN) == -1) {
+        aec->nearFrBufH = NULL;
+        return -1;
+    }
+
+    if (aec->outFrBufH == NULL &&
+        WebRtcApm_CreateFloatBuffer(&aec->outFrBufH, FRAME_LEN + PART_LEN) == -1) {
+        aec->outFrBufH = NULL;
+        return -1;
+    }
+
     return 0;
 }
 
@@ -367,12 +411,18 @@ int WebRtcAec_InitAec(aec_t *aec, int sampFreq)
         return -1;
     }
 
-    if (WebRtcApm_InitBuffer(aec->nearFrBufH) == -1) {
+    if (SizeHighBandBuffers(aec) == -1) {
         return -1;
     }
 
-    if (WebRtcApm_InitBuffer(aec->outFrBufH) == -1) {
-        return -1;
+    if (aec->nearFrBufH != NULL) {
+        if (WebRtcApm_InitBuffer(aec->nearFrBufH) == -1) {
+            return -1;
+        }
+
+        if (WebRtcApm_InitBuffer(aec->outFrBufH) == -1) {
+            return -1;
+        }
     }
 
     // Default target suppression level
@@ -408,6 +458,15 @@ int WebRtcAec_InitAec(aec_t *aec, int sampFreq)
     memset(aec->dInitMinPow, 0, sizeof(aec->dInitMinPow));
     aec->noisePow = aec->dInitMinPow;
     aec->noiseEstCtr = 0;
+    aec->farSilentBlocks = 0;
+    aec->dormant = 0;
+    aec->dormantDelay = 0;
+
+    memset(aec->cnMag, 0, sizeof(aec->cnMag));
+    aec->cnMagH = 0;
+    aec->cnAudible = 0;
+    aec->cnBufLen = 0;
+    memset(aec->cnOutBuf, 0, sizeof(aec->cnOutBuf));
 
     // Initial comfort noise power
     for (i = 0; i < PART_LEN1; i++) {
@@ -444,6 +503,7 @@ int WebRtcAec_InitAec(aec_t *aec, int sampFreq)
     aec->overDrive = 2;
     aec->overDriveSm = 2;
     aec->delayIdx = 0;
+    memset(aec->delayHistogram, 0, sizeof(aec->delayHistogram));
     aec->stNearState = 0;
     aec->echoState = 0;
     aec->divergeState = 0;
@@ -460,7 +520,13 @@ int WebRtcAec_InitAec(aec_t *aec, int sampFreq)
 
     // Metrics disabled by default
     aec->metricsMode = 0;
-    WebRtcAec_InitMetrics(aec);
+    WebRtcAec_InitMetrics(&aec->metrics);
+    aec->deferMetrics = 0;
+    aec->numMetricsBlocks = 0;
+
+    // No spectrum filter by default
+    aec->spectrumFilter = NULL;
+    aec->spectrumFilterContext = NULL;
 
     // Assembly optimization
     WebRtcAec_FilterFar = FilterFar;
@@ -477,33 +543,87 @@ int WebRtcAec_InitAec(aec_t *aec, int sampFreq)
     return 0;
 }
 
-void WebRtcAec_InitMetrics(aec_t *aec)
+int WebRtcAec_ChangeSampFreqAec(aec_t *aec, int sampFreq)
 {
-    aec->stateCounter = 0;
-    WebRtcAec_InitLevel(&aec->farlevel);
-    WebRtcAec_InitLevel(&aec->nearlevel);
-    WebRtcAec_InitLevel(&aec->linoutlevel);
-    WebRtcAec_InitLevel(&aec->nlpoutlevel);
-
-    WebRtcAec_InitStats(&aec->erl);
-    WebRtcAec_InitStats(&aec->erle);
-    WebRtcAec_InitStats(&aec->aNlp);
-    WebRtcAec_InitStats(&aec->rerl);
+    float zeros[PART_LEN2];
+    int size;
+
+    // The low band runs at 16 kHz for both rates, with the same multiplier.
+    if ((sampFreq != 16000 && sampFreq != 32000) || aec->mult != 2) {
+        return -1;
+    }
+    aec->sampFreq = sampFreq;
+
+    if (SizeHighBandBuffers(aec) == -1) {
+        return -1;
+    }
+    memset(aec->dBufH, 0, sizeof(aec->dBufH));
+    memset(aec->dormantBufH, 0, sizeof(aec->dormantBufH));
+    memset(aec->cnBufH, 0, sizeof(aec->cnBufH));
+    if (aec->nearFrBufH == NULL) {
+        return 0;
+    }
+
+    // The H band is buffered in step with the L band. Restart it from silence
+    // at the current L band buffer levels.
+    if (WebRtcApm_InitBuffer(aec->nearFrBufH) == -1) {
+        return -1;
+    }
+
+    if (WebRtcApm_InitBuffer(aec->outFrBufH) == -1) {
+        return -1;
+    }
+
+    memset(zeros, 0, sizeof(zeros));
+    size = WEBRTC_SPL_MIN(WebRtcApm_get_buffer_size(aec->nearFrBuf), PART_LEN2);
+    WebRtcApm_WriteBufferFloat(aec->nearFrBufH, zeros, size);
+    size = WEBRTC_SPL_MIN(WebRtcApm_get_buffer_size(aec->outFrBuf), PART_LEN2);
+    WebRtcApm_WriteBufferFloat(aec->outFrBufH, zeros, size);
+
+    return 0;
+}
+
+void WebRtcAec_InitMetrics(aec_metrics_t *metrics)
+{
+    metrics->stateCounter = 0;
+    WebRtcAec_InitLevel(&metrics->farlevel);
+    WebRtcAec_InitLevel(&metrics->nearlevel);
+    WebRtcAec_InitLevel(&metrics->linoutlevel);
+    WebRtcAec_InitLevel(&metrics->nlpoutlevel);
+
+    WebRtcAec_InitStats(&metrics->erl);
+    WebRtcAec_InitStats(&metrics->erle);
+    WebRtcAec_InitStats(&metrics->aNlp);
+    WebRtcAec_InitStats(&metrics->rerl);
 }
 
 
 void WebRtcAec_ProcessFrame(aec_t *aec, const short *farend,
-                       const short *nearend, const short *nearendH,
-                       short *out, short *outH,
+                       const float *nearend, const float *nearendH,
+                       float *out, float *outH,
                        int knownDelay)
 {
-    short farBl[PART_LEN], nearBl[PART_LEN], outBl[PART_LEN];
-    short farFr[FRAME_LEN];
+    short farBl[PART_LEN], farFr[FRAME_LEN];
+    float nearBl[PART_LEN], outBl[PART_LEN];
     // For H band
-    short nearBlH[PART_LEN], outBlH[PART_LEN];
+    float nearBlH[PART_LEN], outBlH[PART_LEN];
 
     int size = 0;
 
+    // While dormant, and as long as the filter has only seen silence, the
+    // frame is passed through ahead of any buffering or block processing.
+    // The estimates are held until the farend returns.
+    if (aec->dormant && aec->farSilentBlocks > NR_PART &&
+        aec->spectrumFilter == NULL && IsSilent(farend, FRAME_LEN)) {
+        if (aec->dormantDelay > 0 || SuspendFrameBuffers(aec) == 0) {
+            PassThroughFrame(aec, nearend, nearendH, out, outH);
+            return;
+        }
+    }
+    else if (aec->dormantDelay > 0) {
+        ResumeFrameBuffers(aec);
+    }
+
     // initialize: only used for SWB
     memset(nearBlH, 0, sizeof(nearBlH));
     memset(outBlH, 0, sizeof(outBlH));
@@ -516,29 +636,29 @@ void WebRtcAec_ProcessFrame(aec_t *aec, const short *farend,
     // Buffer the synchronized far and near frames,
     // to pass the smaller blocks individually.
     WebRtcApm_WriteBuffer(aec->farFrBuf, farFr, FRAME_LEN);
-    WebRtcApm_WriteBuffer(aec->nearFrBuf, nearend, FRAME_LEN);
+    WebRtcApm_WriteBufferFloat(aec->nearFrBuf, nearend, FRAME_LEN);
     // For H band
     if (aec->sampFreq == 32000) {
-        WebRtcApm_WriteBuffer(aec->nearFrBufH, nearendH, FRAME_LEN);
+        WebRtcApm_WriteBufferFloat(aec->nearFrBufH, nearendH, FRAME_LEN);
     }
 
     // Process as many blocks as possible.
     while (WebRtcApm_get_buffer_size(aec->farFrBuf) >= PART_LEN) {
 
         WebRtcApm_ReadBuffer(aec->farFrBuf, farBl, PART_LEN);
-        WebRtcApm_ReadBuffer(aec->nearFrBuf, nearBl, PART_LEN);
+        WebRtcApm_ReadBufferFloat(aec->nearFrBuf, nearBl, PART_LEN);
 
         // For H band
         if (aec->sampFreq == 32000) {
-            WebRtcApm_ReadBuffer(aec->nearFrBufH, nearBlH, PART_LEN);
+            WebRtcApm_ReadBufferFloat(aec->nearFrBufH, nearBlH, PART_LEN);
         }
 
-        ProcessBlock(aec, farBl, nearBl, nearBlH, outBl, outBlH);
+        ProcessBlock(aec, farBl, NULL, nearBl, nearBlH, outBl, outBlH);
 
-        WebRtcApm_WriteBuffer(aec->outFrBuf, outBl, PART_LEN);
+        WebRtcApm_WriteBufferFloat(aec->outFrBuf, outBl, PART_LEN);
         // For H band
         if (aec->sampFreq == 32000) {
-            WebRtcApm_WriteBuffer(aec->outFrBufH, outBlH, PART_LEN);
+            WebRtcApm_WriteBufferFloat(aec->outFrBufH, outBlH, PART_LEN);
         }
     }
 
@@ -553,37 +673,85 @@ void WebRtcAec_ProcessFrame(aec_t *aec, const short *farend,
     }
 
     // Obtain an output frame.
-    WebRtcApm_ReadBuffer(aec->outFrBuf, out, FRAME_LEN);
+    WebRtcApm_ReadBufferFloat(aec->outFrBuf, out, FRAME_LEN);
     // For H band
     if (aec->sampFreq == 32000) {
-        WebRtcApm_ReadBuffer(aec->outFrBufH, outH, FRAME_LEN);
+        WebRtcApm_ReadBufferFloat(aec->outFrBufH, outH, FRAME_LEN);
+    }
+}
+
+void WebRtcAec_ProcessBlock(aec_t *aec, const short *farend,
+                            const float *nearend, const float *nearendH,
+                            float *out, float *outH,
+                            int knownDelay)
+{
+    short farBl[PART_LEN];
+
+    // With block-aligned input, the near and far ends need no reframing.
+    BufferFar(aec, farend, PART_LEN);
+    FetchFar(aec, farBl, PART_LEN, knownDelay);
+
+    ProcessBlock(aec, farBl, NULL, nearend, nearendH, out, outH);
+}
+
+void WebRtcAec_ComputeFarSpectra(const short *history, const short *farend,
+                                 int nBlocks, far_spectrum_t *farSpectra)
+{
+    int i, j;
+    float xBuf[PART_LEN2];
+    const short *oldBlock = history;
+
+    for (j = 0; j < nBlocks; j++) {
+        for (i = 0; i < PART_LEN; i++) {
+            xBuf[i] = (float)oldBlock[i];
+            xBuf[PART_LEN + i] = (float)farend[j * PART_LEN + i];
+        }
+        ComputeFarSpectrum(xBuf, &farSpectra[j]);
+        oldBlock = &farend[j * PART_LEN];
     }
 }
 
+void WebRtcAec_ProcessBlockFarSpectrum(aec_t *aec, const short *farend,
+                                       const far_spectrum_t *farSpectrum,
+                                       const float *nearend,
+                                       const float *nearendH,
+                                       float *out, float *outH)
+{
+    ProcessBlock(aec, farend, farSpectrum, nearend, nearendH, out, outH);
+}
+
+// Processes one block. The farend spectra are computed here unless given in
+// |farSpectrum|.
 static void ProcessBlock(aec_t *aec, const short *farend,
-                              const short *nearend, const short *nearendH,
-                              short *output, short *outputH)
+                              const far_spectrum_t *farSpectrum,
+                              const float *nearend, const float *nearendH,
+                              float *output, float *outputH)
 {
     int i;
     float d[PART_LEN], y[PART_LEN], e[PART_LEN], dH[PART_LEN];
-    short eInt16[PART_LEN];
+#ifdef AEC_DEBUG
+    short nearInt16[PART_LEN], eInt16[PART_LEN], outInt16[PART_LEN];
+#endif
     float scale;
 
     float fft[PART_LEN2];
-    float xf[2][PART_LEN1], yf[2][PART_LEN1], ef[2][PART_LEN1];
-    complex_t df[PART_LEN1];
-
-    const float gPow[2] = {0.9f, 0.1f};
+    float yf[2][PART_LEN1], ef[2][PART_LEN1];
+    far_spectrum_t farSpectrumBlock;
 
-    // Noise estimate constants.
-    const int noiseInitBlocks = 500 * aec->mult;
-    const float step = 0.1f;
-    const float ramp = 1.0002f;
-    const float gInitNoise[2] = {0.999f, 0.001f};
+    // While dormant, blocks are passed through as long as the filter has
+    // only seen silence. Any farend activity restores full processing.
+    if (aec->dormant && aec->farSilentBlocks > NR_PART &&
+        aec->spectrumFilter == NULL && IsSilent(farend, PART_LEN)) {
+        PassThroughBlock(aec, nearend, nearendH, output, outputH);
+        return;
+    }
 
 #ifdef AEC_DEBUG
+    for (i = 0; i < PART_LEN; i++) {
+        nearInt16[i] = SaturateW16(nearend[i]);
+    }
     fwrite(farend, sizeof(short), PART_LEN, aec->farFile);
-    fwrite(nearend, sizeof(short), PART_LEN, aec->nearFile);
+    fwrite(nearInt16, sizeof(short), PART_LEN, aec->nearFile);
 #endif
 
     memset(dH, 0, sizeof(dH));
@@ -592,88 +760,27 @@ static void ProcessBlock(aec_t *aec, const short *farend,
     // Concatenate old and new farend blocks.
     for (i = 0; i < PART_LEN; i++) {
         aec->xBuf[i + PART_LEN] = (float)farend[i];
-        d[i] = (float)nearend[i];
+        d[i] = nearend[i];
+    }
+    if (farSpectrum == NULL) {
+        ComputeFarSpectrum(aec->xBuf, &farSpectrumBlock);
+        farSpectrum = &farSpectrumBlock;
     }
 
     if (aec->sampFreq == 32000) {
         for (i = 0; i < PART_LEN; i++) {
-            dH[i] = (float)nearendH[i];
+            dH[i] = nearendH[i];
         }
     }
 
 
-    memcpy(fft, aec->xBuf, sizeof(float) * PART_LEN2);
     memcpy(aec->dBuf + PART_LEN, d, sizeof(float) * PART_LEN);
     // For H band
     if (aec->sampFreq == 32000) {
         memcpy(aec->dBufH + PART_LEN, dH, sizeof(float) * PART_LEN);
     }
 
-    aec_rdft_forward_128(fft);
-
-    // Far fft
-    xf[1][0] = 0;
-    xf[1][PART_LEN] = 0;
-    xf[0][0] = fft[0];
-    xf[0][PART_LEN] = fft[1];
-
-    for (i = 1; i < PART_LEN; i++) {
-        xf[0][i] = fft[2 * i];
-        xf[1][i] = fft[2 * i + 1];
-    }
-
-    // Near fft
-    memcpy(fft, aec->dBuf, sizeof(float) * PART_LEN2);
-    aec_rdft_forward_128(fft);
-    df[0][1] = 0;
-    df[PART_LEN][1] = 0;
-    df[0][0] = fft[0];
-    df[PART_LEN][0] = fft[1];
-
-    for (i = 1; i < PART_LEN; i++) {
-        df[i][0] = fft[2 * i];
-        df[i][1] = fft[2 * i + 1];
-    }
-
-    // Power smoothing
-    for (i = 0; i < PART_LEN1; i++) {
-        aec->xPow[i] = gPow[0] * aec->xPow[i] + gPow[1] * NR_PART *
-            (xf[0][i] * xf[0][i] + xf[1][i] * xf[1][i]);
-        aec->dPow[i] = gPow[0] * aec->dPow[i] + gPow[1] *
-            (df[i][0] * df[i][0] + df[i][1] * df[i][1]);
-    }
-
-    // Estimate noise power. Wait until dPow is more stable.
-    if (aec->noiseEstCtr > 50) {
-        for (i = 0; i < PART_LEN1; i++) {
-            if (aec->dPow[i] < aec->dMinPow[i]) {
-                aec->dMinPow[i] = (aec->dPow[i] + step * (aec->dMinPow[i] -
-                    aec->dPow[i])) * ramp;
-            }
-            else {
-                aec->dMinPow[i] *= ramp;
-            }
-        }
-    }
-
-    // Smooth increasing noise power from zero at the start,
-    // to avoid a sudden burst of comfort noise.
-    if (aec->noiseEstCtr < noiseInitBlocks) {
-        aec->noiseEstCtr++;
-        for (i = 0; i < PART_LEN1; i++) {
-            if (aec->dMinPow[i] > aec->dInitMinPow[i]) {
-                aec->dInitMinPow[i] = gInitNoise[0] * aec->dInitMinPow[i] +
-                    gInitNoise[1] * aec->dMinPow[i];
-            }
-            else {
-                aec->dInitMinPow[i] = aec->dMinPow[i];
-            }
-        }
-        aec->noisePow = aec->dInitMinPow;
-    }
-    else {
-        aec->noisePow = aec->dMinPow;
-    }
+    UpdatePowers(aec, farSpectrum->xPow);
 
 
     // Update the xfBuf block position.
@@ -683,95 +790,169 @@ static void ProcessBlock(aec_t *aec, const short *farend,
     }
 
     // Buffer xf
-    memcpy(aec->xfBuf[0] + aec->xfBufBlockPos * PART_LEN1, xf[0],
+    memcpy(aec->xfBuf[0] + aec->xfBufBlockPos * PART_LEN1, farSpectrum->xf[0],
            sizeof(float) * PART_LEN1);
-    memcpy(aec->xfBuf[1] + aec->xfBufBlockPos * PART_LEN1, xf[1],
+    memcpy(aec->xfBuf[1] + aec->xfBufBlockPos * PART_LEN1, farSpectrum->xf[1],
            sizeof(float) * PART_LEN1);
 
-    memset(yf[0], 0, sizeof(float) * (PART_LEN1 * 2));
-
-    // Filter far
-    WebRtcAec_FilterFar(aec, yf);
-
-    // Inverse fft to obtain echo estimate and error.
-    fft[0] = yf[0][0];
-    fft[1] = yf[0][PART_LEN];
-    for (i = 1; i < PART_LEN; i++) {
-        fft[2 * i] = yf[0][i];
-        fft[2 * i + 1] = yf[1][i];
+    // Count the farend blocks of digital silence. Once all farend spectra in
+    // the filter are zero, the echo estimate and the filter update are exactly
+    // zero, so the linear stage reduces to e = d.
+    if (!IsSilent(farend, PART_LEN)) {
+        aec->farSilentBlocks = 0;
     }
-    aec_rdft_inverse_128(fft);
-
-    scale = 2.0f / PART_LEN2;
-    for (i = 0; i < PART_LEN; i++) {
-        y[i] = fft[PART_LEN + i] * scale; // fft scaling
+    else if (aec->farSilentBlocks <= NR_PART) {
+        aec->farSilentBlocks++;
     }
 
-    for (i = 0; i < PART_LEN; i++) {
-        e[i] = d[i] - y[i];
+    if (aec->farSilentBlocks > NR_PART) {
+        memcpy(e, d, sizeof(float) * PART_LEN);
+        memcpy(aec->eBuf + PART_LEN, e, sizeof(float) * PART_LEN);
     }
+    else {
+        memset(yf[0], 0, sizeof(float) * (PART_LEN1 * 2));
 
-    // Error fft
-    memcpy(aec->eBuf + PART_LEN, e, sizeof(float) * PART_LEN);
-    memset(fft, 0, sizeof(float) * PART_LEN);
-    memcpy(fft + PART_LEN, e, sizeof(float) * PART_LEN);
-    aec_rdft_forward_128(fft);
+        // Filter far
+        WebRtcAec_FilterFar(aec, yf);
 
-    ef[1][0] = 0;
-    ef[1][PART_LEN] = 0;
-    ef[0][0] = fft[0];
-    ef[0][PART_LEN] = fft[1];
-    for (i = 1; i < PART_LEN; i++) {
-        ef[0][i] = fft[2 * i];
-        ef[1][i] = fft[2 * i + 1];
-    }
+        // Inverse fft to obtain echo estimate and error.
+        fft[0] = yf[0][0];
+        fft[1] = yf[0][PART_LEN];
+        for (i = 1; i < PART_LEN; i++) {
+            fft[2 * i] = yf[0][i];
+            fft[2 * i + 1] = yf[1][i];
+        }
+        aec_rdft_inverse_128(fft);
+
+        scale = 2.0f / PART_LEN2;
+        for (i = 0; i < PART_LEN; i++) {
+            y[i] = fft[PART_LEN + i] * scale; // fft scaling
+        }
+
+        for (i = 0; i < PART_LEN; i++) {
+            e[i] = d[i] - y[i];
+        }
+
+        // Error fft
+        memcpy(aec->eBuf + PART_LEN, e, sizeof(float) * PART_LEN);
+        memset(fft, 0, sizeof(float) * PART_LEN);
+        memcpy(fft + PART_LEN, e, sizeof(float) * PART_LEN);
+        aec_rdft_forward_128(fft);
+
+        ef[1][0] = 0;
+        ef[1][PART_LEN] = 0;
+        ef[0][0] = fft[0];
+        ef[0][PART_LEN] = fft[1];
+        for (i = 1; i < PART_LEN; i++) {
+            ef[0][i] = fft[2 * i];
+            ef[1][i] = fft[2 * i + 1];
+        }
 
-    // Scale error signal inversely with far power.
-    WebRtcAec_ScaleErrorSignal(aec, ef);
+        // Scale error signal inversely with far power.
+        WebRtcAec_ScaleErrorSignal(aec, ef);
 #ifdef G167
-    if (aec->adaptToggle) {
+        if (aec->adaptToggle) {
 #endif
-        // Filter adaptation
-        WebRtcAec_FilterAdaptation(aec, fft, ef);
+            // Filter adaptation
+            WebRtcAec_FilterAdaptation(aec, fft, ef);
 #ifdef G167
-    }
+        }
 #endif
+    }
 
-    NonLinearProcessing(aec, output, outputH);
+    NonLinearProcessing(aec, farSpectrum->xfw, output, outputH);
 
-#if defined(AEC_DEBUG) || defined(G167)
-    for (i = 0; i < PART_LEN; i++) {
-        eInt16[i] = (short)WEBRTC_SPL_SAT(WEBRTC_SPL_WORD16_MAX, e[i],
-            WEBRTC_SPL_WORD16_MIN);
-    }
-#endif
 #ifdef G167
     if (aec->nlpToggle == 0) {
-        memcpy(output, eInt16, sizeof(eInt16));
+        memcpy(output, e, sizeof(e));
     }
 #endif
 
     if (aec->metricsMode == 1) {
+        AecMetricsBlock block;
+        float farEnergy = 0, nearEnergy = 0, linoutEnergy = 0, nlpoutEnergy = 0;
+
+        // The energies are those of the 16-bit signals, as for 16-bit
+        // input and output.
         for (i = 0; i < PART_LEN; i++) {
-            eInt16[i] = (short)WEBRTC_SPL_SAT(WEBRTC_SPL_WORD16_MAX, e[i],
-                WEBRTC_SPL_WORD16_MIN);
+            const short nearSat = SaturateW16(nearend[i]);
+            const short eSat = SaturateW16(e[i]);
+            const short outSat = SaturateW16(output[i]);
+            farEnergy += farend[i] * farend[i];
+            nearEnergy += nearSat * nearSat;
+            linoutEnergy += eSat * eSat;
+            nlpoutEnergy += outSat * outSat;
+        }
+        block.farEnergy = farEnergy;
+        block.nearEnergy = nearEnergy;
+        block.linearOutEnergy = linoutEnergy;
+        block.nlpOutEnergy = nlpoutEnergy;
+        block.echoState = aec->echoState;
+
+        // Leave the power levels and echo metrics to the owner in deferred
+        // mode.
+        if (!aec->deferMetrics) {
+            WebRtcAec_UpdateMetrics(&aec->metrics, &block);
+        } else if (aec->numMetricsBlocks < kMaxMetricsBlocks) {
+            aec->metricsBlocks[aec->numMetricsBlocks] = block;
+            aec->numMetricsBlocks++;
         }
-
-        // Update power levels and echo metrics
-        UpdateLevel(&aec->farlevel, farend);
-        UpdateLevel(&aec->nearlevel, nearend);
-        UpdateLevel(&aec->linoutlevel, eInt16);
-        UpdateLevel(&aec->nlpoutlevel, output);
-        UpdateMetrics(aec);
     }
 
 #ifdef AEC_DEBUG
+    for (i = 0; i < PART_LEN; i++) {
+        eInt16[i] = SaturateW16(e[i]);
+        outInt16[i] = SaturateW16(output[i]);
+    }
     fwrite(eInt16, sizeof(short), PART_LEN, aec->outLpFile);
-    fwrite(output, sizeof(short), PART_LEN, aec->outFile);
+    fwrite(outInt16, sizeof(short), PART_LEN, aec->outFile);
 #endif
 }
 
-static void NonLinearProcessing(aec_t *aec, short *output, short *outputH)
+// Computes the spectra of the two farend blocks in |xBuf|, the older first.
+static void ComputeFarSpectrum(const float *xBuf, far_spectrum_t *farSpectrum)
+{
+    int i;
+    float fft[PART_LEN2];
+
+    // Far fft
+    memcpy(fft, xBuf, sizeof(float) * PART_LEN2);
+    aec_rdft_forward_128(fft);
+
+    farSpectrum->xf[1][0] = 0;
+    farSpectrum->xf[1][PART_LEN] = 0;
+    farSpectrum->xf[0][0] = fft[0];
+    farSpectrum->xf[0][PART_LEN] = fft[1];
+
+    for (i = 1; i < PART_LEN; i++) {
+        farSpectrum->xf[0][i] = fft[2 * i];
+        farSpectrum->xf[1][i] = fft[2 * i + 1];
+    }
+
+    for (i = 0; i < PART_LEN1; i++) {
+        farSpectrum->xPow[i] = farSpectrum->xf[0][i] * farSpectrum->xf[0][i] +
+            farSpectrum->xf[1][i] * farSpectrum->xf[1][i];
+    }
+
+    // Windowed far fft
+    for (i = 0; i < PART_LEN; i++) {
+        fft[i] = xBuf[i] * sqrtHanning[i];
+        fft[PART_LEN + i] = xBuf[PART_LEN + i] * sqrtHanning[PART_LEN - i];
+    }
+    aec_rdft_forward_128(fft);
+
+    farSpectrum->xfw[0][1] = 0;
+    farSpectrum->xfw[PART_LEN][1] = 0;
+    farSpectrum->xfw[0][0] = fft[0];
+    farSpectrum->xfw[PART_LEN][0] = fft[1];
+    for (i = 1; i < PART_LEN; i++) {
+        farSpectrum->xfw[i][0] = fft[2 * i];
+        farSpectrum->xfw[i][1] = fft[2 * i + 1];
+    }
+}
+
+static void NonLinearProcessing(aec_t *aec, const complex_t *farXfw,
+                                float *output, float *outputH)
 {
     float efw[2][PART_LEN1], dfw[2][PART_LEN1];
     complex_t xfw[PART_LEN1];
@@ -779,6 +960,7 @@ static void NonLinearProcessing(aec_t *aec, short *output, short *outputH)
     float fft[PART_LEN2];
     float scale, dtmp;
     float nlpGainHband;
+    float filterGainHband = 1;
     int i, j, pos;
 
     // Coherence and non-linear filter
@@ -830,27 +1012,16 @@ static void NonLinearProcessing(aec_t *aec, short *output, short *outputH)
                 aec->delayIdx = i;
             }
         }
-    }
-
-    // NLP
-    // Windowed far fft
-    for (i = 0; i < PART_LEN; i++) {
-        fft[i] = aec->xBuf[i] * sqrtHanning[i];
-        fft[PART_LEN + i] = aec->xBuf[PART_LEN + i] * sqrtHanning[PART_LEN - i];
-    }
-    aec_rdft_forward_128(fft);
 
-    xfw[0][1] = 0;
-    xfw[PART_LEN][1] = 0;
-    xfw[0][0] = fft[0];
-    xfw[PART_LEN][0] = fft[1];
-    for (i = 1; i < PART_LEN; i++) {
-        xfw[i][0] = fft[2 * i];
-        xfw[i][1] = fft[2 * i + 1];
+        // Only count estimates of an adapted filter.
+        if (wfEnMax > 0) {
+            aec->delayHistogram[aec->delayIdx]++;
+        }
     }
 
-    // Buffer far.
-    memcpy(aec->xfwBuf, xfw, sizeof(xfw));
+    // NLP
+    // Buffer the windowed far fft.
+    memcpy(aec->xfwBuf, farXfw, sizeof(xfw));
 
     // Use delayed far.
     memcpy(xfw, aec->xfwBuf + aec->delayIdx * PART_LEN1, sizeof(xfw));
@@ -1045,6 +1216,13 @@ static void NonLinearProcessing(aec_t *aec, short *output, short *outputH)
     ComfortNoise(aec, efw, comfortNoiseHband, aec->noisePow, hNl);
 #endif
 
+    // Let a following spectral processor work on the output spectrum, saving
+    // it a separate analysis and synthesis.
+    if (aec->spectrumFilter != NULL) {
+        aec->spectrumFilter(aec->spectrumFilterContext, efw[0], efw[1],
+                            PART_LEN1, &filterGainHband);
+    }
+
     // Inverse error fft.
     fft[0] = efw[0][0];
     fft[1] = efw[0][PART_LEN];
@@ -1059,11 +1237,7 @@ static void NonLinearProcessing(aec_t *aec, short *output, short *outputH)
     scale = 2.0f / PART_LEN2;
     for (i = 0; i < PART_LEN; i++) {
         fft[i] *= scale; // fft scaling
-        fft[i] = fft[i]*sqrtHanning[i] + aec->outBuf[i];
-
-        // Saturation protection
-        output[i] = (short)WEBRTC_SPL_SAT(WEBRTC_SPL_WORD16_MAX, fft[i],
-            WEBRTC_SPL_WORD16_MIN);
+        output[i] = fft[i]*sqrtHanning[i] + aec->outBuf[i];
 
         fft[PART_LEN + i] *= scale; // fft scaling
         aec->outBuf[i] = fft[PART_LEN + i] * sqrtHanning[PART_LEN - i];
@@ -1099,10 +1273,7 @@ static void NonLinearProcessing(aec_t *aec, short *output, short *outputH)
                 fft[i] *= scale; // fft scaling
                 dtmp += cnScaleHband * fft[i];
             }
-
-            // Saturation protection
-            outputH[i] = (short)WEBRTC_SPL_SAT(WEBRTC_SPL_WORD16_MAX, dtmp,
-                WEBRTC_SPL_WORD16_MIN);
+            outputH[i] = dtmp * filterGainHband;
          }
     }
 
@@ -1120,6 +1291,317 @@ static void NonLinearProcessing(aec_t *aec, short *output, short *outputH)
         sizeof(complex_t) * PART_LEN1);
 }
 
+// Updates the smoothed farend and nearend powers from |farPow| and the
+// nearend in |dBuf|, and the nearend noise estimate. A NULL |farPow| stands
+// for a silent farend.
+static void UpdatePowers(aec_t *aec, const float *farPow)
+{
+    int i;
+    float fft[PART_LEN2];
+    complex_t df[PART_LEN1];
+
+    const float gPow[2] = {0.9f, 0.1f};
+
+    // Noise estimate constants.
+    const int noiseInitBlocks = 500 * aec->mult;
+    const float step = 0.1f;
+    const float ramp = 1.0002f;
+    const float gInitNoise[2] = {0.999f, 0.001f};
+
+    // Near fft
+    memcpy(fft, aec->dBuf, sizeof(float) * PART_LEN2);
+    aec_rdft_forward_128(fft);
+    df[0][1] = 0;
+    df[PART_LEN][1] = 0;
+    df[0][0] = fft[0];
+    df[PART_LEN][0] = fft[1];
+
+    for (i = 1; i < PART_LEN; i++) {
+        df[i][0] = fft[2 * i];
+        df[i][1] = fft[2 * i + 1];
+    }
+
+    // Power smoothing
+    for (i = 0; i < PART_LEN1; i++) {
+        aec->xPow[i] = gPow[0] * aec->xPow[i] + gPow[1] * NR_PART *
+            (farPow != NULL ? farPow[i] : 0);
+        aec->dPow[i] = gPow[0] * aec->dPow[i] + gPow[1] *
+            (df[i][0] * df[i][0] + df[i][1] * df[i][1]);
+    }
+
+    // Estimate noise power. Wait until dPow is more stable.
+    if (aec->noiseEstCtr > 50) {
+        for (i = 0; i < PART_LEN1; i++) {
+            if (aec->dPow[i] < aec->dMinPow[i]) {
+                aec->dMinPow[i] = (aec->dPow[i] + step * (aec->dMinPow[i] -
+                    aec->dPow[i])) * ramp;
+            }
+            else {
+                aec->dMinPow[i] *= ramp;
+            }
+        }
+    }
+
+    // Smooth increasing noise power from zero at the start,
+    // to avoid a sudden burst of comfort noise.
+    if (aec->noiseEstCtr < noiseInitBlocks) {
+        aec->noiseEstCtr++;
+        for (i = 0; i < PART_LEN1; i++) {
+            if (aec->dMinPow[i] > aec->dInitMinPow[i]) {
+                aec->dInitMinPow[i] = gInitNoise[0] * aec->dInitMinPow[i] +
+                    gInitNoise[1] * aec->dMinPow[i];
+            }
+            else {
+                aec->dInitMinPow[i] = aec->dMinPow[i];
+            }
+        }
+        aec->noisePow = aec->dInitMinPow;
+    }
+    else {
+        aec->noisePow = aec->dMinPow;
+    }
+}
+
+// Passes a nearend block through with the latency of the full processing,
+// keeping the analysis and overlap-add buffers consistent. This matches the
+// output of NonLinearProcessing() without suppression or comfort noise. The
+// adaptive filter is left untouched, while the power and noise estimates are
+// kept up to date for when processing resumes.
+static void PassThroughBlock(aec_t *aec, const float *nearend,
+                             const float *nearendH, float *output,
+                             float *outputH)
+{
+    int i;
+
+    memcpy(aec->dBuf + PART_LEN, nearend, sizeof(float) * PART_LEN);
+    memcpy(aec->eBuf + PART_LEN, aec->dBuf + PART_LEN, sizeof(float) * PART_LEN);
+    UpdatePowers(aec, NULL);
+
+    // The squared windows of consecutive blocks add up to one.
+    for (i = 0; i < PART_LEN; i++) {
+        output[i] = aec->eBuf[i] * sqrtHanning[i] * sqrtHanning[i] +
+            aec->outBuf[i];
+        aec->outBuf[i] = aec->eBuf[PART_LEN + i] * sqrtHanning[PART_LEN - i] *
+            sqrtHanning[PART_LEN - i];
+    }
+
+    if (aec->sampFreq == 32000) {
+        memcpy(aec->dBufH + PART_LEN, nearendH, sizeof(float) * PART_LEN);
+        memcpy(outputH, aec->dBufH, sizeof(float) * PART_LEN);
+        memcpy(aec->dBufH, aec->dBufH + PART_LEN, sizeof(float) * PART_LEN);
+    }
+
+    AddDormantComfortNoise(aec, output, outputH, PART_LEN);
+
+    // The farend is silent, so its buffers stay zero.
+    memcpy(aec->dBuf, aec->dBuf + PART_LEN, sizeof(float) * PART_LEN);
+    memcpy(aec->eBuf, aec->eBuf + PART_LEN, sizeof(float) * PART_LEN);
+
+    aec->echoState = 0;
+}
+
+// Moves the nearend in flight into |dormantBuf|: the output frame buffer,
+// the last block completed as by PassThroughBlock() and the nearend frame
+// buffer, in that order. The farend frame buffer is left as it is, still in
+// step with the nearend. Returns -1 if it does not fit.
+static int SuspendFrameBuffers(aec_t *aec)
+{
+    int i;
+    const int outLen = WebRtcApm_get_buffer_size(aec->outFrBuf);
+    const int nearLen = WebRtcApm_get_buffer_size(aec->nearFrBuf);
+    const int delay = outLen + PART_LEN + nearLen;
+
+    if (delay + FRAME_LEN > DORMANT_BUF_LEN) {
+        return -1;
+    }
+
+    if (outLen > 0) {
+        WebRtcApm_ReadBufferFloat(aec->outFrBuf, aec->dormantBuf, outLen);
+    }
+    for (i = 0; i < PART_LEN; i++) {
+        aec->dormantBuf[outLen + i] = aec->eBuf[i] * sqrtHanning[i] *
+            sqrtHanning[i] + aec->outBuf[i];
+    }
+    if (nearLen > 0) {
+        WebRtcApm_ReadBufferFloat(aec->nearFrBuf,
+                             &aec->dormantBuf[outLen + PART_LEN], nearLen);
+    }
+
+    if (aec->sampFreq == 32000) {
+        if (outLen > 0) {
+            WebRtcApm_ReadBufferFloat(aec->outFrBufH, aec->dormantBufH, outLen);
+        }
+        memcpy(&aec->dormantBufH[outLen], aec->dBufH, sizeof(float) * PART_LEN);
+        if (nearLen > 0) {
+            WebRtcApm_ReadBufferFloat(aec->nearFrBufH,
+                                 &aec->dormantBufH[outLen + PART_LEN], nearLen);
+        }
+    }
+
+    aec->dormantDelay = delay;
+    aec->echoState = 0;
+
+    return 0;
+}
+
+// Outputs the oldest frame of |dormantBuf| and holds back |nearend| in its
+// place, keeping the latency of the full processing.
+static void PassThroughFrame(aec_t *aec, const float *nearend,
+                             const float *nearendH, float *out, float *outH)
+{
+    const int delay = aec->dormantDelay;
+
+    memcpy(&aec->dormantBuf[delay], nearend, sizeof(float) * FRAME_LEN);
+    memcpy(out, aec->dormantBuf, sizeof(float) * FRAME_LEN);
+    memmove(aec->dormantBuf, &aec->dormantBuf[FRAME_LEN], sizeof(float) * delay);
+
+    if (aec->sampFreq == 32000) {
+        memcpy(&aec->dormantBufH[delay], nearendH, sizeof(float) * FRAME_LEN);
+        memcpy(outH, aec->dormantBufH, sizeof(float) * FRAME_LEN);
+        memmove(aec->dormantBufH, &aec->dormantBufH[FRAME_LEN],
+                sizeof(float) * delay);
+    }
+
+    AddDormantComfortNoise(aec, out, outH, FRAME_LEN);
+}
+
+// Returns the nearend held in |dormantBuf| to where SuspendFrameBuffers()
+// took it from, with the last block as if it had been passed through.
+static void ResumeFrameBuffers(aec_t *aec)
+{
+    int i;
+    const int nearLen = WebRtcApm_get_buffer_size(aec->farFrBuf);
+    const int outLen = aec->dormantDelay - PART_LEN - nearLen;
+    const float *block = &aec->dormantBuf[outLen];
+
+    if (outLen > 0) {
+        WebRtcApm_WriteBufferFloat(aec->outFrBuf, aec->dormantBuf, outLen);
+    }
+    for (i = 0; i < PART_LEN; i++) {
+        aec->dBuf[i] = block[i];
+        aec->eBuf[i] = aec->dBuf[i];
+        aec->outBuf[i] = aec->eBuf[i] * sqrtHanning[PART_LEN - i] *
+            sqrtHanning[PART_LEN - i];
+    }
+    if (nearLen > 0) {
+        WebRtcApm_WriteBufferFloat(aec->nearFrBuf, &block[PART_LEN], nearLen);
+    }
+
+    if (aec->sampFreq == 32000) {
+        block = &aec->dormantBufH[outLen];
+        if (outLen > 0) {
+            WebRtcApm_WriteBufferFloat(aec->outFrBufH, aec->dormantBufH, outLen);
+        }
+        memcpy(aec->dBufH, block, sizeof(float) * PART_LEN);
+        if (nearLen > 0) {
+            WebRtcApm_WriteBufferFloat(aec->nearFrBufH, &block[PART_LEN],
+                                       nearLen);
+        }
+    }
+
+    // The comfort noise restarts with the next processed block.
+    aec->cnBufLen = 0;
+    memset(aec->cnOutBuf, 0, sizeof(aec->cnOutBuf));
+    aec->dormantDelay = 0;
+}
+
+// Appends a block to |cnBuf|, the comfort noise NonLinearProcessing() would
+// add with the noise estimate and gains held in |cnMag|.
+static void DormantComfortNoise(aec_t *aec)
+{
+    int i;
+    float fft[PART_LEN2];
+    float *noise = &aec->cnBuf[aec->cnBufLen];
+    float *noiseH = &aec->cnBufH[aec->cnBufLen];
+    WebRtc_Word16 cosQ13[PART_LEN];
+    WebRtc_Word16 sinQ13[PART_LEN];
+
+    const float kQ13ToFloat = 1.0f / 8192;
+    const float scale = 2.0f / PART_LEN2;
+
+    WebRtcSpl_RandPhaseQ13(cosQ13, sinQ13, PART_LEN, &aec->seed);
+
+    // The phases of ComfortNoise(), with the sign change of the Ooura fft.
+    fft[0] = 0;
+    fft[1] = aec->cnMag[PART_LEN] * kQ13ToFloat * cosQ13[PART_LEN - 1];
+    for (i = 1; i < PART_LEN; i++) {
+        fft[2 * i] = aec->cnMag[i] * kQ13ToFloat * cosQ13[i - 1];
+        fft[2 * i + 1] = aec->cnMag[i] * kQ13ToFloat * sinQ13[i - 1];
+    }
+    aec_rdft_inverse_128(fft);
+
+    for (i = 0; i < PART_LEN; i++) {
+        noise[i] = fft[i] * scale * sqrtHanning[i] + aec->cnOutBuf[i];
+        aec->cnOutBuf[i] = fft[PART_LEN + i] * scale *
+            sqrtHanning[PART_LEN - i];
+    }
+
+    if (aec->sampFreq == 32000 && flagHbandCn == 1) {
+        fft[0] = 0;
+        fft[1] = aec->cnMagH * kQ13ToFloat * cosQ13[PART_LEN - 1];
+        for (i = 1; i < PART_LEN; i++) {
+            fft[2 * i] = aec->cnMagH * kQ13ToFloat * cosQ13[i - 1];
+            fft[2 * i + 1] = -aec->cnMagH * kQ13ToFloat * sinQ13[i - 1];
+        }
+        aec_rdft_inverse_128(fft);
+
+        for (i = 0; i < PART_LEN; i++) {
+            noiseH[i] = cnScaleHband * fft[i] * scale;
+        }
+    }
+    else {
+        memset(noiseH, 0, sizeof(float) * PART_LEN);
+    }
+
+    aec->cnBufLen += PART_LEN;
+}
+
+// Adds |len| samples of the held comfort noise to the passed through output.
+static void AddDormantComfortNoise(aec_t *aec, float *out, float *outH,
+                                   int len)
+{
+    int i;
+
+    if (!aec->cnAudible) {
+        return;
+    }
+
+    while (aec->cnBufLen < len) {
+        DormantComfortNoise(aec);
+    }
+
+    for (i = 0; i < len; i++) {
+        out[i] += aec->cnBuf[i];
+    }
+    if (aec->sampFreq == 32000) {
+        for (i = 0; i < len; i++) {
+            outH[i] += aec->cnBufH[i];
+        }
+    }
+
+    aec->cnBufLen -= len;
+    memmove(aec->cnBuf, &aec->cnBuf[len], sizeof(float) * aec->cnBufLen);
+    memmove(aec->cnBufH, &aec->cnBufH[len], sizeof(float) * aec->cnBufLen);
+}
+
+// Limits to the 16-bit range and truncates towards zero.
+static short SaturateW16(float value)
+{
+    return (short)WEBRTC_SPL_SAT(WEBRTC_SPL_WORD16_MAX, value,
+                                 WEBRTC_SPL_WORD16_MIN);
+}
+
+static int IsSilent(const short *in, int length)
+{
+    int i;
+    for (i = 0; i < length; i++) {
+        if (in[i] != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 static void GetHighbandGain(const float *lambda, float *nlpGainHband)
 {
     int i;
@@ -1134,84 +1616,67 @@ static void GetHighbandGain(const float *lambda, float *nlpGainHband)
 static void ComfortNoise(aec_t *aec, float efw[2][PART_LEN1],
     complex_t *comfortNoiseHband, const float *noisePow, const float *lambda)
 {
-    int i, num;
-    float rand[PART_LEN];
-    float noise, noiseAvg, tmp, tmpAvg;
-    WebRtc_Word16 randW16[PART_LEN];
+    int i;
+    float noiseAvg, weightAvg, magSum;
+    float noise[PART_LEN1];
+    float weight[PART_LEN1];
+    WebRtc_Word16 cosQ13[PART_LEN];
+    WebRtc_Word16 sinQ13[PART_LEN];
     complex_t u[PART_LEN1];
 
-    const float pi2 = 6.28318530717959f;
+    const float kQ13ToFloat = 1.0f / 8192;
 
-    // Generate a uniform random array on [0 1]
-    WebRtcSpl_RandUArray(randW16, PART_LEN, &aec->seed);
-    for (i = 0; i < PART_LEN; i++) {
-        rand[i] = ((float)randW16[i]) / 32768;
-    }
+    // Random phases from the SPL tables, which are accurate enough for noise.
+    WebRtcSpl_RandPhaseQ13(cosQ13, sinQ13, PART_LEN, &aec->seed);
 
     // Reject LF noise
     u[0][0] = 0;
     u[0][1] = 0;
     for (i = 1; i < PART_LEN1; i++) {
-        tmp = pi2 * rand[i - 1];
-
-        noise = sqrtf(noisePow[i]);
-        u[i][0] = noise * (float)cos(tmp);
-        u[i][1] = -noise * (float)sin(tmp);
+        u[i][0] = kQ13ToFloat * cosQ13[i - 1];
+        u[i][1] = -kQ13ToFloat * sinQ13[i - 1];
     }
     u[PART_LEN][1] = 0;
 
+    magSum = 0;
     for (i = 0; i < PART_LEN1; i++) {
+        noise[i] = sqrtf(noisePow[i]);
         // This is the proper weighting to match the background noise power
-        tmp = sqrtf(WEBRTC_SPL_MAX(1 - lambda[i] * lambda[i], 0));
-        //tmp = 1 - lambda[i];
-        efw[0][i] += tmp * u[i][0];
-        efw[1][i] += tmp * u[i][1];
+        weight[i] = sqrtf(WEBRTC_SPL_MAX(1 - lambda[i] * lambda[i], 0));
+        efw[0][i] += weight[i] * noise[i] * u[i][0];
+        efw[1][i] += weight[i] * noise[i] * u[i][1];
+
+        // Held for the dormant mode.
+        aec->cnMag[i] = weight[i] * noise[i];
+        magSum += aec->cnMag[i];
     }
+    // Bounds the noise after the inverse fft and overlap-add.
+    aec->cnAudible = (2 * 2.0f / PART_LEN2 * magSum >= 1.0f);
 
     // For H band comfort noise
-    // TODO: don't compute noise and "tmp" twice. Use the previous results.
-    noiseAvg = 0.0;
-    tmpAvg = 0.0;
-    num = 0;
     if (aec->sampFreq == 32000 && flagHbandCn == 1) {
 
-        // average noise scale
-        // average over second half of freq spectrum (i.e., 4->8khz)
-        // TODO: we shouldn't need num. We know how many elements we're summing.
+        // Average noise and NLP weight over the second half of the L band
+        // (i.e., 4->8khz), reusing the values computed above.
+        noiseAvg = 0.0;
+        weightAvg = 0.0;
         for (i = PART_LEN1 >> 1; i < PART_LEN1; i++) {
-            num++;
-            noiseAvg += sqrtf(noisePow[i]);
+            noiseAvg += noise[i];
+            weightAvg += weight[i];
         }
-        noiseAvg /= (float)num;
+        noiseAvg /= (float)(PART_LEN1 - (PART_LEN1 >> 1));
+        weightAvg /= (float)(PART_LEN1 - (PART_LEN1 >> 1));
 
-        // average nlp scale
-        // average over second half of freq spectrum (i.e., 4->8khz)
-        // TODO: we shouldn't need num. We know how many elements we're summing.
-        num = 0;
-        for (i = PART_LEN1 >> 1; i < PART_LEN1; i++) {
-            num++;
-            tmpAvg += sqrtf(WEBRTC_SPL_MAX(1 - lambda[i] * lambda[i], 0));
+        aec->cnMagH = weightAvg * noiseAvg;
+        if (cnScaleHband * 2.0f / PART_LEN2 * PART_LEN1 * aec->cnMagH >= 1.0f) {
+            aec->cnAudible = 1;
         }
-        tmpAvg /= (float)num;
 
-        // Use average noise for H band
+        // Use the average noise and NLP weight for H band.
         // TODO: we should probably have a new random vector here.
-        // Reject LF noise
-        u[0][0] = 0;
-        u[0][1] = 0;
-        for (i = 1; i < PART_LEN1; i++) {
-            tmp = pi2 * rand[i - 1];
-
-            // Use average noise for H band
-            u[i][0] = noiseAvg * (float)cos(tmp);
-            u[i][1] = -noiseAvg * (float)sin(tmp);
-        }
-        u[PART_LEN][1] = 0;
-
         for (i = 0; i < PART_LEN1; i++) {
-            // Use average NLP weight for H band
-            comfortNoiseHband[i][0] = tmpAvg * u[i][0];
-            comfortNoiseHband[i][1] = tmpAvg * u[i][1];
+            comfortNoiseHband[i][0] = weightAvg * noiseAvg * u[i][0];
+            comfortNoiseHband[i][1] = weightAvg * noiseAvg * u[i][1];
         }
     }
 }
@@ -1296,13 +1761,9 @@ static void WebRtcAec_InitStats(stats_t *stats)
     stats->hicounter = 0;
 }
 
-static void UpdateLevel(power_level_t *level, const short *in)
+static void UpdateLevel(power_level_t *level, float energy)
 {
-    int k;
-
-    for (k = 0; k < PART_LEN; k++) {
-        level->sfrsum += in[k] * in[k];
-    }
+    level->sfrsum += energy;
     level->sfrcounter++;
 
     if (level->sfrcounter > subCountLen) {
@@ -1329,7 +1790,8 @@ static void UpdateLevel(power_level_t *level, const short *in)
     }
 }
 
-static void UpdateMetrics(aec_t *aec)
+void WebRtcAec_UpdateMetrics(aec_metrics_t *metrics,
+                             const AecMetricsBlock *block)
 {
     float dtmp, dtmp2, dtmp3;
 
@@ -1341,116 +1803,122 @@ static void UpdateMetrics(aec_t *aec)
     float actThreshold;
     float echo, suppressedEcho;
 
-    if (aec->echoState) {   // Check if echo is likely present
-        aec->stateCounter++;
+    // Update power levels
+    UpdateLevel(&metrics->farlevel, block->farEnergy);
+    UpdateLevel(&metrics->nearlevel, block->nearEnergy);
+    UpdateLevel(&metrics->linoutlevel, block->linearOutEnergy);
+    UpdateLevel(&metrics->nlpoutlevel, block->nlpOutEnergy);
+
+    if (block->echoState) {   // Check if echo is likely present
+        metrics->stateCounter++;
     }
 
-    if (aec->farlevel.frcounter == countLen) {
+    if (metrics->farlevel.frcounter == countLen) {
 
-        if (aec->farlevel.minlevel < noisyPower) {
+        if (metrics->farlevel.minlevel < noisyPower) {
             actThreshold = actThresholdClean;
         }
         else {
             actThreshold = actThresholdNoisy;
         }
 
-        if ((aec->stateCounter > (0.5f * countLen * subCountLen))
-            && (aec->farlevel.sfrcounter == 0)
+        if ((metrics->stateCounter > (0.5f * countLen * subCountLen))
+            && (metrics->farlevel.sfrcounter == 0)
 
             // Estimate in active far-end segments only
-            && (aec->farlevel.averagelevel > (actThreshold * aec->farlevel.minlevel))
+            && (metrics->farlevel.averagelevel > (actThreshold * metrics->farlevel.minlevel))
             ) {
 
             // Subtract noise power
-            echo = aec->nearlevel.averagelevel - safety * aec->nearlevel.minlevel;
+            echo = metrics->nearlevel.averagelevel - safety * metrics->nearlevel.minlevel;
 
             // ERL
-            dtmp = 10 * (float)log10(aec->farlevel.averagelevel /
-                aec->nearlevel.averagelevel + 1e-10f);
-            dtmp2 = 10 * (float)log10(aec->farlevel.averagelevel / echo + 1e-10f);
+            dtmp = 10 * (float)log10(metrics->farlevel.averagelevel /
+                metrics->nearlevel.averagelevel + 1e-10f);
+            dtmp2 = 10 * (float)log10(metrics->farlevel.averagelevel / echo + 1e-10f);
 
-            aec->erl.instant = dtmp;
-            if (dtmp > aec->erl.max) {
-                aec->erl.max = dtmp;
+            metrics->erl.instant = dtmp;
+            if (dtmp > metrics->erl.max) {
+                metrics->erl.max = dtmp;
             }
 
-            if (dtmp < aec->erl.min) {
-                aec->erl.min = dtmp;
+            if (dtmp < metrics->erl.min) {
+                metrics->erl.min = dtmp;
             }
 
-            aec->erl.counter++;
-            aec->erl.sum += dtmp;
-            aec->erl.average = aec->erl.sum / aec->erl.counter;
+            metrics->erl.counter++;
+            metrics->erl.sum += dtmp;
+            metrics->erl.average = metrics->erl.sum / metrics->erl.counter;
 
             // Upper mean
-            if (dtmp > aec->erl.average) {
-                aec->erl.hicounter++;
-                aec->erl.hisum += dtmp;
-                aec->erl.himean = aec->erl.hisum / aec->erl.hicounter;
+            if (dtmp > metrics->erl.average) {
+                metrics->erl.hicounter++;
+                metrics->erl.hisum += dtmp;
+                metrics->erl.himean = metrics->erl.hisum / metrics->erl.hicounter;
             }
 
             // A_NLP
-            dtmp = 10 * (float)log10(aec->nearlevel.averagelevel /
-                aec->linoutlevel.averagelevel + 1e-10f);
+            dtmp = 10 * (float)log10(metrics->nearlevel.averagelevel /
+                metrics->linoutlevel.averagelevel + 1e-10f);
 
             // subtract noise power
-            suppressedEcho = aec->linoutlevel.averagelevel - safety * aec->linoutlevel.minlevel;
+            suppressedEcho = metrics->linoutlevel.averagelevel - safety * metrics->linoutlevel.minlevel;
 
             dtmp2 = 10 * (float)log10(echo / suppressedEcho + 1e-10f);
-            dtmp3 = 10 * (float)log10(aec->nearlevel.averagelevel / suppressedEcho + 1e-10f);
+            dtmp3 = 10 * (float)log10(metrics->nearlevel.averagelevel / suppressedEcho + 1e-10f);
 
-            aec->aNlp.instant = dtmp2;
-            if (dtmp > aec->aNlp.max) {
-                aec->aNlp.max = dtmp;
+            metrics->aNlp.instant = dtmp2;
+            if (dtmp > metrics->aNlp.max) {
+                metrics->aNlp.max = dtmp;
             }
 
-            if (dtmp < aec->aNlp.min) {
-                aec->aNlp.min = dtmp;
+            if (dtmp < metrics->aNlp.min) {
+                metrics->aNlp.min = dtmp;
             }
 
-            aec->aNlp.counter++;
-            aec->aNlp.sum += dtmp;
-            aec->aNlp.average = aec->aNlp.sum / aec->aNlp.counter;
+            metrics->aNlp.counter++;
+            metrics->aNlp.sum += dtmp;
+            metrics->aNlp.average = metrics->aNlp.sum / metrics->aNlp.counter;
 
             // Upper mean
-            if (dtmp > aec->aNlp.average) {
-                aec->aNlp.hicounter++;
-                aec->aNlp.hisum += dtmp;
-                aec->aNlp.himean = aec->aNlp.hisum / aec->aNlp.hicounter;
+            if (dtmp > metrics->aNlp.average) {
+                metrics->aNlp.hicounter++;
+                metrics->aNlp.hisum += dtmp;
+                metrics->aNlp.himean = metrics->aNlp.hisum / metrics->aNlp.hicounter;
             }
 
             // ERLE
 
             // subtract noise power
-            suppressedEcho = aec->nlpoutlevel.averagelevel - safety * aec->nlpoutlevel.minlevel;
+            suppressedEcho = metrics->nlpoutlevel.averagelevel - safety * metrics->nlpoutlevel.minlevel;
 
-            dtmp = 10 * (float)log10(aec->nearlevel.averagelevel /
-                aec->nlpoutlevel.averagelevel + 1e-10f);
+            dtmp = 10 * (float)log10(metrics->nearlevel.averagelevel /
+                metrics->nlpoutlevel.averagelevel + 1e-10f);
             dtmp2 = 10 * (float)log10(echo / suppressedEcho + 1e-10f);
 
             dtmp = dtmp2;
-            aec->erle.instant = dtmp;
-            if (dtmp > aec->erle.max) {
-                aec->erle.max = dtmp;
+            metrics->erle.instant = dtmp;
+            if (dtmp > metrics->erle.max) {
+                metrics->erle.max = dtmp;
             }
 
-            if (dtmp < aec->erle.min) {
-                aec->erle.min = dtmp;
+            if (dtmp < metrics->erle.min) {
+                metrics->erle.min = dtmp;
             }
 
-            aec->erle.counter++;
-            aec->erle.sum += dtmp;
-            aec->erle.average = aec->erle.sum / aec->erle.counter;
+            metrics->erle.counter++;
+            metrics->erle.sum += dtmp;
+            metrics->erle.average = metrics->erle.sum / metrics->erle.counter;
 
             // Upper mean
-            if (dtmp > aec->erle.average) {
-                aec->erle.hicounter++;
-                aec->erle.hisum += dtmp;
-                aec->erle.himean = aec->erle.hisum / aec->erle.hicounter;
+            if (dtmp > metrics->erle.average) {
+                metrics->erle.hicounter++;
+                metrics->erle.hisum += dtmp;
+                metrics->erle.himean = metrics->erle.hisum / metrics->erle.hicounter;
             }
         }
 
-        aec->stateCounter = 0;
+        metrics->stateCounter = 0;
     }
 }
 
@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include "typedefs.h"
 #include "signal_processing_library.h"
+#include "echo_cancellation.h"
 
 //#define G167 // for running G167 tests
 //#define UNCONSTR // time-unconstrained filter
@@ -27,11 +28,13 @@
 #define PART_LEN 64 // Length of partition
 #define PART_LEN1 (PART_LEN + 1) // Unique fft coefficients
 #define PART_LEN2 (PART_LEN * 2) // Length of partition * 2
-#define NR_PART 12 // Number of partitions
+#define NR_PART 12 // Number of partitions, see AEC_DELAY_HISTOGRAM_SIZE
 #define FILT_LEN (PART_LEN * NR_PART) // Filter length
 #define FILT_LEN2 (FILT_LEN * 2) // Double filter length
 #define FAR_BUF_LEN (FILT_LEN2 * 2)
 #define PREF_BAND_SIZE 24
+// Nearend held back while dormant, see WebRtcAec_ProcessFrame()
+#define DORMANT_BUF_LEN (PART_LEN2 * 2 + FRAME_LEN)
 
 #define BLOCKL_MAX FRAME_LEN
 
@@ -69,6 +72,31 @@ typedef struct {
     int hicounter;
 } stats_t;
 
+// Echo metrics, aggregated from AecMetricsBlocks.
+typedef struct {
+    power_level_t farlevel;
+    power_level_t nearlevel;
+    power_level_t linoutlevel;
+    power_level_t nlpoutlevel;
+
+    int stateCounter;
+    stats_t erl;
+    stats_t erle;
+    stats_t aNlp;
+    stats_t rerl;
+} aec_metrics_t;
+
+// Metrics blocks held by an instance in deferred mode; three blocks are
+// produced per 10 ms at most.
+enum {kMaxMetricsBlocks = 8};
+
+// Spectra of a farend block, which depend on the farend signal only.
+typedef struct {
+    float xf[2][PART_LEN1]; // farend fft
+    float xPow[PART_LEN1]; // farend psd
+    complex_t xfw[PART_LEN1]; // farend windowed fft
+} far_spectrum_t;
+
 typedef struct {
     int farBufWritePos, farBufReadPos;
 
@@ -80,6 +108,9 @@ typedef struct {
 
     void *nearFrBufH;
     void *outFrBufH;
+    // In compact mode the H band buffers only exist at 32 kHz. Takes effect
+    // at the next WebRtcAec_InitAec().
+    int compact;
 
     float xBuf[PART_LEN2]; // farend
     float dBuf[PART_LEN2]; // nearend
@@ -116,6 +147,8 @@ typedef struct {
     float targetSupp, minOverDrive;
     float outBuf[PART_LEN];
     int delayIdx;
+    // Number of times each partition held the most filter energy
+    WebRtc_UWord32 delayHistogram[NR_PART];
 
     short stNearState, echoState;
     short divergeState;
@@ -132,6 +165,23 @@ typedef struct {
     float errThresh; // error threshold
 
     int noiseEstCtr;
+    int farSilentBlocks; // consecutive blocks of digitally silent farend
+    int dormant; // pass the nearend through while the farend stays silent
+
+    // While dormant, the nearend in flight through the frame buffers and the
+    // last block, |dormantDelay| samples, is held here instead. 0 otherwise.
+    int dormantDelay;
+    float dormantBuf[DORMANT_BUF_LEN];
+    float dormantBufH[DORMANT_BUF_LEN];
+
+    // Comfort noise of the last processed block, held for the dormant mode.
+    float cnMag[PART_LEN1];
+    float cnMagH;
+    int cnAudible; // whether it can change the output at all
+    float cnBuf[PART_LEN + FRAME_LEN]; // generated but not yet output
+    float cnBufH[PART_LEN + FRAME_LEN];
+    int cnBufLen;
+    float cnOutBuf[PART_LEN]; // overlap of the next block
 
     // Toggles for G.167 testing
 #ifdef G167
@@ -140,23 +190,23 @@ typedef struct {
     short cnToggle;     // Comfort noise
 #endif
 
-    power_level_t farlevel;
-    power_level_t nearlevel;
-    power_level_t linoutlevel;
-    power_level_t nlpoutlevel;
-
     int metricsMode;
-    int stateCounter;
-    stats_t erl;
-    stats_t erle;
-    stats_t aNlp;
-    stats_t rerl;
+    aec_metrics_t metrics;
+
+    // Blocks not yet aggregated, see WebRtcAec_set_deferred_metrics()
+    int deferMetrics;
+    int numMetricsBlocks;
+    AecMetricsBlock metricsBlocks[kMaxMetricsBlocks];
 
     // Quantities to control H band scaling for SWB input
     int freq_avg_ic;         //initial bin for averaging nlp gain
     int flag_Hband_cn;      //for comfort noise
     float cn_scale_Hband;   //scale for comfort noise in H band
 
+    // Optional filter of the output spectrum, see WebRtcAec_set_spectrum_filter()
+    AecSpectrumFilter spectrumFilter;
+    void *spectrumFilterContext;
+
 #ifdef AEC_DEBUG
     FILE *farFile;
     FILE *nearFile;
@@ -181,13 +231,42 @@ extern WebRtcAec_OverdriveAndSuppress_t WebRtcAec_OverdriveAndSuppress;
 int WebRtcAec_CreateAec(aec_t **aec);
 int WebRtcAec_FreeAec(aec_t *aec);
 int WebRtcAec_InitAec(aec_t *aec, int sampFreq);
+// Switches between 16 and 32 kHz, keeping the state of the low band.
+int WebRtcAec_ChangeSampFreqAec(aec_t *aec, int sampFreq);
 void WebRtcAec_InitAec_SSE2(void);
 
-void WebRtcAec_InitMetrics(aec_t *aec);
+void WebRtcAec_InitMetrics(aec_metrics_t *metrics);
+// Adds the energies of one block to the metrics.
+void WebRtcAec_UpdateMetrics(aec_metrics_t *metrics,
+                             const AecMetricsBlock *block);
+// The nearend and the output are in float on the 16-bit scale. The output is
+// not limited to the 16-bit range.
 void WebRtcAec_ProcessFrame(aec_t *aec, const short *farend,
-                       const short *nearend, const short *nearendH,
-                       short *out, short *outH,
+                       const float *nearend, const float *nearendH,
+                       float *out, float *outH,
                        int knownDelay);
+// Processes one PART_LEN block, bypassing the frame buffers used by
+// WebRtcAec_ProcessFrame(). Should not be mixed with that function on the
+// same instance without re-initialization.
+void WebRtcAec_ProcessBlock(aec_t *aec, const short *farend,
+                            const float *nearend, const float *nearendH,
+                            float *out, float *outH,
+                            int knownDelay);
+
+// Computes the farend spectra of |nBlocks| consecutive PART_LEN blocks in
+// |farend|, preceded by the PART_LEN samples in |history|. Has no state of its
+// own, so that a long signal can be split up and processed in parallel. Needs
+// the FFT tables set up by WebRtcAec_InitAec().
+void WebRtcAec_ComputeFarSpectra(const short *history, const short *farend,
+                                 int nBlocks, far_spectrum_t *farSpectra);
+// As WebRtcAec_ProcessBlock(), but with the farend spectra precomputed by
+// WebRtcAec_ComputeFarSpectra(). The farend is not buffered and must be
+// aligned with the nearend by the caller.
+void WebRtcAec_ProcessBlockFarSpectrum(aec_t *aec, const short *farend,
+                                       const far_spectrum_t *farSpectrum,
+                                       const float *nearend,
+                                       const float *nearendH,
+                                       float *out, float *outH);
 
 #endif // WEBRTC_MODULES_AUDIO_PROCESSING_AEC_MAIN_SOURCE_AEC_CORE_H_
 
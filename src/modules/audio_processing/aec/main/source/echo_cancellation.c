@@ -11,6 +11,7 @@
 /*
  * Contains the API functions for the AEC.
  */
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -30,11 +31,26 @@
 
 static const int bufSizeSamp = BUF_SIZE_FRAMES * FRAME_LEN; // buffer size (samples)
 static const int sampMsNb = 8; // samples per ms in nb
+// Largest soundcard buffer accepted by WebRtcAec_Process() (ms).
+static const short maxDelayDefaultMs = 500;
+// Most farend samples stuffed at once by DelayComp().
+static const int maxStuffSamp = 10 * FRAME_LEN;
 // Target suppression levels for nlp modes
 // log{0.001, 0.00001, 0.00000001}
 static const float targetSupp[3] = {-6.9f, -11.5f, -18.4f};
 static const float minOverDrive[3] = {1.0f, 2.0f, 5.0f};
 static const int initCheck = 42;
+// Duration of consecutive silent farend before the AEC turns dormant.
+static const int dormantMs = 1000;
+// Number of blocks in a batch of farend spectra in WebRtcAec_ProcessOffline().
+static const int offlineBatchBlocks = 32;
+
+// Processing modes, see WebRtcAec_ProcessOffline().
+enum {
+    kAecModeNone = 0, // no processing since initialization
+    kAecModeStreaming, // WebRtcAec_BufferFarend() and WebRtcAec_Process()
+    kAecModeOffline // WebRtcAec_ProcessOffline()
+};
 
 typedef struct {
     int delayCtr;
@@ -79,6 +95,8 @@ typedef struct {
 
     // Structures
     void *farendBuf;
+    int farendBufSize; // capacity of farendBuf (samples)
+    short maxDelayMs; // see WebRtcAec_set_compact_memory(), 0 if not compact
     void *resampler;
 
     int skewFrCtr;
@@ -88,6 +106,14 @@ typedef struct {
 
     int lastError;
 
+    short dormantMode; // see WebRtcAec_set_dormant_mode()
+    int farendSilentSamples; // consecutive silent samples in BufferFarend
+    int blockSamples; // samples processed since the last 10 ms update
+    int processMode; // set by the first call after initialization
+
+    // Farend spectra of a batch in WebRtcAec_ProcessOffline()
+    far_spectrum_t *farSpectra;
+
     aec_t *aec;
 } aecpc_t;
 
@@ -98,6 +124,23 @@ static int EstBufDelay(aecpc_t *aecInst, short msInSndCardBuf);
 // Stuffs the farend buffer if the estimated delay is too large
 static int DelayComp(aecpc_t *aecInst);
 
+// Capacity of the farend buffer at |sampFreq|, for the soundcard buffers
+// allowed by |maxDelayMs|
+static int FarendBufSize(short maxDelayMs, int sampFreq);
+
+static void UpdateStartup(aecpc_t *aecpc, short nBlocks10ms);
+// Fails if the instance has been used in another processing mode since its
+// initialization
+static int SetProcessMode(aecpc_t *aecpc, int mode);
+static void ProcessBlocks(aecpc_t *aecpc, const float *nearend,
+                          const float *nearendH, float *out, float *outH,
+                          short nrOfSamples);
+static void ShortToFloat(const short *in, int length, float *out);
+static void FloatToShort(const float *in, int length, short *out);
+
+// Fills |metrics| from the aggregated |aecMetrics|
+static void GetMetrics(const aec_metrics_t *aecMetrics, AecMetrics *metrics);
+
 WebRtc_Word32 WebRtcAec_Create(void **aecInst)
 {
     aecpc_t *aecpc;
@@ -122,6 +165,8 @@ WebRtc_Word32 WebRtcAec_Create(void **aecInst)
         aecpc = NULL;
         return -1;
     }
+    aecpc->farendBufSize = bufSizeSamp;
+    aecpc->maxDelayMs = 0;
 
     if (WebRtcAec_CreateResampler(&aecpc->resampler) == -1) {
         WebRtcAec_Free(aecpc);
@@ -129,6 +174,13 @@ WebRtc_Word32 WebRtcAec_Create(void **aecInst)
         return -1;
     }
 
+    aecpc->farSpectra = malloc(sizeof(far_spectrum_t) * offlineBatchBlocks);
+    if (aecpc->farSpectra == NULL) {
+        WebRtcAec_Free(aecpc);
+        aecpc = NULL;
+        return -1;
+    }
+
     aecpc->initFlag = 0;
     aecpc->lastError = 0;
 
@@ -172,6 +224,7 @@ WebRtc_Word32 WebRtcAec_Free(void *aecInst)
     WebRtcAec_FreeAec(aecpc->aec);
     WebRtcApm_FreeBuffer(aecpc->farendBuf);
     WebRtcAec_FreeResampler(aecpc->resampler);
+    free(aecpc->farSpectra);
     free(aecpc);
 
     return 0;
@@ -181,6 +234,7 @@ WebRtc_Word32 WebRtcAec_Init(void *aecInst, WebRtc_Word32 sampFreq, WebRtc_Word3
 {
     aecpc_t *aecpc = aecInst;
     AecConfig aecConfig;
+    int farendBufSize;
 
     if (aecpc == NULL) {
         return -1;
@@ -199,11 +253,25 @@ WebRtc_Word32 WebRtcAec_Init(void *aecInst, WebRtc_Word32 sampFreq, WebRtc_Word3
     aecpc->scSampFreq = scSampFreq;
 
     // Initialize echo canceller core
+    aecpc->aec->compact = (aecpc->maxDelayMs > 0);
     if (WebRtcAec_InitAec(aecpc->aec, aecpc->sampFreq) == -1) {
         aecpc->lastError = AEC_UNSPECIFIED_ERROR;
         return -1;
     }
 
+    // Resize the farend buffer for the rate and the maximum delay
+    farendBufSize = FarendBufSize(aecpc->maxDelayMs, aecpc->sampFreq);
+    if (farendBufSize != aecpc->farendBufSize) {
+        WebRtcApm_FreeBuffer(aecpc->farendBuf);
+        if (WebRtcApm_CreateBuffer(&aecpc->farendBuf, farendBufSize) == -1) {
+            aecpc->farendBuf = NULL;
+            aecpc->farendBufSize = 0;
+            aecpc->lastError = AEC_UNSPECIFIED_ERROR;
+            return -1;
+        }
+        aecpc->farendBufSize = farendBufSize;
+    }
+
     // Initialize farend buffer
     if (WebRtcApm_InitBuffer(aecpc->farendBuf) == -1) {
         aecpc->lastError = AEC_UNSPECIFIED_ERROR;
@@ -226,6 +294,10 @@ WebRtc_Word32 WebRtcAec_Init(void *aecInst, WebRtc_Word32 sampFreq, WebRtc_Word3
 
     aecpc->skewFrCtr = 0;
     aecpc->activity = 0;
+    aecpc->dormantMode = kAecFalse;
+    aecpc->farendSilentSamples = 0;
+    aecpc->blockSamples = 0;
+    aecpc->processMode = kAecModeNone;
 
     aecpc->delayChange = 1;
     aecpc->delayCtr = 0;
@@ -263,6 +335,28 @@ WebRtc_Word32 WebRtcAec_Init(void *aecInst, WebRtc_Word32 sampFreq, WebRtc_Word3
     return 0;
 }
 
+WebRtc_Word32 WebRtcAec_ChangeSampFreq(void *aecInst, WebRtc_Word32 sampFreq)
+{
+    aecpc_t *aecpc = aecInst;
+
+    if (aecpc == NULL) {
+        return -1;
+    }
+
+    if (aecpc->initFlag != initCheck) {
+        aecpc->lastError = AEC_UNINITIALIZED_ERROR;
+        return -1;
+    }
+
+    if (WebRtcAec_ChangeSampFreqAec(aecpc->aec, sampFreq) == -1) {
+        aecpc->lastError = AEC_BAD_PARAMETER_ERROR;
+        return -1;
+    }
+    aecpc->sampFreq = sampFreq;
+
+    return 0;
+}
+
 // only buffer L band for farend
 WebRtc_Word32 WebRtcAec_BufferFarend(void *aecInst, const WebRtc_Word16 *farend,
     WebRtc_Word16 nrOfSamples)
@@ -287,14 +381,37 @@ WebRtc_Word32 WebRtcAec_BufferFarend(void *aecInst, const WebRtc_Word16 *farend,
         return -1;
     }
 
-    // number of samples == 160 for SWB input
-    if (nrOfSamples != 80 && nrOfSamples != 160) {
+    if (SetProcessMode(aecpc, kAecModeStreaming) == -1) {
+        return -1;
+    }
+
+    // number of samples == 160 for SWB input, or PART_LEN multiples when the
+    // input is block aligned
+    if (nrOfSamples != 80 && nrOfSamples != 160 &&
+            nrOfSamples != PART_LEN && nrOfSamples != PART_LEN2) {
         aecpc->lastError = AEC_BAD_PARAMETER_ERROR;
         return -1;
     }
 
     skew = aecpc->skew;
 
+    // Turn dormant after a period of farend digital silence. The farend is
+    // checked here, ahead of the buffering, so that processing is resumed
+    // before the signal reaches the filter.
+    if (aecpc->dormantMode == kAecTrue) {
+        if (WebRtcSpl_MaxAbsValueW16(farend, nrOfSamples) != 0) {
+            aecpc->farendSilentSamples = 0;
+            aecpc->aec->dormant = 0;
+        }
+        else if (!aecpc->aec->dormant) {
+            aecpc->farendSilentSamples += nrOfSamples;
+            if (aecpc->farendSilentSamples >=
+                    dormantMs * sampMsNb * aecpc->aec->mult) {
+                aecpc->aec->dormant = 1;
+            }
+        }
+    }
+
     // TODO: Is this really a good idea?
     if (!aecpc->ECstartup) {
         DelayComp(aecpc);
@@ -324,6 +441,50 @@ WebRtc_Word32 WebRtcAec_BufferFarend(void *aecInst, const WebRtc_Word16 *farend,
 WebRtc_Word32 WebRtcAec_Process(void *aecInst, const WebRtc_Word16 *nearend,
     const WebRtc_Word16 *nearendH, WebRtc_Word16 *out, WebRtc_Word16 *outH,
     WebRtc_Word16 nrOfSamples, WebRtc_Word16 msInSndCardBuf, WebRtc_Word32 skew)
+{
+    aecpc_t *aecpc = aecInst;
+    float nearFloat[FRAME_LEN * 2], nearFloatH[FRAME_LEN * 2];
+    float outFloat[FRAME_LEN * 2], outFloatH[FRAME_LEN * 2];
+    const int flagHB = (nearendH != NULL && outH != NULL);
+    WebRtc_Word32 retVal;
+
+    if (aecpc == NULL) {
+        return -1;
+    }
+
+    if (nearend == NULL || out == NULL) {
+        aecpc->lastError = AEC_NULL_POINTER_ERROR;
+        return -1;
+    }
+
+    if (nrOfSamples < 0 || nrOfSamples > FRAME_LEN * 2) {
+        aecpc->lastError = AEC_BAD_PARAMETER_ERROR;
+        return -1;
+    }
+
+    ShortToFloat(nearend, nrOfSamples, nearFloat);
+    if (flagHB) {
+        ShortToFloat(nearendH, nrOfSamples, nearFloatH);
+    }
+
+    retVal = WebRtcAec_ProcessFloat(aecInst, nearFloat,
+        flagHB ? nearFloatH : NULL, outFloat, flagHB ? outFloatH : NULL,
+        nrOfSamples, msInSndCardBuf, skew);
+
+    // Warnings come with an output, errors without.
+    if (retVal == 0 || aecpc->lastError == AEC_BAD_PARAMETER_WARNING) {
+        FloatToShort(outFloat, nrOfSamples, out);
+        if (flagHB && aecpc->sampFreq == 32000) {
+            FloatToShort(outFloatH, nrOfSamples, outH);
+        }
+    }
+
+    return retVal;
+}
+
+WebRtc_Word32 WebRtcAec_ProcessFloat(void *aecInst, const float *nearend,
+    const float *nearendH, float *out, float *outH,
+    WebRtc_Word16 nrOfSamples, WebRtc_Word16 msInSndCardBuf, WebRtc_Word32 skew)
 {
     aecpc_t *aecpc = aecInst;
     WebRtc_Word32 retVal = 0;
@@ -332,6 +493,8 @@ WebRtc_Word32 WebRtcAec_Process(void *aecInst, const WebRtc_Word16 *nearend,
     short nmbrOfFilledBuffers;
     short nBlocks10ms;
     short nFrames;
+    int flagHB;
+    short maxDelayMs;
 #ifdef AEC_DEBUG
     short msInAECBuf;
 #endif
@@ -342,6 +505,7 @@ WebRtc_Word32 WebRtcAec_Process(void *aecInst, const WebRtc_Word16 *nearend,
     if (aecpc == NULL) {
         return -1;
     }
+    maxDelayMs = aecpc->maxDelayMs > 0 ? aecpc->maxDelayMs : maxDelayDefaultMs;
 
     if (nearend == NULL) {
         aecpc->lastError = AEC_NULL_POINTER_ERROR;
@@ -358,14 +522,21 @@ WebRtc_Word32 WebRtcAec_Process(void *aecInst, const WebRtc_Word16 *nearend,
         return -1;
     }
 
-    // number of samples == 160 for SWB input
-    if (nrOfSamples != 80 && nrOfSamples != 160) {
+    if (SetProcessMode(aecpc, kAecModeStreaming) == -1) {
+        return -1;
+    }
+
+    // number of samples == 160 for SWB input, or PART_LEN multiples when the
+    // input is block aligned
+    if (nrOfSamples != 80 && nrOfSamples != 160 &&
+            nrOfSamples != PART_LEN && nrOfSamples != PART_LEN2) {
         aecpc->lastError = AEC_BAD_PARAMETER_ERROR;
         return -1;
     }
 
     // Check for valid pointers based on sampling rate
-    if (aecpc->sampFreq == 32000 && nearendH == NULL) {
+    flagHB = (aecpc->sampFreq == 32000);
+    if (flagHB && (nearendH == NULL || outH == NULL)) {
        aecpc->lastError = AEC_NULL_POINTER_ERROR;
        return -1;
     }
@@ -375,8 +546,8 @@ WebRtc_Word32 WebRtcAec_Process(void *aecInst, const WebRtc_Word16 *nearend,
         aecpc->lastError = AEC_BAD_PARAMETER_WARNING;
         retVal = -1;
     }
-    else if (msInSndCardBuf > 500) {
-        msInSndCardBuf = 500;
+    else if (msInSndCardBuf > maxDelayMs) {
+        msInSndCardBuf = maxDelayMs;
         aecpc->lastError = AEC_BAD_PARAMETER_WARNING;
         retVal = -1;
     }
@@ -419,70 +590,16 @@ WebRtc_Word32 WebRtcAec_Process(void *aecInst, const WebRtc_Word16 *nearend,
     nFrames = nrOfSamples / FRAME_LEN;
     nBlocks10ms = nFrames / aecpc->aec->mult;
 
-    if (aecpc->ECstartup) {
-        memcpy(out, nearend, sizeof(short) * nrOfSamples);
-        nmbrOfFilledBuffers = WebRtcApm_get_buffer_size(aecpc->farendBuf) / FRAME_LEN;
-
-        // The AEC is in the start up mode
-        // AEC is disabled until the soundcard buffer and farend buffers are OK
-
-        // Mechanism to ensure that the soundcard buffer is reasonably stable.
-        if (aecpc->checkBuffSize) {
-
-            aecpc->checkBufSizeCtr++;
-            // Before we fill up the far end buffer we require the amount of data on the
-            // sound card to be stable (+/-8 ms) compared to the first value. This
-            // comparison is made during the following 4 consecutive frames. If it seems
-            // to be stable then we start to fill up the far end buffer.
-
-            if (aecpc->counter == 0) {
-                aecpc->firstVal = aecpc->msInSndCardBuf;
-                aecpc->sum = 0;
-            }
-
-            if (abs(aecpc->firstVal - aecpc->msInSndCardBuf) <
-                WEBRTC_SPL_MAX(0.2 * aecpc->msInSndCardBuf, sampMsNb)) {
-                aecpc->sum += aecpc->msInSndCardBuf;
-                aecpc->counter++;
-            }
-            else {
-                aecpc->counter = 0;
-            }
-
-            if (aecpc->counter*nBlocks10ms >= 6) {
-                // The farend buffer size is determined in blocks of 80 samples
-                // Use 75% of the average value of the soundcard buffer
-                aecpc->bufSizeStart = WEBRTC_SPL_MIN((int) (0.75 * (aecpc->sum *
-                    aecpc->aec->mult) / (aecpc->counter * 10)), BUF_SIZE_FRAMES);
-                // buffersize has now been determined
-                aecpc->checkBuffSize = 0;
-            }
-
-            if (aecpc->checkBufSizeCtr * nBlocks10ms > 50) {
-                // for really bad sound cards, don't disable echocanceller for more than 0.5 sec
-                aecpc->bufSizeStart = WEBRTC_SPL_MIN((int) (0.75 * (aecpc->msInSndCardBuf *
-                    aecpc->aec->mult) / 10), BUF_SIZE_FRAMES);
-                aecpc->checkBuffSize = 0;
-            }
-        }
-
-        // if checkBuffSize changed in the if-statement above
-        if (!aecpc->checkBuffSize) {
-            // soundcard buffer is now reasonably stable
-            // When the far end buffer is filled with approximately the same amount of
-            // data as the amount on the sound card we end the start up phase and start
-            // to cancel echoes.
-
-            if (nmbrOfFilledBuffers == aecpc->bufSizeStart) {
-                aecpc->ECstartup = 0;  // Enable the AEC
-            }
-            else if (nmbrOfFilledBuffers > aecpc->bufSizeStart) {
-                WebRtcApm_FlushBuffer(aecpc->farendBuf, WebRtcApm_get_buffer_size(aecpc->farendBuf) -
-                    aecpc->bufSizeStart * FRAME_LEN);
-                aecpc->ECstartup = 0;
-            }
+    if (nrOfSamples % FRAME_LEN != 0) {
+        // Block aligned input
+        ProcessBlocks(aecpc, nearend, nearendH, out, outH, nrOfSamples);
+    }
+    else if (aecpc->ECstartup) {
+        memcpy(out, nearend, sizeof(float) * nrOfSamples);
+        if (flagHB) {
+            memcpy(outH, nearendH, sizeof(float) * nrOfSamples);
         }
-
+        UpdateStartup(aecpc, nBlocks10ms);
     }
     else {
         // AEC is enabled
@@ -512,8 +629,10 @@ WebRtc_Word32 WebRtcAec_Process(void *aecInst, const WebRtc_Word16 *nearend,
             }
 
             // Call the AEC
-           WebRtcAec_ProcessFrame(aecpc->aec, farend, &nearend[FRAME_LEN * i], &nearendH[FRAME_LEN * i],
-               &out[FRAME_LEN * i], &outH[FRAME_LEN * i], aecpc->knownDelay);
+            // The H band is only given for SWB
+            WebRtcAec_ProcessFrame(aecpc->aec, farend, &nearend[FRAME_LEN * i],
+                flagHB ? &nearendH[FRAME_LEN * i] : NULL, &out[FRAME_LEN * i],
+                flagHB ? &outH[FRAME_LEN * i] : NULL, aecpc->knownDelay);
         }
     }
 
@@ -526,6 +645,82 @@ WebRtc_Word32 WebRtcAec_Process(void *aecInst, const WebRtc_Word16 *nearend,
     return retVal;
 }
 
+WebRtc_Word32 WebRtcAec_ProcessOffline(void *aecInst,
+    const WebRtc_Word16 *farend, const WebRtc_Word16 *nearend,
+    const WebRtc_Word16 *nearendH, WebRtc_Word16 *out, WebRtc_Word16 *outH,
+    WebRtc_Word32 nrOfSamples)
+{
+    aecpc_t *aecpc = aecInst;
+    far_spectrum_t *farSpectra;
+    const short *history;
+    float nearBl[PART_LEN], nearBlH[PART_LEN];
+    float outBl[PART_LEN], outBlH[PART_LEN];
+    int nBlocks, nBatch, i, j, pos;
+    int flagHB;
+
+    if (aecpc == NULL) {
+        return -1;
+    }
+
+    if (farend == NULL || nearend == NULL || out == NULL) {
+        aecpc->lastError = AEC_NULL_POINTER_ERROR;
+        return -1;
+    }
+
+    if (aecpc->initFlag != initCheck) {
+        aecpc->lastError = AEC_UNINITIALIZED_ERROR;
+        return -1;
+    }
+
+    if (SetProcessMode(aecpc, kAecModeOffline) == -1) {
+        return -1;
+    }
+
+    if (nrOfSamples < 0 || nrOfSamples % PART_LEN != 0) {
+        aecpc->lastError = AEC_BAD_PARAMETER_ERROR;
+        return -1;
+    }
+
+    // Check for valid pointers based on sampling rate
+    flagHB = (aecpc->sampFreq == 32000);
+    if (flagHB && (nearendH == NULL || outH == NULL)) {
+       aecpc->lastError = AEC_NULL_POINTER_ERROR;
+       return -1;
+    }
+
+    farSpectra = aecpc->farSpectra;
+
+    // The last farend block of the previous call precedes the first one.
+    history = aecpc->farendOld[0];
+    nBlocks = nrOfSamples / PART_LEN;
+    for (i = 0; i < nBlocks; i += nBatch) {
+        nBatch = WEBRTC_SPL_MIN(nBlocks - i, offlineBatchBlocks);
+        WebRtcAec_ComputeFarSpectra(history, &farend[PART_LEN * i], nBatch,
+            farSpectra);
+
+        for (j = 0; j < nBatch; j++) {
+            pos = PART_LEN * (i + j);
+            ShortToFloat(&nearend[pos], PART_LEN, nearBl);
+            if (flagHB) {
+                ShortToFloat(&nearendH[pos], PART_LEN, nearBlH);
+            }
+            WebRtcAec_ProcessBlockFarSpectrum(aecpc->aec, &farend[pos],
+                &farSpectra[j], nearBl, nearBlH, outBl, outBlH);
+            FloatToShort(outBl, PART_LEN, &out[pos]);
+            if (flagHB) {
+                FloatToShort(outBlH, PART_LEN, &outH[pos]);
+            }
+        }
+        history = &farend[PART_LEN * (i + nBatch - 1)];
+    }
+
+    if (nBlocks > 0) {
+        memcpy(aecpc->farendOld[0], history, sizeof(short) * PART_LEN);
+    }
+
+    return 0;
+}
+
 WebRtc_Word32 WebRtcAec_set_config(void *aecInst, AecConfig config)
 {
     aecpc_t *aecpc = aecInst;
@@ -560,9 +755,76 @@ WebRtc_Word32 WebRtcAec_set_config(void *aecInst, AecConfig config)
     }
     aecpc->aec->metricsMode = config.metricsMode;
     if (aecpc->aec->metricsMode == kAecTrue) {
-        WebRtcAec_InitMetrics(aecpc->aec);
+        WebRtcAec_InitMetrics(&aecpc->aec->metrics);
+    }
+
+    return 0;
+}
+
+WebRtc_Word32 WebRtcAec_set_dormant_mode(void *aecInst, WebRtc_Word16 enable)
+{
+    aecpc_t *aecpc = aecInst;
+
+    if (aecpc == NULL) {
+        return -1;
+    }
+
+    if (aecpc->initFlag != initCheck) {
+        aecpc->lastError = AEC_UNINITIALIZED_ERROR;
+        return -1;
+    }
+
+    if (enable != kAecFalse && enable != kAecTrue) {
+        aecpc->lastError = AEC_BAD_PARAMETER_ERROR;
+        return -1;
+    }
+
+    aecpc->dormantMode = enable;
+    if (enable == kAecFalse) {
+        aecpc->farendSilentSamples = 0;
+        aecpc->aec->dormant = 0;
+    }
+
+    return 0;
+}
+
+WebRtc_Word32 WebRtcAec_set_compact_memory(void *aecInst,
+                                           WebRtc_Word16 maxDelayMs)
+{
+    aecpc_t *aecpc = aecInst;
+
+    if (aecpc == NULL) {
+        return -1;
     }
 
+    if (maxDelayMs < 0 || maxDelayMs > maxDelayDefaultMs) {
+        aecpc->lastError = AEC_BAD_PARAMETER_ERROR;
+        return -1;
+    }
+
+    aecpc->maxDelayMs = maxDelayMs;
+
+    return 0;
+}
+
+WebRtc_Word32 WebRtcAec_set_spectrum_filter(void *aecInst,
+                                            AecSpectrumFilter filter,
+                                            void *context)
+{
+    aecpc_t *aecpc = aecInst;
+
+    if (aecpc == NULL) {
+        return -1;
+    }
+
+    if (aecpc->initFlag != initCheck) {
+        aecpc->lastError = AEC_UNINITIALIZED_ERROR;
+        return -1;
+    }
+
+    aecpc->aec->spectrumFilter = filter;
+    aecpc->aec->spectrumFilterContext = context;
+
     return 0;
 }
 
@@ -616,9 +878,6 @@ WebRtc_Word32 WebRtcAec_get_echo_status(void *aecInst, WebRtc_Word16 *status)
 
 WebRtc_Word32 WebRtcAec_GetMetrics(void *aecInst, AecMetrics *metrics)
 {
-    const float upweight = 0.7f;
-    float dtmp;
-    short stmp;
     aecpc_t *aecpc = aecInst;
 
     if (aecpc == NULL) {
@@ -635,82 +894,199 @@ WebRtc_Word32 WebRtcAec_GetMetrics(void *aecInst, AecMetrics *metrics)
         return -1;
     }
 
-    // ERL
-    metrics->erl.instant = (short) aecpc->aec->erl.instant;
+    GetMetrics(&aecpc->aec->metrics, metrics);
 
-    if ((aecpc->aec->erl.himean > offsetLevel) && (aecpc->aec->erl.average > offsetLevel)) {
-    // Use a mix between regular average and upper part average
-        dtmp = upweight * aecpc->aec->erl.himean + (1 - upweight) * aecpc->aec->erl.average;
-        metrics->erl.average = (short) dtmp;
+    return 0;
+}
+
+WebRtc_Word32 WebRtcAec_GetDelayMetrics(void *aecInst,
+                                        AecDelayMetrics *metrics)
+{
+    aecpc_t *aecpc = aecInst;
+    const WebRtc_UWord32 *histogram;
+    WebRtc_UWord32 total = 0, count = 0;
+    float mean = 0, var = 0, dtmp;
+    int i;
+
+    if (aecpc == NULL) {
+        return -1;
     }
-    else {
-        metrics->erl.average = offsetLevel;
+
+    if (metrics == NULL) {
+        aecpc->lastError = AEC_NULL_POINTER_ERROR;
+        return -1;
     }
 
-    metrics->erl.max = (short) aecpc->aec->erl.max;
+    if (aecpc->initFlag != initCheck) {
+        aecpc->lastError = AEC_UNINITIALIZED_ERROR;
+        return -1;
+    }
 
-    if (aecpc->aec->erl.min < (offsetLevel * (-1))) {
-        metrics->erl.min = (short) aecpc->aec->erl.min;
+    // One partition of the filter at the split rate
+    metrics->binWidth = (short)(PART_LEN / (sampMsNb * aecpc->aec->mult));
+    metrics->alignedDelay = (short)(aecpc->knownDelay /
+        (sampMsNb * aecpc->aec->mult));
+
+    histogram = aecpc->aec->delayHistogram;
+    for (i = 0; i < AEC_DELAY_HISTOGRAM_SIZE; i++) {
+        metrics->histogram[i] = histogram[i];
+        total += histogram[i];
+        mean += (float)i * histogram[i];
     }
-    else {
-        metrics->erl.min = offsetLevel;
+
+    if (total == 0) {
+        metrics->median = -1;
+        metrics->std = -1;
+        return 0;
     }
+    mean /= total;
 
-    // ERLE
-    metrics->erle.instant = (short) aecpc->aec->erle.instant;
+    // The first bin to reach half of the estimates
+    for (i = 0; i < AEC_DELAY_HISTOGRAM_SIZE; i++) {
+        count += histogram[i];
+        if (2 * count >= total) {
+            break;
+        }
+    }
+    metrics->median = (short)(i * metrics->binWidth);
 
-    if ((aecpc->aec->erle.himean > offsetLevel) && (aecpc->aec->erle.average > offsetLevel)) {
-        // Use a mix between regular average and upper part average
-        dtmp =  upweight * aecpc->aec->erle.himean + (1 - upweight) * aecpc->aec->erle.average;
-        metrics->erle.average = (short) dtmp;
+    for (i = 0; i < AEC_DELAY_HISTOGRAM_SIZE; i++) {
+        dtmp = i - mean;
+        var += dtmp * dtmp * histogram[i];
     }
-    else {
-        metrics->erle.average = offsetLevel;
+    metrics->std = (short)(sqrtf(var / total) * metrics->binWidth + 0.5f);
+
+    return 0;
+}
+
+WebRtc_Word32 WebRtcAec_set_deferred_metrics(void *aecInst,
+                                             WebRtc_Word16 enable)
+{
+    aecpc_t *aecpc = aecInst;
+
+    if (aecpc == NULL) {
+        return -1;
     }
 
-    metrics->erle.max = (short) aecpc->aec->erle.max;
+    if (aecpc->initFlag != initCheck) {
+        aecpc->lastError = AEC_UNINITIALIZED_ERROR;
+        return -1;
+    }
 
-    if (aecpc->aec->erle.min < (offsetLevel * (-1))) {
-        metrics->erle.min = (short) aecpc->aec->erle.min;
-    } else {
-        metrics->erle.min = offsetLevel;
+    if (enable != kAecFalse && enable != kAecTrue) {
+        aecpc->lastError = AEC_BAD_PARAMETER_ERROR;
+        return -1;
     }
 
-    // RERL
-    if ((metrics->erl.average > offsetLevel) && (metrics->erle.average > offsetLevel)) {
-        stmp = metrics->erl.average + metrics->erle.average;
+    aecpc->aec->deferMetrics = enable;
+    aecpc->aec->numMetricsBlocks = 0;
+
+    return 0;
+}
+
+WebRtc_Word32 WebRtcAec_GetMetricsBlocks(void *aecInst,
+                                         AecMetricsBlock *blocks,
+                                         WebRtc_Word16 maxBlocks)
+{
+    aecpc_t *aecpc = aecInst;
+    int numBlocks;
+
+    if (aecpc == NULL) {
+        return -1;
     }
-    else {
-        stmp = offsetLevel;
+
+    if (blocks == NULL) {
+        aecpc->lastError = AEC_NULL_POINTER_ERROR;
+        return -1;
     }
-    metrics->rerl.average = stmp;
 
-    // No other statistics needed, but returned for completeness
-    metrics->rerl.instant = stmp;
-    metrics->rerl.max = stmp;
-    metrics->rerl.min = stmp;
+    if (aecpc->initFlag != initCheck) {
+        aecpc->lastError = AEC_UNINITIALIZED_ERROR;
+        return -1;
+    }
 
-    // A_NLP
-    metrics->aNlp.instant = (short) aecpc->aec->aNlp.instant;
+    if (maxBlocks < 0) {
+        aecpc->lastError = AEC_BAD_PARAMETER_ERROR;
+        return -1;
+    }
 
-    if ((aecpc->aec->aNlp.himean > offsetLevel) && (aecpc->aec->aNlp.average > offsetLevel)) {
-        // Use a mix between regular average and upper part average
-        dtmp =  upweight * aecpc->aec->aNlp.himean + (1 - upweight) * aecpc->aec->aNlp.average;
-        metrics->aNlp.average = (short) dtmp;
+    numBlocks = WEBRTC_SPL_MIN(aecpc->aec->numMetricsBlocks, maxBlocks);
+    memcpy(blocks, aecpc->aec->metricsBlocks,
+        sizeof(AecMetricsBlock) * numBlocks);
+    aecpc->aec->numMetricsBlocks -= numBlocks;
+    memmove(aecpc->aec->metricsBlocks, aecpc->aec->metricsBlocks + numBlocks,
+        sizeof(AecMetricsBlock) * aecpc->aec->numMetricsBlocks);
+
+    return numBlocks;
+}
+
+WebRtc_Word32 WebRtcAec_CreateMetricsAggregator(void **metricsInst)
+{
+    aec_metrics_t *aecMetrics = NULL;
+
+    if (metricsInst == NULL) {
+        return -1;
     }
-    else {
-        metrics->aNlp.average = offsetLevel;
+
+    aecMetrics = malloc(sizeof(aec_metrics_t));
+    *metricsInst = aecMetrics;
+    if (aecMetrics == NULL) {
+        return -1;
+    }
+
+    WebRtcAec_InitMetrics(aecMetrics);
+
+    return 0;
+}
+
+WebRtc_Word32 WebRtcAec_FreeMetricsAggregator(void *metricsInst)
+{
+    if (metricsInst == NULL) {
+        return -1;
     }
 
-    metrics->aNlp.max = (short) aecpc->aec->aNlp.max;
+    free(metricsInst);
+
+    return 0;
+}
 
-    if (aecpc->aec->aNlp.min < (offsetLevel * (-1))) {
-        metrics->aNlp.min = (short) aecpc->aec->aNlp.min;
+WebRtc_Word32 WebRtcAec_InitMetricsAggregator(void *metricsInst)
+{
+    if (metricsInst == NULL) {
+        return -1;
     }
-    else {
-        metrics->aNlp.min = offsetLevel;
+
+    WebRtcAec_InitMetrics(metricsInst);
+
+    return 0;
+}
+
+WebRtc_Word32 WebRtcAec_AggregateMetrics(void *metricsInst,
+                                         const AecMetricsBlock *blocks,
+                                         WebRtc_Word32 numBlocks)
+{
+    int i;
+
+    if (metricsInst == NULL || (blocks == NULL && numBlocks > 0)) {
+        return -1;
+    }
+
+    for (i = 0; i < numBlocks; i++) {
+        WebRtcAec_UpdateMetrics(metricsInst, &blocks[i]);
+    }
+
+    return 0;
+}
+
+WebRtc_Word32 WebRtcAec_GetAggregatedMetrics(void *metricsInst,
+                                             AecMetrics *metrics)
+{
+    if (metricsInst == NULL || metrics == NULL) {
+        return -1;
     }
 
+    GetMetrics(metricsInst, metrics);
+
     return 0;
 }
 
@@ -742,6 +1118,162 @@ WebRtc_Word32 WebRtcAec_get_error_code(void *aecInst)
     return aecpc->lastError;
 }
 
+size_t WebRtcAec_memory_usage_bytes(void *aecInst)
+{
+    aecpc_t *aecpc = aecInst;
+    aec_t *aec;
+
+    if (aecpc == NULL) {
+        return 0;
+    }
+    aec = aecpc->aec;
+
+    return sizeof(aecpc_t) + sizeof(aec_t) +
+        WebRtcApm_get_buffer_memory(aecpc->farendBuf) +
+        WebRtcAec_GetResamplerMemory(aecpc->resampler) +
+        WebRtcApm_get_buffer_memory(aec->farFrBuf) +
+        WebRtcApm_get_buffer_memory(aec->nearFrBuf) +
+        WebRtcApm_get_buffer_memory(aec->outFrBuf) +
+        WebRtcApm_get_buffer_memory(aec->nearFrBufH) +
+        WebRtcApm_get_buffer_memory(aec->outFrBufH);
+}
+
+// Ends the start up phase once the soundcard and farend buffers are stable.
+// nBlocks10ms is the number of 10 ms blocks since the previous call.
+static void UpdateStartup(aecpc_t *aecpc, short nBlocks10ms)
+{
+    short nmbrOfFilledBuffers;
+
+    nmbrOfFilledBuffers = WebRtcApm_get_buffer_size(aecpc->farendBuf) / FRAME_LEN;
+
+    // The AEC is in the start up mode
+    // AEC is disabled until the soundcard buffer and farend buffers are OK
+
+    // Mechanism to ensure that the soundcard buffer is reasonably stable.
+    if (aecpc->checkBuffSize) {
+
+        aecpc->checkBufSizeCtr++;
+        // Before we fill up the far end buffer we require the amount of data on the
+        // sound card to be stable (+/-8 ms) compared to the first value. This
+        // comparison is made during the following 4 consecutive frames. If it seems
+        // to be stable then we start to fill up the far end buffer.
+
+        if (aecpc->counter == 0) {
+            aecpc->firstVal = aecpc->msInSndCardBuf;
+            aecpc->sum = 0;
+        }
+
+        if (abs(aecpc->firstVal - aecpc->msInSndCardBuf) <
+            WEBRTC_SPL_MAX(0.2 * aecpc->msInSndCardBuf, sampMsNb)) {
+            aecpc->sum += aecpc->msInSndCardBuf;
+            aecpc->counter++;
+        }
+        else {
+            aecpc->counter = 0;
+        }
+
+        if (aecpc->counter*nBlocks10ms >= 6) {
+            // The farend buffer size is determined in blocks of 80 samples
+            // Use 75% of the average value of the soundcard buffer
+            aecpc->bufSizeStart = WEBRTC_SPL_MIN((int) (0.75 * (aecpc->sum *
+                aecpc->aec->mult) / (aecpc->counter * 10)),
+                aecpc->farendBufSize / FRAME_LEN);
+            // buffersize has now been determined
+            aecpc->checkBuffSize = 0;
+        }
+
+        if (aecpc->checkBufSizeCtr * nBlocks10ms > 50) {
+            // for really bad sound cards, don't disable echocanceller for more than 0.5 sec
+            aecpc->bufSizeStart = WEBRTC_SPL_MIN((int) (0.75 * (aecpc->msInSndCardBuf *
+                aecpc->aec->mult) / 10), aecpc->farendBufSize / FRAME_LEN);
+            aecpc->checkBuffSize = 0;
+        }
+    }
+
+    // if checkBuffSize changed in the if-statement above
+    if (!aecpc->checkBuffSize) {
+        // soundcard buffer is now reasonably stable
+        // When the far end buffer is filled with approximately the same amount of
+        // data as the amount on the sound card we end the start up phase and start
+        // to cancel echoes.
+
+        // Block aligned input may leave part of a frame on top of the start
+        // size, which is flushed as well so that both framings start out
+        // with the same farend alignment.
+        if (nmbrOfFilledBuffers >= aecpc->bufSizeStart) {
+            WebRtcApm_FlushBuffer(aecpc->farendBuf, WebRtcApm_get_buffer_size(aecpc->farendBuf) -
+                aecpc->bufSizeStart * FRAME_LEN);
+            aecpc->ECstartup = 0;  // Enable the AEC
+        }
+    }
+}
+
+static int SetProcessMode(aecpc_t *aecpc, int mode)
+{
+    // The streaming and the offline modes share the farend history.
+    if (aecpc->processMode != kAecModeNone && aecpc->processMode != mode) {
+        aecpc->lastError = AEC_UNSUPPORTED_FUNCTION_ERROR;
+        return -1;
+    }
+    aecpc->processMode = mode;
+
+    return 0;
+}
+
+// Processes block-aligned input directly, with no reframing. The buffer
+// bookkeeping of WebRtcAec_Process() runs once the call is consumed, where
+// the nearend and the farend have been delivered alike, as at the end of a
+// 10 ms frame. Run within the call, it would measure farend samples whose
+// nearend is still to come and align the farend up to a call too late.
+static void ProcessBlocks(aecpc_t *aecpc, const float *nearend,
+                          const float *nearendH, float *out, float *outH,
+                          short nrOfSamples)
+{
+    short i;
+    short farend[PART_LEN];
+    const short nBlocks = nrOfSamples / PART_LEN;
+    const int samples10ms = FRAME_LEN * aecpc->aec->mult;
+    const int flagHB = (aecpc->sampFreq == 32000);
+    int nUpdates10ms;
+
+    aecpc->blockSamples += nrOfSamples;
+    nUpdates10ms = aecpc->blockSamples / samples10ms;
+    aecpc->blockSamples -= nUpdates10ms * samples10ms;
+
+    if (aecpc->ECstartup) {
+        memcpy(out, nearend, sizeof(float) * nrOfSamples);
+        if (flagHB) {
+            memcpy(outH, nearendH, sizeof(float) * nrOfSamples);
+        }
+        if (nUpdates10ms > 0) {
+            UpdateStartup(aecpc, nUpdates10ms);
+        }
+        return;
+    }
+
+    for (i = 0; i < nBlocks; i++) {
+        // Check that there is data in the far end buffer
+        if (WebRtcApm_get_buffer_size(aecpc->farendBuf) >= PART_LEN) {
+            WebRtcApm_ReadBuffer(aecpc->farendBuf, farend, PART_LEN);
+
+            // Always store the last block for use when we run out of data
+            memcpy(&(aecpc->farendOld[i][0]), farend, PART_LEN * sizeof(short));
+        }
+        else {
+            // We have no data so we use the last played block
+            memcpy(farend, &(aecpc->farendOld[i][0]), PART_LEN * sizeof(short));
+        }
+
+        WebRtcAec_ProcessBlock(aecpc->aec, farend, &nearend[PART_LEN * i],
+            flagHB ? &nearendH[PART_LEN * i] : NULL, &out[PART_LEN * i],
+            flagHB ? &outH[PART_LEN * i] : NULL, aecpc->knownDelay);
+    }
+
+    if (nUpdates10ms > 0) {
+        EstBufDelay(aecpc, aecpc->msInSndCardBuf);
+    }
+}
+
 static int EstBufDelay(aecpc_t *aecpc, short msInSndCardBuf)
 {
     short delayNew, nSampFar, nSampSndCard;
@@ -795,7 +1327,6 @@ static int EstBufDelay(aecpc_t *aecpc, short msInSndCardBuf)
 static int DelayComp(aecpc_t *aecpc)
 {
     int nSampFar, nSampSndCard, delayNew, nSampAdd;
-    const int maxStuffSamp = 10 * FRAME_LEN;
 
     nSampFar = WebRtcApm_get_buffer_size(aecpc->farendBuf);
     nSampSndCard = aecpc->msInSndCardBuf * sampMsNb * aecpc->aec->mult;
@@ -819,3 +1350,125 @@ static int DelayComp(aecpc_t *aecpc)
 
     return 0;
 }
+
+static int FarendBufSize(short maxDelayMs, int sampFreq)
+{
+    const int mult = (sampFreq == 8000) ? 1 : 2;
+    int size;
+
+    if (maxDelayMs == 0) {
+        return bufSizeSamp;
+    }
+
+    // The buffer level follows the soundcard buffer, which WebRtcAec_Process()
+    // limits to |maxDelayMs| + 10 ms. Leave room for a stuffing by
+    // DelayComp() and as much again for farend frames delivered ahead of
+    // their nearend.
+    size = (maxDelayMs + 10) * sampMsNb * mult + 2 * maxStuffSamp;
+
+    return WEBRTC_SPL_MIN(size, bufSizeSamp);
+}
+
+static void ShortToFloat(const short *in, int length, float *out)
+{
+    int i;
+
+    for (i = 0; i < length; i++) {
+        out[i] = (float)in[i];
+    }
+}
+
+// Limits to the 16-bit range and truncates towards zero, as the AEC did
+// internally before it produced float output.
+static void FloatToShort(const float *in, int length, short *out)
+{
+    int i;
+
+    for (i = 0; i < length; i++) {
+        out[i] = (short)WEBRTC_SPL_SAT(WEBRTC_SPL_WORD16_MAX, in[i],
+                                       WEBRTC_SPL_WORD16_MIN);
+    }
+}
+
+static void GetMetrics(const aec_metrics_t *aecMetrics, AecMetrics *metrics)
+{
+    const float upweight = 0.7f;
+    float dtmp;
+    short stmp;
+
+    // ERL
+    metrics->erl.instant = (short) aecMetrics->erl.instant;
+
+    if ((aecMetrics->erl.himean > offsetLevel) && (aecMetrics->erl.average > offsetLevel)) {
+    // Use a mix between regular average and upper part average
+        dtmp = upweight * aecMetrics->erl.himean + (1 - upweight) * aecMetrics->erl.average;
+        metrics->erl.average = (short) dtmp;
+    }
+    else {
+        metrics->erl.average = offsetLevel;
+    }
+
+    metrics->erl.max = (short) aecMetrics->erl.max;
+
+    if (aecMetrics->erl.min < (offsetLevel * (-1))) {
+        metrics->erl.min = (short) aecMetrics->erl.min;
+    }
+    else {
+        metrics->erl.min = offsetLevel;
+    }
+
+    // ERLE
+    metrics->erle.instant = (short) aecMetrics->erle.instant;
+
+    if ((aecMetrics->erle.himean > offsetLevel) && (aecMetrics->erle.average > offsetLevel)) {
+        // Use a mix between regular average and upper part average
+        dtmp =  upweight * aecMetrics->erle.himean + (1 - upweight) * aecMetrics->erle.average;
+        metrics->erle.average = (short) dtmp;
+    }
+    else {
+        metrics->erle.average = offsetLevel;
+    }
+
+    metrics->erle.max = (short) aecMetrics->erle.max;
+
+    if (aecMetrics->erle.min < (offsetLevel * (-1))) {
+        metrics->erle.min = (short) aecMetrics->erle.min;
+    } else {
+        metrics->erle.min = offsetLevel;
+    }
+
+    // RERL
+    if ((metrics->erl.average > offsetLevel) && (metrics->erle.average > offsetLevel)) {
+        stmp = metrics->erl.average + metrics->erle.average;
+    }
+    else {
+        stmp = offsetLevel;
+    }
+    metrics->rerl.average = stmp;
+
+    // No other statistics needed, but returned for completeness
+    metrics->rerl.instant = stmp;
+    metrics->rerl.max = stmp;
+    metrics->rerl.min = stmp;
+
+    // A_NLP
+    metrics->aNlp.instant = (short) aecMetrics->aNlp.instant;
+
+    if ((aecMetrics->aNlp.himean > offsetLevel) && (aecMetrics->aNlp.average > offsetLevel)) {
+        // Use a mix between regular average and upper part average
+        dtmp =  upweight * aecMetrics->aNlp.himean + (1 - upweight) * aecMetrics->aNlp.average;
+        metrics->aNlp.average = (short) dtmp;
+    }
+    else {
+        metrics->aNlp.average = offsetLevel;
+    }
+
+    metrics->aNlp.max = (short) aecMetrics->aNlp.max;
+
+    if (aecMetrics->aNlp.min < (offsetLevel * (-1))) {
+        metrics->aNlp.min = (short) aecMetrics->aNlp.min;
+    }
+    else {
+        metrics->aNlp.min = offsetLevel;
+    }
+}
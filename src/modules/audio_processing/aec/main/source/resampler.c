@@ -49,6 +49,11 @@ int WebRtcAec_CreateResampler(void **resampInst)
     return 0;
 }
 
+int WebRtcAec_GetResamplerMemory(const void *resampInst)
+{
+    return (int)sizeof(resampler_t);
+}
+
 int WebRtcAec_InitResampler(void *resampInst, int deviceSampleRateHz)
 {
     resampler_t *obj = (resampler_t*) resampInst;
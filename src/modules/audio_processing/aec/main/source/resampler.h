@@ -17,6 +17,8 @@ enum { kResamplingDelay = 1 };
 int WebRtcAec_CreateResampler(void **resampInst);
 int WebRtcAec_InitResampler(void *resampInst, int deviceSampleRateHz);
 int WebRtcAec_FreeResampler(void *resampInst);
+// Returns number of bytes allocated for the resampler.
+int WebRtcAec_GetResamplerMemory(const void *resampInst);
 
 // Estimates skew from raw measurement.
 int WebRtcAec_GetSkew(void *resampInst, int rawSkew, float *skewEst);
@@ -11,6 +11,8 @@
 #ifndef WEBRTC_MODULES_AUDIO_PROCESSING_AECM_MAIN_INTERFACE_ECHO_CONTROL_MOBILE_H_
 #define WEBRTC_MODULES_AUDIO_PROCESSING_AECM_MAIN_INTERFACE_ECHO_CONTROL_MOBILE_H_
 
+#include <stdlib.h>
+
 #include "typedefs.h"
 
 enum {
@@ -73,7 +75,10 @@ WebRtc_Word32 WebRtcAecm_Free(void *aecmInst);
  * Inputs                       Description
  * -------------------------------------------------------------------
  * void           *aecmInst     Pointer to the AECM instance
- * WebRtc_Word32  sampFreq      Sampling frequency of data
+ * WebRtc_Word32  sampFreq      Sampling frequency of data, 8000, 16000
+ *                              or 32000 Hz. At 32000 Hz the lower and
+ *                              upper bands are passed separately to
+ *                              WebRtcAecm_Process().
  * WebRtc_Word32  scSampFreq    Soundcard sampling frequency
  *
  * Outputs                      Description
@@ -105,7 +110,9 @@ WebRtc_Word32 WebRtcAecm_BufferFarend(void* aecmInst,
                                       WebRtc_Word16 nrOfSamples);
 
 /*
- * Runs the AECM on an 80 or 160 sample blocks of data.
+ * Runs the AECM on an 80 or 160 sample blocks of data. At 32 kHz the
+ * blocks are the 0-8 kHz band, and the 8-16 kHz band is attenuated by the
+ * average suppression gain of the upper half of the lower band.
  *
  * Inputs                       Description
  * -------------------------------------------------------------------
@@ -119,6 +126,9 @@ WebRtc_Word32 WebRtcAecm_BufferFarend(void* aecmInst,
  *                               reduction is active, provide the
  *                               clean signal here. Otherwise pass a
  *                               NULL pointer.
+ * WebRtc_Word16  *nearendH      In buffer containing one frame of
+ *                               nearend+echo signal for the H band
+ *                               (32 kHz only, otherwise NULL).
  * WebRtc_Word16  nrOfSamples    Number of samples in nearend buffer
  * WebRtc_Word16  msInSndCardBuf Delay estimate for sound card and
  *                               system buffers
@@ -126,13 +136,17 @@ WebRtc_Word32 WebRtcAecm_BufferFarend(void* aecmInst,
  * Outputs                      Description
  * -------------------------------------------------------------------
  * WebRtc_Word16  *out          Out buffer, one frame of processed nearend
+ * WebRtc_Word16  *outH         Out buffer, one frame of processed nearend
+ *                              for the H band (32 kHz only)
  * WebRtc_Word32  return        0: OK
  *                             -1: error
  */
 WebRtc_Word32 WebRtcAecm_Process(void* aecmInst,
                                  const WebRtc_Word16* nearendNoisy,
                                  const WebRtc_Word16* nearendClean,
+                                 const WebRtc_Word16* nearendH,
                                  WebRtc_Word16* out,
+                                 WebRtc_Word16* outH,
                                  WebRtc_Word16 nrOfSamples,
                                  WebRtc_Word16 msInSndCardBuf);
 
@@ -170,6 +184,55 @@ WebRtc_Word32 WebRtcAecm_set_config(void* aecmInst,
 WebRtc_Word32 WebRtcAecm_get_config(void *aecmInst,
                                     AecmConfig *config);
 
+/*
+ * This function enables the user to set the echo path on-the-fly, e.g. one
+ * stored with WebRtcAecm_GetEchoPath() in an earlier call on the same
+ * device and audio route. The AECM then skips the startup phase in which
+ * the echo path is learned from scratch.
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void*        aecmInst        Pointer to the AECM instance
+ * void*        echo_path       Pointer to the echo path to be set
+ * size_t       size_bytes      Size in bytes of the echo path
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * WebRtc_Word32  return        0: OK
+ *                             -1: error
+ */
+WebRtc_Word32 WebRtcAecm_InitEchoPath(void* aecmInst,
+                                      const void* echo_path,
+                                      size_t size_bytes);
+
+/*
+ * This function enables the user to get the currently used echo path
+ * on-the-fly
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void*        aecmInst        Pointer to the AECM instance
+ * void*        echo_path       Pointer to echo path
+ * size_t       size_bytes      Size in bytes of the echo path
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * WebRtc_Word32  return        0: OK
+ *                             -1: error
+ */
+WebRtc_Word32 WebRtcAecm_GetEchoPath(void* aecmInst,
+                                     void* echo_path,
+                                     size_t size_bytes);
+
+/*
+ * This function enables the user to get the echo path size in bytes
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * size_t       return           : size in bytes
+ */
+size_t WebRtcAecm_echo_path_size_bytes(void);
+
 /*
  * Gets the last error code.
  *
@@ -183,6 +246,19 @@ WebRtc_Word32 WebRtcAecm_get_config(void *aecmInst,
  */
 WebRtc_Word32 WebRtcAecm_get_error_code(void *aecmInst);
 
+/*
+ * Gets the heap memory held by an instance, including its buffers.
+ *
+ * Inputs                       Description
+ * -------------------------------------------------------------------
+ * void         *aecmInst       Pointer to the AECM instance
+ *
+ * Outputs                      Description
+ * -------------------------------------------------------------------
+ * size_t       return          Size in bytes
+ */
+size_t WebRtcAecm_memory_usage_bytes(void *aecmInst);
+
 /*
  * Gets a version string
  *
@@ -250,6 +250,20 @@ int WebRtcAecm_CreateCore(AecmCore_t **aecmInst)
         return -1;
     }
 
+    if (WebRtcApm_CreateBuffer(&aecm->nearFrameBufH, FRAME_LEN + PART_LEN) == -1)
+    {
+        WebRtcAecm_FreeCore(aecm);
+        aecm = NULL;
+        return -1;
+    }
+
+    if (WebRtcApm_CreateBuffer(&aecm->outFrameBufH, FRAME_LEN + PART_LEN) == -1)
+    {
+        WebRtcAecm_FreeCore(aecm);
+        aecm = NULL;
+        return -1;
+    }
+
     return 0;
 }
 
@@ -272,11 +286,17 @@ int WebRtcAecm_InitCore(AecmCore_t * const aecm, int samplingFreq)
     WebRtc_Word16 i;
     WebRtc_Word16 tmp16;
 
-    if (samplingFreq != 8000 && samplingFreq != 16000)
+    if (samplingFreq != 8000 && samplingFreq != 16000 && samplingFreq != 32000)
     {
         samplingFreq = 8000;
         retVal = -1;
     }
+    aecm->sampFreq = samplingFreq;
+    // Super-wideband is processed as wideband in the low band.
+    if (samplingFreq == 32000)
+    {
+        samplingFreq = 16000;
+    }
     // sanity check of sampling frequency
     aecm->mult = (WebRtc_Word16)samplingFreq / 8000;
 
@@ -289,10 +309,13 @@ int WebRtcAecm_InitCore(AecmCore_t * const aecm, int samplingFreq)
     WebRtcApm_InitBuffer(aecm->nearNoisyFrameBuf);
     WebRtcApm_InitBuffer(aecm->nearCleanFrameBuf);
     WebRtcApm_InitBuffer(aecm->outFrameBuf);
+    WebRtcApm_InitBuffer(aecm->nearFrameBufH);
+    WebRtcApm_InitBuffer(aecm->outFrameBufH);
 
     memset(aecm->xBuf, 0, sizeof(aecm->xBuf));
     memset(aecm->dBufClean, 0, sizeof(aecm->dBufClean));
     memset(aecm->dBufNoisy, 0, sizeof(aecm->dBufNoisy));
+    memset(aecm->dBufH, 0, sizeof(aecm->dBufH));
     memset(aecm->outBuf, 0, sizeof(WebRtc_Word16) * PART_LEN);
 
     aecm->seed = 666;
@@ -428,6 +451,36 @@ int WebRtcAecm_InitCore(AecmCore_t * const aecm, int samplingFreq)
     return 0;
 }
 
+void WebRtcAecm_InitEchoPathCore(AecmCore_t * const aecm, const WebRtc_Word16 * const echo_path)
+{
+    int i = 0;
+
+    // Reset the stored channel
+    memcpy(aecm->channelStored, echo_path, sizeof(WebRtc_Word16) * PART_LEN1);
+    // Reset the adapted channels
+    memcpy(aecm->channelAdapt16, echo_path, sizeof(WebRtc_Word16) * PART_LEN1);
+    for (i = 0; i < PART_LEN1; i++)
+    {
+        aecm->channelAdapt32[i] = WEBRTC_SPL_LSHIFT_W32(
+            (WebRtc_Word32)(aecm->channelAdapt16[i]), 16);
+    }
+
+    // Reset channel storing variables
+    aecm->mseAdaptOld = 1000;
+    aecm->mseStoredOld = 1000;
+    aecm->mseThreshold = WEBRTC_SPL_WORD32_MAX;
+    aecm->mseChannelCount = 0;
+
+    // The echo path is known, so skip the blind channel storing of the first
+    // startup state and the scaling of the initial channel at first far end
+    // activity.
+    aecm->firstVAD = 0;
+    if (aecm->totCount < CONV_LEN)
+    {
+        aecm->totCount = CONV_LEN;
+    }
+}
+
 int WebRtcAecm_Control(AecmCore_t *aecm, int delay, int nlpFlag, int delayOffsetFlag)
 {
     aecm->nlpFlag = nlpFlag;
@@ -644,6 +697,8 @@ int WebRtcAecm_FreeCore(AecmCore_t *aecm)
     WebRtcApm_FreeBuffer(aecm->nearNoisyFrameBuf);
     WebRtcApm_FreeBuffer(aecm->nearCleanFrameBuf);
     WebRtcApm_FreeBuffer(aecm->outFrameBuf);
+    WebRtcApm_FreeBuffer(aecm->nearFrameBufH);
+    WebRtcApm_FreeBuffer(aecm->outFrameBufH);
 
     free(aecm);
 
@@ -653,12 +708,16 @@ int WebRtcAecm_FreeCore(AecmCore_t *aecm)
 void WebRtcAecm_ProcessFrame(AecmCore_t * const aecm, const WebRtc_Word16 * const farend,
                              const WebRtc_Word16 * const nearendNoisy,
                              const WebRtc_Word16 * const nearendClean,
-                             WebRtc_Word16 * const out)
+                             const WebRtc_Word16 * const nearendH,
+                             WebRtc_Word16 * const out,
+                             WebRtc_Word16 * const outH)
 {
     WebRtc_Word16 farBlock[PART_LEN];
     WebRtc_Word16 nearNoisyBlock[PART_LEN];
     WebRtc_Word16 nearCleanBlock[PART_LEN];
+    WebRtc_Word16 nearBlockH[PART_LEN];
     WebRtc_Word16 outBlock[PART_LEN];
+    WebRtc_Word16 outBlockH[PART_LEN];
     WebRtc_Word16 farFrame[FRAME_LEN];
     int size = 0;
 
@@ -675,22 +734,39 @@ void WebRtcAecm_ProcessFrame(AecmCore_t * const aecm, const WebRtc_Word16 * cons
     {
         WebRtcApm_WriteBuffer(aecm->nearCleanFrameBuf, nearendClean, FRAME_LEN);
     }
+    // For H band
+    if (aecm->sampFreq == 32000)
+    {
+        WebRtcApm_WriteBuffer(aecm->nearFrameBufH, nearendH, FRAME_LEN);
+    }
 
     // Process as many blocks as possible.
     while (WebRtcApm_get_buffer_size(aecm->farFrameBuf) >= PART_LEN)
     {
         WebRtcApm_ReadBuffer(aecm->farFrameBuf, farBlock, PART_LEN);
         WebRtcApm_ReadBuffer(aecm->nearNoisyFrameBuf, nearNoisyBlock, PART_LEN);
+        // For H band
+        if (aecm->sampFreq == 32000)
+        {
+            WebRtcApm_ReadBuffer(aecm->nearFrameBufH, nearBlockH, PART_LEN);
+        }
         if (nearendClean != NULL)
         {
             WebRtcApm_ReadBuffer(aecm->nearCleanFrameBuf, nearCleanBlock, PART_LEN);
-            WebRtcAecm_ProcessBlock(aecm, farBlock, nearNoisyBlock, nearCleanBlock, outBlock);
+            WebRtcAecm_ProcessBlock(aecm, farBlock, nearNoisyBlock, nearCleanBlock,
+                                    nearBlockH, outBlock, outBlockH);
         } else
         {
-            WebRtcAecm_ProcessBlock(aecm, farBlock, nearNoisyBlock, NULL, outBlock);
+            WebRtcAecm_ProcessBlock(aecm, farBlock, nearNoisyBlock, NULL,
+                                    nearBlockH, outBlock, outBlockH);
         }
 
         WebRtcApm_WriteBuffer(aecm->outFrameBuf, outBlock, PART_LEN);
+        // For H band
+        if (aecm->sampFreq == 32000)
+        {
+            WebRtcApm_WriteBuffer(aecm->outFrameBufH, outBlockH, PART_LEN);
+        }
     }
 
     // Stuff the out buffer if we have less than a frame to output.
@@ -699,10 +775,19 @@ void WebRtcAecm_ProcessFrame(AecmCore_t * const aecm, const WebRtc_Word16 * cons
     if (size < FRAME_LEN)
     {
         WebRtcApm_StuffBuffer(aecm->outFrameBuf, FRAME_LEN - size);
+        if (aecm->sampFreq == 32000)
+        {
+            WebRtcApm_StuffBuffer(aecm->outFrameBufH, FRAME_LEN - size);
+        }
     }
 
     // Obtain an output frame.
     WebRtcApm_ReadBuffer(aecm->outFrameBuf, out, FRAME_LEN);
+    // For H band
+    if (aecm->sampFreq == 32000)
+    {
+        WebRtcApm_ReadBuffer(aecm->outFrameBufH, outH, FRAME_LEN);
+    }
 }
 
 // WebRtcAecm_AsymFilt(...)
@@ -1512,7 +1597,9 @@ void WebRtcAecm_DelayCompensation(AecmCore_t * const aecm)
 void WebRtcAecm_ProcessBlock(AecmCore_t * const aecm, const WebRtc_Word16 * const farend,
                              const WebRtc_Word16 * const nearendNoisy,
                              const WebRtc_Word16 * const nearendClean,
-                             WebRtc_Word16 * const output)
+                             const WebRtc_Word16 * const nearendH,
+                             WebRtc_Word16 * const output,
+                             WebRtc_Word16 * const outputH)
 {
     int i, j;
 
@@ -1547,6 +1634,7 @@ void WebRtcAecm_ProcessBlock(AecmCore_t * const aecm, const WebRtc_Word16 * cons
     WebRtc_Word16 hnl[PART_LEN1];
     WebRtc_Word16 numPosCoef;
     WebRtc_Word16 nlpGain;
+    WebRtc_Word16 nlpGainH;
     WebRtc_Word16 delay, diff, diffMinusOne;
     WebRtc_Word16 tmp16no1;
     WebRtc_Word16 tmp16no2;
@@ -1589,6 +1677,11 @@ void WebRtcAecm_ProcessBlock(AecmCore_t * const aecm, const WebRtc_Word16 * cons
     {
         memcpy(aecm->dBufClean + PART_LEN, nearendClean, sizeof(WebRtc_Word16) * PART_LEN);
     }
+    // For H band
+    if (aecm->sampFreq == 32000)
+    {
+        memcpy(aecm->dBufH + PART_LEN, nearendH, sizeof(WebRtc_Word16) * PART_LEN);
+    }
     // TODO(bjornv): Will be removed in final version.
 #ifdef VAD_DATA
     fwrite(aecm->xBuf, sizeof(WebRtc_Word16), PART_LEN, aecm->far_file);
@@ -2245,6 +2338,25 @@ void WebRtcAecm_ProcessBlock(AecmCore_t * const aecm, const WebRtc_Word16 * cons
                                                                           14));
     }
 
+    // For H band
+    if (aecm->sampFreq == 32000)
+    {
+        // Attenuate the high band with the average suppression gain over the
+        // upper half of the low band (4-8 kHz), in Q14. The high band is
+        // output with the same one block delay as the low band.
+        tmp32no1 = 0;
+        for (i = PART_LEN >> 1; i < PART_LEN; i++)
+        {
+            tmp32no1 += hnl[i];
+        }
+        nlpGainH = (WebRtc_Word16)WEBRTC_SPL_RSHIFT_W32(tmp32no1, PART_LEN_SHIFT - 2);
+        for (i = 0; i < PART_LEN; i++)
+        {
+            outputH[i] = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT_WITH_ROUND(
+                    aecm->dBufH[i], nlpGainH, 14);
+        }
+    }
+
     if (aecm->cngMode == AecmTrue)
     {
         WebRtcAecm_ComfortNoise(aecm, ptrDfaClean, efwReal, efwImag, hnl);
@@ -2347,6 +2459,10 @@ void WebRtcAecm_ProcessBlock(AecmCore_t * const aecm, const WebRtc_Word16 * cons
     {
         memcpy(aecm->dBufClean, aecm->dBufClean + PART_LEN, sizeof(WebRtc_Word16) * PART_LEN);
     }
+    if (aecm->sampFreq == 32000)
+    {
+        memcpy(aecm->dBufH, aecm->dBufH + PART_LEN, sizeof(WebRtc_Word16) * PART_LEN);
+    }
 }
 
 // Generate comfort noise and add to output signal.
@@ -2366,7 +2482,8 @@ static void WebRtcAecm_ComfortNoise(AecmCore_t * const aecm, const WebRtc_UWord1
     WebRtc_Word16 tmp16;
     WebRtc_Word32 tmp32;
 
-    WebRtc_Word16 randW16[PART_LEN];
+    WebRtc_Word16 cosQ13[PART_LEN];
+    WebRtc_Word16 sinQ13[PART_LEN];
     WebRtc_Word16 uReal[PART_LEN1];
     WebRtc_Word16 uImag[PART_LEN1];
     WebRtc_Word32 outLShift32[PART_LEN1];
@@ -2432,22 +2549,18 @@ static void WebRtcAecm_ComfortNoise(AecmCore_t * const aecm, const WebRtc_UWord1
                 = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT(tmp16, noiseRShift16[i], 14);
     }
 
-    // Generate a uniform random array on [0 2^15-1].
-    WebRtcSpl_RandUArray(randW16, PART_LEN, &aecm->seed);
+    // Generate a random phase (Q13) for each bin.
+    WebRtcSpl_RandPhaseQ13(cosQ13, sinQ13, PART_LEN, &aecm->seed);
 
     // Generate noise according to estimated energy.
     uReal[0] = 0; // Reject LF noise.
     uImag[0] = 0;
     for (i = 1; i < PART_LEN1; i++)
     {
-        // Get a random index for the cos and sin tables over [0 359].
-        tmp16 = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT(359, randW16[i - 1], 15);
-
-        // Tables are in Q13.
         uReal[i] = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT(noiseRShift16[i],
-                WebRtcSpl_kCosTable[tmp16], 13);
+                cosQ13[i - 1], 13);
         uImag[i] = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT(-noiseRShift16[i],
-                WebRtcSpl_kSinTable[tmp16], 13);
+                sinQ13[i - 1], 13);
     }
     uImag[PART_LEN] = 0;
 
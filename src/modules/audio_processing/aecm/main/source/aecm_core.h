@@ -115,15 +115,19 @@ typedef struct
     void *nearNoisyFrameBuf;
     void *nearCleanFrameBuf;
     void *outFrameBuf;
+    void *nearFrameBufH; // nearend high band for super-wideband
+    void *outFrameBufH;
 
     WebRtc_Word16 xBuf[PART_LEN2]; // farend
     WebRtc_Word16 dBufClean[PART_LEN2]; // nearend
     WebRtc_Word16 dBufNoisy[PART_LEN2]; // nearend
+    WebRtc_Word16 dBufH[PART_LEN2]; // nearend high band
     WebRtc_Word16 outBuf[PART_LEN];
 
     WebRtc_Word16 farBuf[FAR_BUF_LEN];
 
     WebRtc_Word16 mult;
+    int sampFreq; // 32000 when a high band is processed along with the low band
     WebRtc_UWord32 seed;
 
     // Delay estimation variables
@@ -265,6 +269,20 @@ int WebRtcAecm_InitCore(AecmCore_t * const aecm, int samplingFreq);
 //
 int WebRtcAecm_FreeCore(AecmCore_t *aecm);
 
+///////////////////////////////////////////////////////////////////////////////////////////////
+// WebRtcAecm_InitEchoPathCore(...)
+//
+// This function resets the echo channel adaptation with the specified channel,
+// and skips the part of the startup phase that learns the channel from scratch.
+// Input:
+//      - aecm          : Pointer to the AECM instance
+//      - echo_path     : Pointer to the data that should initialize the echo path
+//
+// Output:
+//      - aecm          : Initialized instance
+//
+void WebRtcAecm_InitEchoPathCore(AecmCore_t * const aecm, const WebRtc_Word16 * const echo_path);
+
 int WebRtcAecm_Control(AecmCore_t *aecm, int delay, int nlpFlag, int delayOffsetFlag);
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
@@ -277,15 +295,20 @@ int WebRtcAecm_Control(AecmCore_t *aecm, int delay, int nlpFlag, int delayOffset
 //      - farend        : In buffer containing one frame of echo signal
 //      - nearendNoisy  : In buffer containing one frame of nearend+echo signal without NS
 //      - nearendClean  : In buffer containing one frame of nearend+echo signal with NS
+//      - nearendH      : In buffer containing one frame of the nearend high band
+//                        (super-wideband only, otherwise NULL)
 //
 // Output:
 //      - out           : Out buffer, one frame of nearend signal          :
+//      - outH          : Out buffer, one frame of the nearend high band
 //
 //
 void WebRtcAecm_ProcessFrame(AecmCore_t * const aecm, const WebRtc_Word16 * const farend,
                              const WebRtc_Word16 * const nearendNoisy,
                              const WebRtc_Word16 * const nearendClean,
-                             WebRtc_Word16 * const out);
+                             const WebRtc_Word16 * const nearendH,
+                             WebRtc_Word16 * const out,
+                             WebRtc_Word16 * const outH);
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
 // WebRtcAecm_ProcessBlock(...)
@@ -298,15 +321,21 @@ void WebRtcAecm_ProcessFrame(AecmCore_t * const aecm, const WebRtc_Word16 * cons
 //      - farend        : In buffer containing one block of echo signal
 //      - nearendNoisy  : In buffer containing one frame of nearend+echo signal without NS
 //      - nearendClean  : In buffer containing one frame of nearend+echo signal with NS
+//      - nearendH      : In buffer containing one block of the nearend high band
+//                        (super-wideband only, otherwise NULL)
 //
 // Output:
 //      - out           : Out buffer, one block of nearend signal          :
+//      - outH          : Out buffer, one block of the nearend high band,
+//                        attenuated with the upper low band suppression gain
 //
 //
 void WebRtcAecm_ProcessBlock(AecmCore_t * const aecm, const WebRtc_Word16 * const farend,
                                 const WebRtc_Word16 * const nearendNoisy,
                                 const WebRtc_Word16 * const noisyClean,
-                                WebRtc_Word16 * const out);
+                                const WebRtc_Word16 * const nearendH,
+                                WebRtc_Word16 * const out,
+                                WebRtc_Word16 * const outH);
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
 // WebRtcAecm_BufferFarFrame()
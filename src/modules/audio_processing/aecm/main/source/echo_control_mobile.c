@@ -169,7 +169,7 @@ WebRtc_Word32 WebRtcAecm_Init(void *aecmInst, WebRtc_Word32 sampFreq, WebRtc_Wor
         return -1;
     }
 
-    if (sampFreq != 8000 && sampFreq != 16000)
+    if (sampFreq != 8000 && sampFreq != 16000 && sampFreq != 32000)
     {
         aecm->lastError = AECM_BAD_PARAMETER_ERROR;
         return -1;
@@ -270,8 +270,10 @@ WebRtc_Word32 WebRtcAecm_BufferFarend(void *aecmInst, const WebRtc_Word16 *faren
 }
 
 WebRtc_Word32 WebRtcAecm_Process(void *aecmInst, const WebRtc_Word16 *nearendNoisy,
-                                 const WebRtc_Word16 *nearendClean, WebRtc_Word16 *out,
-                                 WebRtc_Word16 nrOfSamples, WebRtc_Word16 msInSndCardBuf)
+                                 const WebRtc_Word16 *nearendClean,
+                                 const WebRtc_Word16 *nearendH, WebRtc_Word16 *out,
+                                 WebRtc_Word16 *outH, WebRtc_Word16 nrOfSamples,
+                                 WebRtc_Word16 msInSndCardBuf)
 {
     aecmob_t *aecm = aecmInst;
     WebRtc_Word32 retVal = 0;
@@ -319,6 +321,12 @@ WebRtc_Word32 WebRtcAecm_Process(void *aecmInst, const WebRtc_Word16 *nearendNoi
         return -1;
     }
 
+    if (aecm->sampFreq == 32000 && (nearendH == NULL || outH == NULL))
+    {
+        aecm->lastError = AECM_NULL_POINTER_ERROR;
+        return -1;
+    }
+
     if (nrOfSamples != 80 && nrOfSamples != 160)
     {
         aecm->lastError = AECM_BAD_PARAMETER_ERROR;
@@ -351,6 +359,11 @@ WebRtc_Word32 WebRtcAecm_Process(void *aecmInst, const WebRtc_Word16 *nearendNoi
         {
             memcpy(out, nearendClean, sizeof(short) * nrOfSamples);
         }
+        // For H band
+        if (aecm->sampFreq == 32000)
+        {
+            memcpy(outH, nearendH, sizeof(short) * nrOfSamples);
+        }
 
         nmbrOfFilledBuffers = WebRtcApm_get_buffer_size(aecm->farendBuf) / FRAME_LEN;
         // The AECM is in the start up mode
@@ -446,8 +459,8 @@ WebRtc_Word32 WebRtcAecm_Process(void *aecmInst, const WebRtc_Word16 *nearendNoi
             }
 
             // Call buffer delay estimator when all data is extracted,
-            // i,e. i = 0 for NB and i = 1 for WB
-            if ((i == 0 && aecm->sampFreq == 8000) || (i == 1 && aecm->sampFreq == 16000))
+            // i,e. i = 0 for NB and i = 1 for WB and SWB
+            if ((i == 0 && aecm->sampFreq == 8000) || (i == 1 && aecm->sampFreq != 8000))
             {
                 WebRtcAecm_EstBufDelay(aecm, aecm->msInSndCardBuf);
             }
@@ -466,11 +479,17 @@ WebRtc_Word32 WebRtcAecm_Process(void *aecmInst, const WebRtc_Word16 *nearendNoi
             if (nearendClean == NULL)
             {
                 WebRtcAecm_ProcessFrame(aecm->aecmCore, farend, &nearendNoisy[FRAME_LEN * i],
-                                        NULL, &out[FRAME_LEN * i]);
+                                        NULL,
+                                        nearendH ? &nearendH[FRAME_LEN * i] : NULL,
+                                        &out[FRAME_LEN * i],
+                                        outH ? &outH[FRAME_LEN * i] : NULL);
             } else
             {
                 WebRtcAecm_ProcessFrame(aecm->aecmCore, farend, &nearendNoisy[FRAME_LEN * i],
-                                        &nearendClean[FRAME_LEN * i], &out[FRAME_LEN * i]);
+                                        &nearendClean[FRAME_LEN * i],
+                                        nearendH ? &nearendH[FRAME_LEN * i] : NULL,
+                                        &out[FRAME_LEN * i],
+                                        outH ? &outH[FRAME_LEN * i] : NULL);
             }
 
 #ifdef ARM_WINM_LOG
@@ -627,6 +646,74 @@ WebRtc_Word32 WebRtcAecm_get_config(void *aecmInst, AecmConfig *config)
     return 0;
 }
 
+WebRtc_Word32 WebRtcAecm_InitEchoPath(void* aecmInst,
+                                      const void* echo_path,
+                                      size_t size_bytes)
+{
+    aecmob_t *aecm = aecmInst;
+    const WebRtc_Word16* echo_path_ptr = echo_path;
+
+    if ((aecm == NULL) || (echo_path == NULL))
+    {
+        if (aecm != NULL)
+        {
+            aecm->lastError = AECM_NULL_POINTER_ERROR;
+        }
+        return -1;
+    }
+    if (size_bytes != WebRtcAecm_echo_path_size_bytes())
+    {
+        // Input channel size does not match the size of AECM
+        aecm->lastError = AECM_BAD_PARAMETER_ERROR;
+        return -1;
+    }
+    if (aecm->initFlag != kInitCheck)
+    {
+        aecm->lastError = AECM_UNINITIALIZED_ERROR;
+        return -1;
+    }
+
+    WebRtcAecm_InitEchoPathCore(aecm->aecmCore, echo_path_ptr);
+
+    return 0;
+}
+
+WebRtc_Word32 WebRtcAecm_GetEchoPath(void* aecmInst,
+                                     void* echo_path,
+                                     size_t size_bytes)
+{
+    aecmob_t *aecm = aecmInst;
+    WebRtc_Word16* echo_path_ptr = echo_path;
+
+    if ((aecm == NULL) || (echo_path == NULL))
+    {
+        if (aecm != NULL)
+        {
+            aecm->lastError = AECM_NULL_POINTER_ERROR;
+        }
+        return -1;
+    }
+    if (size_bytes != WebRtcAecm_echo_path_size_bytes())
+    {
+        // Input channel size does not match the size of AECM
+        aecm->lastError = AECM_BAD_PARAMETER_ERROR;
+        return -1;
+    }
+    if (aecm->initFlag != kInitCheck)
+    {
+        aecm->lastError = AECM_UNINITIALIZED_ERROR;
+        return -1;
+    }
+
+    memcpy(echo_path_ptr, aecm->aecmCore->channelStored, size_bytes);
+    return 0;
+}
+
+size_t WebRtcAecm_echo_path_size_bytes(void)
+{
+    return (PART_LEN1 * sizeof(WebRtc_Word16));
+}
+
 WebRtc_Word32 WebRtcAecm_get_version(WebRtc_Word8 *versionStr, WebRtc_Word16 len)
 {
     const char version[] = "AECM 1.2.0";
@@ -658,6 +745,27 @@ WebRtc_Word32 WebRtcAecm_get_error_code(void *aecmInst)
     return aecm->lastError;
 }
 
+size_t WebRtcAecm_memory_usage_bytes(void *aecmInst)
+{
+    aecmob_t *aecm = aecmInst;
+    AecmCore_t *core;
+
+    if (aecm == NULL)
+    {
+        return 0;
+    }
+    core = aecm->aecmCore;
+
+    return sizeof(aecmob_t) + sizeof(AecmCore_t) +
+        WebRtcApm_get_buffer_memory(aecm->farendBuf) +
+        WebRtcApm_get_buffer_memory(core->farFrameBuf) +
+        WebRtcApm_get_buffer_memory(core->nearNoisyFrameBuf) +
+        WebRtcApm_get_buffer_memory(core->nearCleanFrameBuf) +
+        WebRtcApm_get_buffer_memory(core->outFrameBuf) +
+        WebRtcApm_get_buffer_memory(core->nearFrameBufH) +
+        WebRtcApm_get_buffer_memory(core->outFrameBufH);
+}
+
 static int WebRtcAecm_EstBufDelay(aecmob_t *aecm, short msInSndCardBuf)
 {
     short delayNew, nSampFar, nSampSndCard;
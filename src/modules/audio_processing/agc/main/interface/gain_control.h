@@ -11,6 +11,8 @@
 #ifndef WEBRTC_MODULES_AUDIO_PROCESSING_AGC_MAIN_INTERFACE_GAIN_CONTROL_H_
 #define WEBRTC_MODULES_AUDIO_PROCESSING_AGC_MAIN_INTERFACE_GAIN_CONTROL_H_
 
+#include <stdlib.h>
+
 #include "typedefs.h"
 
 // Errors
@@ -23,6 +25,9 @@
 // Warnings
 #define AGC_BAD_PARAMETER_WARNING       18050
 
+// Maximum number of channels handled by one instance in linked mode
+#define AGC_MAX_CHANNELS                8
+
 enum
 {
     kAgcModeUnchanged,
@@ -96,6 +101,30 @@ int WebRtcAgc_AddMic(void* agcInst,
                      WebRtc_Word16* inMic_H,
                      WebRtc_Word16 samples);
 
+/*
+ * As WebRtcAgc_AddMic(), but for |numChannels| (at most AGC_MAX_CHANNELS)
+ * linked channels sharing one instance. The envelope is the maximum over the
+ * channels, the VAD runs on their mix, and the same gain is applied to each.
+ *
+ * Input:
+ *      - agcInst           : AGC instance.
+ *      - inMic             : Microphone input speech vectors, one per channel,
+ *                            for L band
+ *      - inMic_H           : Microphone input speech vectors, one per channel,
+ *                            for H band
+ *      - numChannels       : Number of channels
+ *      - samples           : Number of samples in each input vector
+ *
+ * Return value:
+ *                          :  0 - Normal operation.
+ *                          : -1 - Error
+ */
+int WebRtcAgc_AddMicLinked(void* agcInst,
+                           WebRtc_Word16* const* inMic,
+                           WebRtc_Word16* const* inMic_H,
+                           WebRtc_Word16 numChannels,
+                           WebRtc_Word16 samples);
+
 /*
  * This function replaces the analog microphone with a virtual one.
  * It is a digital gain applied to the input signal and is used in the
@@ -129,6 +158,38 @@ int WebRtcAgc_VirtualMic(void* agcInst,
                          WebRtc_Word32 micLevelIn,
                          WebRtc_Word32* micLevelOut);
 
+/*
+ * As WebRtcAgc_VirtualMic(), but for |numChannels| linked channels sharing
+ * one instance. The level is decided on the mix of the channels, and the same
+ * gain is applied to each.
+ *
+ * Input:
+ *      - agcInst           : AGC instance.
+ *      - inMic             : Microphone input speech vectors, one per channel,
+ *                            for L band
+ *      - inMic_H           : Microphone input speech vectors, one per channel,
+ *                            for H band
+ *      - numChannels       : Number of channels
+ *      - samples           : Number of samples in each input vector
+ *      - micLevelIn        : Input level of microphone (static)
+ *
+ * Output:
+ *      - inMic             : Microphone output after processing (L band)
+ *      - inMic_H           : Microphone output after processing (H band)
+ *      - micLevelOut       : Adjusted microphone level after processing
+ *
+ * Return value:
+ *                          :  0 - Normal operation.
+ *                          : -1 - Error
+ */
+int WebRtcAgc_VirtualMicLinked(void* agcInst,
+                               WebRtc_Word16* const* inMic,
+                               WebRtc_Word16* const* inMic_H,
+                               WebRtc_Word16 numChannels,
+                               WebRtc_Word16 samples,
+                               WebRtc_Word32 micLevelIn,
+                               WebRtc_Word32* micLevelOut);
+
 /*
  * This function processes a 10/20ms frame and adjusts (normalizes) the gain
  * both analog and digitally. The gain adjustments are done only during
@@ -178,6 +239,47 @@ int WebRtcAgc_Process(void* agcInst,
                       WebRtc_Word16 echo,
                       WebRtc_UWord8* saturationWarning);
 
+/*
+ * As WebRtcAgc_Process(), but for |numChannels| linked channels sharing one
+ * instance. The gain is computed once, from the maximum envelope over the
+ * channels, and applied to each of them, which preserves the stereo image.
+ * Must be used together with WebRtcAgc_AddMicLinked() or
+ * WebRtcAgc_VirtualMicLinked() on the same channels.
+ *
+ * Input:
+ *      - agcInst           : AGC instance
+ *      - inNear            : Near-end input speech vectors, one per channel,
+ *                            for L band
+ *      - inNear_H          : Near-end input speech vectors, one per channel,
+ *                            for H band
+ *      - numChannels       : Number of channels
+ *      - samples           : Number of samples in each input/output vector
+ *      - inMicLevel        : Current microphone volume level
+ *      - echo              : As for WebRtcAgc_Process()
+ *
+ * Output:
+ *      - outMicLevel       : Adjusted microphone volume level
+ *      - out               : Gain-adjusted near-end speech vectors (L band)
+ *                          : May be the same vectors as the input.
+ *      - out_H             : Gain-adjusted near-end speech vectors (H band)
+ *      - saturationWarning : As for WebRtcAgc_Process()
+ *
+ * Return value:
+ *                          :  0 - Normal operation.
+ *                          : -1 - Error
+ */
+int WebRtcAgc_ProcessLinked(void* agcInst,
+                            const WebRtc_Word16* const* inNear,
+                            const WebRtc_Word16* const* inNear_H,
+                            WebRtc_Word16 numChannels,
+                            WebRtc_Word16 samples,
+                            WebRtc_Word16* const* out,
+                            WebRtc_Word16* const* out_H,
+                            WebRtc_Word32 inMicLevel,
+                            WebRtc_Word32* outMicLevel,
+                            WebRtc_Word16 echo,
+                            WebRtc_UWord8* saturationWarning);
+
 /*
  * This function sets the config parameters (targetLevelDbfs,
  * compressionGaindB and limiterEnable).
@@ -194,6 +296,22 @@ int WebRtcAgc_Process(void* agcInst,
  */
 int WebRtcAgc_set_config(void* agcInst, WebRtcAgc_config_t config);
 
+/*
+ * This function tells the AGC whether the near end is active. While it is
+ * not, the last digital gain is applied as it is, and the analog level, the
+ * envelopes and the VADs are left unchanged. The AGC is active after
+ * WebRtcAgc_Init().
+ *
+ * Input:
+ *      - agcInst           : AGC instance
+ *      - active            : 0 - Inactive, otherwise active
+ *
+ * Return value:
+ *                          :  0 - Normal operation.
+ *                          : -1 - Error
+ */
+int WebRtcAgc_set_activity(void* agcInst, WebRtc_Word16 active);
+
 /*
  * This function returns the config parameters (targetLevelDbfs,
  * compressionGaindB and limiterEnable).
@@ -230,6 +348,16 @@ int WebRtcAgc_Create(void **agcInst);
  */
 int WebRtcAgc_Free(void *agcInst);
 
+/*
+ * This function returns the heap memory held by an AGC instance.
+ *
+ * Input:
+ *      - agcInst           : AGC instance.
+ *
+ * Return value             : Size in bytes
+ */
+size_t WebRtcAgc_memory_usage_bytes(void *agcInst);
+
 /*
  * This function initializes an AGC instance.
  *
@@ -24,6 +24,16 @@
 #endif
 #include "analog_agc.h"
 
+/* The per-sample loops use SSE2 or NEON when the compiler targets it. */
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WEBRTC_AGC_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define WEBRTC_AGC_NEON
+#include <arm_neon.h>
+#endif
+
 /* The slope of in Q13*/
 static const WebRtc_Word16 kSlope1[8] = {21793, 12517, 7189, 4129, 2372, 1362, 472, 78};
 
@@ -110,13 +120,218 @@ static const WebRtc_Word32 kTargetLevelTable[64] = {134209536, 106606424, 846804
         6726, 5343, 4244, 3371, 2678, 2127, 1690, 1342, 1066, 847, 673, 534, 424, 337, 268,
         213, 169, 134, 107, 85, 67};
 
+/* The per-sample loops below are kept free of state updates and early exits.
+ * The SSE2 and NEON versions give the same result as the plain C ones, which
+ * also handle the samples left over. */
+
+#if defined(WEBRTC_AGC_SSE2)
+/* Widens the range [*minValue, *maxValue] to include the lanes of |vmin| and
+ * |vmax|. */
+static __inline void WebRtcAgc_FoldRangeSse2(__m128i vmin, __m128i vmax,
+                                             WebRtc_Word16 *minValue,
+                                             WebRtc_Word16 *maxValue)
+{
+    WebRtc_Word16 lanes[16];
+    int k;
+
+    _mm_storeu_si128((__m128i*)lanes, vmin);
+    _mm_storeu_si128((__m128i*)&lanes[8], vmax);
+    for (k = 0; k < 8; k++)
+    {
+        *minValue = WEBRTC_SPL_MIN(*minValue, lanes[k]);
+        *maxValue = WEBRTC_SPL_MAX(*maxValue, lanes[8 + k]);
+    }
+}
+#elif defined(WEBRTC_AGC_NEON)
+/* Widens the range [*minValue, *maxValue] to include the lanes of |vmin| and
+ * |vmax|. */
+static __inline void WebRtcAgc_FoldRangeNeon(int16x8_t vmin, int16x8_t vmax,
+                                             WebRtc_Word16 *minValue,
+                                             WebRtc_Word16 *maxValue)
+{
+    WebRtc_Word16 lanes[16];
+    int k;
+
+    vst1q_s16(lanes, vmin);
+    vst1q_s16(&lanes[8], vmax);
+    for (k = 0; k < 8; k++)
+    {
+        *minValue = WEBRTC_SPL_MIN(*minValue, lanes[k]);
+        *maxValue = WEBRTC_SPL_MAX(*maxValue, lanes[8 + k]);
+    }
+}
+#endif
+
+/* Multiplies |vector| by |gain| and shifts it down by |rshift| with saturation,
+ * in place. */
+static void WebRtcAgc_ApplyGainW16(WebRtc_Word16 *vector, int length,
+                                   WebRtc_UWord16 gain, int rshift)
+{
+    WebRtc_Word32 tmp32;
+    int i = 0;
+#if defined(WEBRTC_AGC_SSE2)
+    const __m128i vgain = _mm_set1_epi16((WebRtc_Word16)gain);
+    const __m128i count = _mm_cvtsi32_si128(rshift);
+
+    for (; i + 8 <= length; i += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)&vector[i]);
+        __m128i lo = _mm_mullo_epi16(x, vgain);
+        /* High half of the signed by unsigned product */
+        __m128i hi = _mm_sub_epi16(_mm_mulhi_epu16(x, vgain),
+                                   _mm_and_si128(_mm_srai_epi16(x, 15), vgain));
+        __m128i y0 = _mm_sra_epi32(_mm_unpacklo_epi16(lo, hi), count);
+        __m128i y1 = _mm_sra_epi32(_mm_unpackhi_epi16(lo, hi), count);
+        _mm_storeu_si128((__m128i*)&vector[i], _mm_packs_epi32(y0, y1));
+    }
+#elif defined(WEBRTC_AGC_NEON)
+    const int32x4_t vgain = vdupq_n_s32(gain);
+    const int32x4_t shift = vdupq_n_s32(-rshift);
+
+    for (; i + 8 <= length; i += 8)
+    {
+        int16x8_t x = vld1q_s16(&vector[i]);
+        int32x4_t y0 = vshlq_s32(vmulq_s32(vmovl_s16(vget_low_s16(x)), vgain), shift);
+        int32x4_t y1 = vshlq_s32(vmulq_s32(vmovl_s16(vget_high_s16(x)), vgain), shift);
+        vst1q_s16(&vector[i], vcombine_s16(vqmovn_s32(y0), vqmovn_s32(y1)));
+    }
+#endif
+
+    for (; i < length; i++)
+    {
+        tmp32 = WEBRTC_SPL_RSHIFT_W32(WEBRTC_SPL_MUL_16_U16(vector[i], gain), rshift);
+        vector[i] = (WebRtc_Word16)WEBRTC_SPL_SAT(32767, tmp32, -32768);
+    }
+}
+
+/* Returns the maximum of the squared samples in |vector|. */
+static WebRtc_Word32 WebRtcAgc_MaxSquareW16(const WebRtc_Word16 *vector, int length)
+{
+    WebRtc_Word32 nrg, max_nrg = 0;
+    int i = 0;
+#if defined(WEBRTC_AGC_SSE2) || defined(WEBRTC_AGC_NEON)
+    /* The largest square is that of the minimum or the maximum. */
+    WebRtc_Word16 minVal = 0;
+    WebRtc_Word16 maxVal = 0;
+#if defined(WEBRTC_AGC_SSE2)
+    __m128i vmin = _mm_setzero_si128();
+    __m128i vmax = _mm_setzero_si128();
+
+    for (; i + 8 <= length; i += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)&vector[i]);
+        vmin = _mm_min_epi16(vmin, x);
+        vmax = _mm_max_epi16(vmax, x);
+    }
+    WebRtcAgc_FoldRangeSse2(vmin, vmax, &minVal, &maxVal);
+#else
+    int16x8_t vmin = vdupq_n_s16(0);
+    int16x8_t vmax = vdupq_n_s16(0);
+
+    for (; i + 8 <= length; i += 8)
+    {
+        int16x8_t x = vld1q_s16(&vector[i]);
+        vmin = vminq_s16(vmin, x);
+        vmax = vmaxq_s16(vmax, x);
+    }
+    WebRtcAgc_FoldRangeNeon(vmin, vmax, &minVal, &maxVal);
+#endif
+    max_nrg = WEBRTC_SPL_MAX(WEBRTC_SPL_MUL_16_16(minVal, minVal),
+                             WEBRTC_SPL_MUL_16_16(maxVal, maxVal));
+#endif
+
+    for (; i < length; i++)
+    {
+        nrg = WEBRTC_SPL_MUL_16_16(vector[i], vector[i]);
+        max_nrg = WEBRTC_SPL_MAX(max_nrg, nrg);
+    }
+    return max_nrg;
+}
+
+/* Returns the number of zero crossings in |vector|, and its minimum and maximum
+ * values in |minValue| and |maxValue|. */
+static WebRtc_Word16 WebRtcAgc_ZeroCrossingsAndRange(const WebRtc_Word16 *vector,
+                                                     int length,
+                                                     WebRtc_Word16 *minValue,
+                                                     WebRtc_Word16 *maxValue)
+{
+    WebRtc_Word16 numZeroCrossing = 0;
+    WebRtc_Word16 minVal = vector[0];
+    WebRtc_Word16 maxVal = vector[0];
+    int i = 1;
+#if defined(WEBRTC_AGC_SSE2)
+    __m128i vmin = _mm_set1_epi16(vector[0]);
+    __m128i vmax = vmin;
+    __m128i count = _mm_setzero_si128();
+    WebRtc_Word16 lanes[8];
+    int k;
+
+    for (; i + 8 <= length; i += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)&vector[i]);
+        __m128i prev = _mm_loadu_si128((const __m128i*)&vector[i - 1]);
+        /* Subtracts -1 where the sign changes */
+        count = _mm_sub_epi16(count, _mm_srai_epi16(_mm_xor_si128(x, prev), 15));
+        vmin = _mm_min_epi16(vmin, x);
+        vmax = _mm_max_epi16(vmax, x);
+    }
+    WebRtcAgc_FoldRangeSse2(vmin, vmax, &minVal, &maxVal);
+    _mm_storeu_si128((__m128i*)lanes, count);
+    for (k = 0; k < 8; k++)
+    {
+        numZeroCrossing += lanes[k];
+    }
+#elif defined(WEBRTC_AGC_NEON)
+    int16x8_t vmin = vdupq_n_s16(vector[0]);
+    int16x8_t vmax = vmin;
+    int16x8_t count = vdupq_n_s16(0);
+    WebRtc_Word16 lanes[8];
+    int k;
+
+    for (; i + 8 <= length; i += 8)
+    {
+        int16x8_t x = vld1q_s16(&vector[i]);
+        int16x8_t prev = vld1q_s16(&vector[i - 1]);
+        /* Subtracts -1 where the sign changes */
+        count = vsubq_s16(count, vshrq_n_s16(veorq_s16(x, prev), 15));
+        vmin = vminq_s16(vmin, x);
+        vmax = vmaxq_s16(vmax, x);
+    }
+    WebRtcAgc_FoldRangeNeon(vmin, vmax, &minVal, &maxVal);
+    vst1q_s16(lanes, count);
+    for (k = 0; k < 8; k++)
+    {
+        numZeroCrossing += lanes[k];
+    }
+#endif
+
+    for (; i < length; i++)
+    {
+        numZeroCrossing += ((vector[i] ^ vector[i - 1]) < 0);
+        minVal = WEBRTC_SPL_MIN(minVal, vector[i]);
+        maxVal = WEBRTC_SPL_MAX(maxVal, vector[i]);
+    }
+    *minValue = minVal;
+    *maxValue = maxVal;
+    return numZeroCrossing;
+}
+
 int WebRtcAgc_AddMic(void *state, WebRtc_Word16 *in_mic, WebRtc_Word16 *in_mic_H,
                      WebRtc_Word16 samples)
 {
-    WebRtc_Word32 nrg, max_nrg, sample, tmp32;
+    return WebRtcAgc_AddMicLinked(state, &in_mic, &in_mic_H, 1, samples);
+}
+
+int WebRtcAgc_AddMicLinked(void *state, WebRtc_Word16 *const *in_mic,
+                           WebRtc_Word16 *const *in_mic_H, WebRtc_Word16 num_channels,
+                           WebRtc_Word16 samples)
+{
+    WebRtc_Word32 tmp32;
     WebRtc_Word32 *ptr;
     WebRtc_UWord16 targetGainIdx, gain;
-    WebRtc_Word16 i, n, L, M, subFrames, tmp16, tmp_speech[16];
+    WebRtc_Word16 i, ch, L, M, subFrames, tmp16, tmp_speech[16];
+    WebRtc_Word16 mix[320];
+    const WebRtc_Word16 *mic;
     Agc_t *stt;
     stt = (Agc_t *)state;
 
@@ -186,6 +401,10 @@ int WebRtcAgc_AddMic(void *state, WebRtc_Word16 *in_mic, WebRtc_Word16 *in_mic_H
         }
     }
 
+    if ((num_channels < 1) || (num_channels > AGC_MAX_CHANNELS))
+    {
+        return -1;
+    }
     /* Check for valid pointers based on sampling rate */
     if ((stt->fs == 32000) && (in_mic_H == NULL))
     {
@@ -196,6 +415,13 @@ int WebRtcAgc_AddMic(void *state, WebRtc_Word16 *in_mic, WebRtc_Word16 *in_mic_H
     {
         return -1;
     }
+    for (ch = 0; ch < num_channels; ch++)
+    {
+        if (((stt->fs == 32000) && (in_mic_H[ch] == NULL)) || (in_mic[ch] == NULL))
+        {
+            return -1;
+        }
+    }
 
     /* apply slowly varying digital gain */
     if (stt->micVol > stt->maxAnalog)
@@ -221,37 +447,14 @@ int WebRtcAgc_AddMic(void *state, WebRtc_Word16 *in_mic, WebRtc_Word16 *in_mic_H
         /* Q12 */
         gain = kGainTableAnalog[stt->gainTableIdx];
 
-        for (i = 0; i < samples; i++)
+        for (ch = 0; ch < num_channels; ch++)
         {
             // For lower band
-            tmp32 = WEBRTC_SPL_MUL_16_U16(in_mic[i], gain);
-            sample = WEBRTC_SPL_RSHIFT_W32(tmp32, 12);
-            if (sample > 32767)
-            {
-                in_mic[i] = 32767;
-            } else if (sample < -32768)
-            {
-                in_mic[i] = -32768;
-            } else
-            {
-                in_mic[i] = (WebRtc_Word16)sample;
-            }
-
+            WebRtcAgc_ApplyGainW16(in_mic[ch], samples, gain, 12);
             // For higher band
             if (stt->fs == 32000)
             {
-                tmp32 = WEBRTC_SPL_MUL_16_U16(in_mic_H[i], gain);
-                sample = WEBRTC_SPL_RSHIFT_W32(tmp32, 12);
-                if (sample > 32767)
-                {
-                    in_mic_H[i] = 32767;
-                } else if (sample < -32768)
-                {
-                    in_mic_H[i] = -32768;
-                } else
-                {
-                    in_mic_H[i] = (WebRtc_Word16)sample;
-                }
+                WebRtcAgc_ApplyGainW16(in_mic_H[ch], samples, gain, 12);
             }
         }
     } else
@@ -270,17 +473,22 @@ int WebRtcAgc_AddMic(void *state, WebRtc_Word16 *in_mic, WebRtc_Word16 *in_mic_H
 
     for (i = 0; i < M; i++)
     {
-        /* iterate over samples */
-        max_nrg = 0;
-        for (n = 0; n < L; n++)
+        /* iterate over samples, taking the maximum over the channels */
+        ptr[i] = WebRtcAgc_MaxSquareW16(&in_mic[0][i * L], L);
+        for (ch = 1; ch < num_channels; ch++)
         {
-            nrg = WEBRTC_SPL_MUL_16_16(in_mic[i * L + n], in_mic[i * L + n]);
-            if (nrg > max_nrg)
-            {
-                max_nrg = nrg;
-            }
+            tmp32 = WebRtcAgc_MaxSquareW16(&in_mic[ch][i * L], L);
+            ptr[i] = WEBRTC_SPL_MAX(ptr[i], tmp32);
         }
-        ptr[i] = max_nrg;
+    }
+
+    /* the energy and VAD are computed on the mix of the channels */
+    mic = in_mic[0];
+    if (num_channels > 1)
+    {
+        WebRtcAgc_MixChannels((const WebRtc_Word16 *const *)in_mic, num_channels, samples,
+                              mix);
+        mic = mix;
     }
 
     /* compute energy */
@@ -296,10 +504,10 @@ int WebRtcAgc_AddMic(void *state, WebRtc_Word16 *in_mic, WebRtc_Word16 *in_mic_H
     {
         if (stt->fs == 16000)
         {
-            WebRtcSpl_DownsampleBy2(&in_mic[i * 32], 32, tmp_speech, stt->filterState);
+            WebRtcSpl_DownsampleBy2(&mic[i * 32], 32, tmp_speech, stt->filterState);
         } else
         {
-            memcpy(tmp_speech, &in_mic[i * 16], 16 * sizeof(short));
+            memcpy(tmp_speech, &mic[i * 16], 16 * sizeof(short));
         }
         /* Compute energy in blocks of 16 samples */
         ptr[i] = WebRtcSpl_DotProductWithScale(tmp_speech, tmp_speech, 16, 4);
@@ -317,7 +525,7 @@ int WebRtcAgc_AddMic(void *state, WebRtc_Word16 *in_mic, WebRtc_Word16 *in_mic_H
     /* call VAD (use low band only) */
     for (i = 0; i < samples; i += subFrames)
     {
-        WebRtcAgc_ProcessVad(&stt->vadMic, &in_mic[i], subFrames);
+        WebRtcAgc_ProcessVad(&stt->vadMic, &mic[i], subFrames);
     }
 
     return 0;
@@ -392,10 +600,21 @@ int WebRtcAgc_AddFarend(void *state, const WebRtc_Word16 *in_far, WebRtc_Word16
 int WebRtcAgc_VirtualMic(void *agcInst, WebRtc_Word16 *in_near, WebRtc_Word16 *in_near_H,
                          WebRtc_Word16 samples, WebRtc_Word32 micLevelIn,
                          WebRtc_Word32 *micLevelOut)
+{
+    return WebRtcAgc_VirtualMicLinked(agcInst, &in_near, &in_near_H, 1, samples, micLevelIn,
+                                      micLevelOut);
+}
+
+int WebRtcAgc_VirtualMicLinked(void *agcInst, WebRtc_Word16 *const *in_near,
+                               WebRtc_Word16 *const *in_near_H, WebRtc_Word16 num_channels,
+                               WebRtc_Word16 samples, WebRtc_Word32 micLevelIn,
+                               WebRtc_Word32 *micLevelOut)
 {
     WebRtc_Word32 tmpFlt, micLevelTmp, gainIdx;
     WebRtc_UWord16 gain;
-    WebRtc_Word16 ii;
+    WebRtc_Word16 ii, ch, saturated;
+    WebRtc_Word16 mix[320];
+    const WebRtc_Word16 *mic;
     Agc_t *stt;
 
     WebRtc_UWord32 nrg;
@@ -403,11 +622,26 @@ int WebRtcAgc_VirtualMic(void *agcInst, WebRtc_Word16 *in_near, WebRtc_Word16 *i
     WebRtc_UWord32 frameNrg = 0;
     WebRtc_UWord32 frameNrgLimit = 5500;
     WebRtc_Word16 numZeroCrossing = 0;
+    WebRtc_Word16 minSample, maxSample, chMin, chMax;
     const WebRtc_Word16 kZeroCrossingLowLim = 15;
     const WebRtc_Word16 kZeroCrossingHighLim = 20;
 
     stt = (Agc_t *)agcInst;
 
+    if ((num_channels < 1) || (num_channels > AGC_MAX_CHANNELS))
+    {
+        return -1;
+    }
+
+    /* The level decisions are made on the mix of the channels */
+    mic = in_near[0];
+    if (num_channels > 1)
+    {
+        WebRtcAgc_MixChannels((const WebRtc_Word16 *const *)in_near, num_channels, samples,
+                              mix);
+        mic = mix;
+    }
+
     /*
      *  Before applying gain decide if this is a low-level signal.
      *  The idea is that digital AGC will not adapt to low-level
@@ -418,20 +652,24 @@ int WebRtcAgc_VirtualMic(void *agcInst, WebRtc_Word16 *in_near, WebRtc_Word16 *i
         frameNrgLimit = frameNrgLimit << 1;
     }
 
-    frameNrg = WEBRTC_SPL_MUL_16_16(in_near[0], in_near[0]);
-    for (sampleCntr = 1; sampleCntr < samples; sampleCntr++)
+    // increment frame energy until it reaches the limit
+    // the correct value of the energy is not important
+    frameNrg = WEBRTC_SPL_MUL_16_16(mic[0], mic[0]);
+    for (sampleCntr = 1; (sampleCntr < samples) && (frameNrg < frameNrgLimit); sampleCntr++)
     {
+        nrg = WEBRTC_SPL_MUL_16_16(mic[sampleCntr], mic[sampleCntr]);
+        frameNrg += nrg;
+    }
 
-        // increment frame energy if it is less than the limit
-        // the correct value of the energy is not important
-        if (frameNrg < frameNrgLimit)
-        {
-            nrg = WEBRTC_SPL_MUL_16_16(in_near[sampleCntr], in_near[sampleCntr]);
-            frameNrg += nrg;
-        }
-
-        // Count the zero crossings
-        numZeroCrossing += ((in_near[sampleCntr] ^ in_near[sampleCntr - 1]) < 0);
+    // Count the zero crossings, and get the range used below to check for
+    // saturation. The range of the mix is within that of the channels.
+    numZeroCrossing = WebRtcAgc_ZeroCrossingsAndRange(mic, samples,
+                                                      &minSample, &maxSample);
+    for (ch = 0; (num_channels > 1) && (ch < num_channels); ch++)
+    {
+        WebRtcAgc_ZeroCrossingsAndRange(in_near[ch], samples, &chMin, &chMax);
+        minSample = WEBRTC_SPL_MIN(minSample, chMin);
+        maxSample = WEBRTC_SPL_MAX(maxSample, chMax);
     }
 
     if ((frameNrg < 500) || (numZeroCrossing <= 5))
@@ -476,47 +714,64 @@ int WebRtcAgc_VirtualMic(void *agcInst, WebRtc_Word16 *in_near, WebRtc_Word16 *i
     {
         gain = kSuppressionTableVirtualMic[127 - gainIdx];
     }
-    for (ii = 0; ii < samples; ii++)
+    if ((WEBRTC_SPL_RSHIFT_W32(WEBRTC_SPL_MUL_16_U16(maxSample, gain), 10) <= 32767) &&
+        (WEBRTC_SPL_RSHIFT_W32(WEBRTC_SPL_MUL_16_U16(minSample, gain), 10) >= -32768))
     {
-        tmpFlt = WEBRTC_SPL_RSHIFT_W32(WEBRTC_SPL_MUL_16_U16(in_near[ii], gain), 10);
-        if (tmpFlt > 32767)
+        // No sample saturates, so the gain is constant over the frame.
+        for (ch = 0; ch < num_channels; ch++)
         {
-            tmpFlt = 32767;
-            gainIdx--;
-            if (gainIdx >= 127)
-            {
-                gain = kGainTableVirtualMic[gainIdx - 127];
-            } else
+            WebRtcAgc_ApplyGainW16(in_near[ch], samples, gain, 10);
+            if (stt->fs == 32000)
             {
-                gain = kSuppressionTableVirtualMic[127 - gainIdx];
+                WebRtcAgc_ApplyGainW16(in_near_H[ch], samples, gain, 10);
             }
         }
-        if (tmpFlt < -32768)
+    } else
+    {
+        for (ii = 0; ii < samples; ii++)
         {
-            tmpFlt = -32768;
-            gainIdx--;
-            if (gainIdx >= 127)
-            {
-                gain = kGainTableVirtualMic[gainIdx - 127];
-            } else
+            /* Step the gain down once if any of the channels saturates */
+            saturated = 0;
+            for (ch = 0; ch < num_channels; ch++)
             {
-                gain = kSuppressionTableVirtualMic[127 - gainIdx];
+                tmpFlt = WEBRTC_SPL_RSHIFT_W32(WEBRTC_SPL_MUL_16_U16(in_near[ch][ii], gain), 10);
+                if (tmpFlt > 32767)
+                {
+                    tmpFlt = 32767;
+                    saturated = 1;
+                }
+                if (tmpFlt < -32768)
+                {
+                    tmpFlt = -32768;
+                    saturated = 1;
+                }
+                in_near[ch][ii] = (WebRtc_Word16)tmpFlt;
             }
-        }
-        in_near[ii] = (WebRtc_Word16)tmpFlt;
-        if (stt->fs == 32000)
-        {
-            tmpFlt = WEBRTC_SPL_MUL_16_U16(in_near_H[ii], gain);
-            tmpFlt = WEBRTC_SPL_RSHIFT_W32(tmpFlt, 10);
-            if (tmpFlt > 32767)
+            if (saturated)
             {
-                tmpFlt = 32767;
+                gainIdx--;
+                if (gainIdx >= 127)
+                {
+                    gain = kGainTableVirtualMic[gainIdx - 127];
+                } else
+                {
+                    gain = kSuppressionTableVirtualMic[127 - gainIdx];
+                }
             }
-            if (tmpFlt < -32768)
+            for (ch = 0; (stt->fs == 32000) && (ch < num_channels); ch++)
             {
-                tmpFlt = -32768;
+                tmpFlt = WEBRTC_SPL_MUL_16_U16(in_near_H[ch][ii], gain);
+                tmpFlt = WEBRTC_SPL_RSHIFT_W32(tmpFlt, 10);
+                if (tmpFlt > 32767)
+                {
+                    tmpFlt = 32767;
+                }
+                if (tmpFlt < -32768)
+                {
+                    tmpFlt = -32768;
+                }
+                in_near_H[ch][ii] = (WebRtc_Word16)tmpFlt;
             }
-            in_near_H[ii] = (WebRtc_Word16)tmpFlt;
         }
     }
     /* Set the level we (finally) used */
@@ -524,7 +779,7 @@ int WebRtcAgc_VirtualMic(void *agcInst, WebRtc_Word16 *in_near, WebRtc_Word16 *i
 //    *micLevelOut = stt->micGainIdx;
     *micLevelOut = WEBRTC_SPL_RSHIFT_W32(stt->micGainIdx, stt->scale);
     /* Add to Mic as if it was the output from a true microphone */
-    if (WebRtcAgc_AddMic(agcInst, in_near, in_near_H, samples) != 0)
+    if (WebRtcAgc_AddMicLinked(agcInst, in_near, in_near_H, num_channels, samples) != 0)
     {
         return -1;
     }
@@ -1242,10 +1497,23 @@ int WebRtcAgc_Process(void *agcInst, const WebRtc_Word16 *in_near,
                       WebRtc_Word16 *out, WebRtc_Word16 *out_H, WebRtc_Word32 inMicLevel,
                       WebRtc_Word32 *outMicLevel, WebRtc_Word16 echo,
                       WebRtc_UWord8 *saturationWarning)
+{
+    return WebRtcAgc_ProcessLinked(agcInst, &in_near, &in_near_H, 1, samples, &out, &out_H,
+                                   inMicLevel, outMicLevel, echo, saturationWarning);
+}
+
+int WebRtcAgc_ProcessLinked(void *agcInst, const WebRtc_Word16 *const *in_near,
+                            const WebRtc_Word16 *const *in_near_H,
+                            WebRtc_Word16 num_channels, WebRtc_Word16 samples,
+                            WebRtc_Word16 *const *out, WebRtc_Word16 *const *out_H,
+                            WebRtc_Word32 inMicLevel, WebRtc_Word32 *outMicLevel,
+                            WebRtc_Word16 echo, WebRtc_UWord8 *saturationWarning)
 {
     Agc_t *stt;
     WebRtc_Word32 inMicLevelTmp;
-    WebRtc_Word16 subFrames, i;
+    WebRtc_Word16 *out_sub[AGC_MAX_CHANNELS];
+    WebRtc_Word16 *out_H_sub[AGC_MAX_CHANNELS];
+    WebRtc_Word16 subFrames, i, ch;
     WebRtc_UWord8 satWarningTmp = 0;
 
     stt = (Agc_t *)agcInst;
@@ -1300,26 +1568,47 @@ int WebRtcAgc_Process(void *agcInst, const WebRtc_Word16 *in_near,
         return -1;
     }
 
+    if ((num_channels < 1) || (num_channels > AGC_MAX_CHANNELS))
+    {
+        return -1;
+    }
     /* Check for valid pointers based on sampling rate */
-    if (stt->fs == 32000 && in_near_H == NULL)
+    if (stt->fs == 32000 && (in_near_H == NULL || out_H == NULL))
     {
         return -1;
     }
     /* Check for valid pointers for low band */
-    if (in_near == NULL)
+    if (in_near == NULL || out == NULL)
     {
         return -1;
     }
+    for (ch = 0; ch < num_channels; ch++)
+    {
+        if (stt->fs == 32000 && (in_near_H[ch] == NULL || out_H[ch] == NULL))
+        {
+            return -1;
+        }
+        if (in_near[ch] == NULL || out[ch] == NULL)
+        {
+            return -1;
+        }
+    }
 
     *saturationWarning = 0;
     //TODO: PUT IN RANGE CHECKING FOR INPUT LEVELS
     *outMicLevel = inMicLevel;
     inMicLevelTmp = inMicLevel;
 
-    memcpy(out, in_near, samples * sizeof(WebRtc_Word16));
-    if (stt->fs == 32000)
+    for (ch = 0; ch < num_channels; ch++)
     {
-        memcpy(out_H, in_near_H, samples * sizeof(WebRtc_Word16));
+        if (out[ch] != in_near[ch])
+        {
+            memcpy(out[ch], in_near[ch], samples * sizeof(WebRtc_Word16));
+        }
+        if (stt->fs == 32000 && out_H[ch] != in_near_H[ch])
+        {
+            memcpy(out_H[ch], in_near_H[ch], samples * sizeof(WebRtc_Word16));
+        }
     }
 
 #ifdef AGC_DEBUG//test log
@@ -1328,15 +1617,31 @@ int WebRtcAgc_Process(void *agcInst, const WebRtc_Word16 *in_near,
 
     for (i = 0; i < samples; i += subFrames)
     {
-        if (WebRtcAgc_ProcessDigital(&stt->digitalAgc, &in_near[i], &in_near_H[i], &out[i], &out_H[i],
-                           stt->fs, stt->lowLevelSignal) == -1)
+        /* One gain is computed for, and applied to, all the channels */
+        for (ch = 0; ch < num_channels; ch++)
+        {
+            out_sub[ch] = &out[ch][i];
+            out_H_sub[ch] = (stt->fs == 32000) ? &out_H[ch][i] : NULL;
+        }
+        if (!stt->active)
+        {
+            /* Inactive near end: hold the digital gain and leave the analog
+             * level and envelopes as they are. */
+            if (WebRtcAgc_ApplyDigitalGain(&stt->digitalAgc, out_sub, out_H_sub,
+                                           num_channels, stt->fs) == -1)
+            {
+                return -1;
+            }
+        } else if (WebRtcAgc_ProcessDigital(&stt->digitalAgc, out_sub, out_H_sub,
+                                            num_channels, stt->fs,
+                                            stt->lowLevelSignal) == -1)
         {
 #ifdef AGC_DEBUG//test log
             fprintf(stt->fpt, "AGC->Process, frame %d: Error from DigAGC\n\n", stt->fcount);
 #endif
             return -1;
         }
-        if ((stt->agcMode < kAgcModeFixedDigital) && ((stt->lowLevelSignal == 0)
+        if (stt->active && (stt->agcMode < kAgcModeFixedDigital) && ((stt->lowLevelSignal == 0)
                 || (stt->agcMode != kAgcModeAdaptiveDigital)))
         {
             if (WebRtcAgc_ProcessAnalog(agcInst, inMicLevelTmp, outMicLevel,
@@ -1435,6 +1740,27 @@ int WebRtcAgc_set_config(void *agcInst, WebRtcAgc_config_t agcConfig)
     return 0;
 }
 
+int WebRtcAgc_set_activity(void *agcInst, WebRtc_Word16 active)
+{
+    Agc_t *stt;
+    stt = (Agc_t *)agcInst;
+
+    if (stt == NULL)
+    {
+        return -1;
+    }
+
+    if (stt->initFlag != kInitCheck)
+    {
+        stt->lastError = AGC_UNINITIALIZED_ERROR;
+        return -1;
+    }
+
+    stt->active = (active != 0);
+
+    return 0;
+}
+
 int WebRtcAgc_get_config(void *agcInst, WebRtcAgc_config_t *config)
 {
     Agc_t *stt;
@@ -1506,6 +1832,16 @@ int WebRtcAgc_Free(void *state)
     return 0;
 }
 
+size_t WebRtcAgc_memory_usage_bytes(void *agcInst)
+{
+    if (agcInst == NULL)
+    {
+        return 0;
+    }
+
+    return sizeof(Agc_t);
+}
+
 /* minLevel     - Minimum volume level
  * maxLevel     - Maximum volume level
  */
@@ -1662,6 +1998,7 @@ int WebRtcAgc_Init(void *agcInst, WebRtc_Word32 minLevel, WebRtc_Word32 maxLevel
     stt->Rxx160_LPw32 = stt->analogTargetLevel; // Initialize rms value
 
     stt->lowLevelSignal = 0;
+    stt->active = 1;
 
     /* Only positive values are allowed that are not too large */
     if ((minLevel >= maxLevel) || (maxLevel & 0xFC000000))
@@ -128,6 +128,7 @@ typedef struct
 #endif
 
     WebRtc_Word16       lowLevelSignal;
+    WebRtc_Word16       active; // 0: near end inactive, gains and envelopes held
 } Agc_t;
 
 #endif // WEBRTC_MODULES_AUDIO_PROCESSING_AGC_MAIN_SOURCE_ANALOG_AGC_H_
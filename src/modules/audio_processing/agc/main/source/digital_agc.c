@@ -288,52 +288,50 @@ WebRtc_Word32 WebRtcAgc_AddFarendToDigital(DigitalAgc_t *stt, const WebRtc_Word1
     return 0;
 }
 
-WebRtc_Word32 WebRtcAgc_ProcessDigital(DigitalAgc_t *stt, const WebRtc_Word16 *in_near,
-                                       const WebRtc_Word16 *in_near_H, WebRtc_Word16 *out,
-                                       WebRtc_Word16 *out_H, WebRtc_UWord32 FS,
-                                       WebRtc_Word16 lowlevelSignal)
+// Raises |env| to the maximum squared sample of each ms of |in|.
+static void WebRtcAgc_MaxEnvelope(const WebRtc_Word16 *in, WebRtc_Word16 L,
+                                  WebRtc_Word32 *env)
 {
-    // array for gains (one value per ms, incl start & end)
-    WebRtc_Word32 gains[11];
-
-    WebRtc_Word32 out_tmp, tmp32;
-    WebRtc_Word32 env[10];
     WebRtc_Word32 nrg, max_nrg;
+    WebRtc_Word16 k, n;
+
+    // iterate over sub frames
+    for (k = 0; k < 10; k++)
+    {
+        // iterate over samples
+        max_nrg = env[k];
+        for (n = 0; n < L; n++)
+        {
+            nrg = WEBRTC_SPL_MUL_16_16(in[k * L + n], in[k * L + n]);
+            if (nrg > max_nrg)
+            {
+                max_nrg = nrg;
+            }
+        }
+        env[k] = max_nrg;
+    }
+}
+
+// Updates the envelope followers of |stt| with the per ms envelope |env|, and
+// returns the gains (one value per ms, incl start & end) in |gains|. The VAD
+// is run on |in_near|.
+static void WebRtcAgc_ComputeDigitalGains(DigitalAgc_t *stt, const WebRtc_Word16 *in_near,
+                                          const WebRtc_Word32 *env, WebRtc_Word16 L,
+                                          WebRtc_Word16 lowlevelSignal,
+                                          WebRtc_Word32 *gains)
+{
+    WebRtc_Word32 tmp32;
     WebRtc_Word32 cur_level;
-    WebRtc_Word32 gain32, delta;
+    WebRtc_Word32 gain32;
     WebRtc_Word16 logratio;
     WebRtc_Word16 lower_thr, upper_thr;
     WebRtc_Word16 zeros, zeros_fast, frac;
     WebRtc_Word16 decay;
     WebRtc_Word16 gate, gain_adj;
-    WebRtc_Word16 k, n;
-    WebRtc_Word16 L, L2; // samples/subframe
-
-    // determine number of samples per ms
-    if (FS == 8000)
-    {
-        L = 8;
-        L2 = 3;
-    } else if (FS == 16000)
-    {
-        L = 16;
-        L2 = 4;
-    } else if (FS == 32000)
-    {
-        L = 16;
-        L2 = 4;
-    } else
-    {
-        return -1;
-    }
+    WebRtc_Word16 k;
 
-    memcpy(out, in_near, 10 * L * sizeof(WebRtc_Word16));
-    if (FS == 32000)
-    {
-        memcpy(out_H, in_near_H, 10 * L * sizeof(WebRtc_Word16));
-    }
     // VAD for near end
-    logratio = WebRtcAgc_ProcessVad(&stt->vadNearend, out, L * 10);
+    logratio = WebRtcAgc_ProcessVad(&stt->vadNearend, in_near, L * 10);
 
     // Account for far end VAD
     if (stt->vadFarend.counter > 10)
@@ -386,23 +384,6 @@ WebRtc_Word32 WebRtcAgc_ProcessDigital(DigitalAgc_t *stt, const WebRtc_Word16 *i
     stt->frameCounter++;
     fprintf(stt->logFile, "%5.2f\t%d\t%d\t%d\t", (float)(stt->frameCounter) / 100, logratio, decay, stt->vadNearend.stdLongTerm);
 #endif
-    // Find max amplitude per sub frame
-    // iterate over sub frames
-    for (k = 0; k < 10; k++)
-    {
-        // iterate over samples
-        max_nrg = 0;
-        for (n = 0; n < L; n++)
-        {
-            nrg = WEBRTC_SPL_MUL_16_16(out[k * L + n], out[k * L + n]);
-            if (nrg > max_nrg)
-            {
-                max_nrg = nrg;
-            }
-        }
-        env[k] = max_nrg;
-    }
-
     // Calculate gain per sub frame
     gains[0] = stt->gain;
     for (k = 0; k < 10; k++)
@@ -542,8 +523,18 @@ WebRtc_Word32 WebRtcAgc_ProcessDigital(DigitalAgc_t *stt, const WebRtc_Word16 *i
     }
     // save start gain for next frame
     stt->gain = gains[10];
+}
+
+// Applies |gains| to |out|, and to |out_H| at 32 kHz, interpolating linearly
+// within each ms.
+static void WebRtcAgc_ApplyDigitalGains(const WebRtc_Word32 *gains, WebRtc_Word16 L,
+                                        WebRtc_Word16 L2, WebRtc_Word16 *out,
+                                        WebRtc_Word16 *out_H, WebRtc_UWord32 FS)
+{
+    WebRtc_Word32 out_tmp, tmp32;
+    WebRtc_Word32 gain32, delta;
+    WebRtc_Word16 k, n;
 
-    // Apply gain
     // handle first sub frame separately
     delta = WEBRTC_SPL_LSHIFT_W32(gains[1] - gains[0], (4 - L2));
     gain32 = WEBRTC_SPL_LSHIFT_W32(gains[0], 4);
@@ -609,10 +600,110 @@ WebRtc_Word32 WebRtcAgc_ProcessDigital(DigitalAgc_t *stt, const WebRtc_Word16 *i
             gain32 += delta;
         }
     }
+}
+
+// Returns the number of samples per ms, and its base-2 logarithm in |L2|, or
+// -1 for an unsupported sampling frequency.
+static WebRtc_Word16 WebRtcAgc_SamplesPerMs(WebRtc_UWord32 FS, WebRtc_Word16 *L2)
+{
+    if (FS == 8000)
+    {
+        *L2 = 3;
+        return 8;
+    } else if ((FS == 16000) || (FS == 32000))
+    {
+        *L2 = 4;
+        return 16;
+    }
+    return -1;
+}
+
+WebRtc_Word32 WebRtcAgc_ProcessDigital(DigitalAgc_t *stt, WebRtc_Word16 *const *out,
+                                       WebRtc_Word16 *const *out_H, WebRtc_Word16 num_channels,
+                                       WebRtc_UWord32 FS, WebRtc_Word16 lowlevelSignal)
+{
+    // array for gains (one value per ms, incl start & end)
+    WebRtc_Word32 gains[11];
+    WebRtc_Word32 env[10] = {0};
+    WebRtc_Word16 mix[160];
+    const WebRtc_Word16 *vad_in = out[0];
+    WebRtc_Word16 L, L2; // samples/subframe
+    WebRtc_Word16 ch;
+
+    // determine number of samples per ms
+    L = WebRtcAgc_SamplesPerMs(FS, &L2);
+    if (L < 0)
+    {
+        return -1;
+    }
+
+    // The envelope is the maximum over the channels, so that the limiter
+    // protects each of them, while the VAD runs on their mix.
+    for (ch = 0; ch < num_channels; ch++)
+    {
+        WebRtcAgc_MaxEnvelope(out[ch], L, env);
+    }
+    if (num_channels > 1)
+    {
+        WebRtcAgc_MixChannels((const WebRtc_Word16 *const *)out, num_channels, 10 * L, mix);
+        vad_in = mix;
+    }
+
+    WebRtcAgc_ComputeDigitalGains(stt, vad_in, env, L, lowlevelSignal, gains);
+
+    for (ch = 0; ch < num_channels; ch++)
+    {
+        WebRtcAgc_ApplyDigitalGains(gains, L, L2, out[ch], (FS == 32000) ? out_H[ch] : NULL,
+                                    FS);
+    }
 
     return 0;
 }
 
+WebRtc_Word32 WebRtcAgc_ApplyDigitalGain(DigitalAgc_t *stt, WebRtc_Word16 *const *out,
+                                         WebRtc_Word16 *const *out_H, WebRtc_Word16 num_channels,
+                                         WebRtc_UWord32 FS)
+{
+    WebRtc_Word32 gains[11];
+    WebRtc_Word16 L, L2; // samples/subframe
+    WebRtc_Word16 ch, k;
+
+    L = WebRtcAgc_SamplesPerMs(FS, &L2);
+    if (L < 0)
+    {
+        return -1;
+    }
+
+    for (k = 0; k < 11; k++)
+    {
+        gains[k] = stt->gain;
+    }
+    for (ch = 0; ch < num_channels; ch++)
+    {
+        WebRtcAgc_ApplyDigitalGains(gains, L, L2, out[ch], (FS == 32000) ? out_H[ch] : NULL,
+                                    FS);
+    }
+
+    return 0;
+}
+
+void WebRtcAgc_MixChannels(const WebRtc_Word16 *const *in, WebRtc_Word16 num_channels,
+                           WebRtc_Word16 length, WebRtc_Word16 *mix)
+{
+    WebRtc_Word32 sum;
+    WebRtc_Word16 ch, n;
+
+    for (n = 0; n < length; n++)
+    {
+        sum = 0;
+        for (ch = 0; ch < num_channels; ch++)
+        {
+            sum += in[ch][n];
+        }
+        mix[n] = (WebRtc_Word16)WEBRTC_SPL_DIV(sum, num_channels);
+    }
+}
+
 void WebRtcAgc_InitVad(AgcVad_t *state)
 {
     WebRtc_Word16 k;
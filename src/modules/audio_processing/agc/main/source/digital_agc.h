@@ -54,10 +54,22 @@ typedef struct
 
 WebRtc_Word32 WebRtcAgc_InitDigital(DigitalAgc_t *digitalAgcInst, WebRtc_Word16 agcMode);
 
-WebRtc_Word32 WebRtcAgc_ProcessDigital(DigitalAgc_t *digitalAgcInst, const WebRtc_Word16 *inNear,
-                             const WebRtc_Word16 *inNear_H, WebRtc_Word16 *out,
-                             WebRtc_Word16 *out_H, WebRtc_UWord32 FS,
-                             WebRtc_Word16 lowLevelSignal);
+// Computes one gain for the |num_channels| channels in |out| (and |out_H| at
+// 32 kHz) and applies it to each of them, in place.
+WebRtc_Word32 WebRtcAgc_ProcessDigital(DigitalAgc_t *digitalAgcInst, WebRtc_Word16 *const *out,
+                             WebRtc_Word16 *const *out_H, WebRtc_Word16 num_channels,
+                             WebRtc_UWord32 FS, WebRtc_Word16 lowLevelSignal);
+
+// Applies the gain of the last WebRtcAgc_ProcessDigital() call to the
+// |num_channels| channels in |out| (and |out_H| at 32 kHz), in place, without
+// updating the envelopes, VADs or gain.
+WebRtc_Word32 WebRtcAgc_ApplyDigitalGain(DigitalAgc_t *digitalAgcInst, WebRtc_Word16 *const *out,
+                             WebRtc_Word16 *const *out_H, WebRtc_Word16 num_channels,
+                             WebRtc_UWord32 FS);
+
+// Averages the |num_channels| vectors of |length| samples in |in| into |mix|.
+void WebRtcAgc_MixChannels(const WebRtc_Word16 *const *in, WebRtc_Word16 num_channels,
+                           WebRtc_Word16 length, WebRtc_Word16 *mix);
 
 WebRtc_Word32 WebRtcAgc_AddFarendToDigital(DigitalAgc_t *digitalAgcInst, const WebRtc_Word16 *inFar,
                                  WebRtc_Word16 nrSamples);
@@ -16,6 +16,10 @@
       'type': 'executable',
       'dependencies': [
         'source/apm.gyp:audio_processing',
+        '../aec/main/source/aec.gyp:aec',
+        '../aecm/main/source/aecm.gyp:aecm',
+        '../agc/main/source/agc.gyp:agc',
+        '../ns/main/source/ns.gyp:ns_fix',
         '../../../system_wrappers/source/system_wrappers.gyp:system_wrappers',
         '../../../common_audio/signal_processing_library/main/source/spl.gyp:spl',
 
@@ -49,6 +53,23 @@
         'test/process_test/process_test.cc',
       ],
     },
+    {
+      'target_name': 'load_test',
+      'type': 'executable',
+      'dependencies': [
+        'source/apm.gyp:audio_processing',
+        '../../../system_wrappers/source/system_wrappers.gyp:system_wrappers',
+
+        '../../../../testing/gtest.gyp:gtest',
+        '../../../../testing/gtest.gyp:gtest_main',
+      ],
+      'include_dirs': [
+        '../../../../testing/gtest/include',
+      ],
+      'sources': [
+        'test/load_test/load_test.cc',
+      ],
+    },
 
   ],
 }
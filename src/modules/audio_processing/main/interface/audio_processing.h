@@ -11,12 +11,15 @@
 #ifndef WEBRTC_MODULES_AUDIO_PROCESSING_MAIN_INTERFACE_AUDIO_PROCESSING_H_
 #define WEBRTC_MODULES_AUDIO_PROCESSING_MAIN_INTERFACE_AUDIO_PROCESSING_H_
 
+#include <stddef.h>  // size_t
+
 #include "typedefs.h"
 #include "module.h"
 
 namespace webrtc {
 
 class AudioFrame;
+class AudioFrameView;
 class EchoCancellation;
 class EchoControlMobile;
 class GainControl;
@@ -123,6 +126,12 @@ class AudioProcessing : public Module {
 
   // Sets the sample |rate| in Hz for both the primary and reverse audio
   // streams. 8000, 16000 or 32000 Hz are permitted.
+  //
+  // This and the channel setters below may be called during a stream, e.g. on
+  // a device switch. Unlike Initialize(), they keep the adapted state of the
+  // components where it remains valid: always for channels kept across the
+  // change, and across 16000 <-> 32000 Hz for the echo canceller and the noise
+  // suppressor.
   virtual int set_sample_rate_hz(int rate) = 0;
   virtual int sample_rate_hz() const = 0;
 
@@ -150,6 +159,25 @@ class AudioProcessing : public Module {
   // to APM.
   virtual int ProcessStream(AudioFrame* frame) = 0;
 
+  // As above, but on audio held by the caller, which avoids copying it into
+  // an AudioFrame. The members of |frame| are checked as above. The processed
+  // audio is written back interleaved with num_output_channels() channels.
+  virtual int ProcessStream(const AudioFrameView& frame) = 0;
+
+  // As above, but for callers whose audio is already in float. |data| holds
+  // one pointer per input channel to |samples_per_channel| non-interleaved
+  // samples, on the 16-bit scale (i.e. [-32768, 32767]). The sample rate and
+  // number of channels are the ones supplied to APM. The processed audio is
+  // written back to the first num_output_channels() channels of |data|.
+  //
+  // The input is limited to the 16-bit range, with NaN taken as zero, and so
+  // is the output, whichever components are enabled. The echo canceller and
+  // the floating-point noise suppressor work on the float audio directly, at
+  // 8 and 16 kHz. The other components, and the band split at 32 kHz, work at
+  // 16-bit precision, and the audio is rounded to 16 bits before the first of
+  // them.
+  virtual int ProcessStream(float* const* data, int samples_per_channel) = 0;
+
   // Analyzes a 10 ms |frame| of the reverse direction audio stream. The frame
   // will not be modified. On the client-side, this is the far-end (or to be
   // rendered) audio.
@@ -166,6 +194,14 @@ class AudioProcessing : public Module {
   // TODO(ajm): add const to input; requires an implementation fix.
   virtual int AnalyzeReverseStream(AudioFrame* frame) = 0;
 
+  // As above, but on audio held by the caller. The samples are not modified.
+  virtual int AnalyzeReverseStream(const AudioFrameView& frame) = 0;
+
+  // As above, but on non-interleaved float audio in the format described for
+  // the float ProcessStream(). |data| is not modified.
+  virtual int AnalyzeReverseStream(const float* const* data,
+                                   int samples_per_channel) = 0;
+
   // This must be called if and only if echo processing is enabled.
   //
   // Sets the |delay| in ms between AnalyzeReverseStream() receiving a far-end
@@ -193,6 +229,46 @@ class AudioProcessing : public Module {
   // cannot be resumed in the same file (without overwriting it).
   virtual int StopDebugRecording() = 0;
 
+  // Heap memory held by the instance, in bytes, broken down by owner. A
+  // component's figure covers its core instances only; it is zero for a
+  // component which has never been enabled.
+  struct MemoryUsage {
+    int audio_buffers;
+    int echo_cancellation;
+    int echo_control_mobile;
+    int gain_control;
+    int high_pass_filter;
+    int level_estimator;
+    int noise_suppression;
+    int voice_detection;
+    int total;  // Including the above and the APM objects themselves.
+  };
+  virtual int GetMemoryUsage(MemoryUsage* usage) const = 0;
+
+  // By default, the core instances of a disabled component, or of channels
+  // no longer in use, are kept so that re-enabling is cheap. When compact
+  // memory is enabled they are freed as soon as they become unused, and any
+  // which are unused at the time of the call are freed immediately. From the
+  // next |Initialize()|, buffers are also sized for the current sample rate,
+  // channel count and |EchoCancellation::max_delay_ms()| rather than for the
+  // worst case. Intended for memory constrained devices; disabled by default.
+  virtual int enable_compact_memory(bool enable) = 0;
+  virtual bool is_compact_memory_enabled() const = 0;
+
+  // When activity gating is enabled, the peak level of each capture frame
+  // decides whether the near end is active. After 200 ms below about
+  // -72 dBFS it is taken to be inactive: the noise suppression then reuses
+  // its latest gains and the gain control its latest digital gain, and both
+  // leave their models, envelopes and analog level untouched. The first
+  // louder frame makes the near end active again, with nothing to relearn.
+  // The AEC is not affected; it stops adapting by itself while the far end
+  // is digitally silent. Disabled by default.
+  virtual int enable_activity_gating(bool enable) = 0;
+  virtual bool is_activity_gating_enabled() const = 0;
+  // Whether the near end was taken to be active in the last capture frame.
+  // Always true while activity gating is disabled.
+  virtual bool stream_is_active() const = 0;
+
   // These provide access to the component interfaces and should never return
   // NULL. The pointers will be valid for the lifetime of the APM instance.
   // The memory for these objects is entirely managed internally.
@@ -235,7 +311,10 @@ class AudioProcessing : public Module {
     kBadStreamParameterWarning = -13,
   };
 
-  // Inherited from Module.
+  // Inherited from Module. |Process()| runs the work which does not have to
+  // be done on the audio thread, currently the aggregation of the echo
+  // metrics. It may be called from a separate thread, e.g. a process thread
+  // the APM is registered with, concurrently with |ProcessStream()|.
   virtual WebRtc_Word32 TimeUntilNextProcess() { return -1; };
   virtual WebRtc_Word32 Process() { return -1; };
 
@@ -288,12 +367,29 @@ class EchoCancellation {
   virtual int set_suppression_level(SuppressionLevel level) = 0;
   virtual SuppressionLevel suppression_level() const = 0;
 
+  // Lets the AEC turn dormant after one second of digitally silent reverse
+  // stream, passing the capture stream through at a fraction of the cost
+  // until the reverse stream resumes. Nothing is suppressed while dormant,
+  // and the comfort noise is held from the last processed frame. Disabled by
+  // default.
+  virtual int enable_dormant_mode(bool enable) = 0;
+  virtual bool is_dormant_mode_enabled() const = 0;
+
+  // The largest delay, in ms, which will be given to |set_stream_delay_ms()|;
+  // 500 by default, which is also the upper limit. With compact memory
+  // enabled, the AEC sizes its render buffer for it when it is initialized,
+  // and larger stream delays are limited to it.
+  virtual int set_max_delay_ms(int delay) = 0;
+  virtual int max_delay_ms() const = 0;
+
   // Returns false if the current frame almost certainly contains no echo
   // and true if it _might_ contain echo.
   virtual bool stream_has_echo() const = 0;
 
   // Enables the computation of various echo metrics. These are obtained
-  // through |GetMetrics()|.
+  // through |GetMetrics()|. The audio thread only records the signal energies;
+  // they are aggregated by |AudioProcessing::Process()|, or failing that, by
+  // |GetMetrics()| and every couple of seconds in |ProcessStream()|.
   virtual int enable_metrics(bool enable) = 0;
   virtual bool are_metrics_enabled() const = 0;
 
@@ -320,6 +416,24 @@ class EchoCancellation {
   // TODO(ajm): discuss the metrics update period.
   virtual int GetMetrics(Metrics* metrics) = 0;
 
+  // The echo delay the AEC finds in its adaptive filter, on top of the delay
+  // it has aligned the render stream by from |set_stream_delay_ms()|. The
+  // estimates are collected since the last |Initialize()| as part of the
+  // processing, so they are always available. All values are in ms.
+  //
+  // A median persistently above zero means the reported delay is too low; a
+  // narrow spread leaves room to shrink the device buffers.
+  enum { kDelayHistogramSize = 12 };
+  struct DelayMetrics {
+    int median_ms;          // -1 without an estimate.
+    int std_ms;             // -1 without an estimate.
+    int aligned_delay_ms;
+    int histogram_bin_ms;   // Delay covered by one histogram bin.
+    int histogram[kDelayHistogramSize];  // Number of estimates in each bin.
+  };
+
+  virtual int GetDelayMetrics(DelayMetrics* metrics) = 0;
+
  protected:
   virtual ~EchoCancellation() {};
 };
@@ -356,6 +470,23 @@ class EchoControlMobile {
   virtual int enable_comfort_noise(bool enable) = 0;
   virtual bool is_comfort_noise_enabled() const = 0;
 
+  // The echo path learned by AECM is specific to the device and audio route.
+  // Storing it at the end of a call with |GetEchoPath()| and restoring it
+  // with |SetEchoPath()| at the start of the next lets AECM skip learning it
+  // from scratch. Both take a buffer of |echo_path_size_bytes()| bytes.
+  //
+  // A set echo path is applied to every channel immediately, and again on
+  // each initialization until another path is set. It may be set before the
+  // component is enabled.
+  virtual int SetEchoPath(const void* echo_path, size_t size_bytes) = 0;
+  // Gets the echo path currently used by the first channel. The component
+  // must be enabled.
+  virtual int GetEchoPath(void* echo_path, size_t size_bytes) const = 0;
+
+  // The returned path size is guaranteed not to change for the lifetime of
+  // the application.
+  static size_t echo_path_size_bytes();
+
  protected:
   virtual ~EchoControlMobile() {};
 };
@@ -433,6 +564,12 @@ class GainControl {
   virtual int enable_limiter(bool enable) = 0;
   virtual bool is_limiter_enabled() const = 0;
 
+  // When enabled, the capture channels are linked: a single gain is computed
+  // from all of them and applied to each. This preserves the stereo image, and
+  // costs about as much as processing one channel. Disabled by default.
+  virtual int enable_channel_linking(bool enable) = 0;
+  virtual bool is_channel_linking_enabled() const = 0;
+
   // Sets the |minimum| and |maximum| analog levels of the audio capture device.
   // Must be set if and only if an analog mode is used. Limited to [0, 65535].
   virtual int set_analog_level_limits(int minimum,
@@ -510,6 +647,31 @@ class NoiseSuppression {
   virtual int set_level(Level level) = 0;
   virtual Level level() const = 0;
 
+  // Runs the suppression on the output spectrum of the echo canceller rather
+  // than on its time-domain output, while both are enabled. This saves the
+  // suppressor's own analysis and synthesis, and its added delay. The noise
+  // estimate then runs on the blocks of the echo canceller. Only supported by
+  // the floating-point suppressor. Disabled by default.
+  //
+  // This changes the output, not only the cost:
+  // - The noise and speech models use the 65 frequency bins of the echo
+  //   canceller at every sample rate. The separate suppressor uses 129 bins
+  //   at 16 and 32 kHz.
+  // - No noise is suppressed during the start-up phase of the echo
+  //   canceller, in which it passes the capture signal through to size its
+  //   buffers. This phase lasts at most 0.5 s.
+  virtual int enable_echo_cancellation_fusion(bool enable) = 0;
+  virtual bool is_echo_cancellation_fusion_enabled() const = 0;
+
+  // Halves the analysis window and hop of the suppressor, reducing its
+  // algorithmic delay from 6 to 3 ms and its complexity. The coarser frequency
+  // resolution may resolve tonal noise less well. Has no effect while fused
+  // with the echo canceller. The fixed-point suppressor has no low-delay mode
+  // at 8 kHz, and updates its models every 5 ms instead of every 10 ms.
+  // Disabled by default.
+  virtual int enable_low_delay(bool enable) = 0;
+  virtual bool is_low_delay_enabled() const = 0;
+
  protected:
   virtual ~NoiseSuppression() {};
 };
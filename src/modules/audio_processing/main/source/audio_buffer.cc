@@ -35,14 +35,35 @@ void StereoToMono(const WebRtc_Word16* left, const WebRtc_Word16* right,
     out[i] = static_cast<WebRtc_Word16>(data_int32);
   }
 }
+
+// NaN compares false with everything, and converting it is undefined; it is
+// mapped to zero.
+WebRtc_Word16 FloatToS16(float v) {
+  if (v != v) {
+    return 0;
+  } else if (v >= 32767.f) {
+    return 32767;
+  } else if (v <= -32768.f) {
+    return -32768;
+  }
+
+  return static_cast<WebRtc_Word16>(v + (v > 0 ? 0.5f : -0.5f));
+}
 }  // namespace
 
+// Sized for the actual frame length rather than the 32 kHz maximum.
 struct AudioChannel {
-  AudioChannel() {
-    memset(data, 0, sizeof(data));
+  AudioChannel() : data(NULL) {}
+  ~AudioChannel() {
+    delete [] data;
+  }
+
+  void Allocate(int samples) {
+    data = new WebRtc_Word16[samples];
+    memset(data, 0, sizeof(WebRtc_Word16) * samples);
   }
 
-  WebRtc_Word16 data[kSamplesPer32kHzChannel];
+  WebRtc_Word16* data;
 };
 
 struct SplitAudioChannel {
@@ -74,20 +95,32 @@ AudioBuffer::AudioBuffer(WebRtc_Word32 max_num_channels,
       samples_per_channel_(samples_per_channel),
       samples_per_split_channel_(samples_per_channel),
       reference_copied_(false),
+      float_current_(false),
       data_(NULL),
+      float_data_(NULL),
       channels_(NULL),
       split_channels_(NULL),
       mixed_low_pass_channels_(NULL),
       low_pass_reference_channels_(NULL) {
+  if (samples_per_channel_ == kSamplesPer32kHzChannel) {
+    split_channels_ = new SplitAudioChannel[max_num_channels_];
+    samples_per_split_channel_ = kSamplesPer16kHzChannel;
+  }
+
+  // Mono frames are normally processed in place, but the float interface
+  // needs somewhere to convert into.
+  channels_ = new AudioChannel[max_num_channels_];
+  low_pass_reference_channels_ = new AudioChannel[max_num_channels_];
   if (max_num_channels_ > 1) {
-    channels_ = new AudioChannel[max_num_channels_];
     mixed_low_pass_channels_ = new AudioChannel[max_num_channels_];
   }
-  low_pass_reference_channels_ = new AudioChannel[max_num_channels_];
 
-  if (samples_per_channel_ == kSamplesPer32kHzChannel) {
-    split_channels_ = new SplitAudioChannel[max_num_channels_];
-    samples_per_split_channel_ = kSamplesPer16kHzChannel;
+  for (int i = 0; i < max_num_channels_; i++) {
+    channels_[i].Allocate(samples_per_channel_);
+    low_pass_reference_channels_[i].Allocate(samples_per_split_channel_);
+    if (mixed_low_pass_channels_ != NULL) {
+      mixed_low_pass_channels_[i].Allocate(samples_per_split_channel_);
+    }
   }
 }
 
@@ -107,10 +140,18 @@ AudioBuffer::~AudioBuffer() {
   if (split_channels_ != NULL) {
     delete [] split_channels_;
   }
+
+  if (float_data_ != NULL) {
+    delete [] float_data_;
+  }
 }
 
 WebRtc_Word16* AudioBuffer::data(WebRtc_Word32 channel) const {
   assert(channel >= 0 && channel < num_channels_);
+  if (float_current_) {
+    ConvertFloatData();
+  }
+
   if (data_ != NULL) {
     return data_;
   }
@@ -151,6 +192,42 @@ WebRtc_Word16* AudioBuffer::low_pass_reference(WebRtc_Word32 channel) const {
   return low_pass_reference_channels_[channel].data;
 }
 
+bool AudioBuffer::float_current() const {
+  return float_current_;
+}
+
+float* AudioBuffer::float_data(WebRtc_Word32 channel) const {
+  assert(channel >= 0 && channel < num_channels_);
+  assert(float_current_);
+  return &float_data_[channel * samples_per_channel_];
+}
+
+void AudioBuffer::ClampToS16Range(const float* in, int length, float* out) {
+  for (int i = 0; i < length; i++) {
+    const float v = in[i];
+    if (v != v) {
+      out[i] = 0.f;
+    } else if (v > 32767.f) {
+      out[i] = 32767.f;
+    } else if (v < -32768.f) {
+      out[i] = -32768.f;
+    } else {
+      out[i] = v;
+    }
+  }
+}
+
+void AudioBuffer::ConvertFloatData() const {
+  for (int i = 0; i < num_channels_; i++) {
+    const float* float_channel = &float_data_[i * samples_per_channel_];
+    WebRtc_Word16* channel = channels_[i].data;
+    for (int j = 0; j < samples_per_channel_; j++) {
+      channel[j] = FloatToS16(float_channel[j]);
+    }
+  }
+  float_current_ = false;
+}
+
 WebRtc_Word32* AudioBuffer::analysis_filter_state1(WebRtc_Word32 channel) const {
   assert(channel >= 0 && channel < num_channels_);
   return split_channels_[channel].analysis_filter_state1;
@@ -171,6 +248,48 @@ WebRtc_Word32* AudioBuffer::synthesis_filter_state2(WebRtc_Word32 channel) const
   return split_channels_[channel].synthesis_filter_state2;
 }
 
+void AudioBuffer::ResetSplitFilterStates() {
+  if (split_channels_ == NULL) {
+    return;
+  }
+
+  for (int i = 0; i < max_num_channels_; i++) {
+    SplitAudioChannel* split = &split_channels_[i];
+    memset(split->analysis_filter_state1, 0,
+           sizeof(split->analysis_filter_state1));
+    memset(split->analysis_filter_state2, 0,
+           sizeof(split->analysis_filter_state2));
+    memset(split->synthesis_filter_state1, 0,
+           sizeof(split->synthesis_filter_state1));
+    memset(split->synthesis_filter_state2, 0,
+           sizeof(split->synthesis_filter_state2));
+  }
+}
+
+int AudioBuffer::memory_usage_bytes() const {
+  int bytes = sizeof(*this);
+  bytes += max_num_channels_ * (sizeof(AudioChannel) +
+      sizeof(WebRtc_Word16) * samples_per_channel_);
+  bytes += max_num_channels_ * (sizeof(AudioChannel) +
+      sizeof(WebRtc_Word16) * samples_per_split_channel_);
+  if (mixed_low_pass_channels_ != NULL) {
+    bytes += max_num_channels_ * (sizeof(AudioChannel) +
+        sizeof(WebRtc_Word16) * samples_per_split_channel_);
+  }
+  if (split_channels_ != NULL) {
+    bytes += max_num_channels_ * sizeof(SplitAudioChannel);
+  }
+  if (float_data_ != NULL) {
+    bytes += max_num_channels_ * sizeof(float) * samples_per_channel_;
+  }
+
+  return bytes;
+}
+
+WebRtc_Word32 AudioBuffer::max_num_channels() const {
+  return max_num_channels_;
+}
+
 WebRtc_Word32 AudioBuffer::num_channels() const {
   return num_channels_;
 }
@@ -184,24 +303,26 @@ WebRtc_Word32 AudioBuffer::samples_per_split_channel() const {
 }
 
 // TODO(ajm): Do deinterleaving and mixing in one step?
-void AudioBuffer::DeinterleaveFrom(AudioFrame* audioFrame) {
-  assert(audioFrame->_audioChannel <= max_num_channels_);
-  assert(audioFrame->_payloadDataLengthInSamples ==  samples_per_channel_);
+void AudioBuffer::DeinterleaveFrom(const AudioFrameView& frame) {
+  assert(frame._audioChannel <= max_num_channels_);
+  assert(frame._payloadDataLengthInSamples ==  samples_per_channel_);
 
-  num_channels_ = audioFrame->_audioChannel;
+  num_channels_ = frame._audioChannel;
   num_mixed_channels_ = 0;
   num_mixed_low_pass_channels_ = 0;
   reference_copied_ = false;
+  float_current_ = false;
 
   if (num_channels_ == 1) {
     // We can get away with a pointer assignment in this case.
-    data_ = audioFrame->_payloadData;
+    data_ = frame._payloadData;
     return;
   }
 
+  data_ = NULL;
   for (int i = 0; i < num_channels_; i++) {
     WebRtc_Word16* deinterleaved = channels_[i].data;
-    WebRtc_Word16* interleaved = audioFrame->_payloadData;
+    WebRtc_Word16* interleaved = frame._payloadData;
     WebRtc_Word32 interleaved_idx = i;
     for (int j = 0; j < samples_per_channel_; j++) {
       deinterleaved[j] = interleaved[interleaved_idx];
@@ -210,18 +331,34 @@ void AudioBuffer::DeinterleaveFrom(AudioFrame* audioFrame) {
   }
 }
 
-void AudioBuffer::InterleaveTo(AudioFrame* audioFrame) const {
-  assert(audioFrame->_audioChannel == num_channels_);
-  assert(audioFrame->_payloadDataLengthInSamples == samples_per_channel_);
+void AudioBuffer::InterleaveTo(const AudioFrameView& frame) const {
+  assert(frame._audioChannel == num_channels_);
+  assert(frame._payloadDataLengthInSamples == samples_per_channel_);
+
+  if (float_current_) {
+    // Converted on the way out, leaving the float data current.
+    for (int i = 0; i < num_channels_; i++) {
+      const float* float_channel = &float_data_[i * samples_per_channel_];
+      WebRtc_Word16* interleaved = frame._payloadData;
+      WebRtc_Word32 interleaved_idx = i;
+      for (int j = 0; j < samples_per_channel_; j++) {
+        interleaved[interleaved_idx] = FloatToS16(float_channel[j]);
+        interleaved_idx += num_channels_;
+      }
+    }
+
+    return;
+  }
 
   if (num_channels_ == 1) {
-    if (num_mixed_channels_ == 1) {
-      memcpy(audioFrame->_payloadData,
+    if (data_ == NULL) {
+      // Either mixed from stereo or converted from float.
+      memcpy(frame._payloadData,
              channels_[0].data,
              sizeof(WebRtc_Word16) * samples_per_channel_);
     } else {
       // These should point to the same buffer in this case.
-      assert(data_ == audioFrame->_payloadData);
+      assert(data_ == frame._payloadData);
     }
 
     return;
@@ -229,7 +366,7 @@ void AudioBuffer::InterleaveTo(AudioFrame* audioFrame) const {
 
   for (int i = 0; i < num_channels_; i++) {
     WebRtc_Word16* deinterleaved = channels_[i].data;
-    WebRtc_Word16* interleaved = audioFrame->_payloadData;
+    WebRtc_Word16* interleaved = frame._payloadData;
     WebRtc_Word32 interleaved_idx = i;
     for (int j = 0; j < samples_per_channel_; j++) {
       interleaved[interleaved_idx] = deinterleaved[j];
@@ -238,6 +375,43 @@ void AudioBuffer::InterleaveTo(AudioFrame* audioFrame) const {
   }
 }
 
+void AudioBuffer::CopyFrom(const float* const* data,
+                           WebRtc_Word32 num_channels) {
+  assert(num_channels <= max_num_channels_);
+
+  num_channels_ = num_channels;
+  num_mixed_channels_ = 0;
+  num_mixed_low_pass_channels_ = 0;
+  reference_copied_ = false;
+  data_ = NULL;
+
+  // Allocated on first use, as most users only ever pass 16-bit frames.
+  if (float_data_ == NULL) {
+    float_data_ = new float[max_num_channels_ * samples_per_channel_];
+  }
+
+  for (int i = 0; i < num_channels_; i++) {
+    ClampToS16Range(data[i], samples_per_channel_,
+                    &float_data_[i * samples_per_channel_]);
+  }
+  float_current_ = true;
+}
+
+void AudioBuffer::CopyTo(float* const* data) const {
+  for (int i = 0; i < num_channels_; i++) {
+    if (float_current_) {
+      // The float components do not limit their output.
+      ClampToS16Range(float_data(i), samples_per_channel_, data[i]);
+      continue;
+    }
+
+    const WebRtc_Word16* channel = this->data(i);
+    for (int j = 0; j < samples_per_channel_; j++) {
+      data[i][j] = channel[j];
+    }
+  }
+}
+
 // TODO(ajm): would be good to support the no-mix case with pointer assignment.
 // TODO(ajm): handle mixing to multiple channels?
 void AudioBuffer::Mix(WebRtc_Word32 num_mixed_channels) {
@@ -245,10 +419,18 @@ void AudioBuffer::Mix(WebRtc_Word32 num_mixed_channels) {
   assert(num_channels_ == 2);
   assert(num_mixed_channels == 1);
 
-  StereoToMono(channels_[0].data,
-               channels_[1].data,
-               channels_[0].data,
-               samples_per_channel_);
+  if (float_current_) {
+    float* left = float_data(0);
+    const float* right = float_data(1);
+    for (int i = 0; i < samples_per_channel_; i++) {
+      left[i] = (left[i] + right[i]) * 0.5f;
+    }
+  } else {
+    StereoToMono(channels_[0].data,
+                 channels_[1].data,
+                 channels_[0].data,
+                 samples_per_channel_);
+  }
 
   num_channels_ = num_mixed_channels;
   num_mixed_channels_ = num_mixed_channels;
@@ -18,16 +18,19 @@ namespace webrtc {
 
 struct AudioChannel;
 struct SplitAudioChannel;
-class AudioFrame;
+class AudioFrameView;
 
 class AudioBuffer {
  public:
   AudioBuffer(WebRtc_Word32 max_num_channels, WebRtc_Word32 samples_per_channel);
   virtual ~AudioBuffer();
 
+  WebRtc_Word32 max_num_channels() const;
   WebRtc_Word32 num_channels() const;
   WebRtc_Word32 samples_per_channel() const;
   WebRtc_Word32 samples_per_split_channel() const;
+  // Size of the buffer and the channel storage it owns, in bytes.
+  int memory_usage_bytes() const;
 
   WebRtc_Word16* data(WebRtc_Word32 channel) const;
   WebRtc_Word16* low_pass_split_data(WebRtc_Word32 channel) const;
@@ -39,9 +42,27 @@ class AudioBuffer {
   WebRtc_Word32* analysis_filter_state2(WebRtc_Word32 channel) const;
   WebRtc_Word32* synthesis_filter_state1(WebRtc_Word32 channel) const;
   WebRtc_Word32* synthesis_filter_state2(WebRtc_Word32 channel) const;
+  // Clears the band split filter states of every channel.
+  void ResetSplitFilterStates();
 
-  void DeinterleaveFrom(AudioFrame* audioFrame);
-  void InterleaveTo(AudioFrame* audioFrame) const;
+  // |frame| is referenced rather than copied when it is mono, and so has to
+  // stay valid until InterleaveTo().
+  void DeinterleaveFrom(const AudioFrameView& frame);
+  void InterleaveTo(const AudioFrameView& frame) const;
+  // Copies |num_channels| non-interleaved float channels, limited to the
+  // 16-bit range, and copies the processed channels back, limited again.
+  void CopyFrom(const float* const* data, WebRtc_Word32 num_channels);
+  void CopyTo(float* const* data) const;
+
+  // The audio given to CopyFrom() is kept in float until one of the 16-bit
+  // accessors above is used, which rounds it to 16 bits for the rest of the
+  // frame. float_data() is only valid while float_current().
+  bool float_current() const;
+  float* float_data(WebRtc_Word32 channel) const;
+
+  // Maps NaN to zero and limits |length| samples to the 16-bit range, without
+  // rounding. |in| and |out| may be the same.
+  static void ClampToS16Range(const float* in, int length, float* out);
   void Mix(WebRtc_Word32 num_mixed_channels);
   void CopyAndMixLowPass(WebRtc_Word32 num_mixed_channels);
   void CopyLowPassToReference();
@@ -54,12 +75,15 @@ class AudioBuffer {
   const WebRtc_Word32 samples_per_channel_;
   WebRtc_Word32 samples_per_split_channel_;
   bool reference_copied_;
+  mutable bool float_current_;
+
+  void ConvertFloatData() const;
 
   WebRtc_Word16* data_;
+  float* float_data_;
   // TODO(ajm): Prefer to make these vectors if permitted...
   AudioChannel* channels_;
   SplitAudioChannel* split_channels_;
-  // TODO(ajm): improve this, we don't need the full 32 kHz space here.
   AudioChannel* mixed_low_pass_channels_;
   AudioChannel* low_pass_reference_channels_;
 };
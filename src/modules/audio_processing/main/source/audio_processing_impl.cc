@@ -16,6 +16,7 @@
 
 #include "critical_section_wrapper.h"
 #include "file_wrapper.h"
+#include "tick_util.h"
 
 #include "audio_buffer.h"
 #include "echo_cancellation_impl.h"
@@ -25,6 +26,7 @@
 #include "level_estimator_impl.h"
 #include "noise_suppression_impl.h"
 #include "processing_component.h"
+#include "signal_processing_library.h"
 #include "splitting_filter.h"
 #include "voice_detection_impl.h"
 
@@ -37,7 +39,33 @@ enum Events {
   kCaptureEvent
 };
 
+// Bits of AudioProcessingImpl::EnabledComponents().
+enum ComponentFlags {
+  kEchoCancellationFlag = 1 << 0,
+  kEchoControlMobileFlag = 1 << 1,
+  kGainControlFlag = 1 << 2,
+  kHighPassFilterFlag = 1 << 3,
+  kNoiseSuppressionFlag = 1 << 4,
+  kVoiceDetectionFlag = 1 << 5
+};
+
 const char kMagicNumber[] = "#!vqetrace1.2";
+
+// Interval of the work done by Process().
+const WebRtc_Word64 kProcessIntervalMs = 100;
+
+// A capture frame with no sample above this peak (about -72 dBFS) is quiet,
+// and the near end is inactive after this many quiet 10 ms frames in a row.
+const int kInactivePeakLevel = 8;
+const int kActivityHangoverFrames = 20;
+
+// Mixes an interleaved stereo frame to mono in place, in the same way as
+// AudioBuffer::Mix().
+void MixStereoToMonoInPlace(WebRtc_Word16* data, int samples_per_channel) {
+  for (int i = 0; i < samples_per_channel; i++) {
+    data[i] = static_cast<WebRtc_Word16>((data[2 * i] + data[2 * i + 1]) >> 1);
+  }
+}
 }  // namespace
 
 AudioProcessing* AudioProcessing::Create(int id) {
@@ -77,9 +105,17 @@ AudioProcessingImpl::AudioProcessingImpl(int id)
       samples_per_channel_(sample_rate_hz_ / 100),
       stream_delay_ms_(0),
       was_stream_delay_set_(false),
+      compact_memory_(false),
+      activity_gating_(false),
+      stream_is_active_(true),
+      inactive_frames_(0),
       num_render_input_channels_(1),
       num_capture_input_channels_(1),
-      num_capture_output_channels_(1) {
+      num_capture_output_channels_(1),
+      enabled_components_(-1),
+      num_capture_stages_(0),
+      render_needed_(false),
+      last_process_time_ms_(TickTime::MillisecondTimestamp()) {
 
   echo_cancellation_ = new EchoCancellationImpl(this);
   component_list_.push_back(echo_cancellation_);
@@ -161,6 +197,8 @@ int AudioProcessingImpl::InitializeLocked() {
                                    samples_per_channel_);
 
   was_stream_delay_set_ = false;
+  stream_is_active_ = true;
+  inactive_frames_ = 0;
 
   // Initialize all components.
   std::list<ProcessingComponent*>::iterator it;
@@ -174,6 +212,42 @@ int AudioProcessingImpl::InitializeLocked() {
   return kNoError;
 }
 
+int AudioProcessingImpl::ReconfigureLocked(bool render_channels_changed) {
+  // Keep the buffers unless their shape has changed.
+  if (render_audio_->max_num_channels() != num_render_input_channels_ ||
+      render_audio_->samples_per_channel() != samples_per_channel_) {
+    delete render_audio_;
+    render_audio_ = new AudioBuffer(num_render_input_channels_,
+                                    samples_per_channel_);
+  }
+
+  if (capture_audio_->max_num_channels() != num_capture_input_channels_ ||
+      capture_audio_->samples_per_channel() != samples_per_channel_) {
+    delete capture_audio_;
+    capture_audio_ = new AudioBuffer(num_capture_input_channels_,
+                                     samples_per_channel_);
+  }
+
+  was_stream_delay_set_ = false;
+
+  std::list<ProcessingComponent*>::iterator it;
+  for (it = component_list_.begin(); it != component_list_.end(); it++) {
+    int err = kNoError;
+    if (render_channels_changed &&
+        (*it == echo_cancellation_ || *it == echo_control_mobile_)) {
+      err = (*it)->Initialize();
+    } else {
+      err = (*it)->Reinitialize();
+    }
+
+    if (err != kNoError) {
+      return err;
+    }
+  }
+
+  return kNoError;
+}
+
 int AudioProcessingImpl::set_sample_rate_hz(int rate) {
   CriticalSectionScoped crit_scoped(*crit_);
   if (rate != kSampleRate8kHz &&
@@ -191,7 +265,7 @@ int AudioProcessingImpl::set_sample_rate_hz(int rate) {
     split_sample_rate_hz_ = sample_rate_hz_;
   }
 
-  return InitializeLocked();
+  return ReconfigureLocked(false);
 }
 
 int AudioProcessingImpl::sample_rate_hz() const {
@@ -205,9 +279,10 @@ int AudioProcessingImpl::set_num_reverse_channels(int channels) {
     return kBadParameterError;
   }
 
+  const bool changed = channels != num_render_input_channels_;
   num_render_input_channels_ = channels;
 
-  return InitializeLocked();
+  return ReconfigureLocked(changed);
 }
 
 int AudioProcessingImpl::num_reverse_channels() const {
@@ -234,7 +309,7 @@ int AudioProcessingImpl::set_num_channels(
   num_capture_input_channels_ = input_channels;
   num_capture_output_channels_ = output_channels;
 
-  return InitializeLocked();
+  return ReconfigureLocked(false);
 }
 
 int AudioProcessingImpl::num_input_channels() const {
@@ -247,184 +322,416 @@ int AudioProcessingImpl::num_output_channels() const {
 
 int AudioProcessingImpl::ProcessStream(AudioFrame* frame) {
   CriticalSectionScoped crit_scoped(*crit_);
+  if (frame == NULL) {
+    return kNullPointerError;
+  }
+
+  int err = ProcessStreamLocked(AudioFrameView(*frame));
+  if (err != kNoError) {
+    return err;
+  }
+
+  frame->_audioChannel = num_capture_output_channels_;
+  return kNoError;
+}
+
+int AudioProcessingImpl::ProcessStream(const AudioFrameView& frame) {
+  CriticalSectionScoped crit_scoped(*crit_);
+  return ProcessStreamLocked(frame);
+}
+
+int AudioProcessingImpl::ProcessStreamLocked(const AudioFrameView& frame) {
   int err = kNoError;
 
-  if (frame == NULL) {
+  if (frame._payloadData == NULL) {
     return kNullPointerError;
   }
 
-  if (frame->_frequencyInHz !=
+  if (frame._frequencyInHz !=
       static_cast<WebRtc_UWord32>(sample_rate_hz_)) {
     return kBadSampleRateError;
   }
 
-  if (frame->_audioChannel != num_capture_input_channels_) {
+  if (frame._audioChannel != num_capture_input_channels_) {
     return kBadNumberChannelsError;
   }
 
-  if (frame->_payloadDataLengthInSamples != samples_per_channel_) {
+  if (frame._payloadDataLengthInSamples != samples_per_channel_) {
     return kBadDataLengthError;
   }
 
   if (debug_file_->Open()) {
-    WebRtc_UWord8 event = kCaptureEvent;
-    if (!debug_file_->Write(&event, sizeof(event))) {
-      return kFileError;
-    }
-
-    if (!debug_file_->Write(&frame->_frequencyInHz,
-                                   sizeof(frame->_frequencyInHz))) {
-      return kFileError;
+    err = WriteDebugFrame(kCaptureEvent, frame);
+    if (err != kNoError) {
+      return err;
     }
+  }
 
-    if (!debug_file_->Write(&frame->_audioChannel,
-                                   sizeof(frame->_audioChannel))) {
-      return kFileError;
-    }
+  err = PrepareCaptureLocked();
+  if (err != kNoError) {
+    return err;
+  }
 
-    if (!debug_file_->Write(&frame->_payloadDataLengthInSamples,
-        sizeof(frame->_payloadDataLengthInSamples))) {
-      return kFileError;
+  if (num_capture_stages_ == 0) {
+    // Nothing to process; only downmix, which can be done in the frame.
+    if (num_capture_output_channels_ < num_capture_input_channels_) {
+      MixStereoToMonoInPlace(frame._payloadData, samples_per_channel_);
     }
 
-    if (!debug_file_->Write(frame->_payloadData,
-        sizeof(WebRtc_Word16) * frame->_payloadDataLengthInSamples *
-        frame->_audioChannel)) {
-      return kFileError;
-    }
+    return kNoError;
   }
 
   capture_audio_->DeinterleaveFrom(frame);
 
-  // TODO(ajm): experiment with mixing and AEC placement.
-  if (num_capture_output_channels_ < num_capture_input_channels_) {
-    capture_audio_->Mix(num_capture_output_channels_);
+  err = ProcessCaptureAudioLocked();
+  if (err != kNoError) {
+    return err;
+  }
+
+  capture_audio_->InterleaveTo(AudioFrameView(frame._payloadData,
+                                              samples_per_channel_,
+                                              sample_rate_hz_,
+                                              num_capture_output_channels_));
+
+  return kNoError;
+}
 
-    frame->_audioChannel = num_capture_output_channels_;
+int AudioProcessingImpl::ProcessStream(float* const* data,
+                                       int samples_per_channel) {
+  CriticalSectionScoped crit_scoped(*crit_);
+  int err = kNoError;
+
+  if (data == NULL) {
+    return kNullPointerError;
   }
 
-  if (sample_rate_hz_ == kSampleRate32kHz) {
-    for (int i = 0; i < num_capture_input_channels_; i++) {
-      // Split into a low and high band.
-      SplittingFilterAnalysis(capture_audio_->data(i),
-                              capture_audio_->low_pass_split_data(i),
-                              capture_audio_->high_pass_split_data(i),
-                              capture_audio_->analysis_filter_state1(i),
-                              capture_audio_->analysis_filter_state2(i));
+  for (int i = 0; i < num_capture_input_channels_; i++) {
+    if (data[i] == NULL) {
+      return kNullPointerError;
     }
   }
 
-  err = high_pass_filter_->ProcessCaptureAudio(capture_audio_);
-  if (err != kNoError) {
-    return err;
+  if (samples_per_channel != samples_per_channel_) {
+    return kBadDataLengthError;
   }
 
-  err = gain_control_->AnalyzeCaptureAudio(capture_audio_);
-  if (err != kNoError) {
-    return err;
+  if (debug_file_->Open()) {
+    // Converted twice in this case, which only matters for recordings.
+    capture_audio_->CopyFrom(data, num_capture_input_channels_);
+    err = WriteDebugFrame(kCaptureEvent, capture_audio_);
+    if (err != kNoError) {
+      return err;
+    }
   }
 
-  err = echo_cancellation_->ProcessCaptureAudio(capture_audio_);
+  err = PrepareCaptureLocked();
   if (err != kNoError) {
     return err;
   }
 
-  if (echo_control_mobile_->is_enabled() &&
-      noise_suppression_->is_enabled()) {
-    capture_audio_->CopyLowPassToReference();
-  }
+  if (num_capture_stages_ == 0) {
+    // Nothing to process; only limit the range as CopyFrom() does, and
+    // downmix, which can both be done in place.
+    for (int i = 0; i < num_capture_input_channels_; i++) {
+      AudioBuffer::ClampToS16Range(data[i], samples_per_channel_, data[i]);
+    }
+    if (num_capture_output_channels_ < num_capture_input_channels_) {
+      for (int i = 0; i < samples_per_channel_; i++) {
+        data[0][i] = (data[0][i] + data[1][i]) * 0.5f;
+      }
+    }
 
-  err = noise_suppression_->ProcessCaptureAudio(capture_audio_);
-  if (err != kNoError) {
-    return err;
+    return kNoError;
   }
 
-  err = echo_control_mobile_->ProcessCaptureAudio(capture_audio_);
-  if (err != kNoError) {
-    return err;
-  }
+  capture_audio_->CopyFrom(data, num_capture_input_channels_);
 
-  err = voice_detection_->ProcessCaptureAudio(capture_audio_);
+  err = ProcessCaptureAudioLocked();
   if (err != kNoError) {
     return err;
   }
 
-  err = gain_control_->ProcessCaptureAudio(capture_audio_);
-  if (err != kNoError) {
-    return err;
-  }
+  capture_audio_->CopyTo(data);
 
-  //err = level_estimator_->ProcessCaptureAudio(capture_audio_);
-  //if (err != kNoError) {
-  //  return err;
-  //}
+  return kNoError;
+}
 
-  if (sample_rate_hz_ == kSampleRate32kHz) {
-    for (int i = 0; i < num_capture_output_channels_; i++) {
-      // Recombine low and high bands.
-      SplittingFilterSynthesis(capture_audio_->low_pass_split_data(i),
-                               capture_audio_->high_pass_split_data(i),
-                               capture_audio_->data(i),
-                               capture_audio_->synthesis_filter_state1(i),
-                               capture_audio_->synthesis_filter_state2(i));
-    }
+int AudioProcessingImpl::AnalyzeReverseStream(AudioFrame* frame) {
+  CriticalSectionScoped crit_scoped(*crit_);
+  if (frame == NULL) {
+    return kNullPointerError;
   }
 
-  capture_audio_->InterleaveTo(frame);
-
-  return kNoError;
+  return AnalyzeReverseStreamLocked(AudioFrameView(*frame));
 }
 
-int AudioProcessingImpl::AnalyzeReverseStream(AudioFrame* frame) {
+int AudioProcessingImpl::AnalyzeReverseStream(const AudioFrameView& frame) {
   CriticalSectionScoped crit_scoped(*crit_);
+  return AnalyzeReverseStreamLocked(frame);
+}
+
+int AudioProcessingImpl::AnalyzeReverseStreamLocked(
+    const AudioFrameView& frame) {
   int err = kNoError;
 
-  if (frame == NULL) {
+  if (frame._payloadData == NULL) {
     return kNullPointerError;
   }
 
-  if (frame->_frequencyInHz !=
+  if (frame._frequencyInHz !=
       static_cast<WebRtc_UWord32>(sample_rate_hz_)) {
     return kBadSampleRateError;
   }
 
-  if (frame->_audioChannel != num_render_input_channels_) {
+  if (frame._audioChannel != num_render_input_channels_) {
     return kBadNumberChannelsError;
   }
 
-  if (frame->_payloadDataLengthInSamples != samples_per_channel_) {
+  if (frame._payloadDataLengthInSamples != samples_per_channel_) {
     return kBadDataLengthError;
   }
 
   if (debug_file_->Open()) {
-    WebRtc_UWord8 event = kRenderEvent;
-    if (!debug_file_->Write(&event, sizeof(event))) {
-      return kFileError;
+    err = WriteDebugFrame(kRenderEvent, frame);
+    if (err != kNoError) {
+      return err;
     }
+  }
 
-    if (!debug_file_->Write(&frame->_frequencyInHz,
-                                   sizeof(frame->_frequencyInHz))) {
-      return kFileError;
+  if (EnabledComponents() != enabled_components_) {
+    UpdatePlan();
+  }
+
+  if (!render_needed_) {
+    was_stream_delay_set_ = false;
+    return kNoError;
+  }
+
+  render_audio_->DeinterleaveFrom(frame);
+
+  return AnalyzeRenderAudioLocked();
+}
+
+int AudioProcessingImpl::AnalyzeReverseStream(const float* const* data,
+                                              int samples_per_channel) {
+  CriticalSectionScoped crit_scoped(*crit_);
+  int err = kNoError;
+
+  if (data == NULL) {
+    return kNullPointerError;
+  }
+
+  for (int i = 0; i < num_render_input_channels_; i++) {
+    if (data[i] == NULL) {
+      return kNullPointerError;
     }
+  }
 
-    if (!debug_file_->Write(&frame->_audioChannel,
-                                   sizeof(frame->_audioChannel))) {
-      return kFileError;
+  if (samples_per_channel != samples_per_channel_) {
+    return kBadDataLengthError;
+  }
+
+  if (debug_file_->Open()) {
+    render_audio_->CopyFrom(data, num_render_input_channels_);
+    err = WriteDebugFrame(kRenderEvent, render_audio_);
+    if (err != kNoError) {
+      return err;
     }
+  }
 
-    if (!debug_file_->Write(&frame->_payloadDataLengthInSamples,
-        sizeof(frame->_payloadDataLengthInSamples))) {
-      return kFileError;
+  if (EnabledComponents() != enabled_components_) {
+    UpdatePlan();
+  }
+
+  if (!render_needed_) {
+    was_stream_delay_set_ = false;
+    return kNoError;
+  }
+
+  render_audio_->CopyFrom(data, num_render_input_channels_);
+
+  return AnalyzeRenderAudioLocked();
+}
+
+int AudioProcessingImpl::WriteDebugFrame(WebRtc_UWord8 event,
+                                         const AudioFrameView& frame) {
+  if (!debug_file_->Write(&event, sizeof(event))) {
+    return kFileError;
+  }
+
+  if (!debug_file_->Write(&frame._frequencyInHz,
+                          sizeof(frame._frequencyInHz))) {
+    return kFileError;
+  }
+
+  if (!debug_file_->Write(&frame._audioChannel,
+                          sizeof(frame._audioChannel))) {
+    return kFileError;
+  }
+
+  if (!debug_file_->Write(&frame._payloadDataLengthInSamples,
+      sizeof(frame._payloadDataLengthInSamples))) {
+    return kFileError;
+  }
+
+  if (!debug_file_->Write(frame._payloadData,
+      sizeof(WebRtc_Word16) * frame._payloadDataLengthInSamples *
+      frame._audioChannel)) {
+    return kFileError;
+  }
+
+  return kNoError;
+}
+
+int AudioProcessingImpl::WriteDebugFrame(WebRtc_UWord8 event,
+                                         AudioBuffer* audio) {
+  // The debug format stores interleaved frames, so the float input is
+  // recorded as it is seen by the components.
+  WebRtc_Word16 interleaved[AudioFrame::kMaxAudioFrameSizeSamples];
+  AudioFrameView frame(interleaved, audio->samples_per_channel(),
+                       sample_rate_hz_, audio->num_channels());
+  audio->InterleaveTo(frame);
+
+  return WriteDebugFrame(event, frame);
+}
+
+int AudioProcessingImpl::PrepareCaptureLocked() {
+  if (EnabledComponents() != enabled_components_) {
+    UpdatePlan();
+  }
+
+  return noise_suppression_->UpdateFusion(echo_cancellation_->is_enabled());
+}
+
+int AudioProcessingImpl::UpdateActivityLocked() {
+  // The same per-frame peak as the AGC envelope, over the output channels.
+  bool loud = false;
+  for (int i = 0; i < num_capture_output_channels_ && !loud; i++) {
+    if (capture_audio_->float_current()) {
+      const float* data = capture_audio_->float_data(i);
+      for (int j = 0; j < samples_per_channel_; j++) {
+        if (data[j] > kInactivePeakLevel || data[j] < -kInactivePeakLevel) {
+          loud = true;
+          break;
+        }
+      }
+    } else {
+      loud = WebRtcSpl_MaxAbsValueW16(capture_audio_->data(i),
+          static_cast<WebRtc_Word16>(samples_per_channel_)) >
+          kInactivePeakLevel;
     }
+  }
 
-    if (!debug_file_->Write(frame->_payloadData,
-        sizeof(WebRtc_Word16) * frame->_payloadDataLengthInSamples *
-        frame->_audioChannel)) {
-      return kFileError;
+  if (loud) {
+    inactive_frames_ = 0;
+  } else if (inactive_frames_ < kActivityHangoverFrames) {
+    inactive_frames_++;
+  }
+  stream_is_active_ = inactive_frames_ < kActivityHangoverFrames;
+
+  int err = noise_suppression_->UpdateActivity(stream_is_active_);
+  if (err != kNoError) {
+    return err;
+  }
+
+  return gain_control_->UpdateActivity(stream_is_active_);
+}
+
+int AudioProcessingImpl::ProcessCaptureAudioLocked() {
+  int err = kNoError;
+
+  // TODO(ajm): experiment with mixing and AEC placement.
+  if (num_capture_output_channels_ < num_capture_input_channels_) {
+    capture_audio_->Mix(num_capture_output_channels_);
+  }
+
+  if (activity_gating_) {
+    err = UpdateActivityLocked();
+    if (err != kNoError) {
+      return err;
     }
   }
 
-  render_audio_->DeinterleaveFrom(frame);
+  // The high-pass filter is always the first stage, so at 32 kHz it is fused
+  // with the band split.
+  const bool split_filtered = sample_rate_hz_ == kSampleRate32kHz &&
+      (enabled_components_ & kHighPassFilterFlag);
+  if (split_filtered) {
+    err = high_pass_filter_->SplitAndProcessCaptureAudio(capture_audio_);
+    if (err != kNoError) {
+      return err;
+    }
+  } else if (sample_rate_hz_ == kSampleRate32kHz) {
+    for (int i = 0; i < num_capture_output_channels_; i++) {
+      // Split into a low and high band.
+      SplittingFilterAnalysis(capture_audio_->data(i),
+                              capture_audio_->low_pass_split_data(i),
+                              capture_audio_->high_pass_split_data(i),
+                              capture_audio_->analysis_filter_state1(i),
+                              capture_audio_->analysis_filter_state2(i));
+    }
+  }
+
+  for (int i = 0; i < num_capture_stages_; i++) {
+    switch (capture_stages_[i]) {
+      case kHighPassFilterStage:
+        if (!split_filtered) {
+          err = high_pass_filter_->ProcessCaptureAudio(capture_audio_);
+        }
+        break;
+      case kAnalyzeGainStage:
+        err = gain_control_->AnalyzeCaptureAudio(capture_audio_);
+        break;
+      case kEchoCancellationStage:
+        err = echo_cancellation_->ProcessCaptureAudio(
+            capture_audio_,
+            noise_suppression_->is_fused() ? noise_suppression_ : NULL);
+        break;
+      case kCopyReferenceStage:
+        capture_audio_->CopyLowPassToReference();
+        break;
+      case kNoiseSuppressionStage:
+        err = noise_suppression_->ProcessCaptureAudio(capture_audio_);
+        break;
+      case kEchoControlMobileStage:
+        err = echo_control_mobile_->ProcessCaptureAudio(capture_audio_);
+        break;
+      case kVoiceDetectionStage:
+        err = voice_detection_->ProcessCaptureAudio(capture_audio_);
+        break;
+      case kGainControlStage:
+        err = gain_control_->ProcessCaptureAudio(capture_audio_);
+        break;
+      default:
+        assert(false);
+    }
+
+    if (err != kNoError) {
+      return err;
+    }
+  }
+
+  //err = level_estimator_->ProcessCaptureAudio(capture_audio_);
+  //if (err != kNoError) {
+  //  return err;
+  //}
+
+  if (sample_rate_hz_ == kSampleRate32kHz) {
+    for (int i = 0; i < num_capture_output_channels_; i++) {
+      // Recombine low and high bands.
+      SplittingFilterSynthesis(capture_audio_->low_pass_split_data(i),
+                               capture_audio_->high_pass_split_data(i),
+                               capture_audio_->data(i),
+                               capture_audio_->synthesis_filter_state1(i),
+                               capture_audio_->synthesis_filter_state2(i));
+    }
+  }
+
+  return kNoError;
+}
+
+int AudioProcessingImpl::AnalyzeRenderAudioLocked() {
+  int err = kNoError;
 
   // TODO(ajm): turn the splitting filter into a component?
   if (sample_rate_hz_ == kSampleRate32kHz) {
@@ -463,6 +770,80 @@ int AudioProcessingImpl::AnalyzeReverseStream(AudioFrame* frame) {
   return err;  // TODO(ajm): this is for returning warnings; necessary?
 }
 
+int AudioProcessingImpl::EnabledComponents() const {
+  int flags = 0;
+  if (echo_cancellation_->is_enabled()) {
+    flags |= kEchoCancellationFlag;
+  }
+  if (echo_control_mobile_->is_enabled()) {
+    flags |= kEchoControlMobileFlag;
+  }
+  if (gain_control_->is_enabled()) {
+    flags |= kGainControlFlag;
+  }
+  if (high_pass_filter_->is_enabled()) {
+    flags |= kHighPassFilterFlag;
+  }
+  if (noise_suppression_->is_enabled()) {
+    flags |= kNoiseSuppressionFlag;
+  }
+  if (voice_detection_->is_enabled()) {
+    flags |= kVoiceDetectionFlag;
+  }
+
+  return flags;
+}
+
+// Lists the capture stages of the enabled components, in processing order.
+// Every capture component works on the split bands, so the 32 kHz band split
+// is only needed when at least one stage is planned. The split filters are
+// reset when a path resumes, rather than continuing from the audio they last
+// saw before it was bypassed.
+void AudioProcessingImpl::UpdatePlan() {
+  const int flags = EnabledComponents();
+  int n = 0;
+
+  if (flags & kHighPassFilterFlag) {
+    capture_stages_[n++] = kHighPassFilterStage;
+  }
+  if (flags & kGainControlFlag) {
+    capture_stages_[n++] = kAnalyzeGainStage;
+  }
+  if (flags & kEchoCancellationFlag) {
+    capture_stages_[n++] = kEchoCancellationStage;
+  }
+  if ((flags & kEchoControlMobileFlag) && (flags & kNoiseSuppressionFlag)) {
+    capture_stages_[n++] = kCopyReferenceStage;
+  }
+  if (flags & kNoiseSuppressionFlag) {
+    capture_stages_[n++] = kNoiseSuppressionStage;
+  }
+  if (flags & kEchoControlMobileFlag) {
+    capture_stages_[n++] = kEchoControlMobileStage;
+  }
+  if (flags & kVoiceDetectionFlag) {
+    capture_stages_[n++] = kVoiceDetectionStage;
+  }
+  if (flags & kGainControlFlag) {
+    capture_stages_[n++] = kGainControlStage;
+  }
+  assert(n <= kNumCaptureStages);
+
+  const bool render_needed = (flags & (kEchoCancellationFlag |
+                                       kEchoControlMobileFlag |
+                                       kGainControlFlag)) != 0;
+  if (num_capture_stages_ == 0 && n > 0) {
+    capture_audio_->ResetSplitFilterStates();
+  }
+  if (!render_needed_ && render_needed) {
+    render_audio_->ResetSplitFilterStates();
+  }
+
+  num_capture_stages_ = n;
+  render_needed_ = render_needed;
+  enabled_components_ = flags;
+}
+
 int AudioProcessingImpl::set_stream_delay_ms(int delay) {
   was_stream_delay_set_ = true;
   if (delay < 0) {
@@ -539,6 +920,91 @@ int AudioProcessingImpl::StopDebugRecording() {
   return kNoError;
 }
 
+int AudioProcessingImpl::GetMemoryUsage(MemoryUsage* usage) const {
+  CriticalSectionScoped crit_scoped(*crit_);
+  if (usage == NULL) {
+    return kNullPointerError;
+  }
+
+  usage->audio_buffers = 0;
+  if (render_audio_ != NULL) {
+    usage->audio_buffers += render_audio_->memory_usage_bytes();
+  }
+  if (capture_audio_ != NULL) {
+    usage->audio_buffers += capture_audio_->memory_usage_bytes();
+  }
+
+  usage->echo_cancellation = echo_cancellation_->memory_usage_bytes();
+  usage->echo_control_mobile = echo_control_mobile_->memory_usage_bytes();
+  usage->gain_control = gain_control_->memory_usage_bytes();
+  usage->high_pass_filter = high_pass_filter_->memory_usage_bytes();
+  usage->level_estimator = level_estimator_->memory_usage_bytes();
+  usage->noise_suppression = noise_suppression_->memory_usage_bytes();
+  usage->voice_detection = voice_detection_->memory_usage_bytes();
+
+  usage->total = sizeof(*this) +
+                 sizeof(*echo_cancellation_) +
+                 sizeof(*echo_control_mobile_) +
+                 sizeof(*gain_control_) +
+                 sizeof(*high_pass_filter_) +
+                 sizeof(*level_estimator_) +
+                 sizeof(*noise_suppression_) +
+                 sizeof(*voice_detection_) +
+                 usage->audio_buffers +
+                 usage->echo_cancellation +
+                 usage->echo_control_mobile +
+                 usage->gain_control +
+                 usage->high_pass_filter +
+                 usage->level_estimator +
+                 usage->noise_suppression +
+                 usage->voice_detection;
+
+  return kNoError;
+}
+
+int AudioProcessingImpl::enable_compact_memory(bool enable) {
+  CriticalSectionScoped crit_scoped(*crit_);
+  compact_memory_ = enable;
+  if (compact_memory_) {
+    std::list<ProcessingComponent*>::iterator it;
+    for (it = component_list_.begin(); it != component_list_.end(); it++) {
+      (*it)->ReleaseUnusedHandles();
+    }
+  }
+
+  return kNoError;
+}
+
+bool AudioProcessingImpl::is_compact_memory_enabled() const {
+  return compact_memory_;
+}
+
+int AudioProcessingImpl::enable_activity_gating(bool enable) {
+  CriticalSectionScoped crit_scoped(*crit_);
+  activity_gating_ = enable;
+  if (activity_gating_ || stream_is_active_) {
+    return kNoError;
+  }
+
+  // Let the components resume where they were held.
+  stream_is_active_ = true;
+  inactive_frames_ = 0;
+  int err = noise_suppression_->UpdateActivity(true);
+  if (err != kNoError) {
+    return err;
+  }
+
+  return gain_control_->UpdateActivity(true);
+}
+
+bool AudioProcessingImpl::is_activity_gating_enabled() const {
+  return activity_gating_;
+}
+
+bool AudioProcessingImpl::stream_is_active() const {
+  return stream_is_active_;
+}
+
 EchoCancellation* AudioProcessingImpl::echo_cancellation() const {
   return echo_cancellation_;
 }
@@ -633,4 +1099,22 @@ WebRtc_Word32 AudioProcessingImpl::ChangeUniqueId(const WebRtc_Word32 id) {
 
   return kNoError;
 }
+
+WebRtc_Word32 AudioProcessingImpl::TimeUntilNextProcess() {
+  const WebRtc_Word64 elapsed_ms =
+      TickTime::MillisecondTimestamp() - last_process_time_ms_;
+  if (elapsed_ms >= kProcessIntervalMs) {
+    return 0;
+  }
+
+  return static_cast<WebRtc_Word32>(kProcessIntervalMs - elapsed_ms);
+}
+
+WebRtc_Word32 AudioProcessingImpl::Process() {
+  // Does not take |crit_|, so as not to hold up the audio thread.
+  last_process_time_ms_ = TickTime::MillisecondTimestamp();
+  echo_cancellation_->AggregateMetrics();
+
+  return kNoError;
+}
 }  // namespace webrtc
@@ -57,10 +57,21 @@ class AudioProcessingImpl : public AudioProcessing {
   virtual int num_reverse_channels() const;
   virtual int ProcessStream(AudioFrame* frame);
   virtual int AnalyzeReverseStream(AudioFrame* frame);
+  virtual int ProcessStream(const AudioFrameView& frame);
+  virtual int AnalyzeReverseStream(const AudioFrameView& frame);
+  virtual int ProcessStream(float* const* data, int samples_per_channel);
+  virtual int AnalyzeReverseStream(const float* const* data,
+                                   int samples_per_channel);
   virtual int set_stream_delay_ms(int delay);
   virtual int stream_delay_ms() const;
   virtual int StartDebugRecording(const char filename[kMaxFilenameSize]);
   virtual int StopDebugRecording();
+  virtual int GetMemoryUsage(MemoryUsage* usage) const;
+  virtual int enable_compact_memory(bool enable);
+  virtual bool is_compact_memory_enabled() const;
+  virtual int enable_activity_gating(bool enable);
+  virtual bool is_activity_gating_enabled() const;
+  virtual bool stream_is_active() const;
   virtual EchoCancellation* echo_cancellation() const;
   virtual EchoControlMobile* echo_control_mobile() const;
   virtual GainControl* gain_control() const;
@@ -74,8 +85,42 @@ class AudioProcessingImpl : public AudioProcessing {
                               WebRtc_UWord32& remainingBufferInBytes,
                               WebRtc_UWord32& position) const;
   virtual WebRtc_Word32 ChangeUniqueId(const WebRtc_Word32 id);
+  virtual WebRtc_Word32 TimeUntilNextProcess();
+  virtual WebRtc_Word32 Process();
 
  private:
+  // The capture-side processing steps, in the order they are run.
+  enum CaptureStage {
+    kHighPassFilterStage,
+    kAnalyzeGainStage,
+    kEchoCancellationStage,
+    kCopyReferenceStage,
+    kNoiseSuppressionStage,
+    kEchoControlMobileStage,
+    kVoiceDetectionStage,
+    kGainControlStage,
+    kNumCaptureStages
+  };
+
+  int EnabledComponents() const;
+  void UpdatePlan();
+  // Applies changed stream parameters without starting over; see
+  // ProcessingComponent::Reinitialize(). The echo components are indexed by
+  // render channel and have to be fully initialized if that count changes.
+  int ReconfigureLocked(bool render_channels_changed);
+
+  // Shared by the AudioFrame and float interfaces.
+  int ProcessStreamLocked(const AudioFrameView& frame);
+  int AnalyzeReverseStreamLocked(const AudioFrameView& frame);
+  int WriteDebugFrame(WebRtc_UWord8 event, const AudioFrameView& frame);
+  int WriteDebugFrame(WebRtc_UWord8 event, AudioBuffer* audio);
+  int PrepareCaptureLocked();
+  // Updates |stream_is_active_| from the peak level of the capture audio and
+  // passes it on to the components.
+  int UpdateActivityLocked();
+  int ProcessCaptureAudioLocked();
+  int AnalyzeRenderAudioLocked();
+
   int id_;
 
   EchoCancellationImpl* echo_cancellation_;
@@ -99,10 +144,24 @@ class AudioProcessingImpl : public AudioProcessing {
   int samples_per_channel_;
   int stream_delay_ms_;
   bool was_stream_delay_set_;
+  bool compact_memory_;
+  bool activity_gating_;
+  bool stream_is_active_;
+  int inactive_frames_;
 
   int num_render_input_channels_;
   int num_capture_input_channels_;
   int num_capture_output_channels_;
+
+  // Execution plan for the enabled components, rebuilt by UpdatePlan()
+  // whenever |enabled_components_| changes.
+  int enabled_components_;
+  int num_capture_stages_;
+  CaptureStage capture_stages_[kNumCaptureStages];
+  bool render_needed_;
+
+  // Only accessed by Process() and TimeUntilNextProcess().
+  WebRtc_Word64 last_process_time_ms_;
 };
 }  // namespace webrtc
 
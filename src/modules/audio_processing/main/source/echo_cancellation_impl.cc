@@ -10,14 +10,15 @@
 
 #include "echo_cancellation_impl.h"
 
+#include <algorithm>
 #include <cassert>
 #include <string.h>
 
 #include "critical_section_wrapper.h"
-#include "echo_cancellation.h"
 
 #include "audio_processing_impl.h"
 #include "audio_buffer.h"
+#include "noise_suppression_impl.h"
 
 namespace webrtc {
 
@@ -55,6 +56,9 @@ int MapError(int err) {
       return AudioProcessing::kUnspecifiedError;
   }
 }
+
+// More than the AEC holds, see WebRtcAec_GetMetricsBlocks().
+const int kMaxFetchedMetricsBlocks = 8;
 }  // namespace
 
 EchoCancellationImpl::EchoCancellationImpl(const AudioProcessingImpl* apm)
@@ -62,13 +66,31 @@ EchoCancellationImpl::EchoCancellationImpl(const AudioProcessingImpl* apm)
     apm_(apm),
     drift_compensation_enabled_(false),
     metrics_enabled_(false),
+    dormant_mode_enabled_(false),
+    max_delay_ms_(500),
     suppression_level_(kModerateSuppression),
     device_sample_rate_hz_(48000),
     stream_drift_samples_(0),
     was_stream_drift_set_(false),
-    stream_has_echo_(false) {}
+    stream_has_echo_(false),
+    metrics_aggregator_(NULL),
+    metrics_crit_(CriticalSectionWrapper::CreateCriticalSection()),
+    metrics_write_pos_(0),
+    metrics_read_pos_(0) {
+  if (WebRtcAec_CreateMetricsAggregator(&metrics_aggregator_) != 0) {
+    metrics_aggregator_ = NULL;
+  }
+}
+
+EchoCancellationImpl::~EchoCancellationImpl() {
+  if (metrics_aggregator_ != NULL) {
+    WebRtcAec_FreeMetricsAggregator(metrics_aggregator_);
+    metrics_aggregator_ = NULL;
+  }
 
-EchoCancellationImpl::~EchoCancellationImpl() {}
+  delete metrics_crit_;
+  metrics_crit_ = NULL;
+}
 
 int EchoCancellationImpl::ProcessRenderAudio(const AudioBuffer* audio) {
   if (!is_component_enabled()) {
@@ -101,7 +123,9 @@ int EchoCancellationImpl::ProcessRenderAudio(const AudioBuffer* audio) {
   return apm_->kNoError;
 }
 
-int EchoCancellationImpl::ProcessCaptureAudio(AudioBuffer* audio) {
+int EchoCancellationImpl::ProcessCaptureAudio(
+    AudioBuffer* audio,
+    NoiseSuppressionImpl* noise_suppression) {
   if (!is_component_enabled()) {
     return apm_->kNoError;
   }
@@ -125,15 +149,43 @@ int EchoCancellationImpl::ProcessCaptureAudio(AudioBuffer* audio) {
   for (int i = 0; i < audio->num_channels(); i++) {
     for (int j = 0; j < apm_->num_reverse_channels(); j++) {
       Handle* my_handle = handle(handle_index);
-      err = WebRtcAec_Process(
-          my_handle,
-          audio->low_pass_split_data(i),
-          audio->high_pass_split_data(i),
-          audio->low_pass_split_data(i),
-          audio->high_pass_split_data(i),
-          static_cast<WebRtc_Word16>(audio->samples_per_split_channel()),
-          apm_->stream_delay_ms(),
-          stream_drift_samples_);
+
+      // The last AEC of a channel produces its output spectrum.
+      if (noise_suppression != NULL && j == apm_->num_reverse_channels() - 1) {
+        err = WebRtcAec_set_spectrum_filter(
+            my_handle,
+            NoiseSuppressionImpl::FilterSpectrum,
+            noise_suppression->fused_handle(i));
+      } else {
+        err = WebRtcAec_set_spectrum_filter(my_handle, NULL, NULL);
+      }
+      if (err != apm_->kNoError) {
+        return GetHandleError(my_handle);
+      }
+
+      if (audio->float_current()) {
+        // Float input which no earlier stage has rounded. There is no band
+        // split in this case.
+        err = WebRtcAec_ProcessFloat(
+            my_handle,
+            audio->float_data(i),
+            NULL,
+            audio->float_data(i),
+            NULL,
+            static_cast<WebRtc_Word16>(audio->samples_per_split_channel()),
+            apm_->stream_delay_ms(),
+            stream_drift_samples_);
+      } else {
+        err = WebRtcAec_Process(
+            my_handle,
+            audio->low_pass_split_data(i),
+            audio->high_pass_split_data(i),
+            audio->low_pass_split_data(i),
+            audio->high_pass_split_data(i),
+            static_cast<WebRtc_Word16>(audio->samples_per_split_channel()),
+            apm_->stream_delay_ms(),
+            stream_drift_samples_);
+      }
 
       if (err != apm_->kNoError) {
         err = GetHandleError(my_handle);
@@ -157,10 +209,84 @@ int EchoCancellationImpl::ProcessCaptureAudio(AudioBuffer* audio) {
     }
   }
 
+  if (metrics_enabled_) {
+    err = QueueMetricsBlocks(handle(0));
+    if (err != apm_->kNoError) {
+      return err;
+    }
+  }
+
   was_stream_drift_set_ = false;
   return apm_->kNoError;
 }
 
+void EchoCancellationImpl::AggregateMetrics() {
+  CriticalSectionScoped crit_scoped(*metrics_crit_);
+  AggregateMetricsLocked();
+}
+
+int EchoCancellationImpl::QueueMetricsBlocks(void* handle) {
+  Handle* my_handle = static_cast<Handle*>(handle);
+  AecMetricsBlock blocks[kMaxFetchedMetricsBlocks];
+  const int num_blocks = WebRtcAec_GetMetricsBlocks(my_handle,
+                                                    blocks,
+                                                    kMaxFetchedMetricsBlocks);
+  if (num_blocks < 0) {
+    return GetHandleError(my_handle);
+  }
+
+  // Blocks are dropped if the queue is full.
+  for (int i = 0; i < num_blocks; i++) {
+    if (num_queued_metrics_blocks() >= kMetricsQueueSize) {
+      break;
+    }
+
+    const WebRtc_UWord32 write_pos =
+        static_cast<WebRtc_UWord32>(metrics_write_pos_.Value());
+    metrics_queue_[write_pos & (kMetricsQueueSize - 1)] = blocks[i];
+    ++metrics_write_pos_;
+  }
+
+  // Without anyone calling AudioProcessing::Process(), aggregate here before
+  // the queue overflows. This thread must not wait for the lock; whoever
+  // holds it is draining the queue already.
+  if (num_queued_metrics_blocks() > 3 * kMetricsQueueSize / 4 &&
+      metrics_crit_->TryEnter()) {
+    AggregateMetricsLocked();
+    metrics_crit_->Leave();
+  }
+
+  return apm_->kNoError;
+}
+
+int EchoCancellationImpl::num_queued_metrics_blocks() const {
+  return static_cast<int>(
+      static_cast<WebRtc_UWord32>(metrics_write_pos_.Value()) -
+      static_cast<WebRtc_UWord32>(metrics_read_pos_.Value()));
+}
+
+void EchoCancellationImpl::AggregateMetricsLocked() {
+  int num_blocks = num_queued_metrics_blocks();
+  while (num_blocks > 0) {
+    // Aggregate up to the end of the ring buffer at a time.
+    const int read_index = static_cast<WebRtc_UWord32>(
+        metrics_read_pos_.Value()) & (kMetricsQueueSize - 1);
+    const int chunk = std::min(num_blocks, kMetricsQueueSize - read_index);
+    WebRtcAec_AggregateMetrics(metrics_aggregator_,
+                               &metrics_queue_[read_index],
+                               chunk);
+    metrics_read_pos_ += chunk;
+    num_blocks -= chunk;
+  }
+}
+
+void EchoCancellationImpl::ResetMetrics() {
+  CriticalSectionScoped crit_scoped(*metrics_crit_);
+  // Skips the queued blocks. Unlike an assignment, this is atomic.
+  metrics_read_pos_ += num_queued_metrics_blocks();
+  WebRtcAec_InitMetricsAggregator(metrics_aggregator_);
+}
+
 int EchoCancellationImpl::Enable(bool enable) {
   CriticalSectionScoped crit_scoped(*apm_->crit());
   // Ensure AEC and AECM are not both enabled.
@@ -190,6 +316,37 @@ EchoCancellation::SuppressionLevel EchoCancellationImpl::suppression_level()
   return suppression_level_;
 }
 
+int EchoCancellationImpl::enable_dormant_mode(bool enable) {
+  CriticalSectionScoped crit_scoped(*apm_->crit());
+  dormant_mode_enabled_ = enable;
+  return Configure();
+}
+
+bool EchoCancellationImpl::is_dormant_mode_enabled() const {
+  return dormant_mode_enabled_;
+}
+
+int EchoCancellationImpl::set_max_delay_ms(int delay) {
+  CriticalSectionScoped crit_scoped(*apm_->crit());
+  if (delay < 1 || delay > 500) {
+    return apm_->kBadParameterError;
+  }
+
+  if (delay == max_delay_ms_) {
+    return apm_->kNoError;
+  }
+  max_delay_ms_ = delay;
+  if (!apm_->is_compact_memory_enabled()) {
+    return apm_->kNoError;
+  }
+  // The render buffer is sized when the AEC is initialized.
+  return Initialize();
+}
+
+int EchoCancellationImpl::max_delay_ms() const {
+  return max_delay_ms_;
+}
+
 int EchoCancellationImpl::enable_drift_compensation(bool enable) {
   CriticalSectionScoped crit_scoped(*apm_->crit());
   drift_compensation_enabled_ = enable;
@@ -227,6 +384,7 @@ int EchoCancellationImpl::stream_drift_samples() const {
 int EchoCancellationImpl::enable_metrics(bool enable) {
   CriticalSectionScoped crit_scoped(*apm_->crit());
   metrics_enabled_ = enable;
+  ResetMetrics();
   return Configure();
 }
 
@@ -250,10 +408,13 @@ int EchoCancellationImpl::GetMetrics(Metrics* metrics) {
   memset(&my_metrics, 0, sizeof(my_metrics));
   memset(metrics, 0, sizeof(Metrics));
 
-  Handle* my_handle = static_cast<Handle*>(handle(0));
-  int err = WebRtcAec_GetMetrics(my_handle, &my_metrics);
-  if (err != apm_->kNoError) {
-    return GetHandleError(my_handle);
+  {
+    CriticalSectionScoped metrics_scoped(*metrics_crit_);
+    AggregateMetricsLocked();
+    if (WebRtcAec_GetAggregatedMetrics(metrics_aggregator_,
+                                       &my_metrics) != 0) {
+      return apm_->kUnspecifiedError;
+    }
   }
 
   metrics->residual_echo_return_loss.instant = my_metrics.rerl.instant;
@@ -279,6 +440,39 @@ int EchoCancellationImpl::GetMetrics(Metrics* metrics) {
   return apm_->kNoError;
 }
 
+// As with GetMetrics(), the first AEC is used.
+int EchoCancellationImpl::GetDelayMetrics(DelayMetrics* metrics) {
+  CriticalSectionScoped crit_scoped(*apm_->crit());
+  if (metrics == NULL) {
+    return apm_->kNullPointerError;
+  }
+
+  if (!is_component_enabled()) {
+    return apm_->kNotEnabledError;
+  }
+
+  AecDelayMetrics my_metrics;
+  memset(&my_metrics, 0, sizeof(my_metrics));
+  memset(metrics, 0, sizeof(DelayMetrics));
+
+  Handle* my_handle = static_cast<Handle*>(handle(0));
+  int err = WebRtcAec_GetDelayMetrics(my_handle, &my_metrics);
+  if (err != apm_->kNoError) {
+    return GetHandleError(my_handle);
+  }
+
+  metrics->median_ms = my_metrics.median;
+  metrics->std_ms = my_metrics.std;
+  metrics->aligned_delay_ms = my_metrics.alignedDelay;
+  metrics->histogram_bin_ms = my_metrics.binWidth;
+  assert(kDelayHistogramSize == AEC_DELAY_HISTOGRAM_SIZE);
+  for (int i = 0; i < kDelayHistogramSize; i++) {
+    metrics->histogram[i] = static_cast<int>(my_metrics.histogram[i]);
+  }
+
+  return apm_->kNoError;
+}
+
 bool EchoCancellationImpl::stream_has_echo() const {
   return stream_has_echo_;
 }
@@ -290,6 +484,19 @@ int EchoCancellationImpl::Initialize() {
   }
 
   was_stream_drift_set_ = false;
+  ResetMetrics();
+
+  return apm_->kNoError;
+}
+
+int EchoCancellationImpl::Reinitialize() {
+  int err = ProcessingComponent::Reinitialize();
+  if (err != apm_->kNoError || !is_component_enabled()) {
+    return err;
+  }
+
+  was_stream_drift_set_ = false;
+  ResetMetrics();
 
   return apm_->kNoError;
 }
@@ -321,11 +528,36 @@ int EchoCancellationImpl::DestroyHandle(void* handle) const {
 
 int EchoCancellationImpl::InitializeHandle(void* handle) const {
   assert(handle != NULL);
+  int err = WebRtcAec_set_compact_memory(static_cast<Handle*>(handle),
+      apm_->is_compact_memory_enabled() ? max_delay_ms_ : 0);
+  if (err != apm_->kNoError) {
+    return err;
+  }
+
   return WebRtcAec_Init(static_cast<Handle*>(handle),
                        apm_->sample_rate_hz(),
                        device_sample_rate_hz_);
 }
 
+int EchoCancellationImpl::ReinitializeHandle(
+    void* handle, int previous_sample_rate_hz) const {
+  assert(handle != NULL);
+  const int sample_rate_hz = apm_->sample_rate_hz();
+  if (previous_sample_rate_hz == sample_rate_hz) {
+    return apm_->kNoError;
+  }
+
+  // 16 and 32 kHz are both cancelled at 16 kHz after the band split, so the
+  // converged filter carries over.
+  if ((previous_sample_rate_hz == 16000 || previous_sample_rate_hz == 32000) &&
+      (sample_rate_hz == 16000 || sample_rate_hz == 32000)) {
+    return WebRtcAec_ChangeSampFreq(static_cast<Handle*>(handle),
+                                    sample_rate_hz);
+  }
+
+  return InitializeHandle(handle);
+}
+
 int EchoCancellationImpl::ConfigureHandle(void* handle) const {
   assert(handle != NULL);
   AecConfig config;
@@ -333,7 +565,20 @@ int EchoCancellationImpl::ConfigureHandle(void* handle) const {
   config.nlpMode = MapSetting(suppression_level_);
   config.skewMode = drift_compensation_enabled_;
 
-  return WebRtcAec_set_config(static_cast<Handle*>(handle), config);
+  int err = WebRtcAec_set_config(static_cast<Handle*>(handle), config);
+  if (err != apm_->kNoError) {
+    return err;
+  }
+
+  err = WebRtcAec_set_dormant_mode(static_cast<Handle*>(handle),
+                                   dormant_mode_enabled_);
+  if (err != apm_->kNoError) {
+    return err;
+  }
+
+  // The metrics are aggregated by AggregateMetrics() instead.
+  return WebRtcAec_set_deferred_metrics(static_cast<Handle*>(handle),
+                                        kAecTrue);
 }
 
 int EchoCancellationImpl::num_handles_required() const {
@@ -345,4 +590,10 @@ int EchoCancellationImpl::GetHandleError(void* handle) const {
   assert(handle != NULL);
   return MapError(WebRtcAec_get_error_code(static_cast<Handle*>(handle)));
 }
+
+int EchoCancellationImpl::GetHandleMemoryUsage(void* handle) const {
+  assert(handle != NULL);
+  return static_cast<int>(
+      WebRtcAec_memory_usage_bytes(static_cast<Handle*>(handle)));
+}
 }  // namespace webrtc
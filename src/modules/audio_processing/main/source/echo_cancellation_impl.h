@@ -11,12 +11,16 @@
 #ifndef WEBRTC_MODULES_AUDIO_PROCESSING_MAIN_SOURCE_ECHO_CANCELLATION_IMPL_H_
 #define WEBRTC_MODULES_AUDIO_PROCESSING_MAIN_SOURCE_ECHO_CANCELLATION_IMPL_H_
 
+#include "atomic32_wrapper.h"
 #include "audio_processing.h"
+#include "echo_cancellation.h"
 #include "processing_component.h"
 
 namespace webrtc {
 class AudioProcessingImpl;
 class AudioBuffer;
+class CriticalSectionWrapper;
+class NoiseSuppressionImpl;
 
 class EchoCancellationImpl : public EchoCancellation,
                              public ProcessingComponent {
@@ -25,13 +29,21 @@ class EchoCancellationImpl : public EchoCancellation,
   virtual ~EchoCancellationImpl();
 
   int ProcessRenderAudio(const AudioBuffer* audio);
-  int ProcessCaptureAudio(AudioBuffer* audio);
+  // If |noise_suppression| is not NULL, it is applied to the output spectrum
+  // of each channel.
+  int ProcessCaptureAudio(AudioBuffer* audio,
+                          NoiseSuppressionImpl* noise_suppression);
+
+  // Aggregates the metrics blocks queued by ProcessCaptureAudio(). May be
+  // called concurrently with it, without holding the APM lock.
+  void AggregateMetrics();
 
   // EchoCancellation implementation.
   virtual bool is_enabled() const;
 
   // ProcessingComponent implementation.
   virtual int Initialize();
+  virtual int Reinitialize();
   virtual int get_version(char* version, int version_len_bytes) const;
 
  private:
@@ -45,27 +57,53 @@ class EchoCancellationImpl : public EchoCancellation,
   virtual int stream_drift_samples() const;
   virtual int set_suppression_level(SuppressionLevel level);
   virtual SuppressionLevel suppression_level() const;
+  virtual int enable_dormant_mode(bool enable);
+  virtual bool is_dormant_mode_enabled() const;
+  virtual int set_max_delay_ms(int delay);
+  virtual int max_delay_ms() const;
   virtual int enable_metrics(bool enable);
   virtual bool are_metrics_enabled() const;
   virtual bool stream_has_echo() const;
   virtual int GetMetrics(Metrics* metrics);
+  virtual int GetDelayMetrics(DelayMetrics* metrics);
 
   // ProcessingComponent implementation.
   virtual void* CreateHandle() const;
   virtual int InitializeHandle(void* handle) const;
+  virtual int ReinitializeHandle(void* handle,
+                                 int previous_sample_rate_hz) const;
   virtual int ConfigureHandle(void* handle) const;
   virtual int DestroyHandle(void* handle) const;
   virtual int num_handles_required() const;
   virtual int GetHandleError(void* handle) const;
+  virtual int GetHandleMemoryUsage(void* handle) const;
+
+  // The metrics queue is a single producer, single consumer ring buffer. The
+  // audio thread writes to it, and the consumer reads from it while holding
+  // |metrics_crit_|. The audio thread only drains it itself when it gets the
+  // lock without waiting.
+  enum { kMetricsQueueSize = 512 };  // Must be a power of two.
+  int QueueMetricsBlocks(void* handle);
+  int num_queued_metrics_blocks() const;
+  void AggregateMetricsLocked();
+  void ResetMetrics();
 
   const AudioProcessingImpl* apm_;
   bool drift_compensation_enabled_;
   bool metrics_enabled_;
+  bool dormant_mode_enabled_;
+  int max_delay_ms_;
   SuppressionLevel suppression_level_;
   int device_sample_rate_hz_;
   int stream_drift_samples_;
   bool was_stream_drift_set_;
   bool stream_has_echo_;
+
+  void* metrics_aggregator_;
+  CriticalSectionWrapper* metrics_crit_;
+  Atomic32Wrapper metrics_write_pos_;
+  Atomic32Wrapper metrics_read_pos_;
+  AecMetricsBlock metrics_queue_[kMetricsQueueSize];
 };
 }  // namespace webrtc
 
@@ -11,6 +11,7 @@
 #include "echo_control_mobile_impl.h"
 
 #include <cassert>
+#include <cstring>
 
 #include "critical_section_wrapper.h"
 #include "echo_control_mobile.h"
@@ -48,22 +49,33 @@ int MapError(int err) {
       return AudioProcessing::kBadParameterError;
     case AECM_BAD_PARAMETER_WARNING:
       return AudioProcessing::kBadStreamParameterWarning;
+    case AECM_NULL_POINTER_ERROR:
+      return AudioProcessing::kNullPointerError;
     default:
       // AECMOBFIX_UNSPECIFIED_ERROR
       // AECMOBFIX_UNINITIALIZED_ERROR
-      // AECMOBFIX_NULL_POINTER_ERROR
       return AudioProcessing::kUnspecifiedError;
   }
 }
 }  // namespace
 
+size_t EchoControlMobile::echo_path_size_bytes() {
+  return WebRtcAecm_echo_path_size_bytes();
+}
+
 EchoControlMobileImpl::EchoControlMobileImpl(const AudioProcessingImpl* apm)
   : ProcessingComponent(apm),
     apm_(apm),
     routing_mode_(kSpeakerphone),
-    comfort_noise_enabled_(true) {}
+    comfort_noise_enabled_(true),
+    external_echo_path_(NULL) {}
 
-EchoControlMobileImpl::~EchoControlMobileImpl() {}
+EchoControlMobileImpl::~EchoControlMobileImpl() {
+  if (external_echo_path_ != NULL) {
+    delete [] external_echo_path_;
+    external_echo_path_ = NULL;
+  }
+}
 
 int EchoControlMobileImpl::ProcessRenderAudio(const AudioBuffer* audio) {
   if (!is_component_enabled()) {
@@ -127,7 +139,9 @@ int EchoControlMobileImpl::ProcessCaptureAudio(AudioBuffer* audio) {
           my_handle,
           noisy,
           clean,
+          audio->high_pass_split_data(i),
           audio->low_pass_split_data(i),
+          audio->high_pass_split_data(i),
           static_cast<WebRtc_Word16>(audio->samples_per_split_channel()),
           apm_->stream_delay_ms());
 
@@ -181,14 +195,65 @@ bool EchoControlMobileImpl::is_comfort_noise_enabled() const {
   return comfort_noise_enabled_;
 }
 
-int EchoControlMobileImpl::Initialize() {
+int EchoControlMobileImpl::SetEchoPath(const void* echo_path,
+                                       size_t size_bytes) {
+  CriticalSectionScoped crit_scoped(*apm_->crit());
+  if (echo_path == NULL) {
+    return apm_->kNullPointerError;
+  }
+  if (size_bytes != echo_path_size_bytes()) {
+    // Size mismatch
+    return apm_->kBadParameterError;
+  }
+
+  if (external_echo_path_ == NULL) {
+    external_echo_path_ = new unsigned char[size_bytes];
+  }
+  memcpy(external_echo_path_, echo_path, size_bytes);
+
   if (!is_component_enabled()) {
+    // Applied when the handles are initialized.
     return apm_->kNoError;
   }
 
-  if (apm_->sample_rate_hz() == apm_->kSampleRate32kHz) {
-    // AECM doesn't support super-wideband.
-    return apm_->kBadSampleRateError;
+  for (int i = 0; i < num_handles(); i++) {
+    Handle* my_handle = static_cast<Handle*>(handle(i));
+    if (WebRtcAecm_InitEchoPath(my_handle,
+                                external_echo_path_,
+                                size_bytes) != 0) {
+      return GetHandleError(my_handle);
+    }
+  }
+
+  return apm_->kNoError;
+}
+
+int EchoControlMobileImpl::GetEchoPath(void* echo_path,
+                                       size_t size_bytes) const {
+  CriticalSectionScoped crit_scoped(*apm_->crit());
+  if (echo_path == NULL) {
+    return apm_->kNullPointerError;
+  }
+  if (size_bytes != echo_path_size_bytes()) {
+    // Size mismatch
+    return apm_->kBadParameterError;
+  }
+  if (!is_component_enabled()) {
+    return apm_->kNotEnabledError;
+  }
+
+  // Get the echo path from the first channel
+  Handle* my_handle = static_cast<Handle*>(handle(0));
+  if (WebRtcAecm_GetEchoPath(my_handle, echo_path, size_bytes) != 0) {
+    return GetHandleError(my_handle);
+  }
+
+  return apm_->kNoError;
+}
+
+int EchoControlMobileImpl::Initialize() {
+  if (!is_component_enabled()) {
+    return apm_->kNoError;
   }
 
   return ProcessingComponent::Initialize();
@@ -219,10 +284,19 @@ int EchoControlMobileImpl::DestroyHandle(void* handle) const {
 }
 
 int EchoControlMobileImpl::InitializeHandle(void* handle) const {
-  return WebRtcAecm_Init(static_cast<Handle*>(handle),
-                         apm_->sample_rate_hz(),
-                         48000); // Dummy value. This isn't actually
-                                 // required by AECM.
+  assert(handle != NULL);
+  Handle* my_handle = static_cast<Handle*>(handle);
+  int err = WebRtcAecm_Init(my_handle,
+                            apm_->sample_rate_hz(),
+                            48000); // Dummy value. This isn't actually
+                                    // required by AECM.
+  if (err == apm_->kNoError && external_echo_path_ != NULL) {
+    err = WebRtcAecm_InitEchoPath(my_handle,
+                                  external_echo_path_,
+                                  echo_path_size_bytes());
+  }
+
+  return err;
 }
 
 int EchoControlMobileImpl::ConfigureHandle(void* handle) const {
@@ -242,4 +316,10 @@ int EchoControlMobileImpl::GetHandleError(void* handle) const {
   assert(handle != NULL);
   return MapError(WebRtcAecm_get_error_code(static_cast<Handle*>(handle)));
 }
+
+int EchoControlMobileImpl::GetHandleMemoryUsage(void* handle) const {
+  assert(handle != NULL);
+  return static_cast<int>(
+      WebRtcAecm_memory_usage_bytes(static_cast<Handle*>(handle)));
+}
 }  // namespace webrtc
@@ -41,6 +41,8 @@ class EchoControlMobileImpl : public EchoControlMobile,
   virtual RoutingMode routing_mode() const;
   virtual int enable_comfort_noise(bool enable);
   virtual bool is_comfort_noise_enabled() const;
+  virtual int SetEchoPath(const void* echo_path, size_t size_bytes);
+  virtual int GetEchoPath(void* echo_path, size_t size_bytes) const;
 
   // ProcessingComponent implementation.
   virtual void* CreateHandle() const;
@@ -49,10 +51,12 @@ class EchoControlMobileImpl : public EchoControlMobile,
   virtual int DestroyHandle(void* handle) const;
   virtual int num_handles_required() const;
   virtual int GetHandleError(void* handle) const;
+  virtual int GetHandleMemoryUsage(void* handle) const;
 
   const AudioProcessingImpl* apm_;
   RoutingMode routing_mode_;
   bool comfort_noise_enabled_;
+  unsigned char* external_echo_path_;
 };
 }  // namespace webrtc
 
@@ -62,6 +62,7 @@ GainControlImpl::GainControlImpl(const AudioProcessingImpl* apm)
     limiter_enabled_(true),
     target_level_dbfs_(3),
     compression_gain_db_(9),
+    channels_linked_(false),
     analog_capture_level_(0),
     was_analog_level_set_(false),
     stream_is_saturated_(false) {}
@@ -102,10 +103,14 @@ int GainControlImpl::AnalyzeCaptureAudio(AudioBuffer* audio) {
   }
 
   assert(audio->samples_per_split_channel() <= 160);
-  assert(audio->num_channels() == num_handles());
+  assert(channels_linked_ || audio->num_channels() == num_handles());
 
   int err = apm_->kNoError;
 
+  if (channels_linked_) {
+    return AnalyzeLinkedCaptureAudio(audio);
+  }
+
   if (mode_ == kAdaptiveAnalog) {
     for (int i = 0; i < num_handles(); i++) {
       Handle* my_handle = static_cast<Handle*>(handle(i));
@@ -156,33 +161,40 @@ int GainControlImpl::ProcessCaptureAudio(AudioBuffer* audio) {
   }
 
   assert(audio->samples_per_split_channel() <= 160);
-  assert(audio->num_channels() == num_handles());
+  assert(channels_linked_ || audio->num_channels() == num_handles());
 
   stream_is_saturated_ = false;
-  for (int i = 0; i < num_handles(); i++) {
-    Handle* my_handle = static_cast<Handle*>(handle(i));
-    WebRtc_Word32 capture_level_out = 0;
-    WebRtc_UWord8 saturation_warning = 0;
-
-    int err = WebRtcAgc_Process(
-        my_handle,
-        audio->low_pass_split_data(i),
-        audio->high_pass_split_data(i),
-        static_cast<WebRtc_Word16>(audio->samples_per_split_channel()),
-        audio->low_pass_split_data(i),
-        audio->high_pass_split_data(i),
-        capture_levels_[i],
-        &capture_level_out,
-        apm_->echo_cancellation()->stream_has_echo(),
-        &saturation_warning);
-
+  if (channels_linked_) {
+    int err = ProcessLinkedCaptureAudio(audio);
     if (err != apm_->kNoError) {
-      return GetHandleError(my_handle);
+      return err;
     }
+  } else {
+    for (int i = 0; i < num_handles(); i++) {
+      Handle* my_handle = static_cast<Handle*>(handle(i));
+      WebRtc_Word32 capture_level_out = 0;
+      WebRtc_UWord8 saturation_warning = 0;
+
+      int err = WebRtcAgc_Process(
+          my_handle,
+          audio->low_pass_split_data(i),
+          audio->high_pass_split_data(i),
+          static_cast<WebRtc_Word16>(audio->samples_per_split_channel()),
+          audio->low_pass_split_data(i),
+          audio->high_pass_split_data(i),
+          capture_levels_[i],
+          &capture_level_out,
+          apm_->echo_cancellation()->stream_has_echo(),
+          &saturation_warning);
+
+      if (err != apm_->kNoError) {
+        return GetHandleError(my_handle);
+      }
 
-    capture_levels_[i] = capture_level_out;
-    if (saturation_warning == 1) {
-      stream_is_saturated_ = true;
+      capture_levels_[i] = capture_level_out;
+      if (saturation_warning == 1) {
+        stream_is_saturated_ = true;
+      }
     }
   }
 
@@ -200,6 +212,98 @@ int GainControlImpl::ProcessCaptureAudio(AudioBuffer* audio) {
   return apm_->kNoError;
 }
 
+int GainControlImpl::UpdateActivity(bool active) {
+  if (!is_component_enabled()) {
+    return apm_->kNoError;
+  }
+
+  for (int i = 0; i < num_handles(); i++) {
+    Handle* my_handle = static_cast<Handle*>(handle(i));
+    int err = WebRtcAgc_set_activity(my_handle, active ? 1 : 0);
+    if (err != apm_->kNoError) {
+      return GetHandleError(my_handle);
+    }
+  }
+
+  return apm_->kNoError;
+}
+
+int GainControlImpl::AnalyzeLinkedCaptureAudio(AudioBuffer* audio) {
+  assert(audio->num_channels() <= AGC_MAX_CHANNELS);
+  WebRtc_Word16* low_pass[AGC_MAX_CHANNELS];
+  WebRtc_Word16* high_pass[AGC_MAX_CHANNELS];
+  for (int i = 0; i < audio->num_channels(); i++) {
+    low_pass[i] = audio->low_pass_split_data(i);
+    high_pass[i] = audio->high_pass_split_data(i);
+  }
+
+  Handle* my_handle = static_cast<Handle*>(handle(0));
+  int err = apm_->kNoError;
+  if (mode_ == kAdaptiveAnalog) {
+    err = WebRtcAgc_AddMicLinked(
+        my_handle,
+        low_pass,
+        high_pass,
+        static_cast<WebRtc_Word16>(audio->num_channels()),
+        static_cast<WebRtc_Word16>(audio->samples_per_split_channel()));
+  } else if (mode_ == kAdaptiveDigital) {
+    WebRtc_Word32 capture_level_out = 0;
+    err = WebRtcAgc_VirtualMicLinked(
+        my_handle,
+        low_pass,
+        high_pass,
+        static_cast<WebRtc_Word16>(audio->num_channels()),
+        static_cast<WebRtc_Word16>(audio->samples_per_split_channel()),
+        analog_capture_level_,
+        &capture_level_out);
+    capture_levels_[0] = capture_level_out;
+  }
+
+  if (err != apm_->kNoError) {
+    return GetHandleError(my_handle);
+  }
+
+  return apm_->kNoError;
+}
+
+int GainControlImpl::ProcessLinkedCaptureAudio(AudioBuffer* audio) {
+  assert(audio->num_channels() <= AGC_MAX_CHANNELS);
+  WebRtc_Word16* low_pass[AGC_MAX_CHANNELS];
+  WebRtc_Word16* high_pass[AGC_MAX_CHANNELS];
+  for (int i = 0; i < audio->num_channels(); i++) {
+    low_pass[i] = audio->low_pass_split_data(i);
+    high_pass[i] = audio->high_pass_split_data(i);
+  }
+
+  Handle* my_handle = static_cast<Handle*>(handle(0));
+  WebRtc_Word32 capture_level_out = 0;
+  WebRtc_UWord8 saturation_warning = 0;
+
+  int err = WebRtcAgc_ProcessLinked(
+      my_handle,
+      low_pass,
+      high_pass,
+      static_cast<WebRtc_Word16>(audio->num_channels()),
+      static_cast<WebRtc_Word16>(audio->samples_per_split_channel()),
+      low_pass,
+      high_pass,
+      capture_levels_[0],
+      &capture_level_out,
+      apm_->echo_cancellation()->stream_has_echo(),
+      &saturation_warning);
+
+  if (err != apm_->kNoError) {
+    return GetHandleError(my_handle);
+  }
+
+  capture_levels_[0] = capture_level_out;
+  if (saturation_warning == 1) {
+    stream_is_saturated_ = true;
+  }
+
+  return apm_->kNoError;
+}
+
 // TODO(ajm): ensure this is called under kAdaptiveAnalog.
 int GainControlImpl::set_stream_analog_level(int level) {
   was_analog_level_set_ = true;
@@ -319,6 +423,21 @@ bool GainControlImpl::is_limiter_enabled() const {
   return limiter_enabled_;
 }
 
+int GainControlImpl::enable_channel_linking(bool enable) {
+  CriticalSectionScoped crit_scoped(*apm_->crit());
+  if (enable == channels_linked_) {
+    // Keeps the adapted state.
+    return apm_->kNoError;
+  }
+
+  channels_linked_ = enable;
+  return Initialize();
+}
+
+bool GainControlImpl::is_channel_linking_enabled() const {
+  return channels_linked_;
+}
+
 int GainControlImpl::Initialize() {
   int err = ProcessingComponent::Initialize();
   if (err != apm_->kNoError || !is_component_enabled()) {
@@ -333,6 +452,18 @@ int GainControlImpl::Initialize() {
   return apm_->kNoError;
 }
 
+int GainControlImpl::Reinitialize() {
+  int err = ProcessingComponent::Reinitialize();
+  if (err != apm_->kNoError || !is_component_enabled()) {
+    return err;
+  }
+
+  // Channels which are still in use keep their analog level.
+  capture_levels_.resize(num_handles(), analog_capture_level_);
+
+  return apm_->kNoError;
+}
+
 int GainControlImpl::get_version(char* version, int version_len_bytes) const {
   if (WebRtcAgc_Version(version, version_len_bytes) != 0) {
       return apm_->kBadParameterError;
@@ -379,6 +510,10 @@ int GainControlImpl::ConfigureHandle(void* handle) const {
 }
 
 int GainControlImpl::num_handles_required() const {
+  if (channels_linked_) {
+    // One handle serves all channels.
+    return 1;
+  }
   return apm_->num_output_channels();
 }
 
@@ -388,4 +523,10 @@ int GainControlImpl::GetHandleError(void* handle) const {
   assert(handle != NULL);
   return apm_->kUnspecifiedError;
 }
+
+int GainControlImpl::GetHandleMemoryUsage(void* handle) const {
+  assert(handle != NULL);
+  return static_cast<int>(
+      WebRtcAgc_memory_usage_bytes(static_cast<Handle*>(handle)));
+}
 }  // namespace webrtc
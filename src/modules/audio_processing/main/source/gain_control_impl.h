@@ -29,9 +29,13 @@ class GainControlImpl : public GainControl,
   int ProcessRenderAudio(AudioBuffer* audio);
   int AnalyzeCaptureAudio(AudioBuffer* audio);
   int ProcessCaptureAudio(AudioBuffer* audio);
+  // Passes the near-end activity on to the handles, which hold their gains
+  // and envelopes while it is false.
+  int UpdateActivity(bool active);
 
   // ProcessingComponent implementation.
   virtual int Initialize();
+  virtual int Reinitialize();
   virtual int get_version(char* version, int version_len_bytes) const;
 
   // GainControl implementation.
@@ -50,11 +54,16 @@ class GainControlImpl : public GainControl,
   virtual int compression_gain_db() const;
   virtual int enable_limiter(bool enable);
   virtual bool is_limiter_enabled() const;
+  virtual int enable_channel_linking(bool enable);
+  virtual bool is_channel_linking_enabled() const;
   virtual int set_analog_level_limits(int minimum, int maximum);
   virtual int analog_level_minimum() const;
   virtual int analog_level_maximum() const;
   virtual bool stream_is_saturated() const;
 
+  int AnalyzeLinkedCaptureAudio(AudioBuffer* audio);
+  int ProcessLinkedCaptureAudio(AudioBuffer* audio);
+
   // ProcessingComponent implementation.
   virtual void* CreateHandle() const;
   virtual int InitializeHandle(void* handle) const;
@@ -62,6 +71,7 @@ class GainControlImpl : public GainControl,
   virtual int DestroyHandle(void* handle) const;
   virtual int num_handles_required() const;
   virtual int GetHandleError(void* handle) const;
+  virtual int GetHandleMemoryUsage(void* handle) const;
 
   const AudioProcessingImpl* apm_;
   Mode mode_;
@@ -70,6 +80,7 @@ class GainControlImpl : public GainControl,
   bool limiter_enabled_;
   int target_level_dbfs_;
   int compression_gain_db_;
+  bool channels_linked_;
   std::vector<int> capture_levels_;
   int analog_capture_level_;
   bool was_analog_level_set_;
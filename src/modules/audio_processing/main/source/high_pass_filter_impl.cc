@@ -18,6 +18,7 @@
 
 #include "audio_processing_impl.h"
 #include "audio_buffer.h"
+#include "splitting_filter.h"
 
 namespace webrtc {
 namespace {
@@ -27,9 +28,10 @@ const WebRtc_Word16 kFilterCoefficients8kHz[5] =
 const WebRtc_Word16 kFilterCoefficients[5] =
     {4012, -8024, 4012, 8002, -3913};
 
+// A single biquad section; see WebRtcSpl_BiquadFilterQ12() for the layout of
+// the coefficients and state.
 struct FilterState {
-  WebRtc_Word16 y[4];
-  WebRtc_Word16 x[2];
+  WebRtc_Word16 state[6];
   const WebRtc_Word16* ba;
 };
 
@@ -42,8 +44,7 @@ int InitializeFilter(FilterState* hpf, int sample_rate_hz) {
     hpf->ba = kFilterCoefficients;
   }
 
-  WebRtcSpl_MemSetW16(hpf->x, 0, 2);
-  WebRtcSpl_MemSetW16(hpf->y, 0, 4);
+  WebRtcSpl_MemSetW16(hpf->state, 0, 6);
 
   return AudioProcessing::kNoError;
 }
@@ -51,53 +52,7 @@ int InitializeFilter(FilterState* hpf, int sample_rate_hz) {
 int Filter(FilterState* hpf, WebRtc_Word16* data, int length) {
   assert(hpf != NULL);
 
-  WebRtc_Word32 tmp_int32 = 0;
-  WebRtc_Word16* y = hpf->y;
-  WebRtc_Word16* x = hpf->x;
-  const WebRtc_Word16* ba = hpf->ba;
-
-  for (int i = 0; i < length; i++) {
-    //  y[i] = b[0] * x[i] + b[1] * x[i-1] + b[2] * x[i-2]
-    //         + -a[1] * y[i-1] + -a[2] * y[i-2];
-
-    tmp_int32 =
-        WEBRTC_SPL_MUL_16_16(y[1], ba[3]); // -a[1] * y[i-1] (low part)
-    tmp_int32 +=
-        WEBRTC_SPL_MUL_16_16(y[3], ba[4]); // -a[2] * y[i-2] (low part)
-    tmp_int32 = (tmp_int32 >> 15);
-    tmp_int32 +=
-        WEBRTC_SPL_MUL_16_16(y[0], ba[3]); // -a[1] * y[i-1] (high part)
-    tmp_int32 +=
-        WEBRTC_SPL_MUL_16_16(y[2], ba[4]); // -a[2] * y[i-2] (high part)
-    tmp_int32 = (tmp_int32 << 1);
-
-    tmp_int32 += WEBRTC_SPL_MUL_16_16(data[i], ba[0]); // b[0]*x[0]
-    tmp_int32 += WEBRTC_SPL_MUL_16_16(x[0], ba[1]);    // b[1]*x[i-1]
-    tmp_int32 += WEBRTC_SPL_MUL_16_16(x[1], ba[2]);    // b[2]*x[i-2]
-
-    // Update state (input part)
-    x[1] = x[0];
-    x[0] = data[i];
-
-    // Update state (filtered part)
-    y[2] = y[0];
-    y[3] = y[1];
-    y[0] = static_cast<WebRtc_Word16>(tmp_int32 >> 13);
-    y[1] = static_cast<WebRtc_Word16>((tmp_int32 -
-        WEBRTC_SPL_LSHIFT_W32(static_cast<WebRtc_Word32>(y[0]), 13)) << 2);
-
-    // Rounding in Q12, i.e. add 2^11
-    tmp_int32 += 2048;
-
-    // Saturate (to 2^27) so that the HP filtered signal does not overflow
-    tmp_int32 = WEBRTC_SPL_SAT(static_cast<WebRtc_Word32>(134217727),
-                               tmp_int32,
-                               static_cast<WebRtc_Word32>(-134217728));
-
-    // Convert back to Q0 and use rounding
-    data[i] = (WebRtc_Word16)WEBRTC_SPL_RSHIFT_W32(tmp_int32, 12);
-
-  }
+  WebRtcSpl_BiquadFilterQ12(data, data, length, hpf->ba, 1, hpf->state);
 
   return AudioProcessing::kNoError;
 }
@@ -134,6 +89,24 @@ int HighPassFilterImpl::ProcessCaptureAudio(AudioBuffer* audio) {
   return apm_->kNoError;
 }
 
+int HighPassFilterImpl::SplitAndProcessCaptureAudio(AudioBuffer* audio) {
+  assert(is_component_enabled());
+  assert(apm_->sample_rate_hz() == apm_->kSampleRate32kHz);
+
+  for (int i = 0; i < num_handles(); i++) {
+    Handle* my_handle = static_cast<Handle*>(handle(i));
+    SplittingFilterAnalysis(audio->data(i),
+                            audio->low_pass_split_data(i),
+                            audio->high_pass_split_data(i),
+                            audio->analysis_filter_state1(i),
+                            audio->analysis_filter_state2(i),
+                            my_handle->ba,
+                            my_handle->state);
+  }
+
+  return apm_->kNoError;
+}
+
 int HighPassFilterImpl::Enable(bool enable) {
   CriticalSectionScoped crit_scoped(*apm_->crit());
   return EnableComponent(enable);
@@ -177,4 +150,9 @@ int HighPassFilterImpl::GetHandleError(void* handle) const {
   assert(handle != NULL);
   return apm_->kUnspecifiedError;
 }
+
+int HighPassFilterImpl::GetHandleMemoryUsage(void* handle) const {
+  assert(handle != NULL);
+  return sizeof(Handle);
+}
 }  // namespace webrtc
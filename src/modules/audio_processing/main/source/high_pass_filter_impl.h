@@ -25,6 +25,9 @@ class HighPassFilterImpl : public HighPassFilter,
   virtual ~HighPassFilterImpl();
 
   int ProcessCaptureAudio(AudioBuffer* audio);
+  // Splits the 32 kHz capture bands, filtering the low band in the same pass.
+  // Replaces the band split and ProcessCaptureAudio().
+  int SplitAndProcessCaptureAudio(AudioBuffer* audio);
 
   // HighPassFilter implementation.
   virtual bool is_enabled() const;
@@ -43,6 +46,7 @@ class HighPassFilterImpl : public HighPassFilter,
   virtual int DestroyHandle(void* handle) const;
   virtual int num_handles_required() const;
   virtual int GetHandleError(void* handle) const;
+  virtual int GetHandleMemoryUsage(void* handle) const;
 
   const AudioProcessingImpl* apm_;
 };
@@ -179,4 +179,9 @@ int LevelEstimatorImpl::GetHandleError(void* handle) const {
   assert(handle != NULL);
   return apm_->kUnspecifiedError;
 }
+
+int LevelEstimatorImpl::GetHandleMemoryUsage(void* /*handle*/) const {
+  // The component allocates no handles.
+  return 0;
+}
 }  // namespace webrtc
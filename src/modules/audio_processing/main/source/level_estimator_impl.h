@@ -45,6 +45,7 @@ class LevelEstimatorImpl : public LevelEstimator,
   virtual int DestroyHandle(void* handle) const;
   virtual int num_handles_required() const;
   virtual int GetHandleError(void* handle) const;
+  virtual int GetHandleMemoryUsage(void* handle) const;
 
   const AudioProcessingImpl* apm_;
 };
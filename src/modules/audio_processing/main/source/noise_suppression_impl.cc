@@ -45,19 +45,26 @@ int MapSetting(NoiseSuppression::Level level) {
       return -1;
   }
 }
+
+// Number of frequency bins in the spectrum of the AEC (128-point FFT).
+const int kAecSpectrumLength = 65;
 }  // namespace
 
 NoiseSuppressionImpl::NoiseSuppressionImpl(const AudioProcessingImpl* apm)
   : ProcessingComponent(apm),
     apm_(apm),
-    level_(kModerate) {}
+    level_(kModerate),
+    fusion_enabled_(false),
+    fused_(false),
+    low_delay_enabled_(false) {}
 
 NoiseSuppressionImpl::~NoiseSuppressionImpl() {}
 
 int NoiseSuppressionImpl::ProcessCaptureAudio(AudioBuffer* audio) {
   int err = apm_->kNoError;
 
-  if (!is_component_enabled()) {
+  if (!is_component_enabled() || fused_) {
+    // When fused, the suppression has already been applied by the AEC.
     return apm_->kNoError;
   }
   assert(audio->samples_per_split_channel() <= 160);
@@ -66,11 +73,20 @@ int NoiseSuppressionImpl::ProcessCaptureAudio(AudioBuffer* audio) {
   for (int i = 0; i < num_handles(); i++) {
     Handle* my_handle = static_cast<Handle*>(handle(i));
 #if defined(WEBRTC_NS_FLOAT)
-    err = WebRtcNs_Process(static_cast<Handle*>(handle(i)),
-                           audio->low_pass_split_data(i),
-                           audio->high_pass_split_data(i),
-                           audio->low_pass_split_data(i),
-                           audio->high_pass_split_data(i));
+    if (audio->float_current()) {
+      // Float input which no earlier stage has rounded, with no band split.
+      err = WebRtcNs_ProcessFloat(static_cast<Handle*>(handle(i)),
+                                  audio->float_data(i),
+                                  NULL,
+                                  audio->float_data(i),
+                                  NULL);
+    } else {
+      err = WebRtcNs_Process(static_cast<Handle*>(handle(i)),
+                             audio->low_pass_split_data(i),
+                             audio->high_pass_split_data(i),
+                             audio->low_pass_split_data(i),
+                             audio->high_pass_split_data(i));
+    }
 #elif defined(WEBRTC_NS_FIXED)
     err = WebRtcNsx_Process(static_cast<Handle*>(handle(i)),
                             audio->low_pass_split_data(i),
@@ -110,6 +126,95 @@ NoiseSuppression::Level NoiseSuppressionImpl::level() const {
   return level_;
 }
 
+int NoiseSuppressionImpl::enable_echo_cancellation_fusion(bool enable) {
+  CriticalSectionScoped crit_scoped(*apm_->crit());
+#if defined(WEBRTC_NS_FIXED)
+  if (enable) {
+    return apm_->kUnsupportedFunctionError;
+  }
+#endif
+
+  fusion_enabled_ = enable;
+  return apm_->kNoError;
+}
+
+bool NoiseSuppressionImpl::is_echo_cancellation_fusion_enabled() const {
+  return fusion_enabled_;
+}
+
+int NoiseSuppressionImpl::enable_low_delay(bool enable) {
+  CriticalSectionScoped crit_scoped(*apm_->crit());
+  if (enable == low_delay_enabled_) {
+    return apm_->kNoError;
+  }
+
+  // The handles are initialized differently for the two modes.
+  low_delay_enabled_ = enable;
+  return Initialize();
+}
+
+bool NoiseSuppressionImpl::is_low_delay_enabled() const {
+  return low_delay_enabled_;
+}
+
+int NoiseSuppressionImpl::UpdateFusion(bool echo_cancellation_enabled) {
+  const bool fused = is_component_enabled() && fusion_enabled_ &&
+                     echo_cancellation_enabled;
+  if (fused == fused_) {
+    return apm_->kNoError;
+  }
+
+  // The handles are initialized differently for the two modes.
+  fused_ = fused;
+  return Initialize();
+}
+
+int NoiseSuppressionImpl::UpdateActivity(bool active) {
+  if (!is_component_enabled()) {
+    return apm_->kNoError;
+  }
+
+  for (int i = 0; i < num_handles(); i++) {
+    Handle* my_handle = static_cast<Handle*>(handle(i));
+#if defined(WEBRTC_NS_FLOAT)
+    int err = WebRtcNs_set_activity(my_handle, active ? 1 : 0);
+#elif defined(WEBRTC_NS_FIXED)
+    int err = WebRtcNsx_set_activity(my_handle, active ? 1 : 0);
+#endif
+
+    if (err != apm_->kNoError) {
+      return GetHandleError(my_handle);
+    }
+  }
+
+  return apm_->kNoError;
+}
+
+bool NoiseSuppressionImpl::is_fused() const {
+  return fused_;
+}
+
+void* NoiseSuppressionImpl::fused_handle(int channel) const {
+  assert(fused_);
+  return handle(channel);
+}
+
+int NoiseSuppressionImpl::FilterSpectrum(void* handle,
+                                         float* real,
+                                         float* imag,
+                                         int length,
+                                         float* gain_high_band) {
+#if defined(WEBRTC_NS_FLOAT)
+  return WebRtcNs_ProcessSpectrum(static_cast<Handle*>(handle),
+                                  real,
+                                  imag,
+                                  length,
+                                  gain_high_band);
+#elif defined(WEBRTC_NS_FIXED)
+  return -1;
+#endif
+}
+
 int NoiseSuppressionImpl::get_version(char* version,
                                       int version_len_bytes) const {
 #if defined(WEBRTC_NS_FLOAT)
@@ -150,12 +255,49 @@ int NoiseSuppressionImpl::DestroyHandle(void* handle) const {
 
 int NoiseSuppressionImpl::InitializeHandle(void* handle) const {
 #if defined(WEBRTC_NS_FLOAT)
+  if (fused_) {
+    return WebRtcNs_InitSpectrum(static_cast<Handle*>(handle),
+                                 apm_->sample_rate_hz(),
+                                 kAecSpectrumLength);
+  }
+  if (low_delay_enabled_) {
+    return WebRtcNs_InitLowDelay(static_cast<Handle*>(handle),
+                                 apm_->sample_rate_hz());
+  }
   return WebRtcNs_Init(static_cast<Handle*>(handle), apm_->sample_rate_hz());
 #elif defined(WEBRTC_NS_FIXED)
+  // The fixed-point suppressor has no shorter analysis at 8 kHz.
+  if (low_delay_enabled_ && apm_->sample_rate_hz() != apm_->kSampleRate8kHz) {
+    return WebRtcNsx_InitLowDelay(static_cast<Handle*>(handle),
+                                  apm_->sample_rate_hz());
+  }
   return WebRtcNsx_Init(static_cast<Handle*>(handle), apm_->sample_rate_hz());
 #endif
 }
 
+int NoiseSuppressionImpl::ReinitializeHandle(
+    void* handle, int previous_sample_rate_hz) const {
+  const int sample_rate_hz = apm_->sample_rate_hz();
+  if (previous_sample_rate_hz == sample_rate_hz) {
+    return apm_->kNoError;
+  }
+
+  // The noise estimate is made on the low band, which is the same at 16 and
+  // 32 kHz.
+  if ((previous_sample_rate_hz == 16000 || previous_sample_rate_hz == 32000) &&
+      (sample_rate_hz == 16000 || sample_rate_hz == 32000)) {
+#if defined(WEBRTC_NS_FLOAT)
+    return WebRtcNs_ChangeSampFreq(static_cast<Handle*>(handle),
+                                   sample_rate_hz);
+#elif defined(WEBRTC_NS_FIXED)
+    return WebRtcNsx_ChangeSampFreq(static_cast<Handle*>(handle),
+                                    sample_rate_hz);
+#endif
+  }
+
+  return InitializeHandle(handle);
+}
+
 int NoiseSuppressionImpl::ConfigureHandle(void* handle) const {
 #if defined(WEBRTC_NS_FLOAT)
   return WebRtcNs_set_policy(static_cast<Handle*>(handle),
@@ -175,5 +317,16 @@ int NoiseSuppressionImpl::GetHandleError(void* handle) const {
   assert(handle != NULL);
   return apm_->kUnspecifiedError;
 }
+
+int NoiseSuppressionImpl::GetHandleMemoryUsage(void* handle) const {
+  assert(handle != NULL);
+#if defined(WEBRTC_NS_FLOAT)
+  return static_cast<int>(
+      WebRtcNs_memory_usage_bytes(static_cast<Handle*>(handle)));
+#elif defined(WEBRTC_NS_FIXED)
+  return static_cast<int>(
+      WebRtcNsx_memory_usage_bytes(static_cast<Handle*>(handle)));
+#endif
+}
 }  // namespace webrtc
 
@@ -26,6 +26,26 @@ class NoiseSuppressionImpl : public NoiseSuppression,
 
   int ProcessCaptureAudio(AudioBuffer* audio);
 
+  // Switches between processing in ProcessCaptureAudio() and processing the
+  // spectrum of the AEC, depending on whether the latter is enabled. Must be
+  // called before the AEC processes the capture audio.
+  int UpdateFusion(bool echo_cancellation_enabled);
+  // Passes the near-end activity on to the handles, which hold their models
+  // and reuse their latest gains while it is false. Must be called before the
+  // AEC processes the capture audio.
+  int UpdateActivity(bool active);
+  // True when the suppression is applied by the AEC through FilterSpectrum().
+  bool is_fused() const;
+  // The handle to pass to FilterSpectrum() for |channel|.
+  void* fused_handle(int channel) const;
+
+  // Suppresses noise in the AEC output spectrum, see AecSpectrumFilter.
+  static int FilterSpectrum(void* handle,
+                            float* real,
+                            float* imag,
+                            int length,
+                            float* gain_high_band);
+
   // NoiseSuppression implementation.
   virtual bool is_enabled() const;
 
@@ -37,17 +57,27 @@ class NoiseSuppressionImpl : public NoiseSuppression,
   virtual int Enable(bool enable);
   virtual int set_level(Level level);
   virtual Level level() const;
+  virtual int enable_echo_cancellation_fusion(bool enable);
+  virtual bool is_echo_cancellation_fusion_enabled() const;
+  virtual int enable_low_delay(bool enable);
+  virtual bool is_low_delay_enabled() const;
 
   // ProcessingComponent implementation.
   virtual void* CreateHandle() const;
   virtual int InitializeHandle(void* handle) const;
+  virtual int ReinitializeHandle(void* handle,
+                                 int previous_sample_rate_hz) const;
   virtual int ConfigureHandle(void* handle) const;
   virtual int DestroyHandle(void* handle) const;
   virtual int num_handles_required() const;
   virtual int GetHandleError(void* handle) const;
+  virtual int GetHandleMemoryUsage(void* handle) const;
 
   const AudioProcessingImpl* apm_;
   Level level_;
+  bool fusion_enabled_;
+  bool fused_;
+  bool low_delay_enabled_;
 };
 }  // namespace webrtc
 
@@ -20,7 +20,8 @@ ProcessingComponent::ProcessingComponent(const AudioProcessingImpl* apm)
   : apm_(apm),
     initialized_(false),
     enabled_(false),
-    num_handles_(0) {}
+    num_handles_(0),
+    sample_rate_hz_(0) {}
 
 ProcessingComponent::~ProcessingComponent() {
   assert(initialized_ == false);
@@ -47,6 +48,9 @@ int ProcessingComponent::EnableComponent(bool enable) {
     }
   } else {
     enabled_ = enable;
+    if (!enabled_ && apm_->is_compact_memory_enabled()) {
+      ReleaseUnusedHandles();
+    }
   }
 
   return apm_->kNoError;
@@ -90,10 +94,68 @@ int ProcessingComponent::Initialize() {
     }
   }
 
+  sample_rate_hz_ = apm_->sample_rate_hz();
   initialized_ = true;
+  if (apm_->is_compact_memory_enabled()) {
+    ReleaseUnusedHandles();
+  }
+
   return Configure();
 }
 
+int ProcessingComponent::Reinitialize() {
+  if (!enabled_ || !initialized_) {
+    return Initialize();
+  }
+
+  const int num_previous_handles = num_handles_;
+  const int previous_sample_rate_hz = sample_rate_hz_;
+  num_handles_ = num_handles_required();
+  if (num_handles_ > static_cast<int>(handles_.size())) {
+    handles_.resize(num_handles_, NULL);
+  }
+
+  assert(static_cast<int>(handles_.size()) >= num_handles_);
+  for (int i = 0; i < num_handles_; i++) {
+    if (handles_[i] == NULL) {
+      handles_[i] = CreateHandle();
+      if (handles_[i] == NULL) {
+        return apm_->kCreationFailedError;
+      }
+    }
+
+    // Handles beyond the previous count may be left over from an earlier
+    // configuration, so their state can't be trusted.
+    int err = apm_->kNoError;
+    if (i < num_previous_handles) {
+      err = ReinitializeHandle(handles_[i], previous_sample_rate_hz);
+    } else {
+      err = InitializeHandle(handles_[i]);
+    }
+
+    if (err != apm_->kNoError) {
+      initialized_ = false;
+      return GetHandleError(handles_[i]);
+    }
+  }
+
+  sample_rate_hz_ = apm_->sample_rate_hz();
+  if (apm_->is_compact_memory_enabled()) {
+    ReleaseUnusedHandles();
+  }
+
+  return Configure();
+}
+
+int ProcessingComponent::ReinitializeHandle(
+    void* handle, int previous_sample_rate_hz) const {
+  if (previous_sample_rate_hz == apm_->sample_rate_hz()) {
+    return apm_->kNoError;
+  }
+
+  return InitializeHandle(handle);
+}
+
 int ProcessingComponent::Configure() {
   if (!initialized_) {
     return apm_->kNoError;
@@ -109,4 +171,29 @@ int ProcessingComponent::Configure() {
 
   return apm_->kNoError;
 }
+
+int ProcessingComponent::memory_usage_bytes() const {
+  int bytes = 0;
+  for (size_t i = 0; i < handles_.size(); i++) {
+    if (handles_[i] != NULL) {
+      bytes += GetHandleMemoryUsage(handles_[i]);
+    }
+  }
+
+  return bytes;
+}
+
+void ProcessingComponent::ReleaseUnusedHandles() {
+  if (!enabled_) {
+    num_handles_ = 0;
+    initialized_ = false;
+  }
+
+  while (static_cast<int>(handles_.size()) > num_handles_) {
+    if (handles_.back() != NULL) {
+      DestroyHandle(handles_.back());
+    }
+    handles_.pop_back();
+  }
+}
 }  // namespace webrtc
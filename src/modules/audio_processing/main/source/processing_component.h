@@ -34,9 +34,19 @@ class ProcessingComponent {
   virtual ~ProcessingComponent();
 
   virtual int Initialize();
+  // As Initialize(), but after a change of stream parameters. Handles which
+  // stay in use keep their adapted state as far as ReinitializeHandle()
+  // allows, and only new handles are initialized from scratch.
+  virtual int Reinitialize();
   virtual int Destroy();
   virtual int get_version(char* version, int version_len_bytes) const = 0;
 
+  // Heap memory held by the allocated handles, in bytes.
+  int memory_usage_bytes() const;
+  // Frees the handles which are not in use, i.e. all of them while the
+  // component is disabled. Done automatically in compact memory mode.
+  void ReleaseUnusedHandles();
+
  protected:
   virtual int Configure();
   int EnableComponent(bool enable);
@@ -47,16 +57,23 @@ class ProcessingComponent {
  private:
   virtual void* CreateHandle() const = 0;
   virtual int InitializeHandle(void* handle) const = 0;
+  // Called on handles kept by Reinitialize(), which were last initialized at
+  // |previous_sample_rate_hz|. The default keeps the handle as it is if the
+  // rate is unchanged, and initializes it otherwise.
+  virtual int ReinitializeHandle(void* handle,
+                                 int previous_sample_rate_hz) const;
   virtual int ConfigureHandle(void* handle) const = 0;
   virtual int DestroyHandle(void* handle) const = 0;
   virtual int num_handles_required() const = 0;
   virtual int GetHandleError(void* handle) const = 0;
+  virtual int GetHandleMemoryUsage(void* handle) const = 0;
 
   const AudioProcessingImpl* apm_;
   std::vector<void*> handles_;
   bool initialized_;
   bool enabled_;
   int num_handles_;
+  int sample_rate_hz_;
 };
 }  // namespace webrtc
 
@@ -22,6 +22,18 @@ void SplittingFilterAnalysis(const WebRtc_Word16* in_data,
     WebRtcSpl_AnalysisQMF(in_data, low_band, high_band, filter_state1, filter_state2);
 }
 
+void SplittingFilterAnalysis(const WebRtc_Word16* in_data,
+                             WebRtc_Word16* low_band,
+                             WebRtc_Word16* high_band,
+                             WebRtc_Word32* filter_state1,
+                             WebRtc_Word32* filter_state2,
+                             const WebRtc_Word16* biquad_coefficients,
+                             WebRtc_Word16* biquad_state)
+{
+    WebRtcSpl_AnalysisQMFBiquadQ12(in_data, low_band, high_band, filter_state1,
+                                   filter_state2, biquad_coefficients, biquad_state);
+}
+
 void SplittingFilterSynthesis(const WebRtc_Word16* low_band,
                               const WebRtc_Word16* high_band,
                               WebRtc_Word16* out_data,
@@ -37,6 +37,19 @@ void SplittingFilterAnalysis(const WebRtc_Word16* in_data,
                              WebRtc_Word32* filt_state1,
                              WebRtc_Word32* filt_state2);
 
+/*
+ * As above, but also filters the low band through the biquad section given
+ * by |biquad_coefficients| and |biquad_state| in the same pass. See
+ * WebRtcSpl_BiquadFilterQ12() for their format.
+ */
+void SplittingFilterAnalysis(const WebRtc_Word16* in_data,
+                             WebRtc_Word16* low_band,
+                             WebRtc_Word16* high_band,
+                             WebRtc_Word32* filt_state1,
+                             WebRtc_Word32* filt_state2,
+                             const WebRtc_Word16* biquad_coefficients,
+                             WebRtc_Word16* biquad_state);
+
 /*
  * SplittingFilterbank_synthesisQMF(...)
  *
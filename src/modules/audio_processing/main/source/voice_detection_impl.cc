@@ -157,6 +157,17 @@ int VoiceDetectionImpl::Initialize() {
   return apm_->kNoError;
 }
 
+int VoiceDetectionImpl::Reinitialize() {
+  int err = ProcessingComponent::Reinitialize();
+  if (err != apm_->kNoError || !is_component_enabled()) {
+    return err;
+  }
+
+  frame_size_samples_ = frame_size_ms_ * (apm_->split_sample_rate_hz() / 1000);
+
+  return apm_->kNoError;
+}
+
 int VoiceDetectionImpl::get_version(char* version,
                                     int version_len_bytes) const {
   if (WebRtcVad_get_version(version, version_len_bytes) != 0) {
@@ -199,4 +210,13 @@ int VoiceDetectionImpl::GetHandleError(void* handle) const {
   assert(handle != NULL);
   return apm_->kUnspecifiedError;
 }
+
+int VoiceDetectionImpl::GetHandleMemoryUsage(void* handle) const {
+  assert(handle != NULL);
+  int size_in_bytes = 0;
+  if (WebRtcVad_AssignSize(&size_in_bytes) != apm_->kNoError) {
+    return 0;
+  }
+  return size_in_bytes;
+}
 }  // namespace webrtc
@@ -31,6 +31,7 @@ class VoiceDetectionImpl : public VoiceDetection,
 
   // ProcessingComponent implementation.
   virtual int Initialize();
+  virtual int Reinitialize();
   virtual int get_version(char* version, int version_len_bytes) const;
 
  private:
@@ -50,6 +51,7 @@ class VoiceDetectionImpl : public VoiceDetection,
   virtual int DestroyHandle(void* handle) const;
   virtual int num_handles_required() const;
   virtual int GetHandleError(void* handle) const;
+  virtual int GetHandleMemoryUsage(void* handle) const;
 
   const AudioProcessingImpl* apm_;
   bool stream_has_voice_;
@@ -0,0 +1,481 @@
+/*
+ *  Copyright (c) 2011 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+// Simulates N concurrent calls, each with its own AudioProcessing instance,
+// fed in real-time cadence by a pool of worker threads. Every 10 ms a new
+// frame becomes available on each stream and must be processed before the
+// next one arrives.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "module_common_types.h"
+
+#include "audio_processing.h"
+
+#include "cpu_wrapper.h"
+#include "event_wrapper.h"
+#include "thread_wrapper.h"
+#include "tick_util.h"
+
+using webrtc::AudioFrame;
+using webrtc::AudioProcessing;
+using webrtc::CpuWrapper;
+using webrtc::EventWrapper;
+using webrtc::GainControl;
+using webrtc::ThreadWrapper;
+using webrtc::TickTime;
+
+namespace {
+const int kFrameMs = 10;
+const double kPi = 3.14159265358979323846;
+
+void usage() {
+  printf(
+  "Usage: load_test [options] [-ir REVERSE_FILE] [-i PRIMARY_FILE]\n");
+  printf(
+  "  Runs N AudioProcessing instances in real-time cadence across a pool of\n"
+  "  threads, and reports the rate of frames missing their 10 ms deadline and\n"
+  "  the ProcessStream latency.\n");
+  printf(
+  "  Mono 16-bit PCM files given with -ir and -i are looped; otherwise\n"
+  "  synthetic audio is used.\n");
+  printf("\n");
+  printf("Options\n");
+  printf("  -n STREAMS      Number of streams (default: 1).\n");
+  printf("  -t SECONDS      Duration of each run (default: 10).\n");
+  printf("  -fs SAMPLE_RATE_HZ\n");
+  printf("  --threads N     Worker threads (default: one per core).\n");
+  printf("  -aec  -aecm  -agc  -hpf  -ns  -vad\n");
+  printf("                  Components to enable on each stream.\n");
+  printf("  --sweep         Search for the largest number of streams for\n");
+  printf("                  which the miss rate stays within the limit.\n");
+  printf("  --max_miss_rate PERCENT\n");
+  printf("                  Limit used by --sweep (default: 0.1).\n");
+}
+
+struct Config {
+  Config()
+      : sample_rate_hz(16000),
+        num_threads(1),
+        duration_s(10),
+        aec(false),
+        aecm(false),
+        agc(false),
+        hpf(false),
+        ns(false),
+        vad(false) {}
+
+  int sample_rate_hz;
+  int num_threads;
+  int duration_s;
+  bool aec;
+  bool aecm;
+  bool agc;
+  bool hpf;
+  bool ns;
+  bool vad;
+  // Looped input, shared by all streams at different offsets.
+  std::vector<WebRtc_Word16> far_audio;
+  std::vector<WebRtc_Word16> near_audio;
+};
+
+struct Stream {
+  AudioProcessing* apm;
+  int position;
+  int capture_level;
+};
+
+struct Worker {
+  const Config* config;
+  std::vector<Stream> streams;
+  TickTime start;
+  int num_periods;
+
+  // Results.
+  std::vector<WebRtc_Word64> latencies_us;
+  int num_missed;
+  bool failed;
+};
+
+struct Report {
+  int num_streams;
+  int num_frames;
+  int num_missed;
+  double miss_rate;
+  double load;
+  WebRtc_Word64 p50_us;
+  WebRtc_Word64 p99_us;
+  WebRtc_Word64 p999_us;
+  WebRtc_Word64 max_us;
+  bool failed;
+};
+
+// Nearest-rank percentile of sorted |values|, in tenths of a percent.
+WebRtc_Word64 Percentile(const std::vector<WebRtc_Word64>& values,
+                         int permille) {
+  if (values.empty()) {
+    return 0;
+  }
+  size_t rank = (values.size() * permille + 999) / 1000;
+  return values[std::max<size_t>(rank, 1) - 1];
+}
+
+// Speech-like far-end: noise with a syllabic envelope. The near-end holds an
+// attenuated, delayed echo of it plus background noise.
+void GenerateAudio(int sample_rate_hz, Config* config) {
+  const int length = sample_rate_hz * 4;
+  const int echo_delay = sample_rate_hz / 50;
+  config->far_audio.resize(length);
+  config->near_audio.resize(length);
+  srand(0);
+  for (int i = 0; i < length; i++) {
+    double envelope = 0.5 + 0.5 * sin(2 * kPi * 4 * i / sample_rate_hz);
+    double noise = (rand() / static_cast<double>(RAND_MAX)) - 0.5;
+    config->far_audio[i] = static_cast<WebRtc_Word16>(
+        16000 * envelope * noise);
+  }
+  for (int i = 0; i < length; i++) {
+    double noise = (rand() / static_cast<double>(RAND_MAX)) - 0.5;
+    int echo = i >= echo_delay ? config->far_audio[i - echo_delay] / 4 : 0;
+    config->near_audio[i] = static_cast<WebRtc_Word16>(echo + 200 * noise);
+  }
+}
+
+void ReadAudio(const char* filename, std::vector<WebRtc_Word16>* audio) {
+  FILE* file = fopen(filename, "rb");
+  ASSERT_TRUE(NULL != file) << "Unable to open audio file " << filename;
+  WebRtc_Word16 buffer[1024];
+  size_t read_count = 0;
+  while ((read_count = fread(buffer, sizeof(WebRtc_Word16), 1024, file)) > 0) {
+    audio->insert(audio->end(), buffer, buffer + read_count);
+  }
+  fclose(file);
+}
+
+void CreateStream(const Config& config, int id, Stream* stream) {
+  AudioProcessing* apm = AudioProcessing::Create(id);
+  ASSERT_TRUE(apm != NULL);
+  stream->apm = apm;
+  stream->capture_level = 127;
+  // Spread the streams out over the input.
+  stream->position = (id * 997 * (config.sample_rate_hz / 100)) %
+      static_cast<int>(config.near_audio.size());
+
+  ASSERT_EQ(apm->kNoError, apm->set_sample_rate_hz(config.sample_rate_hz));
+  ASSERT_EQ(apm->kNoError, apm->echo_cancellation()->Enable(config.aec));
+  ASSERT_EQ(apm->kNoError, apm->echo_control_mobile()->Enable(config.aecm));
+  ASSERT_EQ(apm->kNoError, apm->gain_control()->Enable(config.agc));
+  ASSERT_EQ(apm->kNoError,
+            apm->gain_control()->set_mode(GainControl::kAdaptiveDigital));
+  ASSERT_EQ(apm->kNoError, apm->high_pass_filter()->Enable(config.hpf));
+  ASSERT_EQ(apm->kNoError, apm->noise_suppression()->Enable(config.ns));
+  ASSERT_EQ(apm->kNoError, apm->voice_detection()->Enable(config.vad));
+}
+
+bool ProcessFrame(const Config& config, Stream* stream, AudioFrame* frame) {
+  AudioProcessing* apm = stream->apm;
+  const int samples_per_channel = config.sample_rate_hz / 100;
+  const int length = static_cast<int>(
+      std::min(config.far_audio.size(), config.near_audio.size()));
+  if (stream->position + samples_per_channel > length) {
+    stream->position = 0;
+  }
+
+  frame->_frequencyInHz = config.sample_rate_hz;
+  frame->_audioChannel = 1;
+  frame->_payloadDataLengthInSamples = samples_per_channel;
+
+  memcpy(frame->_payloadData, &config.far_audio[stream->position],
+         samples_per_channel * sizeof(WebRtc_Word16));
+  if (apm->AnalyzeReverseStream(frame) != apm->kNoError) {
+    return false;
+  }
+
+  memcpy(frame->_payloadData, &config.near_audio[stream->position],
+         samples_per_channel * sizeof(WebRtc_Word16));
+  apm->gain_control()->set_stream_analog_level(stream->capture_level);
+  apm->set_stream_delay_ms(0);
+  int err = apm->ProcessStream(frame);
+  if (err != apm->kNoError && err != apm->kBadStreamParameterWarning) {
+    return false;
+  }
+  stream->capture_level = apm->gain_control()->stream_analog_level();
+  stream->position += samples_per_channel;
+
+  return true;
+}
+
+bool WorkerThread(void* obj) {
+  Worker* worker = static_cast<Worker*>(obj);
+  EventWrapper* sleep_event = EventWrapper::Create();
+  AudioFrame frame;
+
+  for (int period = 0; period < worker->num_periods && !worker->failed;
+       period++) {
+    // The frames of this period arrive at |available|, and must be processed
+    // before the next ones arrive.
+    const TickTime available = worker->start +
+        TickTime::MillisecondsToTicks(period * kFrameMs);
+    const TickTime deadline = available +
+        TickTime::MillisecondsToTicks(kFrameMs);
+    WebRtc_Word64 wait_ms = (available - TickTime::Now()).Milliseconds();
+    if (wait_ms > 0) {
+      sleep_event->Wait(static_cast<unsigned long>(wait_ms));
+    }
+
+    for (size_t i = 0; i < worker->streams.size(); i++) {
+      TickTime t0 = TickTime::Now();
+      if (!ProcessFrame(*worker->config, &worker->streams[i], &frame)) {
+        worker->failed = true;
+        break;
+      }
+      TickTime t1 = TickTime::Now();
+      worker->latencies_us.push_back((t1 - t0).Microseconds());
+      if ((t1 - deadline).Microseconds() > 0) {
+        worker->num_missed++;
+      }
+    }
+  }
+
+  delete sleep_event;
+  // Run once only.
+  return false;
+}
+
+// Runs |num_streams| streams for the configured duration.
+void RunLoad(const Config& config, int num_streams, Report* report) {
+  const int num_threads = std::min(config.num_threads, num_streams);
+  std::vector<Worker> workers(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    workers[i].config = &config;
+    workers[i].num_periods = config.duration_s * 1000 / kFrameMs;
+    workers[i].num_missed = 0;
+    workers[i].failed = false;
+    workers[i].latencies_us.reserve(
+        workers[i].num_periods * (num_streams / num_threads + 1));
+  }
+  for (int i = 0; i < num_streams; i++) {
+    Stream stream;
+    CreateStream(config, i, &stream);
+    workers[i % num_threads].streams.push_back(stream);
+  }
+
+  // Leave time for all threads to start before the first frame.
+  const TickTime start = TickTime::Now() +
+      TickTime::MillisecondsToTicks(100);
+  std::vector<ThreadWrapper*> threads;
+  for (int i = 0; i < num_threads; i++) {
+    workers[i].start = start;
+    ThreadWrapper* thread = ThreadWrapper::CreateThread(WorkerThread,
+        &workers[i], webrtc::kRealtimePriority, "load_test_worker");
+    ASSERT_TRUE(thread != NULL);
+    unsigned int thread_id = 0;
+    ASSERT_TRUE(thread->Start(thread_id));
+    threads.push_back(thread);
+  }
+  for (size_t i = 0; i < threads.size(); i++) {
+    // Stop() waits for the worker to finish its run, with a timeout.
+    while (!threads[i]->Stop()) {}
+    delete threads[i];
+  }
+
+  std::vector<WebRtc_Word64> latencies_us;
+  WebRtc_Word64 total_us = 0;
+  memset(report, 0, sizeof(*report));
+  report->num_streams = num_streams;
+  for (int i = 0; i < num_threads; i++) {
+    Worker& worker = workers[i];
+    for (size_t j = 0; j < worker.streams.size(); j++) {
+      AudioProcessing::Destroy(worker.streams[j].apm);
+    }
+    for (size_t j = 0; j < worker.latencies_us.size(); j++) {
+      total_us += worker.latencies_us[j];
+    }
+    latencies_us.insert(latencies_us.end(), worker.latencies_us.begin(),
+                        worker.latencies_us.end());
+    report->num_missed += worker.num_missed;
+    report->failed |= worker.failed;
+  }
+  std::sort(latencies_us.begin(), latencies_us.end());
+
+  report->num_frames = static_cast<int>(latencies_us.size());
+  report->miss_rate = report->num_frames > 0 ?
+      100.0 * report->num_missed / report->num_frames : 0;
+  // Fraction of the worker threads' time spent processing.
+  report->load = 100.0 * total_us /
+      (num_threads * config.duration_s * 1e6);
+  report->p50_us = Percentile(latencies_us, 500);
+  report->p99_us = Percentile(latencies_us, 990);
+  report->p999_us = Percentile(latencies_us, 999);
+  report->max_us = Percentile(latencies_us, 1000);
+}
+
+void PrintReport(const Report& report) {
+  printf("Streams: %d, frames: %d, missed: %d (%.3f%%), load: %.1f%%\n",
+         report.num_streams, report.num_frames, report.num_missed,
+         report.miss_rate, report.load);
+  printf("Latency: %.3f ms (p50), %.3f ms (p99), %.3f ms (p99.9),"
+         " %.3f ms (max)\n",
+         report.p50_us / 1000.0, report.p99_us / 1000.0,
+         report.p999_us / 1000.0, report.max_us / 1000.0);
+}
+
+// Whether |num_streams| can be sustained within |max_miss_rate|.
+bool Sustainable(const Config& config, int num_streams,
+                 double max_miss_rate) {
+  Report report;
+  RunLoad(config, num_streams, &report);
+  PrintReport(report);
+  return !report.failed && report.miss_rate <= max_miss_rate;
+}
+}  // namespace
+
+// void function for gtest.
+void void_main(int argc, char* argv[]) {
+  if (argc > 1 && strcmp(argv[1], "--help") == 0) {
+    usage();
+    return;
+  }
+
+  Config config;
+  config.num_threads = static_cast<int>(CpuWrapper::DetectNumberOfCores());
+  const char* far_filename = NULL;
+  const char* near_filename = NULL;
+  int num_streams = 1;
+  bool sweep = false;
+  double max_miss_rate = 0.1;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-ir") == 0) {
+      i++;
+      ASSERT_LT(i, argc) << "Specify filename after -ir";
+      far_filename = argv[i];
+
+    } else if (strcmp(argv[i], "-i") == 0) {
+      i++;
+      ASSERT_LT(i, argc) << "Specify filename after -i";
+      near_filename = argv[i];
+
+    } else if (strcmp(argv[i], "-n") == 0) {
+      i++;
+      ASSERT_LT(i, argc) << "Specify number of streams after -n";
+      ASSERT_EQ(1, sscanf(argv[i], "%d", &num_streams));
+      ASSERT_GT(num_streams, 0);
+
+    } else if (strcmp(argv[i], "-t") == 0) {
+      i++;
+      ASSERT_LT(i, argc) << "Specify duration after -t";
+      ASSERT_EQ(1, sscanf(argv[i], "%d", &config.duration_s));
+      ASSERT_GT(config.duration_s, 0);
+
+    } else if (strcmp(argv[i], "-fs") == 0) {
+      i++;
+      ASSERT_LT(i, argc) << "Specify sample rate after -fs";
+      ASSERT_EQ(1, sscanf(argv[i], "%d", &config.sample_rate_hz));
+
+    } else if (strcmp(argv[i], "--threads") == 0) {
+      i++;
+      ASSERT_LT(i, argc) << "Specify number of threads after --threads";
+      ASSERT_EQ(1, sscanf(argv[i], "%d", &config.num_threads));
+      ASSERT_GT(config.num_threads, 0);
+
+    } else if (strcmp(argv[i], "-aec") == 0) {
+      config.aec = true;
+
+    } else if (strcmp(argv[i], "-aecm") == 0) {
+      config.aecm = true;
+
+    } else if (strcmp(argv[i], "-agc") == 0) {
+      config.agc = true;
+
+    } else if (strcmp(argv[i], "-hpf") == 0) {
+      config.hpf = true;
+
+    } else if (strcmp(argv[i], "-ns") == 0) {
+      config.ns = true;
+
+    } else if (strcmp(argv[i], "-vad") == 0) {
+      config.vad = true;
+
+    } else if (strcmp(argv[i], "--sweep") == 0) {
+      sweep = true;
+
+    } else if (strcmp(argv[i], "--max_miss_rate") == 0) {
+      i++;
+      ASSERT_LT(i, argc) << "Specify percentage after --max_miss_rate";
+      ASSERT_EQ(1, sscanf(argv[i], "%lf", &max_miss_rate));
+
+    } else {
+      FAIL() << "Unrecognized argument " << argv[i];
+    }
+  }
+  if (config.num_threads < 1) {
+    config.num_threads = 1;
+  }
+
+  if (far_filename != NULL || near_filename != NULL) {
+    ASSERT_TRUE(far_filename != NULL && near_filename != NULL)
+        << "Specify both -ir and -i";
+    ReadAudio(far_filename, &config.far_audio);
+    ReadAudio(near_filename, &config.near_audio);
+    ASSERT_GE(std::min(config.far_audio.size(), config.near_audio.size()),
+              static_cast<size_t>(config.sample_rate_hz / 100))
+        << "Input files are too short";
+  } else {
+    GenerateAudio(config.sample_rate_hz, &config);
+  }
+
+  printf("Sample rate: %d Hz, threads: %d, duration: %d s\n",
+         config.sample_rate_hz, config.num_threads, config.duration_s);
+
+  if (!sweep) {
+    Report report;
+    RunLoad(config, num_streams, &report);
+    PrintReport(report);
+    ASSERT_FALSE(report.failed) << "Processing failed";
+    return;
+  }
+
+  // Double the number of streams until it can not be sustained, then bisect.
+  int good = 0;
+  int bad = num_streams;
+  while (Sustainable(config, bad, max_miss_rate)) {
+    good = bad;
+    bad *= 2;
+  }
+  while (bad - good > 1) {
+    int mid = (good + bad) / 2;
+    if (Sustainable(config, mid, max_miss_rate)) {
+      good = mid;
+    } else {
+      bad = mid;
+    }
+  }
+
+  printf("\nMax sustainable streams: %d (%.1f per core), at most %.3f%%"
+         " missed\n", good, static_cast<double>(good) /
+         std::min<int>(config.num_threads,
+                       CpuWrapper::DetectNumberOfCores()),
+         max_miss_rate);
+}
+
+int main(int argc, char* argv[])
+{
+  void_main(argc, argv);
+
+  return 0;
+}
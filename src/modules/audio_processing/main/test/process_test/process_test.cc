@@ -14,13 +14,22 @@
 #include <sys/stat.h>
 #endif
 
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
 #include "tick_util.h"
 #include "gtest/gtest.h"
+#include "gtest/gtest-spi.h"
 #include "module_common_types.h"
 
 #include "audio_processing.h"
 
 #include "cpu_features_wrapper.h"
+#include "cpu_wrapper.h"
+#include "critical_section_wrapper.h"
+#include "thread_wrapper.h"
 
 using webrtc::AudioFrame;
 using webrtc::TickInterval;
@@ -30,6 +39,26 @@ using webrtc::AudioProcessing;
 using webrtc::GainControl;
 using webrtc::NoiseSuppression;
 
+using webrtc::CpuWrapper;
+using webrtc::CriticalSectionScoped;
+using webrtc::CriticalSectionWrapper;
+using webrtc::ThreadWrapper;
+
+// Timing of one recording processed in corpus mode.
+struct JobResult {
+  JobResult() : completed(false) {}
+
+  std::string args;
+  bool completed;
+  // Failures reported while running the job, empty if there were none.
+  std::string error;
+  // Processing time of each capture frame, including the preceding render
+  // frame.
+  std::vector<WebRtc_Word64> frame_times_us;
+};
+
+void void_main(int argc, char* argv[], JobResult* result = NULL);
+
 void usage() {
   printf(
   "Usage: process_test [options] [-ir REVERSE_FILE] [-i PRIMARY_FILE]\n");
@@ -70,6 +99,7 @@ void usage() {
   printf("  --ns_moderate\n");
   printf("  --ns_high\n");
   printf("  --ns_very_high\n");
+  printf("  --ns_low_delay\n");
   printf("\n  -vad     Voice activity detection\n");
   printf("  --vad_out_file FILE");
   printf("\n");
@@ -78,21 +108,314 @@ void usage() {
   printf("  --quiet         Suppress text output.\n");
   printf("  --no_progress   Suppress progress.\n");
   printf("  --version       Print version information and exit.\n");
+  printf("\n");
+  printf("Corpus mode:\n");
+  printf("  process_test --corpus MANIFEST [--workers N] [--json FILE]\n");
+  printf(
+  "Each line of MANIFEST holds the options of one simulation, which must\n"
+  "include -i. The simulations run in parallel on N workers (default: one\n"
+  "per core), each with its own APM. Per-file and aggregate timing is written\n"
+  "as JSON to FILE (default: corpus.json). Output files are only written with\n"
+  "-o.\n");
+}
+
+namespace {
+// The APM and the files of one simulation. They are released on every path
+// out of void_main(), including the early return of a failed assertion, which
+// a corpus worker survives.
+struct Simulation {
+  Simulation()
+      : apm(NULL),
+        far_file(NULL),
+        near_file(NULL),
+        out_file(NULL),
+        event_file(NULL),
+        delay_file(NULL),
+        drift_file(NULL),
+        vad_out_file(NULL) {}
+
+  ~Simulation() {
+    FILE* files[] = {far_file, near_file, out_file, event_file, delay_file,
+                     drift_file, vad_out_file};
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+      if (files[i] != NULL) {
+        fclose(files[i]);
+      }
+    }
+    if (apm != NULL) {
+      AudioProcessing::Destroy(apm);
+    }
+  }
+
+  AudioProcessing* apm;
+  FILE* far_file;
+  FILE* near_file;
+  FILE* out_file;
+  FILE* event_file;
+  FILE* delay_file;
+  FILE* drift_file;
+  FILE* vad_out_file;
+};
+
+struct Corpus {
+  std::vector<std::string> jobs;
+  std::vector<JobResult> results;
+  size_t next_job;
+  CriticalSectionWrapper* crit;
+};
+
+void RunJob(const std::string& args, JobResult* result) {
+  std::istringstream stream(args);
+  std::vector<std::string> tokens;
+  std::string token;
+  tokens.push_back("process_test");
+  while (stream >> token) {
+    tokens.push_back(token);
+  }
+
+  std::vector<char*> argv;
+  for (size_t i = 0; i < tokens.size(); i++) {
+    argv.push_back(&tokens[i][0]);
+  }
+  result->args = args;
+
+  // A failed assertion returns from void_main() on this thread only; keep
+  // the failures with the job and report them from the main thread.
+  ::testing::TestPartResultArray failures;
+  {
+    ::testing::ScopedFakeTestPartResultReporter reporter(
+        ::testing::ScopedFakeTestPartResultReporter::
+            INTERCEPT_ONLY_CURRENT_THREAD,
+        &failures);
+    void_main(static_cast<int>(argv.size()), &argv[0], result);
+  }
+  for (int i = 0; i < failures.size(); i++) {
+    const ::testing::TestPartResult& failure = failures.GetTestPartResult(i);
+    if (!result->error.empty()) {
+      result->error += "\n";
+    }
+    if (failure.file_name() != NULL) {
+      std::ostringstream location;
+      location << failure.file_name() << ":" << failure.line_number() << ": ";
+      result->error += location.str();
+    }
+    result->error += failure.message();
+  }
+  if (!result->completed && result->error.empty()) {
+    result->error = "Did not complete";
+  }
+}
+
+bool CorpusWorker(void* obj) {
+  Corpus* corpus = static_cast<Corpus*>(obj);
+  for (;;) {
+    size_t job = 0;
+    {
+      CriticalSectionScoped crit_scoped(*corpus->crit);
+      if (corpus->next_job == corpus->jobs.size()) {
+        break;
+      }
+      job = corpus->next_job++;
+    }
+    RunJob(corpus->jobs[job], &corpus->results[job]);
+  }
+
+  // Run once only.
+  return false;
+}
+
+// Nearest-rank percentile of sorted |values|.
+WebRtc_Word64 Percentile(const std::vector<WebRtc_Word64>& values,
+                         int percent) {
+  if (values.empty()) {
+    return 0;
+  }
+  size_t rank = (values.size() * percent + 99) / 100;
+  return values[std::max<size_t>(rank, 1) - 1];
+}
+
+void WriteJsonString(FILE* file, const std::string& str) {
+  fputc('"', file);
+  for (size_t i = 0; i < str.size(); i++) {
+    if (str[i] == '"' || str[i] == '\\') {
+      fputc('\\', file);
+      fputc(str[i], file);
+    } else if (str[i] == '\n') {
+      fputs("\\n", file);
+    } else if (static_cast<unsigned char>(str[i]) < 0x20) {
+      fprintf(file, "\\u%04x", static_cast<unsigned char>(str[i]));
+    } else {
+      fputc(str[i], file);
+    }
+  }
+  fputc('"', file);
+}
+
+// Writes the timing statistics of |frame_times_us| over |audio_s| seconds of
+// audio, processed in |elapsed_s| seconds.
+void WriteJsonTiming(FILE* file, std::vector<WebRtc_Word64> frame_times_us,
+                     double audio_s, double elapsed_s) {
+  WebRtc_Word64 total_us = 0;
+  for (size_t i = 0; i < frame_times_us.size(); i++) {
+    total_us += frame_times_us[i];
+  }
+  std::sort(frame_times_us.begin(), frame_times_us.end());
+
+  fprintf(file, "\"frames\": %d, ", static_cast<int>(frame_times_us.size()));
+  fprintf(file, "\"audio_s\": %.2f, ", audio_s);
+  fprintf(file, "\"processing_s\": %.6f, ", total_us * 1e-6);
+  fprintf(file, "\"realtime_factor\": %.1f, ",
+          elapsed_s > 0 ? audio_s / elapsed_s : 0.0);
+  fprintf(file, "\"frame_us\": {\"mean\": %.1f, \"p50\": %d, "
+          "\"p90\": %d, \"p99\": %d, \"max\": %d}",
+          frame_times_us.empty() ? 0.0 :
+              static_cast<double>(total_us) / frame_times_us.size(),
+          static_cast<int>(Percentile(frame_times_us, 50)),
+          static_cast<int>(Percentile(frame_times_us, 90)),
+          static_cast<int>(Percentile(frame_times_us, 99)),
+          static_cast<int>(Percentile(frame_times_us, 100)));
+}
+
+void RunCorpus(int argc, char* argv[]) {
+  const char* manifest_filename = NULL;
+  const char* json_filename = "corpus.json";
+  int num_workers = static_cast<int>(CpuWrapper::DetectNumberOfCores());
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--corpus") == 0) {
+      i++;
+      ASSERT_LT(i, argc) << "Specify filename after --corpus";
+      manifest_filename = argv[i];
+
+    } else if (strcmp(argv[i], "--workers") == 0) {
+      i++;
+      ASSERT_LT(i, argc) << "Specify number of workers after --workers";
+      ASSERT_EQ(1, sscanf(argv[i], "%d", &num_workers));
+      ASSERT_GT(num_workers, 0);
+
+    } else if (strcmp(argv[i], "--json") == 0) {
+      i++;
+      ASSERT_LT(i, argc) << "Specify filename after --json";
+      json_filename = argv[i];
+
+    } else {
+      FAIL() << "Unrecognized argument in corpus mode " << argv[i];
+    }
+  }
+  if (num_workers < 1) {
+    num_workers = 1;
+  }
+
+  Corpus corpus;
+  FILE* manifest_file = fopen(manifest_filename, "r");
+  ASSERT_TRUE(NULL != manifest_file) << "Unable to open manifest "
+                                     << manifest_filename;
+  char line[4096];
+  while (fgets(line, sizeof(line), manifest_file) != NULL) {
+    std::string job(line);
+    job.erase(job.find_last_not_of(" \t\r\n") + 1);
+    if (job.empty() || job[0] == '#') {
+      continue;
+    }
+    corpus.jobs.push_back(job);
+  }
+  fclose(manifest_file);
+
+  corpus.results.resize(corpus.jobs.size());
+  corpus.next_job = 0;
+  corpus.crit = CriticalSectionWrapper::CreateCriticalSection();
+  num_workers = std::min<int>(num_workers,
+                              std::max<int>(corpus.jobs.size(), 1));
+
+  TickTime t0 = TickTime::Now();
+  std::vector<ThreadWrapper*> workers;
+  for (int i = 0; i < num_workers; i++) {
+    ThreadWrapper* worker = ThreadWrapper::CreateThread(CorpusWorker, &corpus,
+        webrtc::kNormalPriority, "process_test_worker");
+    unsigned int thread_id = 0;
+    if (worker == NULL || !worker->Start(thread_id)) {
+      // The workers already started still share |corpus|; run with those.
+      ADD_FAILURE() << "Unable to start worker " << i;
+      delete worker;
+      break;
+    }
+    workers.push_back(worker);
+  }
+  for (size_t i = 0; i < workers.size(); i++) {
+    // Stop() waits for the worker to finish its jobs, with a timeout.
+    while (!workers[i]->Stop()) {}
+    delete workers[i];
+  }
+  const double wall_s = (TickTime::Now() - t0).Microseconds() * 1e-6;
+  delete corpus.crit;
+
+  FILE* json_file = fopen(json_filename, "w");
+  ASSERT_TRUE(NULL != json_file) << "Unable to open JSON output file "
+                                 << json_filename;
+
+  std::vector<WebRtc_Word64> all_frame_times_us;
+  int num_failed = 0;
+  fprintf(json_file, "{\n  \"jobs\": [\n");
+  for (size_t i = 0; i < corpus.results.size(); i++) {
+    const JobResult& result = corpus.results[i];
+    WebRtc_Word64 total_us = 0;
+    for (size_t j = 0; j < result.frame_times_us.size(); j++) {
+      total_us += result.frame_times_us[j];
+    }
+    if (!result.completed || !result.error.empty()) {
+      num_failed++;
+      ADD_FAILURE() << "Corpus job failed: " << result.args << "\n"
+                    << result.error;
+    }
+    all_frame_times_us.insert(all_frame_times_us.end(),
+                              result.frame_times_us.begin(),
+                              result.frame_times_us.end());
+
+    fprintf(json_file, "    {\"args\": ");
+    WriteJsonString(json_file, corpus.jobs[i]);
+    fprintf(json_file, ", \"completed\": %s, ",
+            result.completed ? "true" : "false");
+    if (!result.error.empty()) {
+      fprintf(json_file, "\"error\": ");
+      WriteJsonString(json_file, result.error);
+      fprintf(json_file, ", ");
+    }
+    WriteJsonTiming(json_file, result.frame_times_us,
+                    result.frame_times_us.size() * 0.01, total_us * 1e-6);
+    fprintf(json_file, "}%s\n", i + 1 < corpus.results.size() ? "," : "");
+  }
+  fprintf(json_file, "  ],\n  \"aggregate\": {\"jobs\": %d, "
+          "\"failed\": %d, \"workers\": %d, \"wall_s\": %.3f, ",
+          static_cast<int>(corpus.jobs.size()), num_failed, num_workers,
+          wall_s);
+  WriteJsonTiming(json_file, all_frame_times_us,
+                  all_frame_times_us.size() * 0.01, wall_s);
+  fprintf(json_file, "}\n}\n");
+  fclose(json_file);
 }
+}  // namespace
 
-// void function for gtest.
-void void_main(int argc, char* argv[]) {
+// void function for gtest. With |result|, runs one simulation of a corpus and
+// reports its timing there.
+void void_main(int argc, char* argv[], JobResult* result) {
   if (argc > 1 && strcmp(argv[1], "--help") == 0) {
     usage();
     return;
   }
 
+  if (result == NULL && argc > 1 && strcmp(argv[1], "--corpus") == 0) {
+    RunCorpus(argc, argv);
+    return;
+  }
+
   if (argc < 2) {
     printf("Did you mean to run without arguments?\n");
     printf("Try `process_test --help' for more information.\n\n");
   }
 
-  AudioProcessing* apm = AudioProcessing::Create(0);
+  Simulation simulation;
+  simulation.apm = AudioProcessing::Create(0);
+  AudioProcessing* apm = simulation.apm;
   ASSERT_TRUE(apm != NULL);
 
   WebRtc_Word8 version[1024];
@@ -257,6 +580,11 @@ void void_main(int argc, char* argv[]) {
       ASSERT_EQ(apm->kNoError,
           apm->noise_suppression()->set_level(NoiseSuppression::kVeryHigh));
 
+    } else if (strcmp(argv[i], "--ns_low_delay") == 0) {
+      ASSERT_EQ(apm->kNoError, apm->noise_suppression()->Enable(true));
+      ASSERT_EQ(apm->kNoError,
+          apm->noise_suppression()->enable_low_delay(true));
+
     } else if (strcmp(argv[i], "-vad") == 0) {
       ASSERT_EQ(apm->kNoError, apm->voice_detection()->Enable(true));
 
@@ -287,6 +615,15 @@ void void_main(int argc, char* argv[]) {
     }
   }
 
+  const bool corpus_job = result != NULL;
+  if (corpus_job) {
+    // Corpus jobs share stdout, and report their timing in |result|.
+    ASSERT_TRUE(near_filename != NULL) << "Specify -i in corpus mode";
+    verbose = false;
+    progress = false;
+    perf_testing = true;
+  }
+
   if (verbose) {
     printf("Sample rate: %d Hz\n", sample_rate_hz);
     printf("Primary channels: %d (in), %d (out)\n",
@@ -308,21 +645,23 @@ void void_main(int argc, char* argv[]) {
     near_filename = near_file_default;
   }
 
-  if (out_filename == NULL) {
-    out_filename = out_file_default;
-  }
+  if (!corpus_job) {
+    if (out_filename == NULL) {
+      out_filename = out_file_default;
+    }
 
-  if (vad_out_filename == NULL) {
-    vad_out_filename = vad_file_default;
+    if (vad_out_filename == NULL) {
+      vad_out_filename = vad_file_default;
+    }
   }
 
-  FILE* far_file = NULL;
-  FILE* near_file = NULL;
-  FILE* out_file = NULL;
-  FILE* event_file = NULL;
-  FILE* delay_file = NULL;
-  FILE* drift_file = NULL;
-  FILE* vad_out_file = NULL;
+  FILE*& far_file = simulation.far_file;
+  FILE*& near_file = simulation.near_file;
+  FILE*& out_file = simulation.out_file;
+  FILE*& event_file = simulation.event_file;
+  FILE*& delay_file = simulation.delay_file;
+  FILE*& drift_file = simulation.drift_file;
+  FILE*& vad_out_file = simulation.vad_out_file;
 
   if (far_filename != NULL) {
     far_file = fopen(far_filename, "rb");
@@ -337,9 +676,11 @@ void void_main(int argc, char* argv[]) {
   stat(near_filename, &st);
   int near_size_samples = st.st_size / sizeof(int16_t);
 
-  out_file = fopen(out_filename, "wb");
-  ASSERT_TRUE(NULL != out_file) << "Unable to open output audio file "
-                                << out_filename;
+  if (out_filename != NULL) {
+    out_file = fopen(out_filename, "wb");
+    ASSERT_TRUE(NULL != out_file) << "Unable to open output audio file "
+                                  << out_filename;
+  }
 
   if (!simulating) {
     event_file = fopen(event_filename, "rb");
@@ -355,7 +696,7 @@ void void_main(int argc, char* argv[]) {
                                     << drift_filename;
   }
 
-  if (apm->voice_detection()->is_enabled()) {
+  if (apm->voice_detection()->is_enabled() && vad_out_filename != NULL) {
     vad_out_file = fopen(vad_out_filename, "wb");
     ASSERT_TRUE(NULL != vad_out_file) << "Unable to open VAD output file "
                                       << vad_out_file;
@@ -391,6 +732,7 @@ void void_main(int argc, char* argv[]) {
   WebRtc_Word64 max_time_reverse_us = 0;
   WebRtc_Word64 min_time_us = 1e6;
   WebRtc_Word64 min_time_reverse_us = 1e6;
+  WebRtc_Word64 reverse_time_us = 0;
 
   while (simulating || feof(event_file) == 0) {
     std::ostringstream trace_stream;
@@ -477,6 +819,7 @@ void void_main(int argc, char* argv[]) {
         t1 = TickTime::Now();
         TickInterval tick_diff = t1 - t0;
         acc_ticks += tick_diff;
+        reverse_time_us = tick_diff.Microseconds();
         if (tick_diff.Microseconds() > max_time_reverse_us) {
           max_time_reverse_us = tick_diff.Microseconds();
         }
@@ -566,13 +909,20 @@ void void_main(int argc, char* argv[]) {
         if (tick_diff.Microseconds() < min_time_us) {
           min_time_us = tick_diff.Microseconds();
         }
+        if (corpus_job) {
+          result->frame_times_us.push_back(tick_diff.Microseconds() +
+                                           reverse_time_us);
+          reverse_time_us = 0;
+        }
       }
 
-      ASSERT_EQ(near_frame._payloadDataLengthInSamples,
-                fwrite(near_frame._payloadData,
-                       sizeof(WebRtc_Word16),
-                       near_frame._payloadDataLengthInSamples,
-                       out_file));
+      if (out_file != NULL) {
+        ASSERT_EQ(near_frame._payloadDataLengthInSamples,
+                  fwrite(near_frame._payloadData,
+                         sizeof(WebRtc_Word16),
+                         near_frame._payloadDataLengthInSamples,
+                         out_file));
+      }
     }
     else {
       FAIL() << "Event " << event << " is unrecognized";
@@ -601,7 +951,7 @@ void void_main(int argc, char* argv[]) {
     EXPECT_NE(0, feof(drift_file)) << "Drift file not fully processed";
   }
 
-  if (perf_testing) {
+  if (perf_testing && !corpus_job) {
     if (primary_count > 0) {
       WebRtc_Word64 exec_time = acc_ticks.Milliseconds();
       printf("\nTotal time: %.3f s, file time: %.2f s\n",
@@ -616,8 +966,9 @@ void void_main(int argc, char* argv[]) {
     }
   }
 
-  AudioProcessing::Destroy(apm);
-  apm = NULL;
+  if (corpus_job) {
+    result->completed = true;
+  }
 }
 
 int main(int argc, char* argv[])
@@ -8,20 +8,30 @@
  *  be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "audio_processing.h"
 #include "audio_processing_unittest.pb.h"
+#include "echo_cancellation.h"
+#include "echo_control_mobile.h"
 #include "event_wrapper.h"
+#include "gain_control.h"
 #include "module_common_types.h"
+#include "noise_suppression_x.h"
 #include "thread_wrapper.h"
 #include "trace.h"
 #include "signal_processing_library.h"
 
 using webrtc::AudioProcessing;
 using webrtc::AudioFrame;
+using webrtc::AudioFrameView;
 using webrtc::GainControl;
 using webrtc::NoiseSuppression;
 using webrtc::EchoCancellation;
@@ -31,6 +41,8 @@ using webrtc::LevelEstimator;
 using webrtc::EchoCancellation;
 using webrtc::EchoControlMobile;
 using webrtc::VoiceDetection;
+using webrtc::ThreadWrapper;
+using webrtc::kNormalPriority;
 
 namespace {
 // When true, this will compare the output data with the results stored to
@@ -132,6 +144,56 @@ void MixStereoToMono(WebRtc_Word16* stereo,
   }
 }
 
+// Reads |num_frames| 10 ms stereo frames at 32 kHz from |file| and stores
+// the lower and upper band of the first channel, at 16 kHz, in |low_band|
+// and |high_band|. |high_band| may be NULL.
+bool ReadBands(FILE* file, int num_frames, WebRtc_Word16* low_band,
+               WebRtc_Word16* high_band) {
+  WebRtc_Word16 stereo[320 * 2];
+  WebRtc_Word16 channel[320];
+  WebRtc_Word16 high_band_frame[160];
+  WebRtc_Word32 filter_state1[6];
+  WebRtc_Word32 filter_state2[6];
+  memset(filter_state1, 0, sizeof(filter_state1));
+  memset(filter_state2, 0, sizeof(filter_state2));
+  for (int i = 0; i < num_frames; i++) {
+    if (fread(stereo, sizeof(WebRtc_Word16), 320 * 2, file) != 320 * 2) {
+      return false;
+    }
+    for (int k = 0; k < 320; k++) {
+      channel[k] = stereo[k * 2];
+    }
+    WebRtcSpl_AnalysisQMF(channel, &low_band[i * 160],
+                          high_band ? &high_band[i * 160] : high_band_frame,
+                          filter_state1, filter_state2);
+  }
+  return true;
+}
+
+// Runs the AECM without comfort noise at 32 kHz, on |far| and on the bands
+// |near| and |near_high| of |num_samples| samples each.
+void ProcessAecmSuperWideband(const std::vector<WebRtc_Word16>& far,
+                              const std::vector<WebRtc_Word16>& near,
+                              const std::vector<WebRtc_Word16>& near_high,
+                              std::vector<WebRtc_Word16>* out,
+                              std::vector<WebRtc_Word16>* out_high) {
+  void* aecm = NULL;
+  ASSERT_EQ(0, WebRtcAecm_Create(&aecm));
+  ASSERT_EQ(0, WebRtcAecm_Init(aecm, 32000, 32000));
+  AecmConfig config;
+  config.cngMode = AecmFalse;
+  config.echoMode = 3;
+  ASSERT_EQ(0, WebRtcAecm_set_config(aecm, config));
+  out->resize(near.size());
+  out_high->resize(near.size());
+  for (size_t i = 0; i + 160 <= near.size(); i += 160) {
+    ASSERT_EQ(0, WebRtcAecm_BufferFarend(aecm, &far[i], 160));
+    ASSERT_EQ(0, WebRtcAecm_Process(aecm, &near[i], NULL, &near_high[i],
+                                    &(*out)[i], &(*out_high)[i], 160, 0));
+  }
+  EXPECT_EQ(0, WebRtcAecm_Free(aecm));
+}
+
 void WriteMessageLiteToFile(const char* filename,
                             const ::google::protobuf::MessageLite& message) {
   assert(filename != NULL);
@@ -234,6 +296,46 @@ bool DeadlockProc(void* thread_object) {
   return true;
 }
 
+struct MetricsThreadData {
+  MetricsThreadData(AudioProcessing* ap_)
+      : error(false),
+        ap(ap_),
+        event(EventWrapper::Create()) {}
+  ~MetricsThreadData() {
+    delete event;
+  }
+  bool error;
+  AudioProcessing* ap;
+  EventWrapper* event;
+};
+
+// Aggregates and reads the echo metrics every millisecond, concurrently with
+// the audio thread. A process thread would do so every 100 ms, but the test
+// stream is processed faster than real time. If this thread were never to
+// sleep, it could hold the metrics lock for so long that the queue overflows.
+bool MetricsProc(void* thread_object) {
+  MetricsThreadData* thread_data =
+      static_cast<MetricsThreadData*>(thread_object);
+  AudioProcessing* ap = thread_data->ap;
+  int err = ap->Process();
+  if (err != ap->kNoError) {
+    printf("Error in Process(): %d\n", err);
+    thread_data->error = true;
+    return false;
+  }
+
+  EchoCancellation::Metrics metrics;
+  err = ap->echo_cancellation()->GetMetrics(&metrics);
+  if (err != ap->kNoError) {
+    printf("Error in GetMetrics(): %d\n", err);
+    thread_data->error = true;
+    return false;
+  }
+
+  thread_data->event->Wait(1);
+  return true;
+}
+
 /*TEST_F(ApmTest, Deadlock) {
   const int num_threads = 16;
   std::vector<ThreadWrapper*> threads(num_threads);
@@ -595,16 +697,415 @@ TEST_F(ApmTest, EchoCancellation) {
             apm_->echo_cancellation()->enable_metrics(false));
   EXPECT_FALSE(apm_->echo_cancellation()->are_metrics_enabled());
 
+  EchoCancellation::DelayMetrics delay_metrics;
+  EXPECT_EQ(apm_->kNotEnabledError,
+            apm_->echo_cancellation()->GetDelayMetrics(&delay_metrics));
+
   EXPECT_EQ(apm_->kNoError, apm_->echo_cancellation()->Enable(true));
   EXPECT_TRUE(apm_->echo_cancellation()->is_enabled());
+  EXPECT_EQ(apm_->kNullPointerError,
+            apm_->echo_cancellation()->GetDelayMetrics(NULL));
+  EXPECT_EQ(apm_->kNoError,
+            apm_->echo_cancellation()->GetDelayMetrics(&delay_metrics));
+  EXPECT_EQ(-1, delay_metrics.median_ms);
+  EXPECT_EQ(-1, delay_metrics.std_ms);
   EXPECT_EQ(apm_->kNoError, apm_->echo_cancellation()->Enable(false));
   EXPECT_FALSE(apm_->echo_cancellation()->is_enabled());
+
+  EXPECT_FALSE(apm_->echo_cancellation()->is_dormant_mode_enabled());
+  EXPECT_EQ(apm_->kNoError,
+            apm_->echo_cancellation()->enable_dormant_mode(true));
+  EXPECT_TRUE(apm_->echo_cancellation()->is_dormant_mode_enabled());
+  EXPECT_EQ(apm_->kNoError,
+            apm_->echo_cancellation()->enable_dormant_mode(false));
+  EXPECT_FALSE(apm_->echo_cancellation()->is_dormant_mode_enabled());
+}
+
+TEST_F(ApmTest, EchoCancellationDormantMode) {
+  // |apm_| may turn dormant, |apm_ref| never does. The reverse stream in
+  // aec_far.pcm is digitally silent for 0.8 s from frame 187 and for 3.7 s
+  // from frame 330. The output has to be identical until the second period
+  // has lasted a second.
+  AudioProcessing* apm_ref = AudioProcessing::Create(1);
+  ASSERT_TRUE(apm_ref != NULL);
+  AudioFrame* frame_ref = new AudioFrame();
+  AudioFrame* frame_in = new AudioFrame();
+  AudioProcessing* apms[] = {apm_, apm_ref};
+  for (int j = 0; j < 2; j++) {
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_sample_rate_hz(32000));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_channels(2, 2));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_reverse_channels(2));
+    EXPECT_EQ(apm_->kNoError, apms[j]->echo_cancellation()->Enable(true));
+  }
+  EXPECT_EQ(apm_->kNoError,
+            apm_->echo_cancellation()->enable_dormant_mode(true));
+
+  const int kSamples = 320 * 2;
+  const int kSilentStart = 330;
+  const int kSilentEnd = 700;
+  int first_dormant_frame = -1;
+  int dormant_frames_with_echo = 0;
+  double in_energy = 0;
+  double out_energy = 0;
+  for (int i = 0; i < kSilentEnd + 50; i++) {
+    size_t read_count = fread(revframe_->_payloadData,
+                              sizeof(WebRtc_Word16),
+                              kSamples,
+                              far_file_);
+    ASSERT_EQ(kSamples, read_count);
+    read_count = fread(frame_->_payloadData,
+                       sizeof(WebRtc_Word16),
+                       kSamples,
+                       near_file_);
+    ASSERT_EQ(kSamples, read_count);
+    *frame_ref = *frame_;
+    *frame_in = *frame_;
+
+    for (int j = 0; j < 2; j++) {
+      EXPECT_EQ(apm_->kNoError, apms[j]->AnalyzeReverseStream(revframe_));
+      EXPECT_EQ(apm_->kNoError, apms[j]->set_stream_delay_ms(0));
+    }
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+    EXPECT_EQ(apm_->kNoError, apm_ref->ProcessStream(frame_ref));
+
+    const bool identical = memcmp(frame_->_payloadData,
+                                  frame_ref->_payloadData,
+                                  sizeof(WebRtc_Word16) * kSamples) == 0;
+    if (i < kSilentStart + 100) {
+      ASSERT_TRUE(identical) << "frame " << i;
+    } else if (i < kSilentEnd) {
+      if (!identical && first_dormant_frame < 0) {
+        first_dormant_frame = i;
+      }
+      if (first_dormant_frame >= 0) {
+        dormant_frames_with_echo +=
+            apm_->echo_cancellation()->stream_has_echo() ? 1 : 0;
+        for (int k = 0; k < kSamples; k++) {
+          in_energy += static_cast<double>(frame_in->_payloadData[k]) *
+              frame_in->_payloadData[k];
+          out_energy += static_cast<double>(frame_->_payloadData[k]) *
+              frame_->_payloadData[k];
+        }
+      }
+    }
+  }
+
+  // While dormant, the nearend is passed through without suppression.
+  EXPECT_GE(first_dormant_frame, kSilentStart + 100);
+  EXPECT_LT(first_dormant_frame, kSilentStart + 110);
+  EXPECT_EQ(0, dormant_frames_with_echo);
+  EXPECT_GT(in_energy, 0);
+  EXPECT_GT(out_energy, 0.9 * in_energy);
+  EXPECT_LT(out_energy, 1.1 * in_energy);
+
+  delete frame_in;
+  delete frame_ref;
+  AudioProcessing::Destroy(apm_ref);
+}
+
+TEST_F(ApmTest, EchoCancellationDormantPassThrough) {
+  // While dormant, the nearend comes out with the latency of the full
+  // processing, with at most the held comfort noise added. |aec| keeps its
+  // converged filter for when the farend returns, as |aec_ref| does.
+  const int kNumFrames = 600;
+  const int kNumSamples = kNumFrames * 160;
+  const int kSilentStart = 200 * 160;
+  const int kSilentEnd = 400 * 160;
+  WebRtc_Word16* far = new WebRtc_Word16[kNumSamples];
+  WebRtc_Word16* near = new WebRtc_Word16[kNumSamples];
+  WebRtc_Word16* out = new WebRtc_Word16[kNumSamples];
+  WebRtc_Word16* out_ref = new WebRtc_Word16[kNumSamples];
+  ASSERT_TRUE(ReadBands(far_file_, kNumFrames, far, NULL));
+  ASSERT_TRUE(ReadBands(near_file_, kNumFrames, near, NULL));
+  memset(&far[kSilentStart], 0,
+         sizeof(WebRtc_Word16) * (kSilentEnd - kSilentStart));
+
+  void* aec = NULL;
+  void* aec_ref = NULL;
+  ASSERT_EQ(0, WebRtcAec_Create(&aec));
+  ASSERT_EQ(0, WebRtcAec_Create(&aec_ref));
+  ASSERT_EQ(0, WebRtcAec_Init(aec, 16000, 16000));
+  ASSERT_EQ(0, WebRtcAec_Init(aec_ref, 16000, 16000));
+  ASSERT_EQ(0, WebRtcAec_set_dormant_mode(aec, kAecTrue));
+  for (int i = 0; i < kNumSamples; i += 160) {
+    ASSERT_EQ(0, WebRtcAec_BufferFarend(aec, &far[i], 160));
+    ASSERT_EQ(0, WebRtcAec_BufferFarend(aec_ref, &far[i], 160));
+    ASSERT_EQ(0, WebRtcAec_Process(aec, &near[i], NULL, &out[i], NULL, 160,
+                                   20, 0));
+    ASSERT_EQ(0, WebRtcAec_Process(aec_ref, &near[i], NULL, &out_ref[i], NULL,
+                                   160, 20, 0));
+  }
+
+  // The second half of the silence is well into the dormant mode.
+  const int kDormantStart = (kSilentStart + kSilentEnd) / 2;
+  int best_delay = -1;
+  int best_error = 0;
+  for (int delay = 0; delay < 400; delay++) {
+    int error = 0;
+    for (int i = kDormantStart; i < kSilentEnd; i++) {
+      error = std::max(error, abs(out[i] - near[i - delay]));
+    }
+    if (best_delay < 0 || error < best_error) {
+      best_delay = delay;
+      best_error = error;
+    }
+  }
+  double energy = 0;
+  double energy_ref = 0;
+  for (int i = kSilentEnd; i < kSilentEnd + 50 * 160; i++) {
+    energy += static_cast<double>(out[i]) * out[i];
+    energy_ref += static_cast<double>(out_ref[i]) * out_ref[i];
+  }
+  // The frame buffers hold 48 samples at 16 kHz, ahead of the block in the
+  // overlap-add. The comfort noise held here is below one LSB.
+  EXPECT_EQ(48 + 64, best_delay);
+  EXPECT_EQ(0, best_error);
+  EXPECT_NEAR(1.0, energy / energy_ref, 0.01);
+
+  EXPECT_EQ(0, WebRtcAec_Free(aec));
+  EXPECT_EQ(0, WebRtcAec_Free(aec_ref));
+  delete [] far;
+  delete [] near;
+  delete [] out;
+  delete [] out_ref;
+}
+
+TEST_F(ApmTest, EchoCancellationBlockInput) {
+  // The AEC processes 128 sample blocks directly, bypassing its reframing.
+  // Compare with 10 ms frames on the same wideband signal, the lower band of
+  // the first channel of the test files.
+  const int kNumFrames = 800;
+  const int kNumSamples = kNumFrames * 160;
+  const int kBlockLen = 128;
+  WebRtc_Word16* far = new WebRtc_Word16[kNumSamples];
+  WebRtc_Word16* near = new WebRtc_Word16[kNumSamples];
+  WebRtc_Word16* out_frame = new WebRtc_Word16[kNumSamples];
+  WebRtc_Word16* out_block = new WebRtc_Word16[kNumSamples];
+  ASSERT_TRUE(ReadBands(far_file_, kNumFrames, far, NULL));
+  ASSERT_TRUE(ReadBands(near_file_, kNumFrames, near, NULL));
+
+  void* aec_frame = NULL;
+  void* aec_block = NULL;
+  ASSERT_EQ(0, WebRtcAec_Create(&aec_frame));
+  ASSERT_EQ(0, WebRtcAec_Create(&aec_block));
+  ASSERT_EQ(0, WebRtcAec_Init(aec_frame, 16000, 16000));
+  ASSERT_EQ(0, WebRtcAec_Init(aec_block, 16000, 16000));
+  for (int i = 0; i < kNumSamples; i += 160) {
+    ASSERT_EQ(0, WebRtcAec_BufferFarend(aec_frame, &far[i], 160));
+    ASSERT_EQ(0, WebRtcAec_Process(aec_frame, &near[i], NULL, &out_frame[i],
+                                   NULL, 160, 20, 0));
+  }
+  // The H band pointers are not used below 32 kHz and may be NULL.
+  for (int i = 0; i < kNumSamples; i += kBlockLen) {
+    ASSERT_EQ(0, WebRtcAec_BufferFarend(aec_block, &far[i], kBlockLen));
+    ASSERT_EQ(0, WebRtcAec_Process(aec_block, &near[i], NULL, &out_block[i],
+                                   NULL, kBlockLen, 20, 0));
+  }
+
+  double near_energy = 0;
+  double frame_energy = 0;
+  double block_energy = 0;
+  for (int i = kNumSamples / 4; i < kNumSamples; i++) {
+    near_energy += static_cast<double>(near[i]) * near[i];
+    frame_energy += static_cast<double>(out_frame[i]) * out_frame[i];
+    block_energy += static_cast<double>(out_block[i]) * out_block[i];
+  }
+  AecDelayMetrics delay_frame;
+  AecDelayMetrics delay_block;
+  EXPECT_EQ(0, WebRtcAec_GetDelayMetrics(aec_frame, &delay_frame));
+  EXPECT_EQ(0, WebRtcAec_GetDelayMetrics(aec_block, &delay_block));
+  // Both framings align the farend alike and remove about the same echo.
+  EXPECT_LT(frame_energy, 0.5 * near_energy);
+  EXPECT_NEAR(1.0, block_energy / frame_energy, 0.05);
+  EXPECT_EQ(delay_frame.alignedDelay, delay_block.alignedDelay);
+  EXPECT_EQ(delay_frame.median, delay_block.median);
+
+  // The H band is required for super-wideband.
+  void* aec_swb = NULL;
+  ASSERT_EQ(0, WebRtcAec_Create(&aec_swb));
+  ASSERT_EQ(0, WebRtcAec_Init(aec_swb, 32000, 32000));
+  EXPECT_EQ(0, WebRtcAec_BufferFarend(aec_swb, far, kBlockLen));
+  EXPECT_EQ(-1, WebRtcAec_Process(aec_swb, near, NULL, out_block, NULL,
+                                  kBlockLen, 20, 0));
+  EXPECT_EQ(0, WebRtcAec_Free(aec_swb));
+
+  EXPECT_EQ(0, WebRtcAec_Free(aec_frame));
+  EXPECT_EQ(0, WebRtcAec_Free(aec_block));
+  delete [] far;
+  delete [] near;
+  delete [] out_frame;
+  delete [] out_block;
+}
+
+TEST_F(ApmTest, EchoCancellationOffline) {
+  // Once started up, the streaming AEC runs the same blocks as the offline
+  // AEC, with the farend delayed by the amount buffered at the end of the
+  // start up phase. Here, 3/4 of the 30 ms reported by the sound card in
+  // whole 80 sample frames, and the delay stays put on this signal.
+  const int kNumFrames = 800;
+  const int kNumSamples = kNumFrames * 160;
+  const int kBlockLen = 128;
+  const int kFarDelay = 320;
+  std::vector<WebRtc_Word16> far(kNumSamples);
+  std::vector<WebRtc_Word16> near(kNumSamples);
+  std::vector<WebRtc_Word16> out_stream(kNumSamples);
+  std::vector<WebRtc_Word16> out_offline(kNumSamples);
+  ASSERT_TRUE(ReadBands(far_file_, kNumFrames, &far[0], NULL));
+  ASSERT_TRUE(ReadBands(near_file_, kNumFrames, &near[0], NULL));
+
+  void* aec = NULL;
+  ASSERT_EQ(0, WebRtcAec_Create(&aec));
+  ASSERT_EQ(0, WebRtcAec_Init(aec, 16000, 16000));
+  for (int i = 0; i < kNumSamples; i += kBlockLen) {
+    ASSERT_EQ(0, WebRtcAec_BufferFarend(aec, &far[i], kBlockLen));
+    ASSERT_EQ(0, WebRtcAec_Process(aec, &near[i], NULL, &out_stream[i], NULL,
+                                   kBlockLen, 20, 0));
+  }
+  // The nearend is passed through during start up.
+  int start = 0;
+  while (start < kNumSamples && out_stream[start] == near[start]) {
+    start++;
+  }
+  start -= start % kBlockLen;
+  ASSERT_GT(start, kFarDelay);
+  ASSERT_LT(start, kNumSamples / 4);
+
+  // The streaming and offline modes can't be mixed without initialization.
+  EXPECT_EQ(-1, WebRtcAec_ProcessOffline(aec, &far[0], &near[0], NULL,
+                                         &out_offline[0], NULL, kBlockLen));
+  EXPECT_EQ(AEC_UNSUPPORTED_FUNCTION_ERROR, WebRtcAec_get_error_code(aec));
+
+  // Split the recording over calls of different sizes, which gives the same
+  // output as a single call.
+  ASSERT_EQ(0, WebRtcAec_Init(aec, 16000, 16000));
+  const int kCallSizes[] = {64, 1984, 128, 2048 * 3, 192};
+  int pos = start;
+  for (int i = 0; pos < kNumSamples; i++) {
+    const int size = std::min(kCallSizes[i % 5], kNumSamples - pos);
+    ASSERT_EQ(0, WebRtcAec_ProcessOffline(aec, &far[pos - kFarDelay],
+                                          &near[pos], NULL, &out_offline[pos],
+                                          NULL, size));
+    pos += size;
+  }
+  for (int i = start; i < kNumSamples; i++) {
+    ASSERT_EQ(out_stream[i], out_offline[i]) << i;
+  }
+
+  EXPECT_EQ(-1, WebRtcAec_BufferFarend(aec, &far[0], kBlockLen));
+  EXPECT_EQ(AEC_UNSUPPORTED_FUNCTION_ERROR, WebRtcAec_get_error_code(aec));
+  EXPECT_EQ(-1, WebRtcAec_Process(aec, &near[0], NULL, &out_stream[0], NULL,
+                                  kBlockLen, 20, 0));
+  EXPECT_EQ(AEC_UNSUPPORTED_FUNCTION_ERROR, WebRtcAec_get_error_code(aec));
+  EXPECT_EQ(0, WebRtcAec_Free(aec));
+}
+
+TEST_F(ApmTest, EchoControlMobileSuperWideband) {
+  // At 32 kHz the AECM scales each 64 sample block of the H band by a single
+  // gain, the mean NLP gain of the 4-8 kHz bins of the L band. The H band is
+  // delayed as the L band: one block in the NLP, plus the 48 samples stuffed
+  // while reframing the 80 sample frames into blocks. Comfort noise is
+  // turned off, as it is only added to the L band.
+  const int kNumFrames = 800;
+  const int kNumSamples = kNumFrames * 160;
+  const int kBlockLen = 64;
+  const int kDelay = kBlockLen + 48;
+  const int kStartup = kNumSamples / 40;
+  std::vector<WebRtc_Word16> far(kNumSamples);
+  std::vector<WebRtc_Word16> near(kNumSamples);
+  std::vector<WebRtc_Word16> near_high(kNumSamples);
+  std::vector<WebRtc_Word16> out;
+  std::vector<WebRtc_Word16> out_high;
+  ASSERT_TRUE(ReadBands(far_file_, kNumFrames, &far[0], NULL));
+  ASSERT_TRUE(ReadBands(near_file_, kNumFrames, &near[0], &near_high[0]));
+
+  void* aecm = NULL;
+  ASSERT_EQ(0, WebRtcAecm_Create(&aecm));
+  ASSERT_EQ(0, WebRtcAecm_Init(aecm, 32000, 32000));
+  EXPECT_EQ(-1, WebRtcAecm_Process(aecm, &near[0], NULL, NULL, &near[0],
+                                   &near_high[0], 160, 0));
+  EXPECT_EQ(0, WebRtcAecm_Free(aecm));
+
+  ProcessAecmSuperWideband(far, near, near_high, &out, &out_high);
+  int num_blocks = 0;
+  double mean_gain = 0;
+  for (int i = kStartup; i + kBlockLen + kDelay <= kNumSamples;
+       i += kBlockLen) {
+    double cross = 0;
+    double power = 0;
+    for (int n = i; n < i + kBlockLen; n++) {
+      cross += static_cast<double>(near_high[n]) * out_high[n + kDelay];
+      power += static_cast<double>(near_high[n]) * near_high[n];
+    }
+    if (power == 0) {
+      continue;
+    }
+    const double gain = cross / power;
+    EXPECT_GE(gain, 0) << i;
+    EXPECT_LE(gain, 1) << i;
+    for (int n = i; n < i + kBlockLen; n++) {
+      ASSERT_NEAR(gain * near_high[n], out_high[n + kDelay], 1.0) << n;
+    }
+    num_blocks++;
+    mean_gain += gain;
+  }
+  ASSERT_GT(num_blocks, 0);
+  mean_gain /= num_blocks;
+
+  // The echo of the recording is broadband, and the H band is suppressed.
+  EXPECT_LT(mean_gain, 0.8);
+
+  // With the echo confined to the lower half of the L band, the gain of the
+  // H band stays well above the suppression there. The farend is low-passed
+  // and its echo mixed with the high-passed nearend, both by (1 -+ z^-1)^4.
+  std::vector<WebRtc_Word16> far_low(kNumSamples);
+  std::vector<WebRtc_Word16> near_mix(kNumSamples);
+  for (int n = 4; n < kNumSamples; n++) {
+    far_low[n] = static_cast<WebRtc_Word16>((far[n] + 4 * far[n - 1] +
+        6 * far[n - 2] + 4 * far[n - 3] + far[n - 4]) / 16);
+    const int high_pass = (near[n] - 4 * near[n - 1] + 6 * near[n - 2] -
+        4 * near[n - 3] + near[n - 4]) / 16;
+    const int echo = n >= 36 ? far_low[n - 32] / 2 : 0;
+    near_mix[n] = static_cast<WebRtc_Word16>(
+        std::max(-32768, std::min(32767, echo + high_pass)));
+  }
+  ProcessAecmSuperWideband(far_low, near_mix, near_high, &out, &out_high);
+  double cross = 0;
+  double power = 0;
+  double power_low_in = 0;
+  double power_low_out = 0;
+  for (int n = kStartup; n + kDelay < kNumSamples; n++) {
+    const int m = n + kDelay;
+    cross += static_cast<double>(near_high[n]) * out_high[m];
+    power += static_cast<double>(near_high[n]) * near_high[n];
+    const double low_in = near_mix[n] + 4.0 * near_mix[n - 1] +
+        6.0 * near_mix[n - 2] + 4.0 * near_mix[n - 3] + near_mix[n - 4];
+    const double low_out = out[m] + 4.0 * out[m - 1] + 6.0 * out[m - 2] +
+        4.0 * out[m - 3] + out[m - 4];
+    power_low_in += low_in * low_in;
+    power_low_out += low_out * low_out;
+  }
+  EXPECT_GT(cross / power, 1.5 * std::sqrt(power_low_out / power_low_in));
 }
 
 TEST_F(ApmTest, EchoControlMobile) {
-  // AECM won't use super-wideband.
+  // Super-wideband is processed in the lower band, with the upper band
+  // attenuated by the lower band suppression.
   EXPECT_EQ(apm_->kNoError, apm_->set_sample_rate_hz(32000));
-  EXPECT_EQ(apm_->kBadSampleRateError, apm_->echo_control_mobile()->Enable(true));
+  EXPECT_EQ(apm_->kNoError, apm_->echo_control_mobile()->Enable(true));
+  for (int i = 0; i < 100; i++) {
+    int num_samples = frame_->_payloadDataLengthInSamples *
+                      frame_->_audioChannel;
+    ASSERT_EQ(static_cast<size_t>(num_samples),
+              fread(revframe_->_payloadData, sizeof(WebRtc_Word16),
+                    num_samples, far_file_));
+    ASSERT_EQ(static_cast<size_t>(num_samples),
+              fread(frame_->_payloadData, sizeof(WebRtc_Word16),
+                    num_samples, near_file_));
+    EXPECT_EQ(apm_->kNoError, apm_->AnalyzeReverseStream(revframe_));
+    EXPECT_EQ(apm_->kNoError, apm_->set_stream_delay_ms(0));
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+  }
+  EXPECT_EQ(apm_->kNoError, apm_->echo_control_mobile()->Enable(false));
   EXPECT_EQ(apm_->kNoError, apm_->set_sample_rate_hz(16000));
   // Turn AECM on (and AEC off)
   EXPECT_EQ(apm_->kNoError, apm_->echo_control_mobile()->Enable(true));
@@ -638,9 +1139,50 @@ TEST_F(ApmTest, EchoControlMobile) {
   EXPECT_EQ(apm_->kNoError,
       apm_->echo_control_mobile()->enable_comfort_noise(true));
   EXPECT_TRUE(apm_->echo_control_mobile()->is_comfort_noise_enabled());
+  // Set and get echo path
+  const size_t echo_path_size =
+      apm_->echo_control_mobile()->echo_path_size_bytes();
+  unsigned char* echo_path_in = new unsigned char[echo_path_size];
+  unsigned char* echo_path_out = new unsigned char[echo_path_size];
+  EXPECT_EQ(apm_->kNullPointerError,
+            apm_->echo_control_mobile()->SetEchoPath(NULL, echo_path_size));
+  EXPECT_EQ(apm_->kNullPointerError,
+            apm_->echo_control_mobile()->GetEchoPath(NULL, echo_path_size));
+  EXPECT_EQ(apm_->kBadParameterError,
+            apm_->echo_control_mobile()->GetEchoPath(echo_path_out, 1));
+  EXPECT_EQ(apm_->kNoError,
+            apm_->echo_control_mobile()->GetEchoPath(echo_path_out,
+                                                     echo_path_size));
+  for (size_t i = 0; i < echo_path_size; i++) {
+    echo_path_in[i] = echo_path_out[i] + 1;
+  }
+  EXPECT_EQ(apm_->kBadParameterError,
+            apm_->echo_control_mobile()->SetEchoPath(echo_path_in, 1));
+  EXPECT_EQ(apm_->kNoError,
+            apm_->echo_control_mobile()->SetEchoPath(echo_path_in,
+                                                     echo_path_size));
+  EXPECT_EQ(apm_->kNoError,
+            apm_->echo_control_mobile()->GetEchoPath(echo_path_out,
+                                                     echo_path_size));
+  for (size_t i = 0; i < echo_path_size; i++) {
+    EXPECT_EQ(echo_path_in[i], echo_path_out[i]);
+  }
+  // The echo path is kept across initialization.
+  EXPECT_EQ(apm_->kNoError, apm_->Initialize());
+  EXPECT_EQ(apm_->kNoError,
+            apm_->echo_control_mobile()->GetEchoPath(echo_path_out,
+                                                     echo_path_size));
+  for (size_t i = 0; i < echo_path_size; i++) {
+    EXPECT_EQ(echo_path_in[i], echo_path_out[i]);
+  }
   // Turn AECM off
   EXPECT_EQ(apm_->kNoError, apm_->echo_control_mobile()->Enable(false));
   EXPECT_FALSE(apm_->echo_control_mobile()->is_enabled());
+  EXPECT_EQ(apm_->kNotEnabledError,
+            apm_->echo_control_mobile()->GetEchoPath(echo_path_out,
+                                                     echo_path_size));
+  delete [] echo_path_in;
+  delete [] echo_path_out;
 }
 
 TEST_F(ApmTest, GainControl) {
@@ -738,6 +1280,68 @@ TEST_F(ApmTest, GainControl) {
     EXPECT_EQ(max_level[i], apm_->gain_control()->analog_level_maximum());
   }
 
+  // Testing channel linking. The right channel is the left one attenuated by
+  // 12 dB. The compressor gain depends on the level, so unlinked the quieter
+  // channel gets more gain; linked, both get the same gain. In compact mode
+  // only one AGC instance is held while linked.
+  EXPECT_EQ(apm_->kNoError,
+      apm_->gain_control()->set_mode(GainControl::kFixedDigital));
+  EXPECT_EQ(apm_->kNoError,
+      apm_->gain_control()->set_target_level_dbfs(3));
+  EXPECT_EQ(apm_->kNoError,
+      apm_->gain_control()->set_compression_gain_db(30));
+  EXPECT_EQ(apm_->kNoError, apm_->enable_compact_memory(true));
+  EXPECT_EQ(apm_->kNoError, apm_->gain_control()->Enable(true));
+  AudioProcessing::MemoryUsage usage;
+  EXPECT_EQ(apm_->kNoError, apm_->GetMemoryUsage(&usage));
+  const int unlinked_gain_control = usage.gain_control;
+  for (int linked = 1; linked >= 0; linked--) {
+    EXPECT_EQ(apm_->kNoError,
+        apm_->gain_control()->enable_channel_linking(linked == 1));
+    EXPECT_EQ(linked == 1,
+              apm_->gain_control()->is_channel_linking_enabled());
+    EXPECT_EQ(apm_->kNoError, apm_->GetMemoryUsage(&usage));
+    EXPECT_EQ(linked == 1 ? unlinked_gain_control / 2 : unlinked_gain_control,
+              usage.gain_control);
+    rewind(near_file_);
+    // The AGC output lags its input, so the gains are compared on the energy
+    // over all frames rather than per frame.
+    double input_power[2] = {0, 0};
+    double output_power[2] = {0, 0};
+    for (int i = 0; i < 300; i++) {
+      const int num_samples = frame_->_payloadDataLengthInSamples *
+                              frame_->_audioChannel;
+      ASSERT_EQ(static_cast<size_t>(num_samples),
+                fread(frame_->_payloadData, sizeof(WebRtc_Word16),
+                      num_samples, near_file_));
+      for (int j = 0; j < num_samples; j += 2) {
+        // The right channel is 12 dB down.
+        frame_->_payloadData[j + 1] = frame_->_payloadData[j] / 4;
+        input_power[0] += static_cast<double>(frame_->_payloadData[j]) *
+                          frame_->_payloadData[j];
+        input_power[1] += static_cast<double>(frame_->_payloadData[j + 1]) *
+                          frame_->_payloadData[j + 1];
+      }
+      EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+      for (int j = 0; j < num_samples; j++) {
+        output_power[j % 2] += static_cast<double>(frame_->_payloadData[j]) *
+                               frame_->_payloadData[j];
+      }
+    }
+    const double gain_left = std::sqrt(output_power[0] / input_power[0]);
+    const double gain_right = std::sqrt(output_power[1] / input_power[1]);
+    if (linked == 1) {
+      EXPECT_NEAR(1.0, gain_right / gain_left, 0.02);
+    } else {
+      EXPECT_GT(gain_right / gain_left, 1.1);
+    }
+  }
+
+  // Setting the same value again keeps the adapted state.
+  EXPECT_EQ(apm_->kNoError,
+      apm_->gain_control()->enable_channel_linking(false));
+  EXPECT_EQ(apm_->kNoError, apm_->enable_compact_memory(false));
+
   // TODO(ajm): stream_is_saturated() and stream_analog_level()
 
   // Turn AGC off
@@ -745,6 +1349,96 @@ TEST_F(ApmTest, GainControl) {
   EXPECT_FALSE(apm_->gain_control()->is_enabled());
 }
 
+TEST_F(ApmTest, GainControlAnalogBitExact) {
+  // Runs the analog AGC directly on the bands of the files, through
+  // WebRtcAgc_AddMicLinked() in adaptive analog mode and through
+  // WebRtcAgc_VirtualMicLinked() in adaptive digital mode, with the mic level
+  // fed back. The files are played quietly a few times, so that the levels
+  // rise and the gain of AddMic and VirtualMic is applied, and then loudly
+  // enough to saturate. The checksums cover the output of each call and the
+  // levels, which follow the envelope and energy state. They are those of
+  // the plain C implementation of the per-sample loops.
+  const int kNumFrames = 800;
+  const int kNumSamples = kNumFrames * 160;
+  const int kNumPasses = 4;
+  const int rates[] = {8000, 16000, 32000};
+  const WebRtc_UWord32 kChecksums[3][2][2] = {
+      {{0x119ff76d, 0x053a7afa}, {0xbe2f5ff9, 0x99ed2b5e}},
+      {{0xc8a8583c, 0xe7c0e39c}, {0x036f2334, 0x028ab4ec}},
+      {{0xcfdf5274, 0xd2f1d3d5}, {0xef7d4f0d, 0x79418150}}};
+  std::vector<WebRtc_Word16> low_band[2];
+  std::vector<WebRtc_Word16> high_band[2];
+  FILE* files[2] = {near_file_, far_file_};
+  for (int ch = 0; ch < 2; ch++) {
+    low_band[ch].resize(kNumSamples);
+    high_band[ch].resize(kNumSamples);
+    ASSERT_TRUE(ReadBands(files[ch], kNumFrames, &low_band[ch][0],
+                          &high_band[ch][0]));
+  }
+
+  for (size_t k = 0; k < sizeof(rates) / sizeof(*rates); k++) {
+    const WebRtc_Word16 frame_len = rates[k] == 8000 ? 80 : 160;
+    for (int num_channels = 1; num_channels <= 2; num_channels++) {
+      for (int digital = 0; digital < 2; digital++) {
+        void* agc = NULL;
+        ASSERT_EQ(0, WebRtcAgc_Create(&agc));
+        ASSERT_EQ(0, WebRtcAgc_Init(agc, 0, 255,
+            digital ? kAgcModeAdaptiveDigital : kAgcModeAdaptiveAnalog,
+            rates[k]));
+        WebRtc_UWord32 checksum = 0;
+        WebRtc_Word32 level = 127;
+        WebRtc_Word16 mic[2][160];
+        WebRtc_Word16 mic_high[2][160];
+        WebRtc_Word16* mic_ptr[2] = {mic[0], mic[1]};
+        WebRtc_Word16* mic_high_ptr[2] = {mic_high[0], mic_high[1]};
+        for (int pass = 0; pass < kNumPasses; pass++) {
+          // Q3 scale of the input.
+          const int scale = pass < kNumPasses - 1 ? 1 : 64;
+          for (int i = 0; i + frame_len <= kNumSamples; i += frame_len) {
+            for (int ch = 0; ch < num_channels; ch++) {
+              for (int n = 0; n < frame_len; n++) {
+                mic[ch][n] = WEBRTC_SPL_SAT(32767,
+                    (low_band[ch][i + n] * scale) >> 3, -32768);
+                mic_high[ch][n] = WEBRTC_SPL_SAT(32767,
+                    (high_band[ch][i + n] * scale) >> 3, -32768);
+              }
+            }
+            // In digital mode the analog level stays at its initial value.
+            WebRtc_Word32 mic_level = level;
+            if (digital) {
+              ASSERT_EQ(0, WebRtcAgc_VirtualMicLinked(agc, mic_ptr,
+                  mic_high_ptr, num_channels, frame_len, 127, &mic_level));
+            } else {
+              ASSERT_EQ(0, WebRtcAgc_AddMicLinked(agc, mic_ptr, mic_high_ptr,
+                  num_channels, frame_len));
+            }
+            for (int ch = 0; ch < num_channels; ch++) {
+              for (int n = 0; n < frame_len; n++) {
+                checksum = checksum * 31 +
+                    static_cast<WebRtc_UWord16>(mic[ch][n]);
+                if (rates[k] == 32000) {
+                  checksum = checksum * 31 +
+                      static_cast<WebRtc_UWord16>(mic_high[ch][n]);
+                }
+              }
+            }
+            WebRtc_UWord8 saturation_warning = 0;
+            ASSERT_EQ(0, WebRtcAgc_ProcessLinked(agc, mic_ptr, mic_high_ptr,
+                num_channels, frame_len, mic_ptr, mic_high_ptr, mic_level,
+                &level, 0, &saturation_warning));
+            checksum = checksum * 31 + static_cast<WebRtc_UWord32>(mic_level);
+            checksum = checksum * 31 + static_cast<WebRtc_UWord32>(level);
+            checksum = checksum * 31 + saturation_warning;
+          }
+        }
+        EXPECT_EQ(0, WebRtcAgc_Free(agc));
+        EXPECT_EQ(kChecksums[k][num_channels - 1][digital], checksum)
+            << rates[k] << " " << num_channels << " " << digital;
+      }
+    }
+  }
+}
+
 TEST_F(ApmTest, NoiseSuppression) {
   // Tesing invalid suppression levels
   EXPECT_EQ(apm_->kBadParameterError,
@@ -773,6 +1467,353 @@ TEST_F(ApmTest, NoiseSuppression) {
   EXPECT_TRUE(apm_->noise_suppression()->is_enabled());
   EXPECT_EQ(apm_->kNoError, apm_->noise_suppression()->Enable(false));
   EXPECT_FALSE(apm_->noise_suppression()->is_enabled());
+
+  // Testing the low-delay mode, see NoiseSuppressionLowDelay for its output.
+  EXPECT_FALSE(apm_->noise_suppression()->is_low_delay_enabled());
+  EXPECT_EQ(apm_->kNoError, apm_->noise_suppression()->enable_low_delay(true));
+  EXPECT_TRUE(apm_->noise_suppression()->is_low_delay_enabled());
+  EXPECT_EQ(apm_->kNoError, apm_->noise_suppression()->enable_low_delay(false));
+  EXPECT_FALSE(apm_->noise_suppression()->is_low_delay_enabled());
+
+  int err;
+  // Testing fusion with the AEC
+  EXPECT_FALSE(
+      apm_->noise_suppression()->is_echo_cancellation_fusion_enabled());
+  err = apm_->noise_suppression()->enable_echo_cancellation_fusion(true);
+  if (err == apm_->kUnsupportedFunctionError) {
+    // Only the floating-point NS supports fusion.
+    EXPECT_FALSE(
+        apm_->noise_suppression()->is_echo_cancellation_fusion_enabled());
+    return;
+  }
+  EXPECT_EQ(apm_->kNoError, err);
+  EXPECT_TRUE(apm_->noise_suppression()->is_echo_cancellation_fusion_enabled());
+
+  EXPECT_EQ(apm_->kNoError, apm_->echo_cancellation()->Enable(true));
+  EXPECT_EQ(apm_->kNoError, apm_->noise_suppression()->Enable(true));
+  for (int i = 0; i < 300; i++) {
+    // Switch between the fused and the separate NS while processing.
+    if (i == 150) {
+      EXPECT_EQ(apm_->kNoError, apm_->echo_cancellation()->Enable(false));
+    } else if (i == 200) {
+      EXPECT_EQ(apm_->kNoError, apm_->echo_cancellation()->Enable(true));
+    }
+
+    int num_samples = revframe_->_payloadDataLengthInSamples *
+                      revframe_->_audioChannel;
+    ASSERT_EQ(static_cast<size_t>(num_samples),
+              fread(revframe_->_payloadData, sizeof(WebRtc_Word16),
+                    num_samples, far_file_));
+    EXPECT_EQ(apm_->kNoError, apm_->AnalyzeReverseStream(revframe_));
+
+    num_samples = frame_->_payloadDataLengthInSamples * frame_->_audioChannel;
+    ASSERT_EQ(static_cast<size_t>(num_samples),
+              fread(frame_->_payloadData, sizeof(WebRtc_Word16),
+                    num_samples, near_file_));
+    EXPECT_EQ(apm_->kNoError, apm_->set_stream_delay_ms(0));
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+  }
+
+  EXPECT_EQ(apm_->kNoError,
+            apm_->noise_suppression()->enable_echo_cancellation_fusion(false));
+  EXPECT_FALSE(
+      apm_->noise_suppression()->is_echo_cancellation_fusion_enabled());
+}
+
+TEST_F(ApmTest, NoiseSuppressionLowDelay) {
+  // Runs the regular (|apms[0]|) and the low-delay (|apms[1]|) NS on the same
+  // mono signal. The delay is found as the lag of the largest correlation
+  // between the input and the output.
+  const int rates[] = {8000, 16000, 32000};
+  const int kNumFrames = 500;
+  const int kMaxLag = 400;
+  int delays[3][2];
+  for (size_t k = 0; k < sizeof(rates) / sizeof(*rates); k++) {
+    const int samples_per_channel = rates[k] / 100;
+    const int num_samples = kNumFrames * samples_per_channel;
+    std::vector<WebRtc_Word16> input(num_samples);
+    std::vector<WebRtc_Word16> output[2];
+    ASSERT_EQ(static_cast<size_t>(num_samples),
+              fread(&input[0], sizeof(WebRtc_Word16), num_samples,
+                    near_file_));
+    for (int j = 0; j < 2; j++) {
+      AudioProcessing* apm = AudioProcessing::Create(j);
+      ASSERT_TRUE(apm != NULL);
+      EXPECT_EQ(apm_->kNoError, apm->set_sample_rate_hz(rates[k]));
+      EXPECT_EQ(apm_->kNoError, apm->set_num_channels(1, 1));
+      EXPECT_EQ(apm_->kNoError, apm->noise_suppression()->Enable(true));
+      EXPECT_EQ(apm_->kNoError,
+                apm->noise_suppression()->enable_low_delay(j == 1));
+      output[j].resize(num_samples);
+      AudioFrame frame;
+      frame._payloadDataLengthInSamples = samples_per_channel;
+      frame._audioChannel = 1;
+      frame._frequencyInHz = rates[k];
+      for (int i = 0; i < num_samples; i += samples_per_channel) {
+        memcpy(frame._payloadData, &input[i],
+               sizeof(WebRtc_Word16) * samples_per_channel);
+        EXPECT_EQ(apm_->kNoError, apm->ProcessStream(&frame));
+        memcpy(&output[j][i], frame._payloadData,
+               sizeof(WebRtc_Word16) * samples_per_channel);
+      }
+      AudioProcessing::Destroy(apm);
+
+      double max_correlation = 0;
+      delays[k][j] = -1;
+      for (int lag = 0; lag < kMaxLag; lag++) {
+        double correlation = 0;
+        for (int n = num_samples / 5; n < num_samples - kMaxLag; n++) {
+          correlation += static_cast<double>(input[n]) * output[j][n + lag];
+        }
+        if (correlation > max_correlation) {
+          max_correlation = correlation;
+          delays[k][j] = lag;
+        }
+      }
+    }
+
+    // Attenuation of the quiet frames, and of all frames, past start-up.
+    double quiet_energy[3] = {0, 0, 0};
+    double total_energy[3] = {0, 0, 0};
+    for (int i = num_samples / 5; i < num_samples - kMaxLag;
+         i += samples_per_channel) {
+      double energy[3] = {0, 0, 0};
+      for (int n = i; n < i + samples_per_channel; n++) {
+        energy[0] += static_cast<double>(input[n]) * input[n];
+        for (int j = 0; j < 2; j++) {
+          const WebRtc_Word16 y = output[j][n + delays[k][j]];
+          energy[j + 1] += static_cast<double>(y) * y;
+        }
+      }
+      for (int j = 0; j < 3; j++) {
+        total_energy[j] += energy[j];
+        if (energy[0] < 1e4 * samples_per_channel) {
+          quiet_energy[j] += energy[j];
+        }
+      }
+    }
+    // The noise is suppressed by more than 6 dB in both modes, with the low
+    // delay mode on par with the regular one, and the speech is kept.
+    EXPECT_LT(quiet_energy[1], 0.25 * quiet_energy[0]) << rates[k];
+    EXPECT_LT(quiet_energy[2], 0.25 * quiet_energy[0]) << rates[k];
+    EXPECT_GT(quiet_energy[2], quiet_energy[1] / 2) << rates[k];
+    EXPECT_LT(quiet_energy[2], quiet_energy[1] * 2) << rates[k];
+    EXPECT_GT(total_energy[2], total_energy[1] / 1.25) << rates[k];
+    EXPECT_LT(total_energy[2], total_energy[1] * 1.25) << rates[k];
+  }
+
+  // The overlap of the analysis windows is halved, from 6 to 3 ms. At 32 kHz
+  // the delay of the band split is added, which is the same for both modes.
+  EXPECT_EQ(48, delays[0][0]);
+  EXPECT_EQ(96, delays[1][0]);
+  EXPECT_EQ(48, delays[1][1]);
+  EXPECT_EQ(96, delays[2][0] - delays[2][1]);
+  // Only the floating-point NS supports fusion, and only it has a low-delay
+  // mode at 8 kHz; the fixed-point NS keeps its regular delay there.
+  if (apm_->noise_suppression()->enable_echo_cancellation_fusion(true) ==
+      apm_->kUnsupportedFunctionError) {
+    EXPECT_EQ(48, delays[0][1]);
+  } else {
+    EXPECT_EQ(24, delays[0][1]);
+    EXPECT_EQ(apm_->kNoError,
+        apm_->noise_suppression()->enable_echo_cancellation_fusion(false));
+  }
+}
+
+TEST_F(ApmTest, NoiseSuppressionFusion) {
+  // Compares the fused NS with the NS running on the output of the AEC.
+  // |apms[0]| runs the AEC only, |apms[1]| the AEC and the separate NS, and
+  // |apms[2]| the fused NS.
+  EXPECT_FALSE(
+      apm_->noise_suppression()->is_echo_cancellation_fusion_enabled());
+  int err = apm_->noise_suppression()->enable_echo_cancellation_fusion(true);
+  if (err == apm_->kUnsupportedFunctionError) {
+    // Only the floating-point NS supports fusion.
+    EXPECT_FALSE(
+        apm_->noise_suppression()->is_echo_cancellation_fusion_enabled());
+    return;
+  }
+  EXPECT_EQ(apm_->kNoError, err);
+  EXPECT_TRUE(apm_->noise_suppression()->is_echo_cancellation_fusion_enabled());
+
+  AudioFrame frames[3];
+  const int rates[] = {8000, 16000, 32000};
+  for (size_t k = 0; k < sizeof(rates) / sizeof(*rates); k++) {
+    const int samples_per_channel = rates[k] / 100;
+    AudioProcessing* apms[3];
+    for (int j = 0; j < 3; j++) {
+      apms[j] = AudioProcessing::Create(j);
+      ASSERT_TRUE(apms[j] != NULL);
+      EXPECT_EQ(apm_->kNoError, apms[j]->set_sample_rate_hz(rates[k]));
+      EXPECT_EQ(apm_->kNoError, apms[j]->set_num_channels(1, 1));
+      EXPECT_EQ(apm_->kNoError, apms[j]->set_num_reverse_channels(1));
+      EXPECT_EQ(apm_->kNoError, apms[j]->echo_cancellation()->Enable(true));
+      EXPECT_EQ(apm_->kNoError, apms[j]->noise_suppression()->Enable(j > 0));
+    }
+    EXPECT_EQ(apm_->kNoError,
+        apms[2]->noise_suppression()->enable_echo_cancellation_fusion(true));
+    revframe_->_payloadDataLengthInSamples = samples_per_channel;
+    revframe_->_audioChannel = 1;
+    revframe_->_frequencyInHz = rates[k];
+
+    int startup_frames = 0;
+    double energy[3] = {0, 0, 0};
+    for (int i = 0; i < 500; i++) {
+      ASSERT_EQ(static_cast<size_t>(samples_per_channel),
+                fread(revframe_->_payloadData, sizeof(WebRtc_Word16),
+                      samples_per_channel, far_file_));
+      ASSERT_EQ(static_cast<size_t>(samples_per_channel),
+                fread(frames[0]._payloadData, sizeof(WebRtc_Word16),
+                      samples_per_channel, near_file_));
+      frames[0]._payloadDataLengthInSamples = samples_per_channel;
+      frames[0]._audioChannel = 1;
+      frames[0]._frequencyInHz = rates[k];
+      frames[1] = frames[0];
+      frames[2] = frames[0];
+      for (int j = 0; j < 3; j++) {
+        EXPECT_EQ(apm_->kNoError, apms[j]->AnalyzeReverseStream(revframe_));
+        EXPECT_EQ(apm_->kNoError, apms[j]->set_stream_delay_ms(0));
+        EXPECT_EQ(apm_->kNoError, apms[j]->ProcessStream(&frames[j]));
+      }
+
+      if (startup_frames == i &&
+          memcmp(frames[0]._payloadData, frames[2]._payloadData,
+                 sizeof(WebRtc_Word16) * samples_per_channel) == 0) {
+        startup_frames++;
+      }
+      if (i >= 100) {
+        for (int j = 0; j < 3; j++) {
+          for (int n = 0; n < samples_per_channel; n++) {
+            energy[j] += static_cast<double>(frames[j]._payloadData[n]) *
+                frames[j]._payloadData[n];
+          }
+        }
+      }
+    }
+
+    // No noise is suppressed by the fused NS before the AEC has started up,
+    // which takes a few frames here.
+    EXPECT_GT(startup_frames, 0) << rates[k];
+    EXPECT_LT(startup_frames, 50) << rates[k];
+
+    // The fused NS runs its models on the 65 bins of the AEC at every rate,
+    // rather than on the 129 bins of the separate NS at 16 and 32 kHz. The
+    // output differs, but the suppression has to be on the same order.
+    EXPECT_LT(energy[1], 0.7 * energy[0]) << rates[k];
+    EXPECT_LT(energy[2], 0.7 * energy[0]) << rates[k];
+    EXPECT_GT(energy[2], energy[1] / 1.5) << rates[k];
+    EXPECT_LT(energy[2], energy[1] * 1.5) << rates[k];
+
+    for (int j = 0; j < 3; j++) {
+      AudioProcessing::Destroy(apms[j]);
+    }
+  }
+}
+
+TEST_F(ApmTest, NoiseSuppressionFixedBitExact) {
+  // Runs the fixed-point NS directly on a fixed input, the bands of the
+  // nearend file, for each rate and policy. The checksums of the output are
+  // those of the implementation before the analysis buffer was made
+  // circular. At 8 and 16 kHz the L band is used as the input.
+  const int kNumFrames = 300;
+  const int kNumSamples = kNumFrames * 160;
+  const int rates[] = {8000, 16000, 32000};
+  const WebRtc_UWord32 kChecksums[3][4] = {
+      {0x82b148db, 0xc873469f, 0x5e027deb, 0xb9ba1a83},
+      {0x1d550dfe, 0x9cb84404, 0xb82e97bf, 0x0ce18f8f},
+      {0x967d6a58, 0x93354953, 0x90ee4159, 0x22e41645}};
+  std::vector<WebRtc_Word16> low_band(kNumSamples);
+  std::vector<WebRtc_Word16> high_band(kNumSamples);
+  ASSERT_TRUE(ReadBands(near_file_, kNumFrames, &low_band[0], &high_band[0]));
+  for (size_t k = 0; k < sizeof(rates) / sizeof(*rates); k++) {
+    const int frame_len = rates[k] == 8000 ? 80 : 160;
+    for (int policy = 0; policy < 4; policy++) {
+      NsxHandle* nsx = NULL;
+      ASSERT_EQ(0, WebRtcNsx_Create(&nsx));
+      ASSERT_EQ(0, WebRtcNsx_Init(nsx, rates[k]));
+      ASSERT_EQ(0, WebRtcNsx_set_policy(nsx, policy));
+      WebRtc_UWord32 checksum = 0;
+      WebRtc_Word16 out[160];
+      WebRtc_Word16 out_high[160];
+      for (int i = 0; i + frame_len <= kNumSamples; i += frame_len) {
+        ASSERT_EQ(0, WebRtcNsx_Process(nsx, &low_band[i],
+            rates[k] == 32000 ? &high_band[i] : NULL, out,
+            rates[k] == 32000 ? out_high : NULL));
+        for (int n = 0; n < frame_len; n++) {
+          checksum = checksum * 31 + static_cast<WebRtc_UWord16>(out[n]);
+          if (rates[k] == 32000) {
+            checksum = checksum * 31 +
+                static_cast<WebRtc_UWord16>(out_high[n]);
+          }
+        }
+      }
+      EXPECT_EQ(0, WebRtcNsx_Free(nsx));
+      EXPECT_EQ(kChecksums[k][policy], checksum) << rates[k] << " " << policy;
+    }
+  }
+}
+
+TEST_F(ApmTest, ActivityGating) {
+  // Runs |apm_| with, and |apm_ref| without, activity gating on speech, a
+  // quiet stretch and speech again. The outputs are the same until the near
+  // end turns inactive, 200 ms into the quiet stretch, and it is active again
+  // from the first frame of speech.
+  const int kNumFrames = 300;
+  const int kQuietStart = 100;
+  const int kQuietEnd = 200;
+  const int kHangoverFrames = 20;
+  EXPECT_FALSE(apm_->is_activity_gating_enabled());
+  EXPECT_TRUE(apm_->stream_is_active());
+
+  AudioProcessing* apm_ref = AudioProcessing::Create(1);
+  ASSERT_TRUE(apm_ref != NULL);
+  EXPECT_EQ(apm_->kNoError, apm_ref->set_sample_rate_hz(32000));
+  EXPECT_EQ(apm_->kNoError, apm_ref->set_num_channels(2, 2));
+  AudioProcessing* apms[] = {apm_, apm_ref};
+  for (int j = 0; j < 2; j++) {
+    EXPECT_EQ(apm_->kNoError, apms[j]->noise_suppression()->Enable(true));
+    EXPECT_EQ(apm_->kNoError, apms[j]->gain_control()->set_mode(
+        GainControl::kAdaptiveDigital));
+    EXPECT_EQ(apm_->kNoError, apms[j]->gain_control()->Enable(true));
+  }
+  EXPECT_EQ(apm_->kNoError, apm_->enable_activity_gating(true));
+  EXPECT_TRUE(apm_->is_activity_gating_enabled());
+
+  AudioFrame ref_frame;
+  const int num_samples = frame_->_payloadDataLengthInSamples *
+                          frame_->_audioChannel;
+  for (int i = 0; i < kNumFrames; i++) {
+    if (i >= kQuietStart && i < kQuietEnd) {
+      // Below the activity threshold, but not digital silence.
+      for (int n = 0; n < num_samples; n++) {
+        frame_->_payloadData[n] = static_cast<WebRtc_Word16>(n % 7 - 3);
+      }
+    } else {
+      ASSERT_EQ(static_cast<size_t>(num_samples),
+                fread(frame_->_payloadData, sizeof(WebRtc_Word16),
+                      num_samples, near_file_));
+    }
+    ref_frame = *frame_;
+
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+    EXPECT_EQ(apm_->kNoError, apm_ref->ProcessStream(&ref_frame));
+    EXPECT_TRUE(apm_ref->stream_is_active());
+
+    const bool active = i < kQuietStart + kHangoverFrames - 1 ||
+                        i >= kQuietEnd;
+    ASSERT_EQ(active, apm_->stream_is_active()) << i;
+    if (i < kQuietStart + kHangoverFrames - 1) {
+      for (int n = 0; n < num_samples; n++) {
+        ASSERT_EQ(ref_frame._payloadData[n], frame_->_payloadData[n]) << i;
+      }
+    }
+  }
+
+  EXPECT_EQ(apm_->kNoError, apm_->enable_activity_gating(false));
+  EXPECT_FALSE(apm_->is_activity_gating_enabled());
+  EXPECT_TRUE(apm_->stream_is_active());
+
+  AudioProcessing::Destroy(apm_ref);
 }
 
 TEST_F(ApmTest, HighPassFilter) {
@@ -846,6 +1887,746 @@ TEST_F(ApmTest, VoiceDetection) {
   // TODO(bjornv): Add tests for streamed voice; stream_has_voice()
 }
 
+TEST_F(ApmTest, NoComponentsEnabled) {
+  // With every component disabled the capture stream should pass through
+  // untouched, apart from the downmix, including at 32 kHz.
+  WebRtc_Word16 input[320 * 2];
+  for (int i = 0; i < 50; i++) {
+    size_t read_count = fread(frame_->_payloadData,
+                              sizeof(WebRtc_Word16),
+                              frame_->_payloadDataLengthInSamples * 2,
+                              near_file_);
+    ASSERT_EQ(frame_->_payloadDataLengthInSamples * 2, read_count);
+    memcpy(input, frame_->_payloadData, sizeof(WebRtc_Word16) * 320 * 2);
+
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+    EXPECT_EQ(0, memcmp(input, frame_->_payloadData,
+                        sizeof(WebRtc_Word16) * 320 * 2));
+  }
+
+  // Once a stage is planned the band split starts over, as if the bypassed
+  // audio had never been seen.
+  WebRtc_Word16 channel[320];
+  WebRtc_Word16 low_band[160];
+  WebRtc_Word16 high_band[160];
+  WebRtc_Word16 expected[2][320];
+  WebRtc_Word32 filter_states[2][4][6];
+  memset(filter_states, 0, sizeof(filter_states));
+  EXPECT_EQ(apm_->kNoError, apm_->voice_detection()->Enable(true));
+  for (int i = 0; i < 50; i++) {
+    size_t read_count = fread(frame_->_payloadData,
+                              sizeof(WebRtc_Word16),
+                              frame_->_payloadDataLengthInSamples * 2,
+                              near_file_);
+    ASSERT_EQ(frame_->_payloadDataLengthInSamples * 2, read_count);
+    for (int j = 0; j < 2; j++) {
+      for (int k = 0; k < 320; k++) {
+        channel[k] = frame_->_payloadData[k * 2 + j];
+      }
+      WebRtcSpl_AnalysisQMF(channel, low_band, high_band,
+                            filter_states[j][0], filter_states[j][1]);
+      WebRtcSpl_SynthesisQMF(low_band, high_band, expected[j],
+                             filter_states[j][2], filter_states[j][3]);
+    }
+
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+    for (int k = 0; k < 320; k++) {
+      ASSERT_EQ(expected[0][k], frame_->_payloadData[k * 2]);
+      ASSERT_EQ(expected[1][k], frame_->_payloadData[k * 2 + 1]);
+    }
+  }
+  EXPECT_EQ(apm_->kNoError, apm_->voice_detection()->Enable(false));
+
+  EXPECT_EQ(apm_->kNoError, apm_->set_sample_rate_hz(16000));
+  frame_->_payloadDataLengthInSamples = 160;
+  frame_->_frequencyInHz = 16000;
+  for (int i = 0; i < 100; i++) {
+    size_t read_count = fread(frame_->_payloadData,
+                              sizeof(WebRtc_Word16),
+                              frame_->_payloadDataLengthInSamples * 2,
+                              near_file_);
+    ASSERT_EQ(frame_->_payloadDataLengthInSamples * 2, read_count);
+    memcpy(input, frame_->_payloadData, sizeof(WebRtc_Word16) * 160 * 2);
+
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+    EXPECT_EQ(0, memcmp(input, frame_->_payloadData,
+                        sizeof(WebRtc_Word16) * 160 * 2));
+  }
+
+  EXPECT_EQ(apm_->kNoError, apm_->set_num_channels(2, 1));
+  WebRtc_Word16 mixed[160];
+  for (int i = 0; i < 100; i++) {
+    frame_->_audioChannel = 2;
+    size_t read_count = fread(frame_->_payloadData,
+                              sizeof(WebRtc_Word16),
+                              frame_->_payloadDataLengthInSamples * 2,
+                              near_file_);
+    ASSERT_EQ(frame_->_payloadDataLengthInSamples * 2, read_count);
+    MixStereoToMono(frame_->_payloadData, mixed,
+                    frame_->_payloadDataLengthInSamples);
+
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+    EXPECT_EQ(1, frame_->_audioChannel);
+    EXPECT_EQ(0, memcmp(mixed, frame_->_payloadData, sizeof(mixed)));
+  }
+}
+
+TEST_F(ApmTest, FloatInterface) {
+  // The float interface should give the same output as the AudioFrame one
+  // when the input is on the 16-bit grid. The downmix is done in float, so
+  // the AudioFrame interface is given it rounded.
+  AudioProcessing* apm_float = AudioProcessing::Create(1);
+  ASSERT_TRUE(apm_float != NULL);
+  AudioProcessing* apms[] = {apm_, apm_float};
+  EXPECT_EQ(apm_->kNoError, apm_->set_num_channels(1, 1));
+  EXPECT_EQ(apm_->kNoError, apm_float->set_num_channels(2, 1));
+  for (int j = 0; j < 2; j++) {
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_sample_rate_hz(32000));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_reverse_channels(2));
+    EXPECT_EQ(apm_->kNoError, apms[j]->echo_cancellation()->Enable(true));
+    EXPECT_EQ(apm_->kNoError, apms[j]->gain_control()->set_mode(
+        GainControl::kAdaptiveDigital));
+    EXPECT_EQ(apm_->kNoError, apms[j]->gain_control()->Enable(true));
+    EXPECT_EQ(apm_->kNoError, apms[j]->high_pass_filter()->Enable(true));
+    EXPECT_EQ(apm_->kNoError, apms[j]->noise_suppression()->Enable(true));
+  }
+
+  EXPECT_EQ(apm_->kNullPointerError,
+            apm_float->ProcessStream(static_cast<float* const*>(NULL), 320));
+
+  const int kSamples = 320;
+  float left[kSamples];
+  float right[kSamples];
+  float* capture[] = {left, right};
+  float far_left[kSamples];
+  float far_right[kSamples];
+  const float* render[] = {far_left, far_right};
+  EXPECT_EQ(apm_->kBadDataLengthError,
+            apm_float->ProcessStream(capture, kSamples / 2));
+  for (int i = 0; i < 100; i++) {
+    size_t read_count = fread(revframe_->_payloadData,
+                              sizeof(WebRtc_Word16),
+                              kSamples * 2,
+                              far_file_);
+    ASSERT_EQ(kSamples * 2, static_cast<int>(read_count));
+    read_count = fread(frame_->_payloadData,
+                       sizeof(WebRtc_Word16),
+                       kSamples * 2,
+                       near_file_);
+    ASSERT_EQ(kSamples * 2, static_cast<int>(read_count));
+    for (int j = 0; j < kSamples; j++) {
+      far_left[j] = revframe_->_payloadData[2 * j];
+      far_right[j] = revframe_->_payloadData[2 * j + 1];
+      left[j] = frame_->_payloadData[2 * j];
+      right[j] = frame_->_payloadData[2 * j + 1];
+      const float mixed = (left[j] + right[j]) * 0.5f;
+      frame_->_payloadData[j] =
+          static_cast<WebRtc_Word16>(mixed + (mixed > 0 ? 0.5f : -0.5f));
+    }
+
+    frame_->_audioChannel = 1;
+    EXPECT_EQ(apm_->kNoError, apm_->AnalyzeReverseStream(revframe_));
+    EXPECT_EQ(apm_->kNoError, apm_->set_stream_delay_ms(0));
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+    EXPECT_EQ(1, frame_->_audioChannel);
+
+    EXPECT_EQ(apm_->kNoError,
+              apm_float->AnalyzeReverseStream(render, kSamples));
+    EXPECT_EQ(apm_->kNoError, apm_float->set_stream_delay_ms(0));
+    EXPECT_EQ(apm_->kNoError, apm_float->ProcessStream(capture, kSamples));
+
+    for (int j = 0; j < kSamples; j++) {
+      ASSERT_EQ(frame_->_payloadData[j], static_cast<WebRtc_Word16>(left[j]));
+    }
+  }
+
+  AudioProcessing::Destroy(apm_float);
+}
+
+TEST_F(ApmTest, FloatInterfaceConversion) {
+  // With only an analysis component enabled, the float interface returns the
+  // input rounded and saturated to the 16-bit range.
+  EXPECT_EQ(apm_->kNoError, apm_->set_sample_rate_hz(16000));
+  EXPECT_EQ(apm_->kNoError, apm_->set_num_channels(1, 1));
+  EXPECT_EQ(apm_->kNoError, apm_->voice_detection()->Enable(true));
+
+  const float kInf = std::numeric_limits<float>::infinity();
+  const float kInput[] = {std::numeric_limits<float>::quiet_NaN(),
+                          -std::numeric_limits<float>::quiet_NaN(),
+                          kInf, -kInf, 1e10f, -1e10f, 32766.6f, -32768.4f,
+                          0.5f, -0.5f, 1.49f, -1.5f, 0.f};
+  const WebRtc_Word16 kOutput[] = {0, 0, 32767, -32768, 32767, -32768, 32767,
+                                   -32768, 1, -1, 1, -2, 0};
+  const int kSamples = 160;
+  float data[kSamples];
+  float* capture[] = {data};
+  for (int i = 0; i < kSamples; i++) {
+    data[i] = 0;
+  }
+  memcpy(data, kInput, sizeof(kInput));
+  EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(capture, kSamples));
+  for (size_t i = 0; i < sizeof(kOutput) / sizeof(*kOutput); i++) {
+    EXPECT_EQ(kOutput[i], data[i]) << i;
+  }
+}
+
+TEST_F(ApmTest, FloatInterfaceRange) {
+  // Whichever components are enabled, the float output is limited to the
+  // 16-bit range, with NaN taken as zero. It is only rounded by the 16-bit
+  // components, so not while the echo canceller passes the input through at
+  // start up.
+  EXPECT_EQ(apm_->kNoError, apm_->set_sample_rate_hz(16000));
+  EXPECT_EQ(apm_->kNoError, apm_->set_num_channels(1, 1));
+
+  const float kInf = std::numeric_limits<float>::infinity();
+  const float kInput[] = {std::numeric_limits<float>::quiet_NaN(),
+                          -std::numeric_limits<float>::quiet_NaN(),
+                          kInf, -kInf, 1e10f, -1e10f, 32766.6f, -32768.4f,
+                          0.5f, -1.5f, 0.f};
+  const float kOutput[] = {0.f, 0.f, 32767.f, -32768.f, 32767.f, -32768.f,
+                           32766.6f, -32768.f, 0.5f, -1.5f, 0.f};
+  const int kInputLength = sizeof(kInput) / sizeof(*kInput);
+  const int kSamples = 160;
+  float data[kSamples];
+  float* capture[] = {data};
+
+  for (int config = 0; config < 3; config++) {
+    if (config == 1) {
+      EXPECT_EQ(apm_->kNoError, apm_->echo_cancellation()->Enable(true));
+    } else if (config == 2) {
+      EXPECT_EQ(apm_->kNoError, apm_->noise_suppression()->Enable(true));
+    }
+
+    for (int i = 0; i < 100; i++) {
+      for (int j = 0; j < kSamples; j++) {
+        data[j] = kInput[j % kInputLength] * (j % 7 == 0 ? 1.f : 0.25f);
+      }
+      memcpy(data, kInput, sizeof(kInput));
+      EXPECT_EQ(apm_->kNoError, apm_->set_stream_delay_ms(0));
+      EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(capture, kSamples));
+
+      if (config < 2 && i == 0) {
+        for (int j = 0; j < kInputLength; j++) {
+          EXPECT_EQ(kOutput[j], data[j]) << config << " " << j;
+        }
+      }
+      for (int j = 0; j < kSamples; j++) {
+        ASSERT_TRUE(data[j] >= -32768.f && data[j] <= 32767.f)
+            << config << " " << i << " " << j << " " << data[j];
+      }
+    }
+
+    EXPECT_EQ(apm_->kNoError, apm_->Initialize());
+  }
+}
+
+TEST_F(ApmTest, FloatInterfaceEchoCancellation) {
+  // On 16-bit input, the float interface should stay close to the AudioFrame
+  // one, while the echo canceller leaves its output unrounded.
+  AudioProcessing* apm_float = AudioProcessing::Create(1);
+  ASSERT_TRUE(apm_float != NULL);
+  AudioProcessing* apms[] = {apm_, apm_float};
+  for (int j = 0; j < 2; j++) {
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_sample_rate_hz(16000));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_channels(1, 1));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_reverse_channels(1));
+    EXPECT_EQ(apm_->kNoError, apms[j]->echo_cancellation()->Enable(true));
+  }
+
+  const int kSamples = 160;
+  float data[kSamples];
+  float far_data[kSamples];
+  float* capture[] = {data};
+  const float* render[] = {far_data};
+  frame_->_audioChannel = 1;
+  frame_->_payloadDataLengthInSamples = kSamples;
+  frame_->_frequencyInHz = 16000;
+  revframe_->_audioChannel = 1;
+  revframe_->_payloadDataLengthInSamples = kSamples;
+  revframe_->_frequencyInHz = 16000;
+  double error_energy = 0;
+  double energy = 0;
+  int unrounded = 0;
+  for (int i = 0; i < 500; i++) {
+    size_t read_count = fread(revframe_->_payloadData,
+                              sizeof(WebRtc_Word16),
+                              kSamples,
+                              far_file_);
+    ASSERT_EQ(kSamples, static_cast<int>(read_count));
+    read_count = fread(frame_->_payloadData,
+                       sizeof(WebRtc_Word16),
+                       kSamples,
+                       near_file_);
+    ASSERT_EQ(kSamples, static_cast<int>(read_count));
+    for (int j = 0; j < kSamples; j++) {
+      far_data[j] = revframe_->_payloadData[j];
+      data[j] = frame_->_payloadData[j];
+    }
+
+    EXPECT_EQ(apm_->kNoError, apm_->AnalyzeReverseStream(revframe_));
+    EXPECT_EQ(apm_->kNoError, apm_->set_stream_delay_ms(0));
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+
+    EXPECT_EQ(apm_->kNoError,
+              apm_float->AnalyzeReverseStream(render, kSamples));
+    EXPECT_EQ(apm_->kNoError, apm_float->set_stream_delay_ms(0));
+    EXPECT_EQ(apm_->kNoError, apm_float->ProcessStream(capture, kSamples));
+
+    for (int j = 0; j < kSamples; j++) {
+      const double error = data[j] - frame_->_payloadData[j];
+      error_energy += error * error;
+      energy += static_cast<double>(data[j]) * data[j];
+      if (data[j] != static_cast<int>(data[j])) {
+        unrounded++;
+      }
+    }
+  }
+
+  // The AudioFrame output is truncated, so the two differ by less than one on
+  // average.
+  const int kTotalSamples = 500 * kSamples;
+  EXPECT_LT(error_energy, kTotalSamples);
+  EXPECT_GT(energy, 1000.0 * kTotalSamples);
+  EXPECT_GT(unrounded, kTotalSamples / 2);
+
+  AudioProcessing::Destroy(apm_float);
+}
+
+TEST_F(ApmTest, FrameView) {
+  // A view on the caller's buffers should give the same output as the
+  // AudioFrame interface.
+  AudioProcessing* apm_view = AudioProcessing::Create(1);
+  ASSERT_TRUE(apm_view != NULL);
+  AudioProcessing* apms[] = {apm_, apm_view};
+  for (int j = 0; j < 2; j++) {
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_sample_rate_hz(32000));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_channels(2, 1));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_reverse_channels(2));
+    EXPECT_EQ(apm_->kNoError, apms[j]->echo_cancellation()->Enable(true));
+    EXPECT_EQ(apm_->kNoError, apms[j]->high_pass_filter()->Enable(true));
+    EXPECT_EQ(apm_->kNoError, apms[j]->noise_suppression()->Enable(true));
+  }
+
+  const int kSamples = 320;
+  WebRtc_Word16 capture[kSamples * 2];
+  WebRtc_Word16 render[kSamples * 2];
+  AudioFrameView capture_view(capture, kSamples, 32000, 2);
+  AudioFrameView render_view(render, kSamples, 32000, 2);
+  EXPECT_EQ(apm_->kNullPointerError, apm_view->ProcessStream(
+      AudioFrameView(NULL, kSamples, 32000, 2)));
+  EXPECT_EQ(apm_->kBadSampleRateError, apm_view->ProcessStream(
+      AudioFrameView(capture, kSamples, 16000, 2)));
+  EXPECT_EQ(apm_->kBadNumberChannelsError, apm_view->AnalyzeReverseStream(
+      AudioFrameView(render, kSamples, 32000, 1)));
+  for (int i = 0; i < 100; i++) {
+    size_t read_count = fread(revframe_->_payloadData,
+                              sizeof(WebRtc_Word16),
+                              kSamples * 2,
+                              far_file_);
+    ASSERT_EQ(kSamples * 2, static_cast<int>(read_count));
+    read_count = fread(frame_->_payloadData,
+                       sizeof(WebRtc_Word16),
+                       kSamples * 2,
+                       near_file_);
+    ASSERT_EQ(kSamples * 2, static_cast<int>(read_count));
+    memcpy(render, revframe_->_payloadData, sizeof(render));
+    memcpy(capture, frame_->_payloadData, sizeof(capture));
+
+    frame_->_audioChannel = 2;
+    EXPECT_EQ(apm_->kNoError, apm_->AnalyzeReverseStream(revframe_));
+    EXPECT_EQ(apm_->kNoError, apm_->set_stream_delay_ms(0));
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+
+    EXPECT_EQ(apm_->kNoError, apm_view->AnalyzeReverseStream(render_view));
+    EXPECT_EQ(apm_->kNoError, apm_view->set_stream_delay_ms(0));
+    EXPECT_EQ(apm_->kNoError, apm_view->ProcessStream(capture_view));
+
+    ASSERT_EQ(0, memcmp(frame_->_payloadData, capture,
+                        sizeof(WebRtc_Word16) * kSamples));
+  }
+
+  AudioProcessing::Destroy(apm_view);
+}
+
+TEST_F(ApmTest, Reconfiguration) {
+  // Setting the stream parameters mid-stream should not reset the adapted
+  // state, unlike Initialize(). |apm_| is reconfigured with unchanged
+  // parameters and has to stay in step with |apm_ref|.
+  AudioProcessing* apm_ref = AudioProcessing::Create(1);
+  ASSERT_TRUE(apm_ref != NULL);
+  AudioFrame* frame_ref = new AudioFrame();
+  AudioProcessing* apms[] = {apm_, apm_ref};
+  for (int j = 0; j < 2; j++) {
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_sample_rate_hz(32000));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_channels(2, 2));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_reverse_channels(2));
+    EXPECT_EQ(apm_->kNoError, apms[j]->echo_cancellation()->Enable(true));
+    EXPECT_EQ(apm_->kNoError, apms[j]->gain_control()->set_mode(
+        GainControl::kAdaptiveDigital));
+    EXPECT_EQ(apm_->kNoError, apms[j]->gain_control()->Enable(true));
+    EXPECT_EQ(apm_->kNoError, apms[j]->high_pass_filter()->Enable(true));
+    EXPECT_EQ(apm_->kNoError, apms[j]->noise_suppression()->Enable(true));
+    EXPECT_EQ(apm_->kNoError, apms[j]->voice_detection()->Enable(true));
+  }
+
+  for (int i = 0; i < 200; i++) {
+    if (i == 100) {
+      EXPECT_EQ(apm_->kNoError, apm_->set_sample_rate_hz(32000));
+      EXPECT_EQ(apm_->kNoError, apm_->set_num_channels(2, 2));
+    }
+
+    size_t read_count = fread(revframe_->_payloadData,
+                              sizeof(WebRtc_Word16),
+                              revframe_->_payloadDataLengthInSamples * 2,
+                              far_file_);
+    ASSERT_EQ(revframe_->_payloadDataLengthInSamples * 2, read_count);
+    read_count = fread(frame_->_payloadData,
+                       sizeof(WebRtc_Word16),
+                       frame_->_payloadDataLengthInSamples * 2,
+                       near_file_);
+    ASSERT_EQ(frame_->_payloadDataLengthInSamples * 2, read_count);
+    *frame_ref = *frame_;
+
+    for (int j = 0; j < 2; j++) {
+      EXPECT_EQ(apm_->kNoError, apms[j]->AnalyzeReverseStream(revframe_));
+      EXPECT_EQ(apm_->kNoError, apms[j]->set_stream_delay_ms(0));
+    }
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+    EXPECT_EQ(apm_->kNoError, apm_ref->ProcessStream(frame_ref));
+    ASSERT_EQ(0, memcmp(frame_->_payloadData, frame_ref->_payloadData,
+                        sizeof(WebRtc_Word16) * 320 * 2));
+  }
+
+  // Switch to wideband and back, as on a device change. The wideband frames
+  // are the low band of the recordings, which is what the AEC works on at
+  // 32 kHz as well, so the converged echo path still applies. |apm_ref| is
+  // initialized at each switch and has to learn it again.
+  WebRtc_Word16 channel[320];
+  WebRtc_Word16 low_band[160];
+  WebRtc_Word16 high_band[160];
+  WebRtc_Word32 filter_states[2][2][2][6];
+  memset(filter_states, 0, sizeof(filter_states));
+  AudioFrame* frames[] = {revframe_, frame_};
+  FILE* files[] = {far_file_, near_file_};
+  const int rates[] = {16000, 32000};
+  // Only the echo cancellation is compared, as the other components would
+  // otherwise mask it while they adapt.
+  for (int j = 0; j < 2; j++) {
+    EXPECT_EQ(apm_->kNoError, apms[j]->gain_control()->Enable(false));
+    EXPECT_EQ(apm_->kNoError, apms[j]->high_pass_filter()->Enable(false));
+    EXPECT_EQ(apm_->kNoError, apms[j]->noise_suppression()->Enable(false));
+  }
+  for (int k = 0; k < 2; k++) {
+    for (int j = 0; j < 2; j++) {
+      EXPECT_EQ(apm_->kNoError, apms[j]->set_sample_rate_hz(rates[k]));
+    }
+    EXPECT_EQ(apm_->kNoError, apm_ref->Initialize());
+
+    double output_energy[2] = {0.0, 0.0};
+    for (int i = 0; i < 50; i++) {
+      for (int f = 0; f < 2; f++) {
+        AudioFrame* frame = frames[f];
+        frame->_payloadDataLengthInSamples = 320;
+        size_t read_count = fread(frame->_payloadData,
+                                  sizeof(WebRtc_Word16),
+                                  320 * 2,
+                                  files[f]);
+        ASSERT_EQ(320u * 2, read_count);
+        if (rates[k] == 16000) {
+          for (int c = 0; c < 2; c++) {
+            for (int n = 0; n < 320; n++) {
+              channel[n] = frame->_payloadData[n * 2 + c];
+            }
+            WebRtcSpl_AnalysisQMF(channel, low_band, high_band,
+                                  filter_states[f][c][0],
+                                  filter_states[f][c][1]);
+            for (int n = 0; n < 160; n++) {
+              frame->_payloadData[n * 2 + c] = low_band[n];
+            }
+          }
+        }
+        frame->_payloadDataLengthInSamples = rates[k] / 100;
+        frame->_frequencyInHz = rates[k];
+      }
+      *frame_ref = *frame_;
+
+      AudioFrame* near_frames[] = {frame_, frame_ref};
+      for (int j = 0; j < 2; j++) {
+        EXPECT_EQ(apm_->kNoError, apms[j]->AnalyzeReverseStream(revframe_));
+        EXPECT_EQ(apm_->kNoError, apms[j]->set_stream_delay_ms(0));
+        EXPECT_EQ(apm_->kNoError, apms[j]->ProcessStream(near_frames[j]));
+        for (int n = 0; n < rates[k] / 100 * 2; n++) {
+          const double sample = near_frames[j]->_payloadData[n];
+          output_energy[j] += sample * sample;
+        }
+      }
+    }
+
+    // The echo which |apm_ref| lets through while it converges again. The
+    // near-end dominates the recording by the time of the second switch.
+    if (rates[k] == 16000) {
+      EXPECT_LT(output_energy[0], 0.75 * output_energy[1]);
+    } else {
+      EXPECT_LT(output_energy[0], output_energy[1]);
+    }
+  }
+
+  delete frame_ref;
+  AudioProcessing::Destroy(apm_ref);
+}
+
+TEST_F(ApmTest, MemoryUsage) {
+  AudioProcessing::MemoryUsage usage;
+  EXPECT_EQ(apm_->kNullPointerError, apm_->GetMemoryUsage(NULL));
+  EXPECT_EQ(apm_->kNoError, apm_->set_sample_rate_hz(16000));
+  EXPECT_EQ(apm_->kNoError, apm_->set_num_channels(1, 1));
+  EXPECT_EQ(apm_->kNoError, apm_->set_num_reverse_channels(1));
+  EXPECT_EQ(apm_->kNoError, apm_->GetMemoryUsage(&usage));
+  EXPECT_EQ(0, usage.echo_cancellation);
+  EXPECT_GT(usage.audio_buffers, 0);
+  const int mono_audio_buffers = usage.audio_buffers;
+
+  EXPECT_EQ(apm_->kNoError, apm_->set_sample_rate_hz(32000));
+  EXPECT_EQ(apm_->kNoError, apm_->set_num_channels(2, 2));
+  EXPECT_EQ(apm_->kNoError, apm_->set_num_reverse_channels(2));
+  EXPECT_EQ(apm_->kNoError, apm_->echo_cancellation()->Enable(true));
+  EXPECT_EQ(apm_->kNoError, apm_->noise_suppression()->Enable(true));
+  EXPECT_EQ(apm_->kNoError, apm_->GetMemoryUsage(&usage));
+  EXPECT_GT(usage.audio_buffers, mono_audio_buffers);
+  EXPECT_GT(usage.echo_cancellation, 0);
+  EXPECT_GT(usage.noise_suppression, 0);
+  EXPECT_EQ(0, usage.echo_control_mobile);
+  EXPECT_GT(usage.total, usage.audio_buffers + usage.echo_cancellation +
+                         usage.noise_suppression);
+  const int stereo_echo_cancellation = usage.echo_cancellation;
+
+  // Unused instances are kept by default...
+  EXPECT_EQ(apm_->kNoError, apm_->set_num_channels(1, 1));
+  EXPECT_EQ(apm_->kNoError, apm_->GetMemoryUsage(&usage));
+  EXPECT_EQ(stereo_echo_cancellation, usage.echo_cancellation);
+
+  // ...and freed in compact mode, one AEC per capture and render channel.
+  EXPECT_FALSE(apm_->is_compact_memory_enabled());
+  EXPECT_EQ(apm_->kNoError, apm_->enable_compact_memory(true));
+  EXPECT_TRUE(apm_->is_compact_memory_enabled());
+  EXPECT_EQ(apm_->kNoError, apm_->GetMemoryUsage(&usage));
+  EXPECT_EQ(stereo_echo_cancellation / 2, usage.echo_cancellation);
+
+  EXPECT_EQ(apm_->kNoError, apm_->echo_cancellation()->Enable(false));
+  EXPECT_EQ(apm_->kNoError, apm_->GetMemoryUsage(&usage));
+  EXPECT_EQ(0, usage.echo_cancellation);
+  EXPECT_GT(usage.noise_suppression, 0);
+
+  // The component is recreated when re-enabled, now sized for the maximum
+  // delay rather than the worst case.
+  EXPECT_EQ(apm_->kNoError, apm_->echo_cancellation()->Enable(true));
+  EXPECT_EQ(apm_->kNoError, apm_->GetMemoryUsage(&usage));
+  EXPECT_GT(usage.echo_cancellation, 0);
+  EXPECT_LE(usage.echo_cancellation, stereo_echo_cancellation / 2);
+  const int compact_echo_cancellation = usage.echo_cancellation;
+
+  EXPECT_EQ(500, apm_->echo_cancellation()->max_delay_ms());
+  EXPECT_EQ(apm_->kBadParameterError,
+            apm_->echo_cancellation()->set_max_delay_ms(0));
+  EXPECT_EQ(apm_->kBadParameterError,
+            apm_->echo_cancellation()->set_max_delay_ms(501));
+  EXPECT_EQ(apm_->kNoError,
+            apm_->echo_cancellation()->set_max_delay_ms(100));
+  EXPECT_EQ(100, apm_->echo_cancellation()->max_delay_ms());
+  EXPECT_EQ(apm_->kNoError, apm_->GetMemoryUsage(&usage));
+  EXPECT_LT(usage.echo_cancellation, compact_echo_cancellation);
+  const int short_delay_echo_cancellation = usage.echo_cancellation;
+
+  // The high band buffers are only kept at 32 kHz.
+  EXPECT_EQ(apm_->kNoError, apm_->set_sample_rate_hz(16000));
+  EXPECT_EQ(apm_->kNoError, apm_->GetMemoryUsage(&usage));
+  EXPECT_LT(usage.echo_cancellation, short_delay_echo_cancellation);
+
+  // Longer stream delays are limited to the maximum.
+  EXPECT_EQ(apm_->kNoError, apm_->set_num_reverse_channels(1));
+  frame_->_payloadDataLengthInSamples = 160;
+  frame_->_audioChannel = 1;
+  frame_->_frequencyInHz = 16000;
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(apm_->kNoError, apm_->AnalyzeReverseStream(frame_));
+    EXPECT_EQ(apm_->kNoError, apm_->set_stream_delay_ms(300));
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+  }
+
+  // The worst case sizes come back at the next initialization.
+  EXPECT_EQ(apm_->kNoError, apm_->enable_compact_memory(false));
+  EXPECT_EQ(apm_->kNoError, apm_->set_num_reverse_channels(2));
+  EXPECT_EQ(apm_->kNoError, apm_->set_sample_rate_hz(32000));
+  EXPECT_EQ(apm_->kNoError, apm_->GetMemoryUsage(&usage));
+  EXPECT_EQ(stereo_echo_cancellation / 2, usage.echo_cancellation);
+  EXPECT_EQ(apm_->kNoError,
+            apm_->echo_cancellation()->set_max_delay_ms(500));
+}
+
+TEST_F(ApmTest, EchoMetricsProcess) {
+  // The echo metrics should be the same whether they are aggregated by
+  // Process() as the stream goes, or only when they are read.
+  AudioProcessing* apm_ref = AudioProcessing::Create(1);
+  ASSERT_TRUE(apm_ref != NULL);
+  AudioFrame* frame_ref = new AudioFrame();
+  AudioProcessing* apms[] = {apm_, apm_ref};
+  for (int j = 0; j < 2; j++) {
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_sample_rate_hz(32000));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_channels(2, 2));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_reverse_channels(2));
+    EXPECT_EQ(apm_->kNoError,
+              apms[j]->echo_cancellation()->enable_metrics(true));
+    EXPECT_EQ(apm_->kNoError, apms[j]->echo_cancellation()->Enable(true));
+  }
+
+  WebRtc_Word32 time_until_process = apm_->TimeUntilNextProcess();
+  EXPECT_GE(time_until_process, 0);
+  EXPECT_LE(time_until_process, 100);
+
+  for (int i = 0; i < 1000; i++) {
+    size_t read_count = fread(revframe_->_payloadData,
+                              sizeof(WebRtc_Word16),
+                              revframe_->_payloadDataLengthInSamples * 2,
+                              far_file_);
+    ASSERT_EQ(revframe_->_payloadDataLengthInSamples * 2, read_count);
+    read_count = fread(frame_->_payloadData,
+                       sizeof(WebRtc_Word16),
+                       frame_->_payloadDataLengthInSamples * 2,
+                       near_file_);
+    ASSERT_EQ(frame_->_payloadDataLengthInSamples * 2, read_count);
+    *frame_ref = *frame_;
+
+    for (int j = 0; j < 2; j++) {
+      EXPECT_EQ(apm_->kNoError, apms[j]->AnalyzeReverseStream(revframe_));
+      EXPECT_EQ(apm_->kNoError, apms[j]->set_stream_delay_ms(0));
+    }
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+    EXPECT_EQ(apm_->kNoError, apm_ref->ProcessStream(frame_ref));
+    if (i % 10 == 0) {
+      EXPECT_EQ(apm_->kNoError, apm_->Process());
+    }
+  }
+
+  EchoCancellation::Metrics metrics;
+  EchoCancellation::Metrics metrics_ref;
+  EXPECT_EQ(apm_->kNoError, apm_->echo_cancellation()->GetMetrics(&metrics));
+  EXPECT_EQ(apm_->kNoError,
+            apm_ref->echo_cancellation()->GetMetrics(&metrics_ref));
+  EXPECT_NE(-100, metrics_ref.echo_return_loss.average);
+  EXPECT_EQ(metrics_ref.echo_return_loss.instant,
+            metrics.echo_return_loss.instant);
+  EXPECT_EQ(metrics_ref.echo_return_loss.average,
+            metrics.echo_return_loss.average);
+  EXPECT_EQ(metrics_ref.echo_return_loss_enhancement.instant,
+            metrics.echo_return_loss_enhancement.instant);
+  EXPECT_EQ(metrics_ref.echo_return_loss_enhancement.average,
+            metrics.echo_return_loss_enhancement.average);
+  EXPECT_EQ(metrics_ref.a_nlp.minimum, metrics.a_nlp.minimum);
+  EXPECT_EQ(metrics_ref.a_nlp.maximum, metrics.a_nlp.maximum);
+
+  // The delay estimates are collected regardless of the metrics.
+  EchoCancellation::DelayMetrics delay_metrics;
+  EXPECT_EQ(apm_->kNoError,
+            apm_->echo_cancellation()->GetDelayMetrics(&delay_metrics));
+  EXPECT_EQ(4, delay_metrics.histogram_bin_ms);
+  EXPECT_GE(delay_metrics.aligned_delay_ms, 0);
+  int num_estimates = 0;
+  for (int i = 0; i < EchoCancellation::kDelayHistogramSize; i++) {
+    num_estimates += delay_metrics.histogram[i];
+  }
+  EXPECT_GT(num_estimates, 0);
+  EXPECT_GE(delay_metrics.median_ms, 0);
+  EXPECT_LT(delay_metrics.median_ms,
+            EchoCancellation::kDelayHistogramSize * 4);
+  EXPECT_GE(delay_metrics.std_ms, 0);
+
+  // Metrics are reset with the rest of the state.
+  EXPECT_EQ(apm_->kNoError, apm_->Initialize());
+  EXPECT_EQ(apm_->kNoError, apm_->echo_cancellation()->GetMetrics(&metrics));
+  EXPECT_EQ(-100, metrics.echo_return_loss.average);
+
+  delete frame_ref;
+  AudioProcessing::Destroy(apm_ref);
+}
+
+TEST_F(ApmTest, EchoMetricsConcurrentProcess) {
+  // The echo metrics should be the same when they are aggregated and read on
+  // another thread while the stream is processed. No block may be lost or
+  // aggregated twice.
+  AudioProcessing* apm_ref = AudioProcessing::Create(1);
+  ASSERT_TRUE(apm_ref != NULL);
+  AudioFrame* frame_ref = new AudioFrame();
+  AudioProcessing* apms[] = {apm_, apm_ref};
+  for (int j = 0; j < 2; j++) {
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_sample_rate_hz(32000));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_channels(2, 2));
+    EXPECT_EQ(apm_->kNoError, apms[j]->set_num_reverse_channels(2));
+    EXPECT_EQ(apm_->kNoError,
+              apms[j]->echo_cancellation()->enable_metrics(true));
+    EXPECT_EQ(apm_->kNoError, apms[j]->echo_cancellation()->Enable(true));
+  }
+
+  MetricsThreadData thread_data(apm_);
+  ThreadWrapper* thread = ThreadWrapper::CreateThread(MetricsProc,
+                                                      &thread_data,
+                                                      kNormalPriority,
+                                                      0);
+  ASSERT_TRUE(thread != NULL);
+  unsigned int thread_id = 0;
+  ASSERT_TRUE(thread->Start(thread_id));
+
+  for (int i = 0; i < 1000; i++) {
+    size_t read_count = fread(revframe_->_payloadData,
+                              sizeof(WebRtc_Word16),
+                              revframe_->_payloadDataLengthInSamples * 2,
+                              far_file_);
+    ASSERT_EQ(revframe_->_payloadDataLengthInSamples * 2, read_count);
+    read_count = fread(frame_->_payloadData,
+                       sizeof(WebRtc_Word16),
+                       frame_->_payloadDataLengthInSamples * 2,
+                       near_file_);
+    ASSERT_EQ(frame_->_payloadDataLengthInSamples * 2, read_count);
+    *frame_ref = *frame_;
+
+    for (int j = 0; j < 2; j++) {
+      EXPECT_EQ(apm_->kNoError, apms[j]->AnalyzeReverseStream(revframe_));
+      EXPECT_EQ(apm_->kNoError, apms[j]->set_stream_delay_ms(0));
+    }
+    EXPECT_EQ(apm_->kNoError, apm_->ProcessStream(frame_));
+    EXPECT_EQ(apm_->kNoError, apm_ref->ProcessStream(frame_ref));
+  }
+
+  ASSERT_TRUE(thread->Stop());
+  delete thread;
+  EXPECT_FALSE(thread_data.error);
+
+  EchoCancellation::Metrics metrics;
+  EchoCancellation::Metrics metrics_ref;
+  EXPECT_EQ(apm_->kNoError, apm_->echo_cancellation()->GetMetrics(&metrics));
+  EXPECT_EQ(apm_->kNoError,
+            apm_ref->echo_cancellation()->GetMetrics(&metrics_ref));
+  EXPECT_NE(-100, metrics_ref.echo_return_loss.average);
+  EXPECT_EQ(metrics_ref.residual_echo_return_loss.average,
+            metrics.residual_echo_return_loss.average);
+  EXPECT_EQ(metrics_ref.echo_return_loss.instant,
+            metrics.echo_return_loss.instant);
+  EXPECT_EQ(metrics_ref.echo_return_loss.average,
+            metrics.echo_return_loss.average);
+  EXPECT_EQ(metrics_ref.echo_return_loss.minimum,
+            metrics.echo_return_loss.minimum);
+  EXPECT_EQ(metrics_ref.echo_return_loss.maximum,
+            metrics.echo_return_loss.maximum);
+  EXPECT_EQ(metrics_ref.echo_return_loss_enhancement.instant,
+            metrics.echo_return_loss_enhancement.instant);
+  EXPECT_EQ(metrics_ref.echo_return_loss_enhancement.average,
+            metrics.echo_return_loss_enhancement.average);
+  EXPECT_EQ(metrics_ref.a_nlp.minimum, metrics.a_nlp.minimum);
+  EXPECT_EQ(metrics_ref.a_nlp.maximum, metrics.a_nlp.maximum);
+
+  delete frame_ref;
+  AudioProcessing::Destroy(apm_ref);
+}
+
 // Below are some ideas for tests from VPM.
 
 /*TEST_F(VideoProcessingModuleTest, GetVersionTest)
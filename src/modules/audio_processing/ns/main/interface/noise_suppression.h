@@ -11,6 +11,8 @@
 #ifndef WEBRTC_MODULES_AUDIO_PROCESSING_NS_MAIN_INTERFACE_NOISE_SUPPRESSION_H_
 #define WEBRTC_MODULES_AUDIO_PROCESSING_NS_MAIN_INTERFACE_NOISE_SUPPRESSION_H_
 
+#include <stdlib.h>
+
 #include "typedefs.h"
 
 typedef struct NsHandleT NsHandle;
@@ -62,6 +64,18 @@ int WebRtcNs_Create(NsHandle **NS_inst);
 int WebRtcNs_Free(NsHandle *NS_inst);
 
 
+/*
+ * This function returns the heap memory held by a specified Noise Reduction
+ * instance.
+ *
+ * Input:
+ *      - NS_inst       : NS instance
+ *
+ * Return value         : Size in bytes
+ */
+size_t WebRtcNs_memory_usage_bytes(NsHandle *NS_inst);
+
+
 /*
  * This function initializes a NS instance
  *
@@ -77,6 +91,23 @@ int WebRtcNs_Free(NsHandle *NS_inst);
  */
 int WebRtcNs_Init(NsHandle *NS_inst, WebRtc_UWord32 fs);
 
+/*
+ * This function changes the sampling frequency of an initialized instance
+ * between 16000 and 32000 Hz. The low band is processed the same way at both
+ * rates, so the noise estimate is kept; only the high band restarts.
+ *
+ * Input:
+ *      - NS_inst       : Initialized instance
+ *      - fs            : new sampling frequency
+ *
+ * Output:
+ *      - NS_inst       : Updated instance
+ *
+ * Return value         :  0 - Ok
+ *                        -1 - Error
+ */
+int WebRtcNs_ChangeSampFreq(NsHandle *NS_inst, WebRtc_UWord32 fs);
+
 /*
  * This changes the aggressiveness of the noise suppression method.
  *
@@ -92,6 +123,21 @@ int WebRtcNs_Init(NsHandle *NS_inst, WebRtc_UWord32 fs);
  */
 int WebRtcNs_set_policy(NsHandle *NS_inst, int mode);
 
+/*
+ * Tells the instance whether the near end is active. While it is not, the
+ * latest suppression gains are applied as they are, and the noise and speech
+ * models are neither updated nor reset. The instance is active after
+ * WebRtcNs_Init().
+ *
+ * Input:
+ *      - NS_inst       : Initialized instance
+ *      - active        : 0: Inactive, otherwise active
+ *
+ * Return value         :  0 - Ok
+ *                        -1 - Error
+ */
+int WebRtcNs_set_activity(NsHandle *NS_inst, int active);
+
 
 /*
  * This functions does Noise Suppression for the inserted speech frame. The
@@ -117,6 +163,94 @@ int WebRtcNs_Process(NsHandle *NS_inst,
                      short *outframe,
                      short *outframe_H);
 
+/*
+ * Same as WebRtcNs_Process(), but for float frames on the 16-bit scale. The
+ * output is not limited to the 16-bit range, which is left to the caller.
+ *
+ * Input
+ *      - NS_inst       : NS Instance. Needs to be initiated before call.
+ *      - spframe       : Pointer to speech frame buffer for L band
+ *      - spframe_H     : Pointer to speech frame buffer for H band
+ *
+ * Output:
+ *      - NS_inst       : Updated NS instance
+ *      - outframe      : Pointer to output frame for L band
+ *      - outframe_H    : Pointer to output frame for H band
+ *
+ * Return value         :  0 - OK
+ *                        -1 - Error
+ */
+int WebRtcNs_ProcessFloat(NsHandle *NS_inst,
+                          const float *spframe,
+                          const float *spframe_H,
+                          float *outframe,
+                          float *outframe_H);
+
+/*
+ * This function initializes a NS instance for low-delay processing with
+ * WebRtcNs_Process(). The analysis window is shortened from 16 to 8 ms, with
+ * a hop of 5 ms instead of 10 ms, which reduces the algorithmic delay from
+ * 6 to 3 ms. The noise and speech models are still updated once per frame,
+ * so the complexity is lower than for WebRtcNs_Init(). The coarser frequency
+ * resolution may resolve tonal noise less well.
+ *
+ * Input:
+ *      - NS_inst       : Instance that should be initialized
+ *      - fs            : sampling frequency
+ *
+ * Output:
+ *      - NS_inst       : Initialized instance
+ *
+ * Return value         :  0 - Ok
+ *                        -1 - Error
+ */
+int WebRtcNs_InitLowDelay(NsHandle *NS_inst, WebRtc_UWord32 fs);
+
+/*
+ * This function initializes a NS instance for use with
+ * WebRtcNs_ProcessSpectrum(). Such an instance cannot be used with
+ * WebRtcNs_Process(). Consecutive blocks are assumed to overlap by half.
+ *
+ * Input:
+ *      - NS_inst       : Instance that should be initialized
+ *      - fs            : sampling frequency
+ *      - length        : number of frequency bins per block (65 or 129)
+ *
+ * Output:
+ *      - NS_inst       : Initialized instance
+ *
+ * Return value         :  0 - Ok
+ *                        -1 - Error
+ */
+int WebRtcNs_InitSpectrum(NsHandle *NS_inst, WebRtc_UWord32 fs, int length);
+
+/*
+ * This function does Noise Suppression on the spectrum of one block, computed
+ * by the caller. It lets another component, e.g. the AEC, share its analysis
+ * and synthesis with the NS. The spectrum is modified in place.
+ *
+ * Input
+ *      - NS_inst       : NS Instance. Needs to be initiated with
+ *                        WebRtcNs_InitSpectrum() before call.
+ *      - real          : Real part of the L band spectrum
+ *      - imag          : Imaginary part of the L band spectrum
+ *      - length        : Number of frequency bins
+ *
+ * Output:
+ *      - NS_inst       : Updated NS instance
+ *      - real          : Real part of the suppressed spectrum
+ *      - imag          : Imaginary part of the suppressed spectrum
+ *      - gain_H        : Gain to apply to the H band (may be NULL)
+ *
+ * Return value         :  0 - OK
+ *                        -1 - Error
+ */
+int WebRtcNs_ProcessSpectrum(NsHandle *NS_inst,
+                             float *real,
+                             float *imag,
+                             int length,
+                             float *gain_H);
+
 #ifdef __cplusplus
 }
 #endif
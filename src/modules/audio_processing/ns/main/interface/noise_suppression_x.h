@@ -11,6 +11,8 @@
 #ifndef WEBRTC_MODULES_AUDIO_PROCESSING_NS_MAIN_INTERFACE_NOISE_SUPPRESSION_X_H_
 #define WEBRTC_MODULES_AUDIO_PROCESSING_NS_MAIN_INTERFACE_NOISE_SUPPRESSION_X_H_
 
+#include <stdlib.h>
+
 #include "signal_processing_library.h"
 
 typedef struct NsxHandleT NsxHandle;
@@ -62,6 +64,18 @@ int WebRtcNsx_Create(NsxHandle **nsxInst);
 int WebRtcNsx_Free(NsxHandle *nsxInst);
 
 
+/*
+ * This function returns the heap memory held by a specified Noise Suppression
+ * instance.
+ *
+ * Input:
+ *      - nsxInst       : NS instance
+ *
+ * Return value         : Size in bytes
+ */
+size_t WebRtcNsx_memory_usage_bytes(NsxHandle *nsxInst);
+
+
 /*
  * This function initializes a NS instance
  *
@@ -77,6 +91,43 @@ int WebRtcNsx_Free(NsxHandle *nsxInst);
  */
 int WebRtcNsx_Init(NsxHandle *nsxInst, WebRtc_UWord32 fs);
 
+/*
+ * This function initializes a NS instance for low-delay processing with
+ * WebRtcNsx_Process(). Each 10 ms frame is processed in two blocks of 5 ms
+ * with a 128 point FFT, which reduces the algorithmic delay from 6 to 3 ms.
+ * Unlike the floating-point version, the models are updated for every block.
+ * Only 16000 and 32000 Hz are supported; at 8000 Hz the regular analysis
+ * already uses the 128 point FFT.
+ *
+ * Input:
+ *      - nsxInst       : Instance that should be initialized
+ *      - fs            : sampling frequency
+ *
+ * Output:
+ *      - nsxInst       : Initialized instance
+ *
+ * Return value         :  0 - Ok
+ *                        -1 - Error
+ */
+int WebRtcNsx_InitLowDelay(NsxHandle *nsxInst, WebRtc_UWord32 fs);
+
+/*
+ * This function changes the sampling frequency of an initialized instance
+ * between 16000 and 32000 Hz. The low band is processed the same way at both
+ * rates, so the noise estimate is kept; only the high band restarts.
+ *
+ * Input:
+ *      - nsxInst       : Initialized instance
+ *      - fs            : new sampling frequency
+ *
+ * Output:
+ *      - nsxInst       : Updated instance
+ *
+ * Return value         :  0 - Ok
+ *                        -1 - Error
+ */
+int WebRtcNsx_ChangeSampFreq(NsxHandle *nsxInst, WebRtc_UWord32 fs);
+
 /*
  * This changes the aggressiveness of the noise suppression method.
  *
@@ -92,6 +143,21 @@ int WebRtcNsx_Init(NsxHandle *nsxInst, WebRtc_UWord32 fs);
  */
 int WebRtcNsx_set_policy(NsxHandle *nsxInst, int mode);
 
+/*
+ * Tells the instance whether the near end is active. While it is not, the
+ * latest suppression gains are applied as they are, and the noise and speech
+ * models are neither updated nor reset. The instance is active after
+ * WebRtcNsx_Init().
+ *
+ * Input:
+ *      - nsxInst       : Initialized instance
+ *      - active        : 0: Inactive, otherwise active
+ *
+ * Return value         :  0 - Ok
+ *                        -1 - Error
+ */
+int WebRtcNsx_set_activity(NsxHandle *nsxInst, int active);
+
 /*
  * This functions does noise suppression for the inserted speech frame. The
  * input and output signals should always be 10ms (80 or 160 samples).
@@ -14,6 +14,7 @@
 #include "noise_suppression.h"
 #include "ns_core.h"
 #include "defines.h"
+#include "signal_processing_library.h"
 
 int WebRtcNs_get_version(char *versionStr, short length)
 {
@@ -51,19 +52,118 @@ int WebRtcNs_Free(NsHandle *NS_inst)
     return 0;
 }
 
+size_t WebRtcNs_memory_usage_bytes(NsHandle *NS_inst)
+{
+    if (NS_inst == NULL)
+    {
+        return 0;
+    }
+    return sizeof(NSinst_t);
+}
+
 
 int WebRtcNs_Init(NsHandle *NS_inst, WebRtc_UWord32 fs)
 {
     return WebRtcNs_InitCore((NSinst_t*) NS_inst, fs);
 }
 
+int WebRtcNs_ChangeSampFreq(NsHandle *NS_inst, WebRtc_UWord32 fs)
+{
+    return WebRtcNs_ChangeSampFreqCore((NSinst_t*) NS_inst, fs);
+}
+
 int WebRtcNs_set_policy(NsHandle *NS_inst, int mode)
 {
     return WebRtcNs_set_policy_core((NSinst_t*) NS_inst, mode);
 }
 
+int WebRtcNs_set_activity(NsHandle *NS_inst, int active)
+{
+    if (NS_inst == NULL)
+    {
+        return -1;
+    }
+    ((NSinst_t*) NS_inst)->active = (active != 0);
+    return 0;
+}
+
+
+// Limits to the 16-bit range and truncates towards zero.
+static void FloatToShort(const float *in, int length, short *out)
+{
+    int i;
+    float tmp;
+
+    for (i = 0; i < length; i++)
+    {
+        tmp = in[i];
+        if (tmp < WEBRTC_SPL_WORD16_MIN)
+        {
+            tmp = WEBRTC_SPL_WORD16_MIN;
+        }
+        else if (tmp > WEBRTC_SPL_WORD16_MAX)
+        {
+            tmp = WEBRTC_SPL_WORD16_MAX;
+        }
+        out[i] = (short)tmp;
+    }
+}
 
 int WebRtcNs_Process(NsHandle *NS_inst, short *spframe, short *spframe_H, short *outframe, short *outframe_H)
+{
+    NSinst_t *inst = (NSinst_t*) NS_inst;
+    float in[BLOCKL_MAX], inH[BLOCKL_MAX];
+    float out[BLOCKL_MAX], outH[BLOCKL_MAX];
+    int flagHB = (spframe_H != NULL && outframe_H != NULL);
+    int i;
+
+    if (inst->initFlag != 1)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < inst->blockLen10ms; i++)
+    {
+        in[i] = (float)spframe[i];
+    }
+    if (flagHB)
+    {
+        for (i = 0; i < inst->blockLen10ms; i++)
+        {
+            inH[i] = (float)spframe_H[i];
+        }
+    }
+
+    if (WebRtcNs_ProcessCore(inst, in, flagHB ? inH : NULL, out,
+                             flagHB ? outH : NULL) != 0)
+    {
+        return -1;
+    }
+
+    FloatToShort(out, inst->blockLen10ms, outframe);
+    if (flagHB && inst->fs == 32000)
+    {
+        FloatToShort(outH, inst->blockLen10ms, outframe_H);
+    }
+    return 0;
+}
+
+int WebRtcNs_ProcessFloat(NsHandle *NS_inst, const float *spframe, const float *spframe_H, float *outframe, float *outframe_H)
 {
     return WebRtcNs_ProcessCore((NSinst_t*) NS_inst, spframe, spframe_H, outframe, outframe_H);
 }
+
+int WebRtcNs_InitLowDelay(NsHandle *NS_inst, WebRtc_UWord32 fs)
+{
+    return WebRtcNs_InitLowDelayCore((NSinst_t*) NS_inst, fs);
+}
+
+int WebRtcNs_InitSpectrum(NsHandle *NS_inst, WebRtc_UWord32 fs, int length)
+{
+    return WebRtcNs_InitSpectrumCore((NSinst_t*) NS_inst, fs, length);
+}
+
+int WebRtcNs_ProcessSpectrum(NsHandle *NS_inst, float *real, float *imag, int length, float *gain_H)
+{
+    return WebRtcNs_ProcessSpectrumCore((NSinst_t*) NS_inst, real, imag, length, gain_H);
+}
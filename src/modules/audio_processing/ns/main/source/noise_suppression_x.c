@@ -55,16 +55,45 @@ int WebRtcNsx_Free(NsxHandle *nsxInst)
     return 0;
 }
 
+size_t WebRtcNsx_memory_usage_bytes(NsxHandle *nsxInst)
+{
+    if (nsxInst == NULL)
+    {
+        return 0;
+    }
+    return sizeof(NsxInst_t);
+}
+
 int WebRtcNsx_Init(NsxHandle *nsxInst, WebRtc_UWord32 fs)
 {
     return WebRtcNsx_InitCore((NsxInst_t*)nsxInst, fs);
 }
 
+int WebRtcNsx_InitLowDelay(NsxHandle *nsxInst, WebRtc_UWord32 fs)
+{
+    return WebRtcNsx_InitLowDelayCore((NsxInst_t*)nsxInst, fs);
+}
+
+int WebRtcNsx_ChangeSampFreq(NsxHandle *nsxInst, WebRtc_UWord32 fs)
+{
+    return WebRtcNsx_ChangeSampFreqCore((NsxInst_t*)nsxInst, fs);
+}
+
 int WebRtcNsx_set_policy(NsxHandle *nsxInst, int mode)
 {
     return WebRtcNsx_set_policy_core((NsxInst_t*)nsxInst, mode);
 }
 
+int WebRtcNsx_set_activity(NsxHandle *nsxInst, int active)
+{
+    if (nsxInst == NULL)
+    {
+        return -1;
+    }
+    ((NsxInst_t*)nsxInst)->active = (active != 0);
+    return 0;
+}
+
 int WebRtcNsx_Process(NsxHandle *nsxInst, short *speechFrame, short *speechFrameHB,
                       short *outFrame, short *outFrameHB)
 {
@@ -150,6 +150,9 @@ int WebRtcNs_InitCore(NSinst_t *inst, WebRtc_UWord32 fs)
     {
         inst->smooth[i] = (float)1.0;
     }
+    inst->spectrumFactor = 1.0f;
+    inst->spectrumGainHB = 1.0f;
+    inst->active = 1;
 
     // Set the aggressiveness: default
     inst->aggrMode = 0;
@@ -222,6 +225,24 @@ int WebRtcNs_InitCore(NSinst_t *inst, WebRtc_UWord32 fs)
     return 0;
 }
 
+int WebRtcNs_ChangeSampFreqCore(NSinst_t *inst, WebRtc_UWord32 fs)
+{
+    if (inst->initFlag != 1)
+    {
+        return -1;
+    }
+    // Block and FFT lengths are the same at 16 and 32 kHz.
+    if ((fs != 16000 && fs != 32000) || (inst->fs != 16000 && inst->fs != 32000))
+    {
+        return -1;
+    }
+    inst->fs = fs;
+
+    memset(inst->dataBufHB, 0, sizeof(float) * ANAL_BLOCKL_MAX);
+
+    return 0;
+}
+
 int WebRtcNs_set_policy_core(NSinst_t *inst, int mode)
 {
     // allow for modes:0,1,2,3
@@ -811,32 +832,25 @@ void WebRtcNs_SpeechNoiseProb(NSinst_t *inst, float *probSpeechFinal, float *snr
     }
 }
 
-int WebRtcNs_ProcessCore(NSinst_t *inst,
-                         short *speechFrame,
-                         short *speechFrameHB,
-                         short *outFrame,
-                         short *outFrameHB)
+// Update the noise and speech models with the spectrum |real|, |imag| of
+// inst->magnLen bins, and apply the resulting suppression gains to it in place.
+// The final speech probabilities are returned in |probSpeechFinal|.
+void WebRtcNs_SuppressSpectrum(NSinst_t *inst, float *real, float *imag,
+                               float *probSpeechFinal)
 {
-    // main routine for noise reduction
-
-    int     flagHB = 0;
     int     i;
     const int kStartBand = 5; // Skip first frequency bins during estimation.
     int     updateParsFlag;
 
-    float   energy1, energy2, gain, factor, factor1, factor2;
     float   signalEnergy, sumMagn;
     float   snrPrior, currentEstimateStsa;
     float   tmpFloat1, tmpFloat2, tmpFloat3, probSpeech, probNonSpeech;
     float   gammaNoiseTmp, gammaNoiseOld;
-    float   noiseUpdateTmp, fTmp, dTmp;
-    float   fin[BLOCKL_MAX], fout[BLOCKL_MAX];
-    float   winData[ANAL_BLOCKL_MAX];
+    float   noiseUpdateTmp, fTmp;
     float   magn[HALF_ANAL_BLOCKL], noise[HALF_ANAL_BLOCKL];
     float   theFilter[HALF_ANAL_BLOCKL], theFilterTmp[HALF_ANAL_BLOCKL];
     float   snrLocPost[HALF_ANAL_BLOCKL], snrLocPrior[HALF_ANAL_BLOCKL];
-    float   probSpeechFinal[HALF_ANAL_BLOCKL], previousEstimateStsa[HALF_ANAL_BLOCKL];
-    float   real[ANAL_BLOCKL_MAX], imag[HALF_ANAL_BLOCKL];
+    float   previousEstimateStsa[HALF_ANAL_BLOCKL];
     // Variables during startup
     float   sum_log_i = 0.0;
     float   sum_log_i_square = 0.0;
@@ -846,14 +860,573 @@ int WebRtcNs_ProcessCore(NSinst_t *inst,
     float   parametric_exp = 0.0;
     float   parametric_num = 0.0;
 
-    // SWB variables
-    int     deltaBweHB = 1;
-    int     deltaGainHB = 1;
+    //
+    updateParsFlag = inst->modelUpdatePars[0];
+    //
+
+    inst->blockInd++; // Update the block index only when we process a block.
+
+    magn[0] = (float)(fabs(real[0]) + 1.0f);
+    magn[inst->magnLen - 1] = (float)(fabs(real[inst->magnLen - 1]) + 1.0f);
+    signalEnergy = (float)(real[0] * real[0]) + (float)(real[inst->magnLen - 1]
+            * real[inst->magnLen - 1]);
+    sumMagn = magn[0] + magn[inst->magnLen - 1];
+    if (inst->blockInd < END_STARTUP_SHORT)
+    {
+        inst->initMagnEst[0] += magn[0];
+        inst->initMagnEst[inst->magnLen - 1] += magn[inst->magnLen - 1];
+        tmpFloat2 = log((float)(inst->magnLen - 1));
+        sum_log_i = tmpFloat2;
+        sum_log_i_square = tmpFloat2 * tmpFloat2;
+        tmpFloat1 = log(magn[inst->magnLen - 1]);
+        sum_log_magn = tmpFloat1;
+        sum_log_i_log_magn = tmpFloat2 * tmpFloat1;
+    }
+    for (i = 1; i < inst->magnLen - 1; i++)
+    {
+        // magnitude spectrum
+        fTmp = real[i] * real[i];
+        fTmp += imag[i] * imag[i];
+        signalEnergy += fTmp;
+        magn[i] = ((float)sqrt(fTmp)) + 1.0f;
+        sumMagn += magn[i];
+        if (inst->blockInd < END_STARTUP_SHORT)
+        {
+            inst->initMagnEst[i] += magn[i];
+            if (i >= kStartBand)
+            {
+                tmpFloat2 = log((float)i);
+                sum_log_i += tmpFloat2;
+                sum_log_i_square += tmpFloat2 * tmpFloat2;
+                tmpFloat1 = log(magn[i]);
+                sum_log_magn += tmpFloat1;
+                sum_log_i_log_magn += tmpFloat2 * tmpFloat1;
+            }
+        }
+    }
+    signalEnergy = signalEnergy / ((float)inst->magnLen);
+    inst->signalEnergy = signalEnergy;
+    inst->sumMagn = sumMagn;
+
+    //compute spectral flatness on input spectrum
+    WebRtcNs_ComputeSpectralFlatness(inst, magn);
+    // quantile noise estimate
+    WebRtcNs_NoiseEstimation(inst, magn, noise);
+    //compute simplified noise model during startup
+    if (inst->blockInd < END_STARTUP_SHORT)
+    {
+        // Estimate White noise
+        inst->whiteNoiseLevel += sumMagn / ((float)inst->magnLen) * inst->overdrive;
+        // Estimate Pink noise parameters
+        tmpFloat1 = sum_log_i_square * ((float)(inst->magnLen - kStartBand));
+        tmpFloat1 -= (sum_log_i * sum_log_i);
+        tmpFloat2 = (sum_log_i_square * sum_log_magn - sum_log_i * sum_log_i_log_magn);
+        tmpFloat3 = tmpFloat2 / tmpFloat1;
+        // Constrain the estimated spectrum to be positive
+        if (tmpFloat3 < 0.0f)
+        {
+            tmpFloat3 = 0.0f;
+        }
+        inst->pinkNoiseNumerator += tmpFloat3;
+        tmpFloat2 = (sum_log_i * sum_log_magn);
+        tmpFloat2 -= ((float)(inst->magnLen - kStartBand)) * sum_log_i_log_magn;
+        tmpFloat3 = tmpFloat2 / tmpFloat1;
+        // Constrain the pink noise power to be in the interval [0, 1];
+        if (tmpFloat3 < 0.0f)
+        {
+            tmpFloat3 = 0.0f;
+        }
+        if (tmpFloat3 > 1.0f)
+        {
+            tmpFloat3 = 1.0f;
+        }
+        inst->pinkNoiseExp += tmpFloat3;
+
+        // Calculate frequency independent parts of parametric noise estimate.
+        if (inst->pinkNoiseExp == 0.0f)
+        {
+            // Use white noise estimate
+            parametric_noise = inst->whiteNoiseLevel;
+        }
+        else
+        {
+            // Use pink noise estimate
+            parametric_num = exp(inst->pinkNoiseNumerator / (float)(inst->blockInd + 1));
+            parametric_num *= (float)(inst->blockInd + 1);
+            parametric_exp = inst->pinkNoiseExp / (float)(inst->blockInd + 1);
+            parametric_noise = parametric_num / pow((float)kStartBand, parametric_exp);
+        }
+        for (i = 0; i < inst->magnLen; i++)
+        {
+            // Estimate the background noise using the white and pink noise parameters
+            if ((inst->pinkNoiseExp > 0.0f) && (i >= kStartBand))
+            {
+                // Use pink noise estimate
+                parametric_noise = parametric_num / pow((float)i, parametric_exp);
+            }
+            theFilterTmp[i] = (inst->initMagnEst[i] - inst->overdrive * parametric_noise);
+            theFilterTmp[i] /= (inst->initMagnEst[i] + (float)0.0001);
+            // Weight quantile noise with modeled noise
+            noise[i] *= (inst->blockInd);
+            tmpFloat2 = parametric_noise * (END_STARTUP_SHORT - inst->blockInd);
+            noise[i] += (tmpFloat2 / (float)(inst->blockInd + 1));
+            noise[i] /= END_STARTUP_SHORT;
+        }
+    }
+    //compute average signal during END_STARTUP_LONG time:
+    // used to normalize spectral difference measure
+    if (inst->blockInd < END_STARTUP_LONG)
+    {
+        inst->featureData[5] *= inst->blockInd;
+        inst->featureData[5] += signalEnergy;
+        inst->featureData[5] /= (inst->blockInd + 1);
+    }
+
+#ifdef PROCESS_FLOW_0
+    if (inst->blockInd > END_STARTUP_LONG)
+    {
+        //option: average the quantile noise: for check with AEC2
+        for (i = 0; i < inst->magnLen; i++)
+        {
+            noise[i] = (float)0.6 * inst->noisePrev[i] + (float)0.4 * noise[i];
+        }
+        for (i = 0; i < inst->magnLen; i++)
+        {
+            // Wiener with over sub-substraction:
+            theFilter[i] = (magn[i] - inst->overdrive * noise[i]) / (magn[i] + (float)0.0001);
+        }
+    }
+#else
+    //start processing at frames == converged+1
+        //
+    // STEP 1: compute  prior and post snr based on quantile noise est
+    //
+
+    // compute DD estimate of prior SNR: needed for new method
+    for (i = 0; i < inst->magnLen; i++)
+    {
+        // post snr
+        snrLocPost[i] = (float)0.0;
+        if (magn[i] > noise[i])
+        {
+            snrLocPost[i] = magn[i] / (noise[i] + (float)0.0001) - (float)1.0;
+        }
+        // previous post snr
+        // previous estimate: based on previous frame with gain filter
+        previousEstimateStsa[i] = inst->magnPrev[i] / (inst->noisePrev[i] + (float)0.0001)
+                * (inst->smooth[i]);
+        // DD estimate is sum of two terms: current estimate and previous estimate
+        // directed decision update of snrPrior
+        snrLocPrior[i] = DD_PR_SNR * previousEstimateStsa[i] + ((float)1.0 - DD_PR_SNR)
+                * snrLocPost[i];
+        // post and prior snr needed for step 2
+    } // end of loop over freqs
+#ifdef PROCESS_FLOW_1
+    for (i = 0; i < inst->magnLen; i++)
+    {
+        // gain filter
+        tmpFloat1 = inst->overdrive + snrLocPrior[i];
+        tmpFloat2 = (float)snrLocPrior[i] / tmpFloat1;
+        theFilter[i] = (float)tmpFloat2;
+    } // end of loop over freqs
+#endif
+    // done with step 1: dd computation of prior and post snr
+
+    //
+    //STEP 2: compute speech/noise likelihood
+    //
+#ifdef PROCESS_FLOW_2
+    // compute difference of input spectrum with learned/estimated noise spectrum
+    WebRtcNs_ComputeSpectralDifference(inst, magn);
+    // compute histograms for parameter decisions (thresholds and weights for features)
+    // parameters are extracted once every window time (=inst->modelUpdatePars[1])
+    if (updateParsFlag >= 1)
+    {
+        // counter update
+        inst->modelUpdatePars[3]--;
+        // update histogram
+        if (inst->modelUpdatePars[3] > 0)
+        {
+            WebRtcNs_FeatureParameterExtraction(inst, 0);
+        }
+        // compute model parameters
+        if (inst->modelUpdatePars[3] == 0)
+        {
+            WebRtcNs_FeatureParameterExtraction(inst, 1);
+            inst->modelUpdatePars[3] = inst->modelUpdatePars[1];
+            // if wish to update only once, set flag to zero
+            if (updateParsFlag == 1)
+            {
+                inst->modelUpdatePars[0] = 0;
+            }
+            else
+            {
+                // update every window:
+                // get normalization for spectral difference for next window estimate
+                inst->featureData[6] = inst->featureData[6]
+                        / ((float)inst->modelUpdatePars[1]);
+                inst->featureData[5] = (float)0.5 * (inst->featureData[6]
+                        + inst->featureData[5]);
+                inst->featureData[6] = (float)0.0;
+            }
+        }
+    }
+    // compute speech/noise probability
+    WebRtcNs_SpeechNoiseProb(inst, probSpeechFinal, snrLocPrior, snrLocPost);
+    // time-avg parameter for noise update
+    gammaNoiseTmp = NOISE_UPDATE;
+    for (i = 0; i < inst->magnLen; i++)
+    {
+        probSpeech = probSpeechFinal[i];
+        probNonSpeech = (float)1.0 - probSpeech;
+        // temporary noise update:
+        // use it for speech frames if update value is less than previous
+        noiseUpdateTmp = gammaNoiseTmp * inst->noisePrev[i] + ((float)1.0 - gammaNoiseTmp)
+                * (probNonSpeech * magn[i] + probSpeech * inst->noisePrev[i]);
+        //
+        // time-constant based on speech/noise state
+        gammaNoiseOld = gammaNoiseTmp;
+        gammaNoiseTmp = NOISE_UPDATE;
+        // increase gamma (i.e., less noise update) for frame likely to be speech
+        if (probSpeech > PROB_RANGE)
+        {
+            gammaNoiseTmp = SPEECH_UPDATE;
+        }
+        // conservative noise update
+        if (probSpeech < PROB_RANGE)
+        {
+            inst->magnAvgPause[i] += GAMMA_PAUSE * (magn[i] - inst->magnAvgPause[i]);
+        }
+        // noise update
+        if (gammaNoiseTmp == gammaNoiseOld)
+        {
+            noise[i] = noiseUpdateTmp;
+        }
+        else
+        {
+            noise[i] = gammaNoiseTmp * inst->noisePrev[i] + ((float)1.0 - gammaNoiseTmp)
+                    * (probNonSpeech * magn[i] + probSpeech * inst->noisePrev[i]);
+            // allow for noise update downwards:
+            //  if noise update decreases the noise, it is safe, so allow it to happen
+            if (noiseUpdateTmp < noise[i])
+            {
+                noise[i] = noiseUpdateTmp;
+            }
+        }
+    } // end of freq loop
+    // done with step 2: noise update
+
+    //
+    // STEP 3: compute dd update of prior snr and post snr based on new noise estimate
+    //
+    for (i = 0; i < inst->magnLen; i++)
+    {
+        // post and prior snr
+        currentEstimateStsa = (float)0.0;
+        if (magn[i] > noise[i])
+        {
+            currentEstimateStsa = magn[i] / (noise[i] + (float)0.0001) - (float)1.0;
+        }
+        // DD estimate is sume of two terms: current estimate and previous estimate
+        // directed decision update of snrPrior
+        snrPrior = DD_PR_SNR * previousEstimateStsa[i] + ((float)1.0 - DD_PR_SNR)
+                * currentEstimateStsa;
+        // gain filter
+        tmpFloat1 = inst->overdrive + snrPrior;
+        tmpFloat2 = (float)snrPrior / tmpFloat1;
+        theFilter[i] = (float)tmpFloat2;
+    } // end of loop over freqs
+    // done with step3
+#endif
+#endif
+
+    for (i = 0; i < inst->magnLen; i++)
+    {
+        // flooring bottom
+        if (theFilter[i] < inst->denoiseBound)
+        {
+            theFilter[i] = inst->denoiseBound;
+        }
+        // flooring top
+        if (theFilter[i] > (float)1.0)
+        {
+            theFilter[i] = 1.0;
+        }
+        if (inst->blockInd < END_STARTUP_SHORT)
+        {
+            // flooring bottom
+            if (theFilterTmp[i] < inst->denoiseBound)
+            {
+                theFilterTmp[i] = inst->denoiseBound;
+            }
+            // flooring top
+            if (theFilterTmp[i] > (float)1.0)
+            {
+                theFilterTmp[i] = 1.0;
+            }
+            // Weight the two suppression filters
+            theFilter[i] *= (inst->blockInd);
+            theFilterTmp[i] *= (END_STARTUP_SHORT - inst->blockInd);
+            theFilter[i] += theFilterTmp[i];
+            theFilter[i] /= (END_STARTUP_SHORT);
+        }
+        // smoothing
+#ifdef PROCESS_FLOW_0
+        inst->smooth[i] *= SMOOTH; // value set to 0.7 in define.h file
+        inst->smooth[i] += ((float)1.0 - SMOOTH) * theFilter[i];
+#else
+        inst->smooth[i] = theFilter[i];
+#endif
+        real[i] *= inst->smooth[i];
+        imag[i] *= inst->smooth[i];
+    }
+    // keep track of noise and magn spectrum for next frame
+    for (i = 0; i < inst->magnLen; i++)
+    {
+        inst->noisePrev[i] = noise[i];
+        inst->magnPrev[i] = magn[i];
+    }
+}
+
+// Compute the scale factor applied to the suppressed signal, from the energy
+// before (|energyIn|) and after (|energyOut|) suppression.
+float WebRtcNs_GainFactor(NSinst_t *inst, float energyIn, float energyOut)
+{
+    float gain, factor, factor1, factor2;
+
+    factor1 = (float)1.0;
+    factor2 = (float)1.0;
+
+    gain = (float)sqrt(energyOut / (energyIn + (float)1.0));
+
+#ifdef PROCESS_FLOW_2
+    // scaling for new version
+    if (gain > B_LIM)
+    {
+        factor1 = (float)1.0 + (float)1.3 * (gain - B_LIM);
+        if (gain * factor1 > (float)1.0)
+        {
+            factor1 = (float)1.0 / gain;
+        }
+    }
+    if (gain < B_LIM)
+    {
+        //don't reduce scale too much for pause regions:
+        // attenuation here should be controlled by flooring
+        if (gain <= inst->denoiseBound)
+        {
+            gain = inst->denoiseBound;
+        }
+        factor2 = (float)1.0 - (float)0.3 * (B_LIM - gain);
+    }
+    //combine both scales with speech/noise prob:
+    // note prior (priorSpeechProb) is not frequency dependent
+    factor = inst->priorSpeechProb * factor1 + ((float)1.0 - inst->priorSpeechProb)
+            * factor2;
+#else
+    if (gain > B_LIM)
+    {
+        factor = (float)1.0 + (float)1.3 * (gain - B_LIM);
+    }
+    else
+    {
+        factor = (float)1.0 + (float)2.0 * (gain - B_LIM);
+    }
+    if (gain * factor > (float)1.0)
+    {
+        factor = (float)1.0 / gain;
+    }
+#endif
+
+    return factor;
+}
+
+// Compute the time-domain gain of the high band from the speech probabilities
+// and suppression gains of the low band.
+float WebRtcNs_HighBandGain(NSinst_t *inst, const float *probSpeechFinal)
+{
+    int     i;
+    // range for averaging low band quantities for H band gain
+    const int deltaBweHB = (int)inst->magnLen / 4;
+    const int deltaGainHB = deltaBweHB;
     float   decayBweHB = 1.0;
     float   gainMapParHB = 1.0;
     float   gainTimeDomainHB = 1.0;
     float   avgProbSpeechHB, avgProbSpeechHBTmp, avgFilterGainHB, gainModHB;
 
+    for (i = 0; i < inst->magnLen; i++)
+    {
+        inst->speechProbHB[i] = probSpeechFinal[i];
+    }
+    if (inst->blockInd > END_STARTUP_LONG)
+    {
+        // average speech prob from low band
+        // avg over second half (i.e., 4->8kHz) of freq. spectrum
+        avgProbSpeechHB = 0.0;
+        for (i = inst->magnLen - deltaBweHB - 1; i < inst->magnLen - 1; i++)
+        {
+            avgProbSpeechHB += inst->speechProbHB[i];
+        }
+        avgProbSpeechHB = avgProbSpeechHB / ((float)deltaBweHB);
+        // average filter gain from low band
+        // average over second half (i.e., 4->8kHz) of freq. spectrum
+        avgFilterGainHB = 0.0;
+        for (i = inst->magnLen - deltaGainHB - 1; i < inst->magnLen - 1; i++)
+        {
+            avgFilterGainHB += inst->smooth[i];
+        }
+        avgFilterGainHB = avgFilterGainHB / ((float)(deltaGainHB));
+        avgProbSpeechHBTmp = (float)2.0 * avgProbSpeechHB - (float)1.0;
+        // gain based on speech prob:
+        gainModHB = (float)0.5 * ((float)1.0 + (float)tanh(gainMapParHB * avgProbSpeechHBTmp));
+        //combine gain with low band gain
+        gainTimeDomainHB = (float)0.5 * gainModHB + (float)0.5 * avgFilterGainHB;
+        if (avgProbSpeechHB >= (float)0.5)
+        {
+            gainTimeDomainHB = (float)0.25 * gainModHB + (float)0.75 * avgFilterGainHB;
+        }
+        gainTimeDomainHB = gainTimeDomainHB * decayBweHB;
+    } // end of converged
+    //make sure gain is within flooring range
+    // flooring bottom
+    if (gainTimeDomainHB < inst->denoiseBound)
+    {
+        gainTimeDomainHB = inst->denoiseBound;
+    }
+    // flooring top
+    if (gainTimeDomainHB > (float)1.0)
+    {
+        gainTimeDomainHB = 1.0;
+    }
+
+    return gainTimeDomainHB;
+}
+
+// Low-delay version of WebRtcNs_ProcessCore(), see WebRtcNs_InitLowDelayCore().
+// The 10 ms frame is split into blocks of inst->blockLen samples, each with its
+// own analysis and synthesis. The models are updated once per frame through
+// WebRtcNs_ProcessSpectrumCore().
+static int ProcessLowDelayCore(NSinst_t *inst,
+                               const float *speechFrame,
+                               const float *speechFrameHB,
+                               float *outFrame,
+                               float *outFrameHB)
+{
+    int     i, j;
+    int     overlap = inst->anaLen - inst->blockLen;
+    float   energy, gainHB;
+    float   winData[ANAL_BLOCKL_MAX];
+    float   real[HALF_ANAL_BLOCKL], imag[HALF_ANAL_BLOCKL];
+
+    for (j = 0; j < inst->blockLen10ms; j += inst->blockLen)
+    {
+        // update analysis buffers
+        memcpy(inst->dataBuf, inst->dataBuf + inst->blockLen,
+               sizeof(float) * overlap);
+        for (i = 0; i < inst->blockLen; i++)
+        {
+            inst->dataBuf[overlap + i] = speechFrame[j + i];
+        }
+        if (speechFrameHB != NULL)
+        {
+            memcpy(inst->dataBufHB, inst->dataBufHB + inst->blockLen,
+                   sizeof(float) * overlap);
+            for (i = 0; i < inst->blockLen; i++)
+            {
+                inst->dataBufHB[overlap + i] = speechFrameHB[j + i];
+            }
+        }
+
+        // windowing
+        energy = 0.0;
+        for (i = 0; i < inst->anaLen; i++)
+        {
+            winData[i] = inst->window[i] * inst->dataBuf[i];
+            energy += winData[i] * winData[i];
+        }
+
+        // As in the time-domain version, zero input leaves the statistics as
+        // they are.
+        gainHB = 1.0f;
+        if (energy > 0.0)
+        {
+            // FFT
+            rdft(inst->anaLen, 1, winData, inst->ip, inst->wfft);
+
+            imag[0] = 0;
+            real[0] = winData[0];
+            imag[inst->magnLen - 1] = 0;
+            real[inst->magnLen - 1] = winData[1];
+            for (i = 1; i < inst->magnLen - 1; i++)
+            {
+                real[i] = winData[2 * i];
+                imag[i] = winData[2 * i + 1];
+            }
+
+            WebRtcNs_ProcessSpectrumCore(inst, real, imag, inst->magnLen,
+                                         &gainHB);
+
+            // back to time domain
+            winData[0] = real[0];
+            winData[1] = real[inst->magnLen - 1];
+            for (i = 1; i < inst->magnLen - 1; i++)
+            {
+                winData[2 * i] = real[i];
+                winData[2 * i + 1] = imag[i];
+            }
+            rdft(inst->anaLen, -1, winData, inst->ip, inst->wfft);
+
+            // synthesis, with fft scaling
+            for (i = 0; i < inst->anaLen; i++)
+            {
+                inst->syntBuf[i] += inst->window[i] * 2.0f * winData[i] /
+                                    inst->anaLen;
+            }
+        }
+
+        // read out fully processed segment
+        for (i = 0; i < inst->blockLen; i++)
+        {
+            outFrame[j + i] = inst->syntBuf[i];
+        }
+        // update synthesis buffer
+        memcpy(inst->syntBuf, inst->syntBuf + inst->blockLen,
+               sizeof(float) * overlap);
+        memset(inst->syntBuf + overlap, 0, sizeof(float) * inst->blockLen);
+
+        // time-domain gain of HB, delayed as the L band
+        if (speechFrameHB != NULL)
+        {
+            for (i = 0; i < inst->blockLen; i++)
+            {
+                outFrameHB[j + i] = gainHB * inst->dataBufHB[i];
+            }
+        }
+    }
+
+    return 0;
+}
+
+int WebRtcNs_ProcessCore(NSinst_t *inst,
+                         const float *speechFrame,
+                         const float *speechFrameHB,
+                         float *outFrame,
+                         float *outFrameHB)
+{
+    // main routine for noise reduction
+
+    int     flagHB = 0;
+    int     i;
+
+    float   energy1, energy2, factor;
+    float   fout[BLOCKL_MAX];
+    float   winData[ANAL_BLOCKL_MAX];
+    float   probSpeechFinal[HALF_ANAL_BLOCKL];
+    float   real[ANAL_BLOCKL_MAX], imag[HALF_ANAL_BLOCKL];
+
+    // SWB variables
+    float   gainTimeDomainHB = 1.0;
+
     // Check that initiation has been done
     if (inst->initFlag != 1)
     {
@@ -867,38 +1440,29 @@ int WebRtcNs_ProcessCore(NSinst_t *inst,
             return -1;
         }
         flagHB = 1;
-        // range for averaging low band quantities for H band gain
-        deltaBweHB = (int)inst->magnLen / 4;
-        deltaGainHB = deltaBweHB;
     }
-    //
-    updateParsFlag = inst->modelUpdatePars[0];
-    //
 
-    //for LB do all processing
-    // convert to float
-    for (i = 0; i < inst->blockLen10ms; i++)
+    if (inst->blockLen < inst->blockLen10ms)
     {
-        fin[i] = (float)speechFrame[i];
+        return ProcessLowDelayCore(inst, speechFrame,
+                                   flagHB ? speechFrameHB : NULL,
+                                   outFrame, outFrameHB);
     }
+
+    //for LB do all processing
     // update analysis buffer for L band
     memcpy(inst->dataBuf, inst->dataBuf + inst->blockLen10ms,
            sizeof(float) * (inst->anaLen - inst->blockLen10ms));
-    memcpy(inst->dataBuf + inst->anaLen - inst->blockLen10ms, fin,
+    memcpy(inst->dataBuf + inst->anaLen - inst->blockLen10ms, speechFrame,
            sizeof(float) * inst->blockLen10ms);
 
     if (flagHB == 1)
     {
-        // convert to float
-        for (i = 0; i < inst->blockLen10ms; i++)
-        {
-            fin[i] = (float)speechFrameHB[i];
-        }
         // update analysis buffer for H band
         memcpy(inst->dataBufHB, inst->dataBufHB + inst->blockLen10ms,
                sizeof(float) * (inst->anaLen - inst->blockLen10ms));
-        memcpy(inst->dataBufHB + inst->anaLen - inst->blockLen10ms, fin,
-               sizeof(float) * inst->blockLen10ms);
+        memcpy(inst->dataBufHB + inst->anaLen - inst->blockLen10ms,
+               speechFrameHB, sizeof(float) * inst->blockLen10ms);
     }
 
     // check if processing needed
@@ -942,19 +1506,9 @@ int WebRtcNs_ProcessCore(NSinst_t *inst,
                     inst->outBuf[i] = fout[i + inst->blockLen10ms];
                 }
             }
-            // convert to short
             for (i = 0; i < inst->blockLen10ms; i++)
             {
-                dTmp = fout[i];
-                if (dTmp < WEBRTC_SPL_WORD16_MIN)
-                {
-                    dTmp = WEBRTC_SPL_WORD16_MIN;
-                }
-                else if (dTmp > WEBRTC_SPL_WORD16_MAX)
-                {
-                    dTmp = WEBRTC_SPL_WORD16_MAX;
-                }
-                outFrame[i] = (short)dTmp;
+                outFrame[i] = fout[i];
             }
 
             // for time-domain gain of HB
@@ -962,353 +1516,41 @@ int WebRtcNs_ProcessCore(NSinst_t *inst,
             {
                 for (i = 0; i < inst->blockLen10ms; i++)
                 {
-                    dTmp = inst->dataBufHB[i];
-                    if (dTmp < WEBRTC_SPL_WORD16_MIN)
-                    {
-                        dTmp = WEBRTC_SPL_WORD16_MIN;
-                    }
-                    else if (dTmp > WEBRTC_SPL_WORD16_MAX)
-                    {
-                        dTmp = WEBRTC_SPL_WORD16_MAX;
-                    }
-                    outFrameHB[i] = (short)dTmp;
+                    outFrameHB[i] = inst->dataBufHB[i];
                 }
             } // end of H band gain computation
             //
             return 0;
         }
 
-        //
-        inst->blockInd++; // Update the block index only when we process a block.
         // FFT
         rdft(inst->anaLen, 1, winData, inst->ip, inst->wfft);
 
         imag[0] = 0;
         real[0] = winData[0];
-        magn[0] = (float)(fabs(real[0]) + 1.0f);
         imag[inst->magnLen - 1] = 0;
         real[inst->magnLen - 1] = winData[1];
-        magn[inst->magnLen - 1] = (float)(fabs(real[inst->magnLen - 1]) + 1.0f);
-        signalEnergy = (float)(real[0] * real[0]) + (float)(real[inst->magnLen - 1]
-                * real[inst->magnLen - 1]);
-        sumMagn = magn[0] + magn[inst->magnLen - 1];
-        if (inst->blockInd < END_STARTUP_SHORT)
-        {
-            inst->initMagnEst[0] += magn[0];
-            inst->initMagnEst[inst->magnLen - 1] += magn[inst->magnLen - 1];
-            tmpFloat2 = log((float)(inst->magnLen - 1));
-            sum_log_i = tmpFloat2;
-            sum_log_i_square = tmpFloat2 * tmpFloat2;
-            tmpFloat1 = log(magn[inst->magnLen - 1]);
-            sum_log_magn = tmpFloat1;
-            sum_log_i_log_magn = tmpFloat2 * tmpFloat1;
-        }
         for (i = 1; i < inst->magnLen - 1; i++)
         {
             real[i] = winData[2 * i];
             imag[i] = winData[2 * i + 1];
-            // magnitude spectrum
-            fTmp = real[i] * real[i];
-            fTmp += imag[i] * imag[i];
-            signalEnergy += fTmp;
-            magn[i] = ((float)sqrt(fTmp)) + 1.0f;
-            sumMagn += magn[i];
-            if (inst->blockInd < END_STARTUP_SHORT)
-            {
-                inst->initMagnEst[i] += magn[i];
-                if (i >= kStartBand)
-                {
-                    tmpFloat2 = log((float)i);
-                    sum_log_i += tmpFloat2;
-                    sum_log_i_square += tmpFloat2 * tmpFloat2;
-                    tmpFloat1 = log(magn[i]);
-                    sum_log_magn += tmpFloat1;
-                    sum_log_i_log_magn += tmpFloat2 * tmpFloat1;
-                }
-            }
         }
-        signalEnergy = signalEnergy / ((float)inst->magnLen);
-        inst->signalEnergy = signalEnergy;
-        inst->sumMagn = sumMagn;
 
-        //compute spectral flatness on input spectrum
-        WebRtcNs_ComputeSpectralFlatness(inst, magn);
-        // quantile noise estimate
-        WebRtcNs_NoiseEstimation(inst, magn, noise);
-        //compute simplified noise model during startup
-        if (inst->blockInd < END_STARTUP_SHORT)
+        if (inst->active)
         {
-            // Estimate White noise
-            inst->whiteNoiseLevel += sumMagn / ((float)inst->magnLen) * inst->overdrive;
-            // Estimate Pink noise parameters
-            tmpFloat1 = sum_log_i_square * ((float)(inst->magnLen - kStartBand));
-            tmpFloat1 -= (sum_log_i * sum_log_i);
-            tmpFloat2 = (sum_log_i_square * sum_log_magn - sum_log_i * sum_log_i_log_magn);
-            tmpFloat3 = tmpFloat2 / tmpFloat1;
-            // Constrain the estimated spectrum to be positive
-            if (tmpFloat3 < 0.0f)
-            {
-                tmpFloat3 = 0.0f;
-            }
-            inst->pinkNoiseNumerator += tmpFloat3;
-            tmpFloat2 = (sum_log_i * sum_log_magn);
-            tmpFloat2 -= ((float)(inst->magnLen - kStartBand)) * sum_log_i_log_magn;
-            tmpFloat3 = tmpFloat2 / tmpFloat1;
-            // Constrain the pink noise power to be in the interval [0, 1];
-            if (tmpFloat3 < 0.0f)
-            {
-                tmpFloat3 = 0.0f;
-            }
-            if (tmpFloat3 > 1.0f)
-            {
-                tmpFloat3 = 1.0f;
-            }
-            inst->pinkNoiseExp += tmpFloat3;
-
-            // Calculate frequency independent parts of parametric noise estimate.
-            if (inst->pinkNoiseExp == 0.0f)
-            {
-                // Use white noise estimate
-                parametric_noise = inst->whiteNoiseLevel;
-            }
-            else
-            {
-                // Use pink noise estimate
-                parametric_num = exp(inst->pinkNoiseNumerator / (float)(inst->blockInd + 1));
-                parametric_num *= (float)(inst->blockInd + 1);
-                parametric_exp = inst->pinkNoiseExp / (float)(inst->blockInd + 1);
-                parametric_noise = parametric_num / pow((float)kStartBand, parametric_exp);
-            }
-            for (i = 0; i < inst->magnLen; i++)
-            {
-                // Estimate the background noise using the white and pink noise parameters
-                if ((inst->pinkNoiseExp > 0.0f) && (i >= kStartBand))
-                {
-                    // Use pink noise estimate
-                    parametric_noise = parametric_num / pow((float)i, parametric_exp);
-                }
-                theFilterTmp[i] = (inst->initMagnEst[i] - inst->overdrive * parametric_noise);
-                theFilterTmp[i] /= (inst->initMagnEst[i] + (float)0.0001);
-                // Weight quantile noise with modeled noise
-                noise[i] *= (inst->blockInd);
-                tmpFloat2 = parametric_noise * (END_STARTUP_SHORT - inst->blockInd);
-                noise[i] += (tmpFloat2 / (float)(inst->blockInd + 1));
-                noise[i] /= END_STARTUP_SHORT;
-            }
-        }
-        //compute average signal during END_STARTUP_LONG time:
-        // used to normalize spectral difference measure
-        if (inst->blockInd < END_STARTUP_LONG)
-        {
-            inst->featureData[5] *= inst->blockInd;
-            inst->featureData[5] += signalEnergy;
-            inst->featureData[5] /= (inst->blockInd + 1);
+            WebRtcNs_SuppressSpectrum(inst, real, imag, probSpeechFinal);
         }
-
-#ifdef PROCESS_FLOW_0
-        if (inst->blockInd > END_STARTUP_LONG)
+        else
         {
-            //option: average the quantile noise: for check with AEC2
+            // Inactive near end: apply the latest gains and leave the noise
+            // and speech models as they are.
             for (i = 0; i < inst->magnLen; i++)
             {
-                noise[i] = (float)0.6 * inst->noisePrev[i] + (float)0.4 * noise[i];
-            }
-            for (i = 0; i < inst->magnLen; i++)
-            {
-                // Wiener with over sub-substraction:
-                theFilter[i] = (magn[i] - inst->overdrive * noise[i]) / (magn[i] + (float)0.0001);
+                real[i] *= inst->smooth[i];
+                imag[i] *= inst->smooth[i];
             }
         }
-#else
-        //start processing at frames == converged+1
-            //
-        // STEP 1: compute  prior and post snr based on quantile noise est
-        //
 
-        // compute DD estimate of prior SNR: needed for new method
-        for (i = 0; i < inst->magnLen; i++)
-        {
-            // post snr
-            snrLocPost[i] = (float)0.0;
-            if (magn[i] > noise[i])
-            {
-                snrLocPost[i] = magn[i] / (noise[i] + (float)0.0001) - (float)1.0;
-            }
-            // previous post snr
-            // previous estimate: based on previous frame with gain filter
-            previousEstimateStsa[i] = inst->magnPrev[i] / (inst->noisePrev[i] + (float)0.0001)
-                    * (inst->smooth[i]);
-            // DD estimate is sum of two terms: current estimate and previous estimate
-            // directed decision update of snrPrior
-            snrLocPrior[i] = DD_PR_SNR * previousEstimateStsa[i] + ((float)1.0 - DD_PR_SNR)
-                    * snrLocPost[i];
-            // post and prior snr needed for step 2
-        } // end of loop over freqs
-#ifdef PROCESS_FLOW_1
-        for (i = 0; i < inst->magnLen; i++)
-        {
-            // gain filter
-            tmpFloat1 = inst->overdrive + snrLocPrior[i];
-            tmpFloat2 = (float)snrLocPrior[i] / tmpFloat1;
-            theFilter[i] = (float)tmpFloat2;
-        } // end of loop over freqs
-#endif
-        // done with step 1: dd computation of prior and post snr
-
-        //
-        //STEP 2: compute speech/noise likelihood
-        //
-#ifdef PROCESS_FLOW_2
-        // compute difference of input spectrum with learned/estimated noise spectrum
-        WebRtcNs_ComputeSpectralDifference(inst, magn);
-        // compute histograms for parameter decisions (thresholds and weights for features)
-        // parameters are extracted once every window time (=inst->modelUpdatePars[1])
-        if (updateParsFlag >= 1)
-        {
-            // counter update
-            inst->modelUpdatePars[3]--;
-            // update histogram
-            if (inst->modelUpdatePars[3] > 0)
-            {
-                WebRtcNs_FeatureParameterExtraction(inst, 0);
-            }
-            // compute model parameters
-            if (inst->modelUpdatePars[3] == 0)
-            {
-                WebRtcNs_FeatureParameterExtraction(inst, 1);
-                inst->modelUpdatePars[3] = inst->modelUpdatePars[1];
-                // if wish to update only once, set flag to zero
-                if (updateParsFlag == 1)
-                {
-                    inst->modelUpdatePars[0] = 0;
-                }
-                else
-                {
-                    // update every window:
-                    // get normalization for spectral difference for next window estimate
-                    inst->featureData[6] = inst->featureData[6]
-                            / ((float)inst->modelUpdatePars[1]);
-                    inst->featureData[5] = (float)0.5 * (inst->featureData[6]
-                            + inst->featureData[5]);
-                    inst->featureData[6] = (float)0.0;
-                }
-            }
-        }
-        // compute speech/noise probability
-        WebRtcNs_SpeechNoiseProb(inst, probSpeechFinal, snrLocPrior, snrLocPost);
-        // time-avg parameter for noise update
-        gammaNoiseTmp = NOISE_UPDATE;
-        for (i = 0; i < inst->magnLen; i++)
-        {
-            probSpeech = probSpeechFinal[i];
-            probNonSpeech = (float)1.0 - probSpeech;
-            // temporary noise update:
-            // use it for speech frames if update value is less than previous
-            noiseUpdateTmp = gammaNoiseTmp * inst->noisePrev[i] + ((float)1.0 - gammaNoiseTmp)
-                    * (probNonSpeech * magn[i] + probSpeech * inst->noisePrev[i]);
-            //
-            // time-constant based on speech/noise state
-            gammaNoiseOld = gammaNoiseTmp;
-            gammaNoiseTmp = NOISE_UPDATE;
-            // increase gamma (i.e., less noise update) for frame likely to be speech
-            if (probSpeech > PROB_RANGE)
-            {
-                gammaNoiseTmp = SPEECH_UPDATE;
-            }
-            // conservative noise update
-            if (probSpeech < PROB_RANGE)
-            {
-                inst->magnAvgPause[i] += GAMMA_PAUSE * (magn[i] - inst->magnAvgPause[i]);
-            }
-            // noise update
-            if (gammaNoiseTmp == gammaNoiseOld)
-            {
-                noise[i] = noiseUpdateTmp;
-            }
-            else
-            {
-                noise[i] = gammaNoiseTmp * inst->noisePrev[i] + ((float)1.0 - gammaNoiseTmp)
-                        * (probNonSpeech * magn[i] + probSpeech * inst->noisePrev[i]);
-                // allow for noise update downwards:
-                //  if noise update decreases the noise, it is safe, so allow it to happen
-                if (noiseUpdateTmp < noise[i])
-                {
-                    noise[i] = noiseUpdateTmp;
-                }
-            }
-        } // end of freq loop
-        // done with step 2: noise update
-
-        //
-        // STEP 3: compute dd update of prior snr and post snr based on new noise estimate
-        //
-        for (i = 0; i < inst->magnLen; i++)
-        {
-            // post and prior snr
-            currentEstimateStsa = (float)0.0;
-            if (magn[i] > noise[i])
-            {
-                currentEstimateStsa = magn[i] / (noise[i] + (float)0.0001) - (float)1.0;
-            }
-            // DD estimate is sume of two terms: current estimate and previous estimate
-            // directed decision update of snrPrior
-            snrPrior = DD_PR_SNR * previousEstimateStsa[i] + ((float)1.0 - DD_PR_SNR)
-                    * currentEstimateStsa;
-            // gain filter
-            tmpFloat1 = inst->overdrive + snrPrior;
-            tmpFloat2 = (float)snrPrior / tmpFloat1;
-            theFilter[i] = (float)tmpFloat2;
-        } // end of loop over freqs
-        // done with step3
-#endif
-#endif
-
-        for (i = 0; i < inst->magnLen; i++)
-        {
-            // flooring bottom
-            if (theFilter[i] < inst->denoiseBound)
-            {
-                theFilter[i] = inst->denoiseBound;
-            }
-            // flooring top
-            if (theFilter[i] > (float)1.0)
-            {
-                theFilter[i] = 1.0;
-            }
-            if (inst->blockInd < END_STARTUP_SHORT)
-            {
-                // flooring bottom
-                if (theFilterTmp[i] < inst->denoiseBound)
-                {
-                    theFilterTmp[i] = inst->denoiseBound;
-                }
-                // flooring top
-                if (theFilterTmp[i] > (float)1.0)
-                {
-                    theFilterTmp[i] = 1.0;
-                }
-                // Weight the two suppression filters
-                theFilter[i] *= (inst->blockInd);
-                theFilterTmp[i] *= (END_STARTUP_SHORT - inst->blockInd);
-                theFilter[i] += theFilterTmp[i];
-                theFilter[i] /= (END_STARTUP_SHORT);
-            }
-            // smoothing
-#ifdef PROCESS_FLOW_0
-            inst->smooth[i] *= SMOOTH; // value set to 0.7 in define.h file
-            inst->smooth[i] += ((float)1.0 - SMOOTH) * theFilter[i];
-#else
-            inst->smooth[i] = theFilter[i];
-#endif
-            real[i] *= inst->smooth[i];
-            imag[i] *= inst->smooth[i];
-        }
-        // keep track of noise and magn spectrum for next frame
-        for (i = 0; i < inst->magnLen; i++)
-        {
-            inst->noisePrev[i] = noise[i];
-            inst->magnPrev[i] = magn[i];
-        }
         // back to time domain
         winData[0] = real[0];
         winData[1] = real[inst->magnLen - 1];
@@ -1326,57 +1568,20 @@ int WebRtcNs_ProcessCore(NSinst_t *inst,
 
         //scale factor: only do it after END_STARTUP_LONG time
         factor = (float)1.0;
-        if (inst->gainmap == 1 && inst->blockInd > END_STARTUP_LONG)
+        if (!inst->active)
+        {
+            factor = inst->spectrumFactor;
+        }
+        else if (inst->gainmap == 1 && inst->blockInd > END_STARTUP_LONG)
         {
-            factor1 = (float)1.0;
-            factor2 = (float)1.0;
-
             energy2 = 0.0;
             for (i = 0; i < inst->anaLen;i++)
             {
                 energy2 += (float)real[i] * (float)real[i];
             }
-            gain = (float)sqrt(energy2 / (energy1 + (float)1.0));
-
-#ifdef PROCESS_FLOW_2
-            // scaling for new version
-            if (gain > B_LIM)
-            {
-                factor1 = (float)1.0 + (float)1.3 * (gain - B_LIM);
-                if (gain * factor1 > (float)1.0)
-                {
-                    factor1 = (float)1.0 / gain;
-                }
-            }
-            if (gain < B_LIM)
-            {
-                //don't reduce scale too much for pause regions:
-                // attenuation here should be controlled by flooring
-                if (gain <= inst->denoiseBound)
-                {
-                    gain = inst->denoiseBound;
-                }
-                factor2 = (float)1.0 - (float)0.3 * (B_LIM - gain);
-            }
-            //combine both scales with speech/noise prob:
-            // note prior (priorSpeechProb) is not frequency dependent
-            factor = inst->priorSpeechProb * factor1 + ((float)1.0 - inst->priorSpeechProb)
-                    * factor2;
-#else
-            if (gain > B_LIM)
-            {
-                factor = (float)1.0 + (float)1.3 * (gain - B_LIM);
-            }
-            else
-            {
-                factor = (float)1.0 + (float)2.0 * (gain - B_LIM);
-            }
-            if (gain * factor > (float)1.0)
-            {
-                factor = (float)1.0 / gain;
-            }
-#endif
+            factor = WebRtcNs_GainFactor(inst, energy1, energy2);
         } // out of inst->gainmap==1
+        inst->spectrumFactor = factor;
 
         // synthesis
         for (i = 0; i < inst->anaLen; i++)
@@ -1417,84 +1622,174 @@ int WebRtcNs_ProcessCore(NSinst_t *inst,
         inst->outLen -= inst->blockLen10ms;
     }
 
-    // convert to short
     for (i = 0; i < inst->blockLen10ms; i++)
     {
-        dTmp = fout[i];
-        if (dTmp < WEBRTC_SPL_WORD16_MIN)
-        {
-            dTmp = WEBRTC_SPL_WORD16_MIN;
-        }
-        else if (dTmp > WEBRTC_SPL_WORD16_MAX)
-        {
-            dTmp = WEBRTC_SPL_WORD16_MAX;
-        }
-        outFrame[i] = (short)dTmp;
+        outFrame[i] = fout[i];
     }
 
     // for time-domain gain of HB
     if (flagHB == 1)
     {
-        for (i = 0; i < inst->magnLen; i++)
+        if (inst->active)
         {
-            inst->speechProbHB[i] = probSpeechFinal[i];
+            inst->spectrumGainHB = WebRtcNs_HighBandGain(inst, probSpeechFinal);
         }
-        if (inst->blockInd > END_STARTUP_LONG)
+        gainTimeDomainHB = inst->spectrumGainHB;
+        //apply gain
+        for (i = 0; i < inst->blockLen10ms; i++)
         {
-            // average speech prob from low band
-            // avg over second half (i.e., 4->8kHz) of freq. spectrum
-            avgProbSpeechHB = 0.0;
-            for (i = inst->magnLen - deltaBweHB - 1; i < inst->magnLen - 1; i++)
-            {
-                avgProbSpeechHB += inst->speechProbHB[i];
-            }
-            avgProbSpeechHB = avgProbSpeechHB / ((float)deltaBweHB);
-            // average filter gain from low band
-            // average over second half (i.e., 4->8kHz) of freq. spectrum
-            avgFilterGainHB = 0.0;
-            for (i = inst->magnLen - deltaGainHB - 1; i < inst->magnLen - 1; i++)
-            {
-                avgFilterGainHB += inst->smooth[i];
-            }
-            avgFilterGainHB = avgFilterGainHB / ((float)(deltaGainHB));
-            avgProbSpeechHBTmp = (float)2.0 * avgProbSpeechHB - (float)1.0;
-            // gain based on speech prob:
-            gainModHB = (float)0.5 * ((float)1.0 + (float)tanh(gainMapParHB * avgProbSpeechHBTmp));
-            //combine gain with low band gain
-            gainTimeDomainHB = (float)0.5 * gainModHB + (float)0.5 * avgFilterGainHB;
-            if (avgProbSpeechHB >= (float)0.5)
-            {
-                gainTimeDomainHB = (float)0.25 * gainModHB + (float)0.75 * avgFilterGainHB;
-            }
-            gainTimeDomainHB = gainTimeDomainHB * decayBweHB;
-        } // end of converged
-        //make sure gain is within flooring range
-        // flooring bottom
-        if (gainTimeDomainHB < inst->denoiseBound)
+            outFrameHB[i] = gainTimeDomainHB * inst->dataBufHB[i];
+        }
+    } // end of H band gain computation
+    //
+
+    return 0;
+}
+
+// Energy of a half spectrum of |length| bins, scaled as the energy of the
+// corresponding time-domain block.
+static float SpectrumEnergy(const float *real, const float *imag, int length)
+{
+    int i;
+    float energy = real[0] * real[0] + real[length - 1] * real[length - 1];
+
+    for (i = 1; i < length - 1; i++)
+    {
+        energy += 2.0f * (real[i] * real[i] + imag[i] * imag[i]);
+    }
+
+    return energy / (float)(2 * (length - 1));
+}
+
+int WebRtcNs_InitSpectrumCore(NSinst_t *inst, WebRtc_UWord32 fs, int length)
+{
+    if (length != 65 && length != 129)
+    {
+        return -1;
+    }
+    if (WebRtcNs_InitCore(inst, fs) != 0)
+    {
+        return -1;
+    }
+
+    // Use the spectral grid of the caller instead of the one for |fs|.
+    inst->blockLen = length - 1;
+    inst->anaLen = 2 * inst->blockLen;
+    inst->magnLen = length;
+
+    // Update the models on the first block.
+    inst->spectrumCounter = inst->blockLen10ms;
+
+    return 0;
+}
+
+int WebRtcNs_InitLowDelayCore(NSinst_t *inst, WebRtc_UWord32 fs)
+{
+    if (WebRtcNs_InitCore(inst, fs) != 0)
+    {
+        return -1;
+    }
+
+    // Two blocks per 10 ms frame, with a proportionally shorter overlap.
+    inst->blockLen = inst->blockLen10ms / 2;
+    if (inst->blockLen == 40)
+    {
+        inst->anaLen = 64;
+        inst->window = kBlocks40w64;
+    }
+    else
+    {
+        inst->anaLen = 128;
+        inst->window = kBlocks80w128;
+    }
+    inst->magnLen = inst->anaLen / 2 + 1;
+
+    // Initialize fft work arrays for the shorter analysis.
+    inst->ip[0] = 0;
+    rdft(inst->anaLen, 1, inst->dataBuf, inst->ip, inst->wfft);
+    memset(inst->dataBuf, 0, sizeof(float) * ANAL_BLOCKL_MAX);
+
+    // Update the models on the first block.
+    inst->spectrumCounter = inst->blockLen10ms;
+
+    return 0;
+}
+
+int WebRtcNs_ProcessSpectrumCore(NSinst_t *inst,
+                                 float *real,
+                                 float *imag,
+                                 int length,
+                                 float *gainHB)
+{
+    int     i;
+    float   energy1, energy2, gain;
+    float   probSpeechFinal[HALF_ANAL_BLOCKL];
+
+    // Check that initiation has been done
+    if (inst->initFlag != 1)
+    {
+        return (-1);
+    }
+    if (length != inst->magnLen)
+    {
+        return -1;
+    }
+
+    if (gainHB != NULL)
+    {
+        *gainHB = 1.0f;
+    }
+
+    // As in the time-domain version, zero input leaves the statistics as they are.
+    energy1 = SpectrumEnergy(real, imag, length);
+    if (energy1 == 0.0)
+    {
+        return 0;
+    }
+
+    // The models are held while the near end is inactive.
+    if (inst->active)
+    {
+        inst->spectrumCounter += inst->blockLen;
+    }
+    if (inst->active && inst->spectrumCounter >= inst->blockLen10ms)
+    {
+        // Update the models, at the same rate as for time signals.
+        inst->spectrumCounter -= inst->blockLen10ms;
+
+        WebRtcNs_SuppressSpectrum(inst, real, imag, probSpeechFinal);
+
+        //scale factor: only do it after END_STARTUP_LONG time
+        inst->spectrumFactor = 1.0f;
+        if (inst->gainmap == 1 && inst->blockInd > END_STARTUP_LONG)
         {
-            gainTimeDomainHB = inst->denoiseBound;
+            energy2 = SpectrumEnergy(real, imag, length);
+            inst->spectrumFactor = WebRtcNs_GainFactor(inst, energy1, energy2);
         }
-        // flooring top
-        if (gainTimeDomainHB > (float)1.0)
+
+        inst->spectrumGainHB = WebRtcNs_HighBandGain(inst, probSpeechFinal);
+
+        for (i = 0; i < length; i++)
         {
-            gainTimeDomainHB = 1.0;
+            real[i] *= inst->spectrumFactor;
+            imag[i] *= inst->spectrumFactor;
         }
-        //apply gain
-        for (i = 0; i < inst->blockLen10ms; i++)
+    }
+    else
+    {
+        // Apply the latest gains.
+        for (i = 0; i < length; i++)
         {
-            dTmp = gainTimeDomainHB * inst->dataBufHB[i];
-            if (dTmp < WEBRTC_SPL_WORD16_MIN)
-            {
-                dTmp = WEBRTC_SPL_WORD16_MIN;
-            }
-            else if (dTmp > WEBRTC_SPL_WORD16_MAX)
-            {
-                dTmp = WEBRTC_SPL_WORD16_MAX;
-            }
-            outFrameHB[i] = (short)dTmp;
+            gain = inst->smooth[i] * inst->spectrumFactor;
+            real[i] *= gain;
+            imag[i] *= gain;
         }
-    } // end of H band gain computation
-    //
+    }
+
+    if (gainHB != NULL)
+    {
+        *gainHB = inst->spectrumGainHB;
+    }
 
     return 0;
 }
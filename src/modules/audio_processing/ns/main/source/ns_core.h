@@ -104,6 +104,12 @@ typedef struct NSinst_t_ {
     //quantities for high band estimate
     float           speechProbHB[HALF_ANAL_BLOCKL];     //final speech/noise prob: prior + LRT
     float           dataBufHB[ANAL_BLOCKL_MAX];         //buffering data for HB
+    //quantities for processing external spectra
+    int             spectrumCounter;                    //samples since the last model update
+    //gains of the last model update, reused between updates and while inactive
+    float           spectrumFactor;                     //scale factor of the last model update
+    float           spectrumGainHB;                     //H band gain of the last model update
+    int             active;                             //0: near end inactive, models held
 
 } NSinst_t;
 
@@ -129,6 +135,24 @@ extern "C" {
  */
 int WebRtcNs_InitCore(NSinst_t *inst, WebRtc_UWord32 fs);
 
+/****************************************************************************
+ * WebRtcNs_ChangeSampFreqCore(...)
+ *
+ * This function changes the sampling frequency of an initialized instance
+ * between 16000 and 32000 Hz, keeping the state of the low band.
+ *
+ * Input:
+ *      - inst          : Initialized instance
+ *      - fs            : New sampling frequency
+ *
+ * Output:
+ *      - inst          : Updated instance
+ *
+ * Return value         :  0 - Ok
+ *                        -1 - Error
+ */
+int WebRtcNs_ChangeSampFreqCore(NSinst_t *inst, WebRtc_UWord32 fs);
+
 /****************************************************************************
  * WebRtcNs_set_policy_core(...)
  *
@@ -149,7 +173,8 @@ int WebRtcNs_set_policy_core(NSinst_t *inst, int mode);
 /****************************************************************************
  * WebRtcNs_ProcessCore
  *
- * Do noise suppression.
+ * Do noise suppression. The frames are in float on the 16-bit scale; the
+ * output is not limited to the 16-bit range.
  *
  * Input:
  *      - inst          : Instance that should be initialized
@@ -167,10 +192,78 @@ int WebRtcNs_set_policy_core(NSinst_t *inst, int mode);
 
 
 int WebRtcNs_ProcessCore(NSinst_t *inst,
-                         short *inFrameLow,
-                         short *inFrameHigh,
-                         short *outFrameLow,
-                         short *outFrameHigh);
+                         const float *inFrameLow,
+                         const float *inFrameHigh,
+                         float *outFrameLow,
+                         float *outFrameHigh);
+
+/****************************************************************************
+ * WebRtcNs_InitSpectrumCore(...)
+ *
+ * This function initializes a noise suppression instance for processing
+ * spectra with WebRtcNs_ProcessSpectrumCore(), rather than time signals.
+ * Consecutive spectra are assumed to overlap by half, i.e. one block advances
+ * (length - 1) samples of the L band.
+ *
+ * Input:
+ *      - inst          : Instance that should be initialized
+ *      - fs            : Sampling frequency
+ *      - length        : Number of frequency bins (65 or 129)
+ *
+ * Output:
+ *      - inst          : Initialized instance
+ *
+ * Return value         :  0 - Ok
+ *                        -1 - Error
+ */
+int WebRtcNs_InitSpectrumCore(NSinst_t *inst, WebRtc_UWord32 fs, int length);
+
+/****************************************************************************
+ * WebRtcNs_InitLowDelayCore(...)
+ *
+ * This function initializes a noise suppression instance for low-delay
+ * processing with WebRtcNs_ProcessCore(). Each 10 ms frame is analyzed in two
+ * blocks, using half the FFT size of WebRtcNs_InitCore().
+ *
+ * Input:
+ *      - inst          : Instance that should be initialized
+ *      - fs            : Sampling frequency
+ *
+ * Output:
+ *      - inst          : Initialized instance
+ *
+ * Return value         :  0 - Ok
+ *                        -1 - Error
+ */
+int WebRtcNs_InitLowDelayCore(NSinst_t *inst, WebRtc_UWord32 fs);
+
+/****************************************************************************
+ * WebRtcNs_ProcessSpectrumCore
+ *
+ * Do noise suppression on one block of a spectrum computed by the caller.
+ * The noise and speech models are updated once per 10 ms of signal, as in
+ * WebRtcNs_ProcessCore(); blocks in between reuse the latest gains.
+ *
+ * Input:
+ *      - inst          : Instance that should be initialized
+ *      - real          : Real part of the spectrum
+ *      - imag          : Imaginary part of the spectrum
+ *      - length        : Number of frequency bins
+ *
+ * Output:
+ *      - inst          : Updated instance
+ *      - real          : Real part of the suppressed spectrum
+ *      - imag          : Imaginary part of the suppressed spectrum
+ *      - gainHB        : Time-domain gain for the higher band (may be NULL)
+ *
+ * Return value         :  0 - OK
+ *                        -1 - Error
+ */
+int WebRtcNs_ProcessSpectrumCore(NSinst_t *inst,
+                                 float *real,
+                                 float *imag,
+                                 int length,
+                                 float *gainHB);
 
 
 #ifdef __cplusplus
@@ -17,6 +17,17 @@
 
 #include "nsx_core.h"
 
+// The windowing and overlap-add kernels use SSE2 or NEON when the compiler
+// targets it.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WEBRTC_NSX_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define WEBRTC_NSX_NEON
+#include <arm_neon.h>
+#endif
+
 // Skip first frequency bins during estimation. (0 <= value < 64)
 static const int kStartBand = 5;
 
@@ -537,10 +548,12 @@ WebRtc_Word32 WebRtcNsx_InitCore(NsxInst_t *inst, WebRtc_UWord32 fs)
         inst->maxLrt = 0x0080000;
         inst->minLrt = 104858;
     }
+    inst->blockLen = inst->blockLen10ms;
     inst->anaLen2 = WEBRTC_SPL_RSHIFT_W16(inst->anaLen, 1);
     inst->magnLen = inst->anaLen2 + 1;
 
     WebRtcSpl_ZerosArrayW16(inst->analysisBuffer, ANAL_BLOCKL_MAX);
+    inst->anaBufPos = 0;
     WebRtcSpl_ZerosArrayW16(inst->synthesisBuffer, ANAL_BLOCKL_MAX);
 
     // for HB processing
@@ -613,6 +626,8 @@ WebRtc_Word32 WebRtcNsx_InitCore(NsxInst_t *inst, WebRtc_UWord32 fs)
     inst->pinkNoiseExp = 0;
     inst->minNorm = 15; // Start with full scale
     inst->zeroInputSignal = 0;
+    inst->gainTimeDomainHB = 16384; // Q14(1.0)
+    inst->active = 1;
 
     //default mode
     WebRtcNsx_set_policy_core(inst, 0);
@@ -632,6 +647,52 @@ WebRtc_Word32 WebRtcNsx_InitCore(NsxInst_t *inst, WebRtc_UWord32 fs)
     return 0;
 }
 
+WebRtc_Word32 WebRtcNsx_InitLowDelayCore(NsxInst_t *inst, WebRtc_UWord32 fs)
+{
+    // A 5 ms block at 8 kHz would need a 64 point FFT, which the fixed-point
+    // tables do not cover.
+    if (fs != 16000 && fs != 32000)
+    {
+        return -1;
+    }
+    if (WebRtcNsx_InitCore(inst, fs) != 0)
+    {
+        return -1;
+    }
+
+    // Two blocks per 10 ms frame, analyzed as in narrow band.
+    inst->blockLen = 80;
+    inst->anaLen = 128;
+    inst->stages = 7;
+    inst->window = kBlocks80w128x;
+    inst->thresholdLogLrt = 131072;
+    inst->maxLrt = 0x0040000;
+    inst->minLrt = 52429;
+    inst->featureLogLrt = inst->thresholdLogLrt;
+    inst->anaLen2 = WEBRTC_SPL_RSHIFT_W16(inst->anaLen, 1);
+    inst->magnLen = inst->anaLen2 + 1;
+
+    return 0;
+}
+
+WebRtc_Word32 WebRtcNsx_ChangeSampFreqCore(NsxInst_t *inst, WebRtc_UWord32 fs)
+{
+    if (inst->initFlag != 1)
+    {
+        return -1;
+    }
+    // Block and FFT lengths are the same at 16 and 32 kHz.
+    if ((fs != 16000 && fs != 32000) || (inst->fs != 16000 && inst->fs != 32000))
+    {
+        return -1;
+    }
+    inst->fs = fs;
+
+    WebRtcSpl_ZerosArrayW16(inst->dataBufHBFX, ANAL_BLOCKL_MAX);
+
+    return 0;
+}
+
 int WebRtcNsx_set_policy_core(NsxInst_t *inst, int mode)
 {
     // allow for modes:0,1,2,3
@@ -1432,6 +1493,144 @@ void WebRtcNsx_SpeechNoiseProb(NsxInst_t *inst, WebRtc_UWord16 *nonSpeechProbFin
     }
 }
 
+// Scaling of WebRtcSpl_Energy() for |length| samples with a maximum absolute
+// value of |maxAbs|, which must be less than 32768. Gives the same result as
+// WebRtcSpl_GetScalingSquare(), without another pass over the data.
+static int WebRtcNsx_EnergyScaling(WebRtc_Word32 maxAbs, int length)
+{
+    int nbits = WebRtcSpl_GetSizeInBits(length);
+    int t = WebRtcSpl_NormW32(WEBRTC_SPL_MUL(maxAbs, maxAbs));
+
+    if (maxAbs == 0)
+    {
+        return 0;
+    }
+    return (t > nbits) ? 0 : nbits - t;
+}
+
+#if defined(WEBRTC_NSX_SSE2)
+// (window * x + 8192) >> 14 for eight samples, truncated to 16 bits as the C
+// cast does.
+static __inline __m128i WebRtcNsx_WindowQ14Sse2(__m128i window, __m128i x)
+{
+    const __m128i round = _mm_set1_epi32(8192);
+    __m128i lo = _mm_mullo_epi16(window, x);
+    __m128i hi = _mm_mulhi_epi16(window, x);
+    __m128i y0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 14);
+    __m128i y1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 14);
+
+    // Sign extend the low halves so that the pack does not saturate.
+    y0 = _mm_srai_epi32(_mm_slli_epi32(y0, 16), 16);
+    y1 = _mm_srai_epi32(_mm_slli_epi32(y1, 16), 16);
+    return _mm_packs_epi32(y0, y1);
+}
+#elif defined(WEBRTC_NSX_NEON)
+// (window * x + 8192) >> 14 for eight samples, truncated to 16 bits as the C
+// cast does.
+static __inline int16x8_t WebRtcNsx_WindowQ14Neon(int16x8_t window, int16x8_t x)
+{
+    int32x4_t y0 = vrshrq_n_s32(vmull_s16(vget_low_s16(window), vget_low_s16(x)), 14);
+    int32x4_t y1 = vrshrq_n_s32(vmull_s16(vget_high_s16(window), vget_high_s16(x)), 14);
+    return vcombine_s16(vmovn_s32(y0), vmovn_s32(y1));
+}
+#endif
+
+// Windows |length| samples of |buffer| into |winData| and widens the range
+// [*minVal, *maxVal] to include the result.
+static void WebRtcNsx_WindowSegment(const WebRtc_Word16 *window,
+                                    const WebRtc_Word16 *buffer,
+                                    WebRtc_Word16 *winData, int length,
+                                    WebRtc_Word16 *minVal, WebRtc_Word16 *maxVal)
+{
+    int i = 0;
+#if defined(WEBRTC_NSX_SSE2)
+    __m128i vmin = _mm_set1_epi16(*minVal);
+    __m128i vmax = _mm_set1_epi16(*maxVal);
+    WebRtc_Word16 lanes[16];
+    int k;
+
+    for (; i + 8 <= length; i += 8)
+    {
+        __m128i y = WebRtcNsx_WindowQ14Sse2(
+            _mm_loadu_si128((const __m128i*)&window[i]),
+            _mm_loadu_si128((const __m128i*)&buffer[i]));
+        _mm_storeu_si128((__m128i*)&winData[i], y);
+        vmin = _mm_min_epi16(vmin, y);
+        vmax = _mm_max_epi16(vmax, y);
+    }
+    _mm_storeu_si128((__m128i*)lanes, vmin);
+    _mm_storeu_si128((__m128i*)&lanes[8], vmax);
+    for (k = 0; k < 8; k++)
+    {
+        *minVal = WEBRTC_SPL_MIN(*minVal, lanes[k]);
+        *maxVal = WEBRTC_SPL_MAX(*maxVal, lanes[8 + k]);
+    }
+#elif defined(WEBRTC_NSX_NEON)
+    int16x8_t vmin = vdupq_n_s16(*minVal);
+    int16x8_t vmax = vdupq_n_s16(*maxVal);
+    WebRtc_Word16 lanes[16];
+    int k;
+
+    for (; i + 8 <= length; i += 8)
+    {
+        int16x8_t y = WebRtcNsx_WindowQ14Neon(vld1q_s16(&window[i]), vld1q_s16(&buffer[i]));
+        vst1q_s16(&winData[i], y);
+        vmin = vminq_s16(vmin, y);
+        vmax = vmaxq_s16(vmax, y);
+    }
+    vst1q_s16(lanes, vmin);
+    vst1q_s16(&lanes[8], vmax);
+    for (k = 0; k < 8; k++)
+    {
+        *minVal = WEBRTC_SPL_MIN(*minVal, lanes[k]);
+        *maxVal = WEBRTC_SPL_MAX(*maxVal, lanes[8 + k]);
+    }
+#endif
+    for (; i < length; i++)
+    {
+        winData[i] = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT_WITH_ROUND(window[i], buffer[i],
+                                                                         14); // Q0
+        *minVal = WEBRTC_SPL_MIN(*minVal, winData[i]);
+        *maxVal = WEBRTC_SPL_MAX(*maxVal, winData[i]);
+    }
+}
+
+// Windows the circular analysis buffer, starting at the oldest sample, into
+// |winData| and returns the maximum absolute value of the result (up to 32768).
+static WebRtc_Word32 WebRtcNsx_WindowAndMaxAbs(const NsxInst_t *inst, WebRtc_Word16 *winData)
+{
+    WebRtc_Word16 minVal = 0;
+    WebRtc_Word16 maxVal = 0;
+    int split = inst->anaLen - inst->anaBufPos;
+
+    WebRtcNsx_WindowSegment(inst->window, inst->analysisBuffer + inst->anaBufPos, winData,
+                            split, &minVal, &maxVal);
+    WebRtcNsx_WindowSegment(inst->window + split, inst->analysisBuffer, winData + split,
+                            inst->anaBufPos, &minVal, &maxVal);
+
+    return WEBRTC_SPL_MAX((WebRtc_Word32)maxVal, -(WebRtc_Word32)minVal);
+}
+
+// Computes the energy of |winData| with |scaling| as WebRtcSpl_Energy(), and
+// packs it normalized by |normData| as the real part of |realImag|, with zero
+// imaginary parts.
+static WebRtc_Word32 WebRtcNsx_EnergyAndPack(const WebRtc_Word16 *winData, int length,
+                                             int scaling, int normData,
+                                             WebRtc_Word16 *realImag)
+{
+    WebRtc_Word32 energy = 0;
+    int i;
+
+    for (i = 0; i < length; i++)
+    {
+        energy += WEBRTC_SPL_MUL_16_16_RSFT(winData[i], winData[i], scaling);
+        realImag[2 * i] = WEBRTC_SPL_LSHIFT_W16(winData[i], normData); // Q(normData)
+        realImag[2 * i + 1] = 0; // Insert zeros in imaginary part
+    }
+
+    return energy;
+}
+
 // Transform input (speechFrame) to frequency domain magnitude (magnU16)
 void WebRtcNsx_DataAnalysis(NsxInst_t *inst, short *speechFrame, WebRtc_UWord16 *magnU16)
 {
@@ -1453,6 +1652,7 @@ void WebRtcNsx_DataAnalysis(NsxInst_t *inst, short *speechFrame, WebRtc_UWord16
     WebRtc_Word16   matrix_determinant = 0;
     WebRtc_Word16   winData[ANAL_BLOCKL_MAX], maxWinData;
     WebRtc_Word16   realImag[ANAL_BLOCKL_MAX << 1];
+    WebRtc_Word32   maxAbsWinData;
 
     int i, j;
     int outCFFT;
@@ -1460,36 +1660,50 @@ void WebRtcNsx_DataAnalysis(NsxInst_t *inst, short *speechFrame, WebRtc_UWord16
     int net_norm = 0;
     int right_shifts_in_magnU16 = 0;
     int right_shifts_in_initMagnEst = 0;
+    int tail;
 
     // For lower band do all processing
-    // update analysis buffer for L band
-    WEBRTC_SPL_MEMCPY_W16(inst->analysisBuffer, inst->analysisBuffer + inst->blockLen10ms,
-                          inst->anaLen - inst->blockLen10ms);
-    WEBRTC_SPL_MEMCPY_W16(inst->analysisBuffer + inst->anaLen - inst->blockLen10ms,
-                          speechFrame, inst->blockLen10ms);
+    // update circular analysis buffer for L band, overwriting the oldest samples
+    tail = WEBRTC_SPL_MIN(inst->blockLen, inst->anaLen - inst->anaBufPos);
+    WEBRTC_SPL_MEMCPY_W16(inst->analysisBuffer + inst->anaBufPos, speechFrame, tail);
+    WEBRTC_SPL_MEMCPY_W16(inst->analysisBuffer, speechFrame + tail, inst->blockLen - tail);
+    inst->anaBufPos += inst->blockLen;
+    if (inst->anaBufPos >= inst->anaLen)
+    {
+        inst->anaBufPos -= inst->anaLen;
+    }
 
     // Window data before FFT
-    for (i = 0; i < inst->anaLen; i++)
-    {
-        winData[i] = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT_WITH_ROUND(inst->window[i],
-                inst->analysisBuffer[i],
-                14); // Q0
-    }
-    // Get input energy
-    inst->energyIn = WebRtcSpl_Energy(winData, (int)inst->anaLen, &(inst->scaleEnergyIn));
+    maxAbsWinData = WebRtcNsx_WindowAndMaxAbs(inst, winData);
 
     // Reset zero input flag
     inst->zeroInputSignal = 0;
     // Acquire norm for winData
-    maxWinData = WebRtcSpl_MaxAbsValueW16(winData, inst->anaLen);
+    maxWinData = (WebRtc_Word16)WEBRTC_SPL_MIN(maxAbsWinData, WEBRTC_SPL_WORD16_MAX);
     inst->normData = WebRtcSpl_NormW16(maxWinData);
     if (maxWinData == 0)
     {
         // Treat zero input separately.
+        inst->energyIn = 0;
+        inst->scaleEnergyIn = 0;
         inst->zeroInputSignal = 1;
         return;
     }
 
+    // Get input energy, and create realImag as winData interleaved with zeros
+    // (= imag. part), normalized.
+    if (maxAbsWinData > WEBRTC_SPL_WORD16_MAX)
+    {
+        // WebRtcSpl_GetScalingSquare() skips -32768 when finding the maximum.
+        inst->scaleEnergyIn = WebRtcSpl_GetScalingSquare(winData, inst->anaLen,
+                                                         inst->anaLen);
+    } else
+    {
+        inst->scaleEnergyIn = WebRtcNsx_EnergyScaling(maxAbsWinData, inst->anaLen);
+    }
+    inst->energyIn = WebRtcNsx_EnergyAndPack(winData, inst->anaLen, inst->scaleEnergyIn,
+                                             inst->normData, realImag);
+
     // Determine the net normalization in the frequency domain
     net_norm = inst->stages - inst->normData;
     // Track lowest normalization factor and use it to prevent wrap around in shifting
@@ -1498,14 +1712,6 @@ void WebRtcNsx_DataAnalysis(NsxInst_t *inst, short *speechFrame, WebRtc_UWord16
     inst->minNorm -= right_shifts_in_initMagnEst;
     right_shifts_in_magnU16 = WEBRTC_SPL_MAX(right_shifts_in_magnU16, 0);
 
-    // create realImag as winData interleaved with zeros (= imag. part), normalize it
-    for (i = 0; i < inst->anaLen; i++)
-    {
-        j = WEBRTC_SPL_LSHIFT_W16(i, 1);
-        realImag[j] = WEBRTC_SPL_LSHIFT_W16(winData[i], inst->normData); // Q(normData)
-        realImag[j + 1] = 0; // Insert zeros in imaginary part
-    }
-
     // bit-reverse position of elements in array and FFT the array
     WebRtcSpl_ComplexBitReverse(realImag, inst->stages); // Q(normData-stages)
     outCFFT = WebRtcSpl_ComplexFFT(realImag, inst->stages, 1);
@@ -1629,9 +1835,9 @@ void WebRtcNsx_DataAnalysis(NsxInst_t *inst, short *speechFrame, WebRtc_UWord16
         matrix_determinant = kDeterminantEstMatrix[kStartBand]; // Q0
         sum_log_i = kSumLogIndex[kStartBand]; // Q5
         sum_log_i_square = kSumSquareLogIndex[kStartBand]; // Q2
-        if (inst->fs == 8000)
+        if (inst->anaLen == 128)
         {
-            // Adjust values to shorter blocks in narrow band.
+            // Adjust values to shorter blocks in narrow band and low delay.
             tmp_1_w32 = (WebRtc_Word32)matrix_determinant;
             tmp_1_w32 += WEBRTC_SPL_MUL_16_16_RSFT(kSumLogIndex[65], sum_log_i, 9);
             tmp_1_w32 -= WEBRTC_SPL_MUL_16_16_RSFT(kSumLogIndex[65], kSumLogIndex[65], 10);
@@ -1692,10 +1898,148 @@ void WebRtcNsx_DataAnalysis(NsxInst_t *inst, short *speechFrame, WebRtc_UWord16
     }
 }
 
-void WebRtcNsx_DataSynthesis(NsxInst_t *inst, short *outFrame)
+// Denormalizes the real part of the IFFT output in |realImag| by |shift|
+// into |inst->real| and returns the maximum absolute value of the result (up
+// to 32768).
+static WebRtc_Word32 WebRtcNsx_DenormalizeAndMaxAbs(NsxInst_t *inst,
+                                                    const WebRtc_Word16 *realImag,
+                                                    int shift)
+{
+    WebRtc_Word32 tmp32no1;
+    WebRtc_Word32 maxAbs = 0;
+    WebRtc_Word32 absVal;
+    int i;
+
+    for (i = 0; i < inst->anaLen; i++)
+    {
+        tmp32no1 = WEBRTC_SPL_SHIFT_W32((WebRtc_Word32)realImag[2 * i], shift);
+        inst->real[i] = (WebRtc_Word16)WEBRTC_SPL_SAT(WEBRTC_SPL_WORD16_MAX, tmp32no1,
+                                                      WEBRTC_SPL_WORD16_MIN);
+        absVal = WEBRTC_SPL_ABS_W32(inst->real[i]);
+        maxAbs = WEBRTC_SPL_MAX(maxAbs, absVal);
+    }
+
+    return maxAbs;
+}
+
+// Windows |inst->real|, applies |gainFactor| (Q13) and overlap-adds the result
+// to the synthesis buffer.
+static void WebRtcNsx_WindowAndOverlapAdd(NsxInst_t *inst, WebRtc_Word16 gainFactor)
+{
+    WebRtc_Word32 tmp32no1;
+    WebRtc_Word16 tmp16no1, tmp16no2;
+    int i = 0;
+#if defined(WEBRTC_NSX_SSE2)
+    const __m128i gain = _mm_set1_epi16(gainFactor);
+    const __m128i round = _mm_set1_epi32(4096);
+
+    for (; i + 8 <= inst->anaLen; i += 8)
+    {
+        __m128i y = WebRtcNsx_WindowQ14Sse2(
+            _mm_loadu_si128((const __m128i*)&inst->window[i]),
+            _mm_loadu_si128((const __m128i*)&inst->real[i]));
+        __m128i lo = _mm_mullo_epi16(y, gain);
+        __m128i hi = _mm_mulhi_epi16(y, gain);
+        __m128i y0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 13);
+        __m128i y1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 13);
+        __m128i out = _mm_loadu_si128((const __m128i*)&inst->synthesisBuffer[i]);
+        _mm_storeu_si128((__m128i*)&inst->synthesisBuffer[i],
+                         _mm_adds_epi16(out, _mm_packs_epi32(y0, y1)));
+    }
+#elif defined(WEBRTC_NSX_NEON)
+    const int16x4_t gain = vdup_n_s16(gainFactor);
+
+    for (; i + 8 <= inst->anaLen; i += 8)
+    {
+        int16x8_t y = WebRtcNsx_WindowQ14Neon(vld1q_s16(&inst->window[i]),
+                                              vld1q_s16(&inst->real[i]));
+        int32x4_t y0 = vrshrq_n_s32(vmull_s16(vget_low_s16(y), gain), 13);
+        int32x4_t y1 = vrshrq_n_s32(vmull_s16(vget_high_s16(y), gain), 13);
+        vst1q_s16(&inst->synthesisBuffer[i],
+                  vqaddq_s16(vld1q_s16(&inst->synthesisBuffer[i]),
+                             vcombine_s16(vqmovn_s32(y0), vqmovn_s32(y1))));
+    }
+#endif
+
+    for (; i < inst->anaLen; i++)
+    {
+        tmp16no1 = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT_WITH_ROUND(inst->window[i],
+                                                                       inst->real[i], 14); // Q0, window in Q14
+        tmp32no1 = WEBRTC_SPL_MUL_16_16_RSFT_WITH_ROUND(tmp16no1, gainFactor, 13); // Q0
+        // Down shift with rounding
+        tmp16no2 = (WebRtc_Word16)WEBRTC_SPL_SAT(WEBRTC_SPL_WORD16_MAX, tmp32no1,
+                                                 WEBRTC_SPL_WORD16_MIN); // Q0
+        inst->synthesisBuffer[i] = WEBRTC_SPL_ADD_SAT_W16(inst->synthesisBuffer[i], tmp16no2); // Q0
+    }
+}
+
+// Denormalizes the real part of the IFFT output in |realImag| by |shift|,
+// windows it and overlap-adds it to the synthesis buffer in one pass. Same as
+// WebRtcNsx_DenormalizeAndMaxAbs() followed by WebRtcNsx_WindowAndOverlapAdd()
+// with unity gain.
+static void WebRtcNsx_DenormalizeWindowAndOverlapAdd(NsxInst_t *inst,
+                                                     const WebRtc_Word16 *realImag,
+                                                     int shift)
 {
     WebRtc_Word32 tmp32no1;
+    WebRtc_Word16 tmp16no1;
+    int i = 0;
+#if defined(WEBRTC_NSX_SSE2)
+    const __m128i count = _mm_cvtsi32_si128(shift >= 0 ? shift : -shift);
+
+    for (; i + 8 <= inst->anaLen; i += 8)
+    {
+        // Keep the real parts, sign extended to 32 bits.
+        __m128i x0 = _mm_srai_epi32(
+            _mm_slli_epi32(_mm_loadu_si128((const __m128i*)&realImag[2 * i]), 16), 16);
+        __m128i x1 = _mm_srai_epi32(
+            _mm_slli_epi32(_mm_loadu_si128((const __m128i*)&realImag[2 * i + 8]), 16), 16);
+        __m128i y;
+        if (shift >= 0)
+        {
+            x0 = _mm_sll_epi32(x0, count);
+            x1 = _mm_sll_epi32(x1, count);
+        }
+        else
+        {
+            x0 = _mm_sra_epi32(x0, count);
+            x1 = _mm_sra_epi32(x1, count);
+        }
+        y = WebRtcNsx_WindowQ14Sse2(_mm_loadu_si128((const __m128i*)&inst->window[i]),
+                                    _mm_packs_epi32(x0, x1));
+        _mm_storeu_si128((__m128i*)&inst->synthesisBuffer[i],
+                         _mm_adds_epi16(_mm_loadu_si128((const __m128i*)
+                                                        &inst->synthesisBuffer[i]), y));
+    }
+#elif defined(WEBRTC_NSX_NEON)
+    const int32x4_t count = vdupq_n_s32(shift);
+
+    for (; i + 8 <= inst->anaLen; i += 8)
+    {
+        int16x8x2_t x = vld2q_s16(&realImag[2 * i]);
+        int32x4_t x0 = vshlq_s32(vmovl_s16(vget_low_s16(x.val[0])), count);
+        int32x4_t x1 = vshlq_s32(vmovl_s16(vget_high_s16(x.val[0])), count);
+        int16x8_t y = WebRtcNsx_WindowQ14Neon(vld1q_s16(&inst->window[i]),
+                                              vcombine_s16(vqmovn_s32(x0), vqmovn_s32(x1)));
+        vst1q_s16(&inst->synthesisBuffer[i], vqaddq_s16(vld1q_s16(&inst->synthesisBuffer[i]), y));
+    }
+#endif
+
+    for (; i < inst->anaLen; i++)
+    {
+        tmp32no1 = WEBRTC_SPL_SHIFT_W32((WebRtc_Word32)realImag[2 * i], shift);
+        tmp16no1 = (WebRtc_Word16)WEBRTC_SPL_SAT(WEBRTC_SPL_WORD16_MAX, tmp32no1,
+                                                 WEBRTC_SPL_WORD16_MIN);
+        tmp16no1 = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT_WITH_ROUND(inst->window[i],
+                                                                       tmp16no1, 14); // Q0, window in Q14
+        inst->synthesisBuffer[i] = WEBRTC_SPL_ADD_SAT_W16(inst->synthesisBuffer[i], tmp16no1); // Q0
+    }
+}
+
+void WebRtcNsx_DataSynthesis(NsxInst_t *inst, short *outFrame)
+{
     WebRtc_Word32 energyOut;
+    WebRtc_Word32 maxAbsReal;
 
     WebRtc_Word16 realImag[ANAL_BLOCKL_MAX << 1];
     WebRtc_Word16 tmp16no1, tmp16no2;
@@ -1710,16 +2054,16 @@ void WebRtcNsx_DataSynthesis(NsxInst_t *inst, short *outFrame)
     {
         // synthesize the special case of zero input
         // read out fully processed segment
-        for (i = 0; i < inst->blockLen10ms; i++)
+        for (i = 0; i < inst->blockLen; i++)
         {
             outFrame[i] = inst->synthesisBuffer[i]; // Q0
         }
         // update synthesis buffer
         WEBRTC_SPL_MEMCPY_W16(inst->synthesisBuffer,
-                              inst->synthesisBuffer + inst->blockLen10ms,
-                              inst->anaLen - inst->blockLen10ms);
-        WebRtcSpl_ZerosArrayW16(inst->synthesisBuffer + inst->anaLen - inst->blockLen10ms,
-                                inst->blockLen10ms);
+                              inst->synthesisBuffer + inst->blockLen,
+                              inst->anaLen - inst->blockLen);
+        WebRtcSpl_ZerosArrayW16(inst->synthesisBuffer + inst->anaLen - inst->blockLen,
+                                inst->blockLen);
         return;
     }
     // Filter the data in the frequency domain
@@ -1750,21 +2094,27 @@ void WebRtcNsx_DataSynthesis(NsxInst_t *inst, short *outFrame)
     WebRtcSpl_ComplexBitReverse(realImag, inst->stages);
     outCIFFT = WebRtcSpl_ComplexIFFT(realImag, inst->stages, 1);
 
-    for (i = 0; i < inst->anaLen; i++)
-    {
-        j = WEBRTC_SPL_LSHIFT_W16(i, 1);
-        tmp32no1 = WEBRTC_SPL_SHIFT_W32((WebRtc_Word32)realImag[j], outCIFFT - inst->normData);
-        inst->real[i] = (WebRtc_Word16)WEBRTC_SPL_SAT(WEBRTC_SPL_WORD16_MAX, tmp32no1,
-                                                      WEBRTC_SPL_WORD16_MIN);
-    }
-
     //scale factor: only do it after END_STARTUP_LONG time
-    gainFactor = 8192; // 8192 = Q13(1.0)
     if (inst->gainMap == 1 &&
         inst->blockIndex > END_STARTUP_LONG &&
         inst->energyIn > 0)
     {
-        energyOut = WebRtcSpl_Energy(inst->real, (int)inst->anaLen, &scaleEnergyOut); // Q(-scaleEnergyOut)
+        maxAbsReal = WebRtcNsx_DenormalizeAndMaxAbs(inst, realImag,
+                                                    outCIFFT - inst->normData);
+        if (maxAbsReal > WEBRTC_SPL_WORD16_MAX)
+        {
+            // WebRtcSpl_GetScalingSquare() skips -32768 when finding the maximum.
+            scaleEnergyOut = WebRtcSpl_GetScalingSquare(inst->real, inst->anaLen, inst->anaLen);
+        } else
+        {
+            scaleEnergyOut = WebRtcNsx_EnergyScaling(maxAbsReal, inst->anaLen);
+        }
+        energyOut = 0;
+        for (i = 0; i < inst->anaLen; i++)
+        {
+            energyOut += WEBRTC_SPL_MUL_16_16_RSFT(inst->real[i], inst->real[i],
+                                                   scaleEnergyOut); // Q(-scaleEnergyOut)
+        }
         if (scaleEnergyOut == 0 && !(energyOut & 0x7f800000))
         {
             energyOut = WEBRTC_SPL_SHIFT_W32(energyOut, 8 + scaleEnergyOut
@@ -1778,6 +2128,8 @@ void WebRtcNsx_DataSynthesis(NsxInst_t *inst, short *outFrame)
         assert(inst->energyIn > 0);
         energyRatio = (WebRtc_Word16)WEBRTC_SPL_DIV(energyOut
                 + WEBRTC_SPL_RSHIFT_W32(inst->energyIn, 1), inst->energyIn); // Q8
+        // The gain tables cover ratios up to 1.0.
+        energyRatio = WEBRTC_SPL_SAT(256, energyRatio, 0); // Q8
 
         //         // original FLOAT code
         //         if (gain > blim) {
@@ -1813,34 +2165,30 @@ void WebRtcNsx_DataSynthesis(NsxInst_t *inst, short *outFrame)
         tmp16no2 = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT(inst->priorNonSpeechProb,
                                                             gainFactor2, 14); // Q13;
         gainFactor = tmp16no1 + tmp16no2; // Q13
-    } // out of flag_gain_map==1
 
-    // synthesis
-    for (i = 0; i < inst->anaLen; i++)
+        // synthesis
+        WebRtcNsx_WindowAndOverlapAdd(inst, gainFactor);
+    } else
     {
-        tmp16no1 = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT_WITH_ROUND(inst->window[i],
-                                                                       inst->real[i], 14); // Q0, window in Q14
-        tmp32no1 = WEBRTC_SPL_MUL_16_16_RSFT_WITH_ROUND(tmp16no1, gainFactor, 13); // Q0
-        // Down shift with rounding
-        tmp16no2 = (WebRtc_Word16)WEBRTC_SPL_SAT(WEBRTC_SPL_WORD16_MAX, tmp32no1,
-                                                 WEBRTC_SPL_WORD16_MIN); // Q0
-        inst->synthesisBuffer[i] = WEBRTC_SPL_ADD_SAT_W16(inst->synthesisBuffer[i], tmp16no2); // Q0
-    }
+        // synthesis with unity gain, 8192 = Q13(1.0)
+        WebRtcNsx_DenormalizeWindowAndOverlapAdd(inst, realImag, outCIFFT - inst->normData);
+    } // out of flag_gain_map==1
 
     // read out fully processed segment
-    for (i = 0; i < inst->blockLen10ms; i++)
+    for (i = 0; i < inst->blockLen; i++)
     {
         outFrame[i] = inst->synthesisBuffer[i]; // Q0
     }
     // update synthesis buffer
-    WEBRTC_SPL_MEMCPY_W16(inst->synthesisBuffer, inst->synthesisBuffer + inst->blockLen10ms,
-                          inst->anaLen - inst->blockLen10ms);
-    WebRtcSpl_ZerosArrayW16(inst->synthesisBuffer + inst->anaLen - inst->blockLen10ms,
-                            inst->blockLen10ms);
+    WEBRTC_SPL_MEMCPY_W16(inst->synthesisBuffer, inst->synthesisBuffer + inst->blockLen,
+                          inst->anaLen - inst->blockLen);
+    WebRtcSpl_ZerosArrayW16(inst->synthesisBuffer + inst->anaLen - inst->blockLen,
+                            inst->blockLen);
 }
 
-int WebRtcNsx_ProcessCore(NsxInst_t *inst, short *speechFrame, short *speechFrameHB,
-                          short *outFrame, short *outFrameHB)
+// Processes one block of inst->blockLen samples.
+static int ProcessBlock(NsxInst_t *inst, short *speechFrame, short *speechFrameHB,
+                        short *outFrame, short *outFrameHB)
 {
     // main routine for noise suppression
 
@@ -1883,7 +2231,7 @@ int WebRtcNsx_ProcessCore(NsxInst_t *inst, short *speechFrame, short *speechFram
     int q_domain_to_use = 0;
 
 #ifdef NS_FILEDEBUG
-    fwrite(spframe, sizeof(short), inst->blockLen10ms, inst->infile);
+    fwrite(spframe, sizeof(short), inst->blockLen, inst->infile);
 #endif
 
     // Check that initialization has been done
@@ -1908,11 +2256,11 @@ int WebRtcNsx_ProcessCore(NsxInst_t *inst, short *speechFrame, short *speechFram
         {
             // update analysis buffer for H band
             // append new data to buffer FX
-            WEBRTC_SPL_MEMCPY_W16(inst->dataBufHBFX, inst->dataBufHBFX + inst->blockLen10ms,
-                                  inst->anaLen - inst->blockLen10ms);
-            WEBRTC_SPL_MEMCPY_W16(inst->dataBufHBFX + inst->anaLen - inst->blockLen10ms,
-                                  speechFrameHB, inst->blockLen10ms);
-            for (i = 0; i < inst->blockLen10ms; i++)
+            WEBRTC_SPL_MEMCPY_W16(inst->dataBufHBFX, inst->dataBufHBFX + inst->blockLen,
+                                  inst->anaLen - inst->blockLen);
+            WEBRTC_SPL_MEMCPY_W16(inst->dataBufHBFX + inst->anaLen - inst->blockLen,
+                                  speechFrameHB, inst->blockLen);
+            for (i = 0; i < inst->blockLen; i++)
             {
                 outFrameHB[i] = inst->dataBufHBFX[i]; // Q0
             }
@@ -1920,6 +2268,27 @@ int WebRtcNsx_ProcessCore(NsxInst_t *inst, short *speechFrame, short *speechFram
         return 0;
     }
 
+    if (!inst->active)
+    {
+        // Inactive near end: apply the latest filter and H band gain, and
+        // leave the noise and speech models as they are.
+        WebRtcNsx_DataSynthesis(inst, outFrame);
+
+        if (inst->fs == 32000)
+        {
+            WEBRTC_SPL_MEMCPY_W16(inst->dataBufHBFX, inst->dataBufHBFX + inst->blockLen,
+                                  inst->anaLen - inst->blockLen);
+            WEBRTC_SPL_MEMCPY_W16(inst->dataBufHBFX + inst->anaLen - inst->blockLen,
+                                  speechFrameHB, inst->blockLen);
+            for (i = 0; i < inst->blockLen; i++)
+            {
+                outFrameHB[i] = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT(
+                        inst->gainTimeDomainHB, inst->dataBufHBFX[i], 14); // Q0
+            }
+        }
+        return 0;
+    }
+
     // Update block index when we have something to process
     inst->blockIndex++;
     //
@@ -2412,7 +2781,7 @@ int WebRtcNsx_ProcessCore(NsxInst_t *inst, short *speechFrame, short *speechFram
 
     WebRtcNsx_DataSynthesis(inst, outFrame);
 #ifdef NS_FILEDEBUG
-    fwrite(outframe, sizeof(short), inst->blockLen10ms, inst->outfile);
+    fwrite(outframe, sizeof(short), inst->blockLen, inst->outfile);
 #endif
 
     //for H band:
@@ -2421,8 +2790,8 @@ int WebRtcNsx_ProcessCore(NsxInst_t *inst, short *speechFrame, short *speechFram
     {
         // update analysis buffer for H band
         // append new data to buffer FX
-        WEBRTC_SPL_MEMCPY_W16(inst->dataBufHBFX, inst->dataBufHBFX + inst->blockLen10ms, inst->anaLen - inst->blockLen10ms);
-        WEBRTC_SPL_MEMCPY_W16(inst->dataBufHBFX + inst->anaLen - inst->blockLen10ms, speechFrameHB, inst->blockLen10ms);
+        WEBRTC_SPL_MEMCPY_W16(inst->dataBufHBFX, inst->dataBufHBFX + inst->blockLen, inst->anaLen - inst->blockLen);
+        WEBRTC_SPL_MEMCPY_W16(inst->dataBufHBFX + inst->anaLen - inst->blockLen, speechFrameHB, inst->blockLen);
         // range for averaging low band quantities for H band gain
 
         gainTimeDomainHB = 16384; // 16384 = Q14(1.0)
@@ -2479,10 +2848,11 @@ int WebRtcNsx_ProcessCore(NsxInst_t *inst, short *speechFrame, short *speechFram
         //make sure gain is within flooring range
         gainTimeDomainHB
                 = WEBRTC_SPL_SAT(16384, gainTimeDomainHB, (WebRtc_Word16)(inst->denoiseBound)); // 16384 = Q14(1.0)
+        inst->gainTimeDomainHB = gainTimeDomainHB;
 
 
         //apply gain
-        for (i = 0; i < inst->blockLen10ms; i++)
+        for (i = 0; i < inst->blockLen; i++)
         {
             outFrameHB[i]
                     = (WebRtc_Word16)WEBRTC_SPL_MUL_16_16_RSFT(gainTimeDomainHB, inst->dataBufHBFX[i], 14); // Q0
@@ -2491,3 +2861,28 @@ int WebRtcNsx_ProcessCore(NsxInst_t *inst, short *speechFrame, short *speechFram
 
     return 0;
 }
+
+int WebRtcNsx_ProcessCore(NsxInst_t *inst, short *speechFrame, short *speechFrameHB,
+                          short *outFrame, short *outFrameHB)
+{
+    int i;
+
+    // Check for valid pointers based on sampling rate
+    if ((inst->fs == 32000) && (speechFrameHB == NULL))
+    {
+        return -1;
+    }
+
+    // The H band pointers are only advanced when given.
+    for (i = 0; i < inst->blockLen10ms; i += inst->blockLen)
+    {
+        if (ProcessBlock(inst, speechFrame + i,
+                         speechFrameHB ? speechFrameHB + i : NULL,
+                         outFrame + i, outFrameHB ? outFrameHB + i : NULL) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -25,7 +25,8 @@ typedef struct NsxInst_t_
     WebRtc_UWord32          fs;
 
     const WebRtc_Word16*    window;
-    WebRtc_Word16           analysisBuffer[ANAL_BLOCKL_MAX];
+    WebRtc_Word16           analysisBuffer[ANAL_BLOCKL_MAX]; // circular, see anaBufPos
+    int                     anaBufPos; // oldest sample in analysisBuffer
     WebRtc_Word16           synthesisBuffer[ANAL_BLOCKL_MAX];
     WebRtc_UWord16          noiseSupFilter[HALF_ANAL_BLOCKL];
     WebRtc_UWord16          overdrive; /* Q8 */
@@ -88,11 +89,13 @@ typedef struct NsxInst_t_
 
     //quantities for high band estimate
     WebRtc_Word16           dataBufHBFX[ANAL_BLOCKL_MAX]; /* Q0 */
+    WebRtc_Word16           gainTimeDomainHB; // Q14, of the last model update
 
     int                     qNoise;
     int                     prevQNoise;
     int                     prevQMagn;
     int                     blockLen10ms;
+    int                     blockLen; // processing block, 10 ms or 5 ms
 
     WebRtc_Word16           real[ANAL_BLOCKL_MAX];
     WebRtc_Word16           imag[ANAL_BLOCKL_MAX];
@@ -100,6 +103,8 @@ typedef struct NsxInst_t_
     int                     scaleEnergyIn;
     int                     normData;
 
+    int                     active; // 0: near end inactive, models held
+
 } NsxInst_t;
 
 #ifdef __cplusplus
@@ -124,6 +129,44 @@ extern "C"
  */
 WebRtc_Word32 WebRtcNsx_InitCore(NsxInst_t *inst, WebRtc_UWord32 fs);
 
+/****************************************************************************
+ * WebRtcNsx_InitLowDelayCore(...)
+ *
+ * This function initializes a noise suppression instance for low-delay
+ * processing with WebRtcNsx_ProcessCore(). Each 10 ms frame is processed in
+ * two blocks, with the analysis used for narrow band. Only 16000 and 32000 Hz
+ * are supported.
+ *
+ * Input:
+ *      - inst          : Instance that should be initialized
+ *      - fs            : Sampling frequency
+ *
+ * Output:
+ *      - inst          : Initialized instance
+ *
+ * Return value         :  0 - Ok
+ *                        -1 - Error
+ */
+WebRtc_Word32 WebRtcNsx_InitLowDelayCore(NsxInst_t *inst, WebRtc_UWord32 fs);
+
+/****************************************************************************
+ * WebRtcNsx_ChangeSampFreqCore(...)
+ *
+ * This function changes the sampling frequency of an initialized instance
+ * between 16000 and 32000 Hz, keeping the state of the low band.
+ *
+ * Input:
+ *      - inst          : Initialized instance
+ *      - fs            : New sampling frequency
+ *
+ * Output:
+ *      - inst          : Updated instance
+ *
+ * Return value         :  0 - Ok
+ *                        -1 - Error
+ */
+WebRtc_Word32 WebRtcNsx_ChangeSampFreqCore(NsxInst_t *inst, WebRtc_UWord32 fs);
+
 /****************************************************************************
  * WebRtcNsx_set_policy_core(...)
  *
@@ -60,6 +60,23 @@ static const float kHanning64w128[128] = {
 
 
 
+// hybrib Hanning & flat window: for low delay
+static const float kBlocks40w64[64] = {
+(float)0.00000000, (float)0.06540313, (float)0.13052619, (float)0.19509032, (float)0.25881905,
+(float)0.32143947, (float)0.38268343, (float)0.44228869, (float)0.50000000, (float)0.55557023,
+(float)0.60876143, (float)0.65934582, (float)0.70710678, (float)0.75183981, (float)0.79335334,
+(float)0.83146961, (float)0.86602540, (float)0.89687274, (float)0.92387953, (float)0.94693013,
+(float)0.96592583, (float)0.98078528, (float)0.99144486, (float)0.99785892, (float)1.00000000,
+(float)1.00000000, (float)1.00000000, (float)1.00000000, (float)1.00000000, (float)1.00000000,
+(float)1.00000000, (float)1.00000000, (float)1.00000000, (float)1.00000000, (float)1.00000000,
+(float)1.00000000, (float)1.00000000, (float)1.00000000, (float)1.00000000, (float)1.00000000,
+(float)1.00000000, (float)0.99785892, (float)0.99144486, (float)0.98078528, (float)0.96592583,
+(float)0.94693013, (float)0.92387953, (float)0.89687274, (float)0.86602540, (float)0.83146961,
+(float)0.79335334, (float)0.75183981, (float)0.70710678, (float)0.65934582, (float)0.60876143,
+(float)0.55557023, (float)0.50000000, (float)0.44228869, (float)0.38268343, (float)0.32143947,
+(float)0.25881905, (float)0.19509032, (float)0.13052619, (float)0.06540313
+};
+
 // hybrib Hanning & flat window
 static const float kBlocks80w128[128] = {
 (float)0.00000000, (float)0.03271908, (float)0.06540313, (float)0.09801714, (float)0.13052619,
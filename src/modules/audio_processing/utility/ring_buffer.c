@@ -22,12 +22,13 @@ typedef struct {
     int writePos;
     int size;
     char rwWrap;
-    bufdata_t *data;
+    int elementSize; // bytes per sample
+    char *data;
 } buf_t;
 
 enum {SAME_WRAP, DIFF_WRAP};
 
-int WebRtcApm_CreateBuffer(void **bufInst, int size)
+static int CreateBuffer(void **bufInst, int size, int elementSize)
 {
     buf_t *buf = NULL;
 
@@ -41,7 +42,7 @@ int WebRtcApm_CreateBuffer(void **bufInst, int size)
         return -1;
     }
 
-    buf->data = malloc(size*sizeof(bufdata_t));
+    buf->data = malloc(size*elementSize);
     if (buf->data == NULL) {
         free(buf);
         buf = NULL;
@@ -49,9 +50,20 @@ int WebRtcApm_CreateBuffer(void **bufInst, int size)
     }
 
     buf->size = size;
+    buf->elementSize = elementSize;
     return 0;
 }
 
+int WebRtcApm_CreateBuffer(void **bufInst, int size)
+{
+    return CreateBuffer(bufInst, size, sizeof(bufdata_t));
+}
+
+int WebRtcApm_CreateFloatBuffer(void **bufInst, int size)
+{
+    return CreateBuffer(bufInst, size, sizeof(float));
+}
+
 int WebRtcApm_InitBuffer(void *bufInst)
 {
     buf_t *buf = (buf_t*)bufInst;
@@ -61,7 +73,7 @@ int WebRtcApm_InitBuffer(void *bufInst)
     buf->rwWrap = SAME_WRAP;
 
     // Initialize buffer to zeros
-    memset(buf->data, 0, sizeof(bufdata_t)*buf->size);
+    memset(buf->data, 0, buf->elementSize*buf->size);
 
     return 0;
 }
@@ -80,9 +92,10 @@ int WebRtcApm_FreeBuffer(void *bufInst)
     return 0;
 }
 
-int WebRtcApm_ReadBuffer(void *bufInst, bufdata_t *data, int size)
+static int ReadBuffer(void *bufInst, char *data, int size)
 {
     buf_t *buf = (buf_t*)bufInst;
+    const int elementSize = buf->elementSize;
     int n = 0, margin = 0;
 
     if (size <= 0 || size > buf->size) {
@@ -94,14 +107,14 @@ int WebRtcApm_ReadBuffer(void *bufInst, bufdata_t *data, int size)
         margin = buf->size - buf->readPos;
         if (n > margin) {
             buf->rwWrap = SAME_WRAP;
-            memcpy(data, buf->data + buf->readPos,
-                sizeof(bufdata_t)*margin);
+            memcpy(data, buf->data + buf->readPos*elementSize,
+                elementSize*margin);
             buf->readPos = 0;
             n = size - margin;
         }
         else {
-            memcpy(data, buf->data + buf->readPos,
-                sizeof(bufdata_t)*n);
+            memcpy(data, buf->data + buf->readPos*elementSize,
+                elementSize*n);
             buf->readPos += n;
             return n;
         }
@@ -111,8 +124,8 @@ int WebRtcApm_ReadBuffer(void *bufInst, bufdata_t *data, int size)
         margin = buf->writePos - buf->readPos;
         if (margin > n)
             margin = n;
-        memcpy(data + size - n, buf->data + buf->readPos,
-            sizeof(bufdata_t)*margin);
+        memcpy(data + (size - n)*elementSize,
+            buf->data + buf->readPos*elementSize, elementSize*margin);
         buf->readPos += margin;
         n -= margin;
     }
@@ -120,9 +133,20 @@ int WebRtcApm_ReadBuffer(void *bufInst, bufdata_t *data, int size)
     return size - n;
 }
 
-int WebRtcApm_WriteBuffer(void *bufInst, const bufdata_t *data, int size)
+int WebRtcApm_ReadBuffer(void *bufInst, bufdata_t *data, int size)
+{
+    return ReadBuffer(bufInst, (char*)data, size);
+}
+
+int WebRtcApm_ReadBufferFloat(void *bufInst, float *data, int size)
+{
+    return ReadBuffer(bufInst, (char*)data, size);
+}
+
+static int WriteBuffer(void *bufInst, const char *data, int size)
 {
     buf_t *buf = (buf_t*)bufInst;
+    const int elementSize = buf->elementSize;
     int n = 0, margin = 0;
 
     if (size < 0 || size > buf->size) {
@@ -134,14 +158,14 @@ int WebRtcApm_WriteBuffer(void *bufInst, const bufdata_t *data, int size)
         margin = buf->size - buf->writePos;
         if (n > margin) {
             buf->rwWrap = DIFF_WRAP;
-            memcpy(buf->data + buf->writePos, data,
-                sizeof(bufdata_t)*margin);
+            memcpy(buf->data + buf->writePos*elementSize, data,
+                elementSize*margin);
             buf->writePos = 0;
             n = size - margin;
         }
         else {
-            memcpy(buf->data + buf->writePos, data,
-                sizeof(bufdata_t)*n);
+            memcpy(buf->data + buf->writePos*elementSize, data,
+                elementSize*n);
             buf->writePos += n;
             return n;
         }
@@ -151,8 +175,8 @@ int WebRtcApm_WriteBuffer(void *bufInst, const bufdata_t *data, int size)
         margin = buf->readPos - buf->writePos;
         if (margin > n)
             margin = n;
-        memcpy(buf->data + buf->writePos, data + size - n,
-            sizeof(bufdata_t)*margin);
+        memcpy(buf->data + buf->writePos*elementSize,
+            data + (size - n)*elementSize, elementSize*margin);
         buf->writePos += margin;
         n -= margin;
     }
@@ -160,6 +184,16 @@ int WebRtcApm_WriteBuffer(void *bufInst, const bufdata_t *data, int size)
     return size - n;
 }
 
+int WebRtcApm_WriteBuffer(void *bufInst, const bufdata_t *data, int size)
+{
+    return WriteBuffer(bufInst, (const char*)data, size);
+}
+
+int WebRtcApm_WriteBufferFloat(void *bufInst, const float *data, int size)
+{
+    return WriteBuffer(bufInst, (const char*)data, size);
+}
+
 int WebRtcApm_FlushBuffer(void *bufInst, int size)
 {
     buf_t *buf = (buf_t*)bufInst;
@@ -237,3 +271,14 @@ int WebRtcApm_get_buffer_size(const void *bufInst)
     else
         return buf->size - buf->readPos + buf->writePos;
 }
+
+int WebRtcApm_get_buffer_memory(const void *bufInst)
+{
+    const buf_t *buf = (buf_t*)bufInst;
+
+    if (buf == NULL) {
+        return 0;
+    }
+
+    return (int)(sizeof(buf_t) + buf->size * buf->elementSize);
+}
@@ -20,14 +20,19 @@ typedef short bufdata_t;
 
 // Unless otherwise specified, functions return 0 on success and -1 on error
 int WebRtcApm_CreateBuffer(void **bufInst, int size);
+// As WebRtcApm_CreateBuffer(), for float samples. Such a buffer is read and
+// written with the Float functions, the others apply to both kinds.
+int WebRtcApm_CreateFloatBuffer(void **bufInst, int size);
 int WebRtcApm_InitBuffer(void *bufInst);
 int WebRtcApm_FreeBuffer(void *bufInst);
 
 // Returns number of samples read
 int WebRtcApm_ReadBuffer(void *bufInst, bufdata_t *data, int size);
+int WebRtcApm_ReadBufferFloat(void *bufInst, float *data, int size);
 
 // Returns number of samples written
 int WebRtcApm_WriteBuffer(void *bufInst, const bufdata_t *data, int size);
+int WebRtcApm_WriteBufferFloat(void *bufInst, const float *data, int size);
 
 // Returns number of samples flushed
 int WebRtcApm_FlushBuffer(void *bufInst, int size);
@@ -38,4 +43,7 @@ int WebRtcApm_StuffBuffer(void *bufInst, int size);
 // Returns number of samples in buffer
 int WebRtcApm_get_buffer_size(const void *bufInst);
 
+// Returns number of bytes allocated for the buffer, 0 for NULL
+int WebRtcApm_get_buffer_memory(const void *bufInst);
+
 #endif // WEBRTC_MODULES_AUDIO_PROCESSING_UTILITY_RING_BUFFER_H_
@@ -7,6 +7,16 @@
 #include "typedefs.h"
 #include "common_types.h"
 
+// The AudioFrame arithmetic uses SSE2 or NEON when the compiler targets it.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WEBRTC_AUDIO_FRAME_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define WEBRTC_AUDIO_FRAME_NEON
+#include <arm_neon.h>
+#endif
+
 #ifdef _WIN32
     #pragma warning(disable:4351)       // remove warning "new behavior: elements of array
                                         // 'array' will be default initialized"
@@ -668,6 +678,10 @@ VideoFrame::Free()
  * - Stereo data is stored in interleaved fashion
  *   starting with the left channel.
  *
+ * - Mix() sums any number of frames with one
+ *   saturation at the end, where repeated use of
+ *   the +operator saturates after every frame.
+ *
  *************************************************/
 class AudioFrame
 {
@@ -713,6 +727,16 @@ public:
     AudioFrame& operator+=(const AudioFrame& rhs);
     AudioFrame& operator-=(const AudioFrame& rhs);
 
+    // Sets this frame to the sum of the |numFrames| frames in |frames|, each
+    // scaled by its gain in |gainsQ14| (16384 is unity), or unscaled if
+    // |gainsQ14| is NULL. The sum is accumulated at 32 bits and saturated
+    // once. The frames must be non-NULL, agree in length and number of
+    // channels, and may include this frame. Returns -1 otherwise, leaving
+    // this frame unchanged.
+    WebRtc_Word32 Mix(const AudioFrame* const* frames,
+                      const WebRtc_Word16* gainsQ14,
+                      const WebRtc_UWord16 numFrames);
+
     WebRtc_Word32  _id;
     WebRtc_UWord32 _timeStamp;
 
@@ -728,6 +752,266 @@ public:
     WebRtc_Word32  _volume;
 };
 
+/*************************************************
+ *
+ * AudioFrameView class
+ *
+ * Describes interleaved audio held elsewhere, with
+ * the same layout and members as AudioFrame, so that
+ * it can be passed on without copying the payload.
+ * The view does not own the samples, which must
+ * outlive it.
+ *
+ *************************************************/
+class AudioFrameView
+{
+public:
+    AudioFrameView(WebRtc_Word16* payloadData,
+                   const WebRtc_UWord16 payloadDataLengthInSamples,
+                   const WebRtc_UWord32 frequencyInHz,
+                   const WebRtc_UWord8  audioChannel = 1);
+    explicit AudioFrameView(const AudioFrame& frame);
+
+    WebRtc_Word16* _payloadData;
+    WebRtc_UWord16 _payloadDataLengthInSamples;
+    WebRtc_UWord32 _frequencyInHz;
+    WebRtc_UWord8  _audioChannel;
+};
+
+inline
+AudioFrameView::AudioFrameView(WebRtc_Word16* payloadData,
+                               const WebRtc_UWord16 payloadDataLengthInSamples,
+                               const WebRtc_UWord32 frequencyInHz,
+                               const WebRtc_UWord8  audioChannel)
+    :
+    _payloadData(payloadData),
+    _payloadDataLengthInSamples(payloadDataLengthInSamples),
+    _frequencyInHz(frequencyInHz),
+    _audioChannel(audioChannel)
+{
+}
+
+inline
+AudioFrameView::AudioFrameView(const AudioFrame& frame)
+    :
+    _payloadData(frame._payloadData),
+    _payloadDataLengthInSamples(frame._payloadDataLengthInSamples),
+    _frequencyInHz(frame._frequencyInHz),
+    _audioChannel(frame._audioChannel)
+{
+}
+
+/*************************************************
+ *
+ * Vector kernels for the AudioFrame arithmetic.
+ * The SSE2 and NEON versions give the same result
+ * as the plain C ones.
+ *
+ *************************************************/
+inline
+void
+AudioFrameAddSatW16(WebRtc_Word16* data, const WebRtc_Word16* rhs, int length)
+{
+    int i = 0;
+#if defined(WEBRTC_AUDIO_FRAME_SSE2)
+    for(; i + 8 <= length; i += 8)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i]));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&rhs[i]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&data[i]),
+                         _mm_adds_epi16(a, b));
+    }
+#elif defined(WEBRTC_AUDIO_FRAME_NEON)
+    for(; i + 8 <= length; i += 8)
+    {
+        vst1q_s16(&data[i], vqaddq_s16(vld1q_s16(&data[i]), vld1q_s16(&rhs[i])));
+    }
+#endif
+    for(; i < length; i++)
+    {
+        WebRtc_Word32 wrapGuard = (WebRtc_Word32)data[i] + (WebRtc_Word32)rhs[i];
+        if(wrapGuard < -32768)
+        {
+            data[i] = -32768;
+        }else if(wrapGuard > 32767)
+        {
+            data[i] = 32767;
+        }else
+        {
+            data[i] = (WebRtc_Word16)wrapGuard;
+        }
+    }
+}
+
+inline
+void
+AudioFrameSubSatW16(WebRtc_Word16* data, const WebRtc_Word16* rhs, int length)
+{
+    int i = 0;
+#if defined(WEBRTC_AUDIO_FRAME_SSE2)
+    for(; i + 8 <= length; i += 8)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i]));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&rhs[i]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&data[i]),
+                         _mm_subs_epi16(a, b));
+    }
+#elif defined(WEBRTC_AUDIO_FRAME_NEON)
+    for(; i + 8 <= length; i += 8)
+    {
+        vst1q_s16(&data[i], vqsubq_s16(vld1q_s16(&data[i]), vld1q_s16(&rhs[i])));
+    }
+#endif
+    for(; i < length; i++)
+    {
+        WebRtc_Word32 wrapGuard = (WebRtc_Word32)data[i] - (WebRtc_Word32)rhs[i];
+        if(wrapGuard < -32768)
+        {
+            data[i] = -32768;
+        }
+        else if(wrapGuard > 32767)
+        {
+            data[i] = 32767;
+        }
+        else
+        {
+            data[i] = (WebRtc_Word16)wrapGuard;
+        }
+    }
+}
+
+// Arithmetic shift of |data| right by 0 <= |shift| < 32.
+inline
+void
+AudioFrameShiftRightW16(WebRtc_Word16* data, int length, int shift)
+{
+    // Any shift past 15 leaves only the sign.
+    if(shift > 15)
+    {
+        shift = 15;
+    }
+    int i = 0;
+#if defined(WEBRTC_AUDIO_FRAME_SSE2)
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    for(; i + 8 <= length; i += 8)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&data[i]),
+                         _mm_sra_epi16(a, count));
+    }
+#elif defined(WEBRTC_AUDIO_FRAME_NEON)
+    const int16x8_t count = vdupq_n_s16(-shift);
+    for(; i + 8 <= length; i += 8)
+    {
+        vst1q_s16(&data[i], vshlq_s16(vld1q_s16(&data[i]), count));
+    }
+#endif
+    for(; i < length; i++)
+    {
+        data[i] = WebRtc_Word16(data[i] >> shift);
+    }
+}
+
+// Adds |in|, scaled by |gainQ14| unless it is 16384, to the 32-bit |acc|.
+inline
+void
+AudioFrameAccumulateW16(WebRtc_Word32* acc, const WebRtc_Word16* in,
+                        WebRtc_Word16 gainQ14, int length)
+{
+    int i = 0;
+    if(gainQ14 == 16384)
+    {
+#if defined(WEBRTC_AUDIO_FRAME_SSE2)
+        for(; i + 8 <= length; i += 8)
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&in[i]));
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+            __m128i* a = reinterpret_cast<__m128i*>(&acc[i]);
+            _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), lo));
+            _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), hi));
+        }
+#elif defined(WEBRTC_AUDIO_FRAME_NEON)
+        for(; i + 8 <= length; i += 8)
+        {
+            int16x8_t x = vld1q_s16(&in[i]);
+            vst1q_s32(&acc[i], vaddw_s16(vld1q_s32(&acc[i]), vget_low_s16(x)));
+            vst1q_s32(&acc[i + 4],
+                      vaddw_s16(vld1q_s32(&acc[i + 4]), vget_high_s16(x)));
+        }
+#endif
+        for(; i < length; i++)
+        {
+            acc[i] += in[i];
+        }
+        return;
+    }
+
+#if defined(WEBRTC_AUDIO_FRAME_SSE2)
+    const __m128i gain = _mm_set1_epi16(gainQ14);
+    for(; i + 8 <= length; i += 8)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&in[i]));
+        __m128i prodLo = _mm_mullo_epi16(x, gain);
+        __m128i prodHi = _mm_mulhi_epi16(x, gain);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(prodLo, prodHi), 14);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(prodLo, prodHi), 14);
+        __m128i* a = reinterpret_cast<__m128i*>(&acc[i]);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), lo));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), hi));
+    }
+#elif defined(WEBRTC_AUDIO_FRAME_NEON)
+    const int16x4_t gain = vdup_n_s16(gainQ14);
+    for(; i + 8 <= length; i += 8)
+    {
+        int16x8_t x = vld1q_s16(&in[i]);
+        int32x4_t lo = vshrq_n_s32(vmull_s16(vget_low_s16(x), gain), 14);
+        int32x4_t hi = vshrq_n_s32(vmull_s16(vget_high_s16(x), gain), 14);
+        vst1q_s32(&acc[i], vaddq_s32(vld1q_s32(&acc[i]), lo));
+        vst1q_s32(&acc[i + 4], vaddq_s32(vld1q_s32(&acc[i + 4]), hi));
+    }
+#endif
+    for(; i < length; i++)
+    {
+        acc[i] += ((WebRtc_Word32)in[i] * gainQ14) >> 14;
+    }
+}
+
+inline
+void
+AudioFrameSaturateW32(const WebRtc_Word32* acc, WebRtc_Word16* out, int length)
+{
+    int i = 0;
+#if defined(WEBRTC_AUDIO_FRAME_SSE2)
+    for(; i + 8 <= length; i += 8)
+    {
+        const __m128i* a = reinterpret_cast<const __m128i*>(&acc[i]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]),
+                         _mm_packs_epi32(_mm_loadu_si128(a),
+                                         _mm_loadu_si128(a + 1)));
+    }
+#elif defined(WEBRTC_AUDIO_FRAME_NEON)
+    for(; i + 8 <= length; i += 8)
+    {
+        vst1q_s16(&out[i], vcombine_s16(vqmovn_s32(vld1q_s32(&acc[i])),
+                                        vqmovn_s32(vld1q_s32(&acc[i + 4]))));
+    }
+#endif
+    for(; i < length; i++)
+    {
+        if(acc[i] < -32768)
+        {
+            out[i] = -32768;
+        }else if(acc[i] > 32767)
+        {
+            out[i] = 32767;
+        }else
+        {
+            out[i] = (WebRtc_Word16)acc[i];
+        }
+    }
+}
+
 inline
 AudioFrame::AudioFrame()
     :
@@ -840,10 +1124,8 @@ AudioFrame::operator>>=(const WebRtc_Word32 rhs)
     {
         return *this;
     }
-    for(WebRtc_UWord16 i = 0; i < _payloadDataLengthInSamples * _audioChannel; i++)
-    {
-        _payloadData[i] = WebRtc_Word16(_payloadData[i] >> rhs);
-    }
+    AudioFrameShiftRightW16(_payloadData,
+                            _payloadDataLengthInSamples * _audioChannel, rhs);
     return *this;
 }
 
@@ -940,22 +1222,8 @@ AudioFrame::operator+=(const AudioFrame& rhs)
           sizeof(WebRtc_Word16) * rhs._payloadDataLengthInSamples * _audioChannel);
     } else
     {
-      // IMPROVEMENT this can be done very fast in assembly
-      for(WebRtc_UWord16 i = 0; i < _payloadDataLengthInSamples * _audioChannel; i++)
-      {
-          WebRtc_Word32 wrapGuard = (WebRtc_Word32)_payloadData[i] +
-                  (WebRtc_Word32)rhs._payloadData[i];
-          if(wrapGuard < -32768)
-          {
-              _payloadData[i] = -32768;
-          }else if(wrapGuard > 32767)
-          {
-              _payloadData[i] = 32767;
-          }else
-          {
-              _payloadData[i] = (WebRtc_Word16)wrapGuard;
-          }
-      }
+      AudioFrameAddSatW16(_payloadData, rhs._payloadData,
+                          _payloadDataLengthInSamples * _audioChannel);
     }
     _energy = 0xffffffff;
     _volume = 0xffffffff;
@@ -985,26 +1253,93 @@ AudioFrame::operator-=(const AudioFrame& rhs)
     }
     _speechType = kUndefined;
 
-    for(WebRtc_UWord16 i = 0; i < _payloadDataLengthInSamples * _audioChannel; i++)
+    AudioFrameSubSatW16(_payloadData, rhs._payloadData,
+                        _payloadDataLengthInSamples * _audioChannel);
+    _energy = 0xffffffff;
+    _volume = 0xffffffff;
+    return *this;
+}
+
+inline
+WebRtc_Word32
+AudioFrame::Mix(const AudioFrame* const* frames,
+                const WebRtc_Word16* gainsQ14,
+                const WebRtc_UWord16 numFrames)
+{
+    // Accumulated in blocks which stay in the cache while all frames are
+    // added in.
+    enum { kMixBlockSamples = 320 };
+
+    if((frames == NULL) || (numFrames == 0) || (frames[0] == NULL))
     {
-        WebRtc_Word32 wrapGuard = (WebRtc_Word32)_payloadData[i] -
-                (WebRtc_Word32)rhs._payloadData[i];
-        if(wrapGuard < -32768)
+        return -1;
+    }
+    const AudioFrame& first = *frames[0];
+    if((first._audioChannel > 2) ||
+        (first._audioChannel < 1) ||
+        (first._payloadDataLengthInSamples * first._audioChannel >
+            kMaxAudioFrameSizeSamples))
+    {
+        return -1;
+    }
+    VADActivity vadActivity = first._vadActivity;
+    SpeechType speechType = first._speechType;
+    for(WebRtc_UWord16 n = 1; n < numFrames; n++)
+    {
+        if(frames[n] == NULL)
         {
-            _payloadData[i] = -32768;
+            return -1;
         }
-        else if(wrapGuard > 32767)
+        const AudioFrame& frame = *frames[n];
+        if((frame._payloadDataLengthInSamples !=
+            first._payloadDataLengthInSamples) ||
+            (frame._audioChannel != first._audioChannel))
         {
-            _payloadData[i] = 32767;
+            return -1;
         }
-        else
+        if((vadActivity == kVadActive) || (frame._vadActivity == kVadActive))
         {
-            _payloadData[i] = (WebRtc_Word16)wrapGuard;
+            vadActivity = kVadActive;
+        }
+        else if((vadActivity == kVadUnknown) ||
+            (frame._vadActivity == kVadUnknown))
+        {
+            vadActivity = kVadUnknown;
+        }
+        if(speechType != frame._speechType)
+        {
+            speechType = kUndefined;
         }
     }
+
+    const int length = first._payloadDataLengthInSamples * first._audioChannel;
+    WebRtc_Word32 acc[kMixBlockSamples];
+    for(int start = 0; start < length; start += kMixBlockSamples)
+    {
+        const int blockLength = (length - start < kMixBlockSamples) ?
+            length - start : kMixBlockSamples;
+        memset(acc, 0, sizeof(WebRtc_Word32) * blockLength);
+        for(WebRtc_UWord16 n = 0; n < numFrames; n++)
+        {
+            AudioFrameAccumulateW16(acc, &frames[n]->_payloadData[start],
+                                    (gainsQ14 != NULL) ? gainsQ14[n] : 16384,
+                                    blockLength);
+        }
+        // Every frame has been read for this block, so it is safe to write
+        // even if this frame is one of them.
+        AudioFrameSaturateW32(acc, &_payloadData[start], blockLength);
+    }
+
+    _id = first._id;
+    _timeStamp = first._timeStamp;
+    _frequencyInHz = first._frequencyInHz;
+    _audioChannel = first._audioChannel;
+    _payloadDataLengthInSamples = first._payloadDataLengthInSamples;
+    _vadActivity = vadActivity;
+    _speechType = speechType;
     _energy = 0xffffffff;
     _volume = 0xffffffff;
-    return *this;
+    return 0;
 }
 
 } // namespace webrtc
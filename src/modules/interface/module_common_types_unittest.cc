@@ -0,0 +1,260 @@
+/*
+ *  Copyright (c) 2011 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include "module_common_types.h"
+
+using webrtc::AudioFrame;
+
+namespace {
+// Gives 16-bit values of which a quarter are at the edges of the range.
+WebRtc_Word16 EdgeBiasedSample(WebRtc_UWord32* seed) {
+  *seed = *seed * 1103515245 + 12345;
+  switch ((*seed >> 8) & 7) {
+    case 0:
+      return 32767;
+    case 1:
+      return -32768;
+    default:
+      return static_cast<WebRtc_Word16>(*seed >> 16);
+  }
+}
+
+WebRtc_Word16 SaturateW32(WebRtc_Word32 value) {
+  return static_cast<WebRtc_Word16>(std::max(-32768, std::min(32767, value)));
+}
+
+// Lengths 0 to 40 cover the vector loops with every tail length.
+const int kMaxKernelLength = 40;
+
+TEST(AudioFrameTest, SaturatingKernels) {
+  WebRtc_UWord32 seed = 1;
+  WebRtc_Word16 data[kMaxKernelLength];
+  WebRtc_Word16 rhs[kMaxKernelLength];
+  WebRtc_Word16 result[kMaxKernelLength];
+  for (int length = 0; length <= kMaxKernelLength; length++) {
+    for (int i = 0; i < length; i++) {
+      data[i] = EdgeBiasedSample(&seed);
+      rhs[i] = EdgeBiasedSample(&seed);
+    }
+
+    memcpy(result, data, sizeof(data));
+    webrtc::AudioFrameAddSatW16(result, rhs, length);
+    for (int i = 0; i < length; i++) {
+      ASSERT_EQ(SaturateW32(data[i] + rhs[i]), result[i]) << length << " " << i;
+    }
+
+    memcpy(result, data, sizeof(data));
+    webrtc::AudioFrameSubSatW16(result, rhs, length);
+    for (int i = 0; i < length; i++) {
+      ASSERT_EQ(SaturateW32(data[i] - rhs[i]), result[i]) << length << " " << i;
+    }
+
+    const int shifts[] = {0, 1, 7, 15, 16, 31};
+    for (size_t k = 0; k < sizeof(shifts) / sizeof(*shifts); k++) {
+      memcpy(result, data, sizeof(data));
+      webrtc::AudioFrameShiftRightW16(result, length, shifts[k]);
+      for (int i = 0; i < length; i++) {
+        ASSERT_EQ(data[i] >> std::min(shifts[k], 15), result[i])
+            << length << " " << shifts[k] << " " << i;
+      }
+    }
+  }
+
+  // Every edge combination, in the vector part and in the tail.
+  const WebRtc_Word16 kLhs[] = {32767, -32768, 32767, -32768, 0, -1, 1, 0,
+                                32767, -32768};
+  const WebRtc_Word16 kRhs[] = {1, -1, 32767, -32768, -32768, -32768, 32767,
+                                32767, -32768, 32767};
+  const WebRtc_Word16 kSum[] = {32767, -32768, 32767, -32768, -32768, -32768,
+                                32767, 32767, -1, -1};
+  const WebRtc_Word16 kDifference[] = {32766, -32767, 0, 0, 32767, 32767,
+                                       -32766, -32767, 32767, -32768};
+  const int kLength = sizeof(kLhs) / sizeof(*kLhs);
+  memcpy(result, kLhs, sizeof(kLhs));
+  webrtc::AudioFrameAddSatW16(result, kRhs, kLength);
+  for (int i = 0; i < kLength; i++) {
+    EXPECT_EQ(kSum[i], result[i]) << i;
+  }
+  memcpy(result, kLhs, sizeof(kLhs));
+  webrtc::AudioFrameSubSatW16(result, kRhs, kLength);
+  for (int i = 0; i < kLength; i++) {
+    EXPECT_EQ(kDifference[i], result[i]) << i;
+  }
+}
+
+TEST(AudioFrameTest, AccumulateAndSaturateKernels) {
+  WebRtc_UWord32 seed = 1;
+  WebRtc_Word16 in[kMaxKernelLength];
+  WebRtc_Word32 acc[kMaxKernelLength];
+  WebRtc_Word32 result[kMaxKernelLength];
+  WebRtc_Word16 out[kMaxKernelLength];
+  const WebRtc_Word16 gains[] = {16384, 0, 1, 8192, -16384, 32767, -32768};
+  for (int length = 0; length <= kMaxKernelLength; length++) {
+    for (int i = 0; i < length; i++) {
+      in[i] = EdgeBiasedSample(&seed);
+      acc[i] = EdgeBiasedSample(&seed) * 16;
+    }
+
+    for (size_t k = 0; k < sizeof(gains) / sizeof(*gains); k++) {
+      memcpy(result, acc, sizeof(acc));
+      webrtc::AudioFrameAccumulateW16(result, in, gains[k], length);
+      for (int i = 0; i < length; i++) {
+        ASSERT_EQ(acc[i] + ((in[i] * gains[k]) >> 14), result[i])
+            << length << " " << gains[k] << " " << i;
+      }
+    }
+
+    // Half of |acc| is out of the 16-bit range.
+    webrtc::AudioFrameSaturateW32(acc, out, length);
+    for (int i = 0; i < length; i++) {
+      ASSERT_EQ(SaturateW32(acc[i]), out[i]) << length << " " << i;
+    }
+  }
+
+  const WebRtc_Word32 kAcc[] = {32767, 32768, -32768, -32769, 0x7fffffff,
+                                -0x7fffffff - 1, 1, -1, 65536};
+  const WebRtc_Word16 kOut[] = {32767, 32767, -32768, -32768, 32767, -32768,
+                                1, -1, 32767};
+  const int kLength = sizeof(kAcc) / sizeof(*kAcc);
+  webrtc::AudioFrameSaturateW32(kAcc, out, kLength);
+  for (int i = 0; i < kLength; i++) {
+    EXPECT_EQ(kOut[i], out[i]) << i;
+  }
+}
+
+TEST(AudioFrameTest, Mix) {
+  // 163 stereo samples take more than one 320 sample block, with a tail
+  // that is not a multiple of 8.
+  const int kNumFrames = 3;
+  const int kSamplesPerChannel = 163;
+  const int kLength = kSamplesPerChannel * 2;
+  const WebRtc_Word16 kGains[kNumFrames] = {16384, 8192, -16384};
+  WebRtc_UWord32 seed = 1;
+  AudioFrame inputs[kNumFrames];
+  const AudioFrame* frames[kNumFrames];
+  for (int n = 0; n < kNumFrames; n++) {
+    inputs[n]._id = n;
+    inputs[n]._timeStamp = 1000 + n;
+    inputs[n]._frequencyInHz = 16000;
+    inputs[n]._audioChannel = 2;
+    inputs[n]._payloadDataLengthInSamples = kSamplesPerChannel;
+    inputs[n]._vadActivity = AudioFrame::kVadPassive;
+    inputs[n]._speechType = AudioFrame::kNormalSpeech;
+    for (int i = 0; i < kLength; i++) {
+      inputs[n]._payloadData[i] = EdgeBiasedSample(&seed);
+    }
+    frames[n] = &inputs[n];
+  }
+  inputs[2]._vadActivity = AudioFrame::kVadActive;
+  inputs[1]._speechType = AudioFrame::kPLC;
+
+  AudioFrame unity;
+  AudioFrame scaled;
+  EXPECT_EQ(0, unity.Mix(frames, NULL, kNumFrames));
+  EXPECT_EQ(0, scaled.Mix(frames, kGains, kNumFrames));
+  EXPECT_EQ(0, scaled._id);
+  EXPECT_EQ(1000u, scaled._timeStamp);
+  EXPECT_EQ(16000u, scaled._frequencyInHz);
+  EXPECT_EQ(2, scaled._audioChannel);
+  EXPECT_EQ(kSamplesPerChannel, scaled._payloadDataLengthInSamples);
+  EXPECT_EQ(AudioFrame::kVadActive, scaled._vadActivity);
+  EXPECT_EQ(AudioFrame::kUndefined, scaled._speechType);
+  for (int i = 0; i < kLength; i++) {
+    WebRtc_Word32 unity_sum = 0;
+    WebRtc_Word32 scaled_sum = 0;
+    for (int n = 0; n < kNumFrames; n++) {
+      unity_sum += inputs[n]._payloadData[i];
+      scaled_sum += (inputs[n]._payloadData[i] * kGains[n]) >> 14;
+    }
+    ASSERT_EQ(SaturateW32(unity_sum), unity._payloadData[i]) << i;
+    ASSERT_EQ(SaturateW32(scaled_sum), scaled._payloadData[i]) << i;
+  }
+
+  // The sum saturates once, not after every frame as with +=.
+  AudioFrame edges[kNumFrames];
+  const AudioFrame* edge_frames[kNumFrames];
+  const WebRtc_Word16 kEdges[kNumFrames] = {32767, 32767, -32768};
+  for (int n = 0; n < kNumFrames; n++) {
+    edges[n]._audioChannel = 1;
+    edges[n]._payloadDataLengthInSamples = 9;
+    for (int i = 0; i < 9; i++) {
+      edges[n]._payloadData[i] = kEdges[n];
+    }
+    edge_frames[n] = &edges[n];
+  }
+  AudioFrame edge_sum;
+  EXPECT_EQ(0, edge_sum.Mix(edge_frames, NULL, 2));
+  EXPECT_EQ(32767, edge_sum._payloadData[0]);
+  EXPECT_EQ(32767, edge_sum._payloadData[8]);
+  EXPECT_EQ(0, edge_sum.Mix(edge_frames, NULL, kNumFrames));
+  EXPECT_EQ(32766, edge_sum._payloadData[0]);
+  EXPECT_EQ(32766, edge_sum._payloadData[8]);
+
+  // In place, with this frame as one of the inputs.
+  AudioFrame copies[kNumFrames];
+  const AudioFrame* copy_frames[kNumFrames];
+  for (int n = 0; n < kNumFrames; n++) {
+    copies[n] = inputs[n];
+    copy_frames[n] = &copies[n];
+  }
+  EXPECT_EQ(0, copies[1].Mix(copy_frames, kGains, kNumFrames));
+  for (int i = 0; i < kLength; i++) {
+    ASSERT_EQ(scaled._payloadData[i], copies[1]._payloadData[i]) << i;
+  }
+}
+
+TEST(AudioFrameTest, MixErrors) {
+  const int kNumFrames = 2;
+  AudioFrame inputs[kNumFrames];
+  const AudioFrame* frames[kNumFrames];
+  for (int n = 0; n < kNumFrames; n++) {
+    inputs[n]._audioChannel = 2;
+    inputs[n]._payloadDataLengthInSamples = 160;
+    frames[n] = &inputs[n];
+  }
+  AudioFrame output;
+  output._payloadDataLengthInSamples = 80;
+  output._payloadData[0] = 1234;
+
+  EXPECT_EQ(-1, output.Mix(NULL, NULL, kNumFrames));
+  EXPECT_EQ(-1, output.Mix(frames, NULL, 0));
+  const AudioFrame* null_frames[kNumFrames] = {NULL, &inputs[1]};
+  EXPECT_EQ(-1, output.Mix(null_frames, NULL, kNumFrames));
+  null_frames[0] = &inputs[0];
+  null_frames[1] = NULL;
+  EXPECT_EQ(-1, output.Mix(null_frames, NULL, kNumFrames));
+
+  inputs[1]._payloadDataLengthInSamples = 161;
+  EXPECT_EQ(-1, output.Mix(frames, NULL, kNumFrames));
+  inputs[1]._payloadDataLengthInSamples = 160;
+  inputs[1]._audioChannel = 1;
+  EXPECT_EQ(-1, output.Mix(frames, NULL, kNumFrames));
+  inputs[1]._audioChannel = 2;
+  inputs[0]._audioChannel = 3;
+  inputs[1]._audioChannel = 3;
+  EXPECT_EQ(-1, output.Mix(frames, NULL, kNumFrames));
+  inputs[0]._audioChannel = 2;
+  inputs[1]._audioChannel = 2;
+  inputs[0]._payloadDataLengthInSamples =
+      AudioFrame::kMaxAudioFrameSizeSamples / 2 + 1;
+  inputs[1]._payloadDataLengthInSamples =
+      AudioFrame::kMaxAudioFrameSizeSamples / 2 + 1;
+  EXPECT_EQ(-1, output.Mix(frames, NULL, kNumFrames));
+
+  // The output is left unchanged.
+  EXPECT_EQ(80, output._payloadDataLengthInSamples);
+  EXPECT_EQ(1234, output._payloadData[0]);
+}
+
+}  // namespace
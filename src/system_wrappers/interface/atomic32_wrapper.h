@@ -37,6 +37,8 @@ public:
     // Sets the value atomically to newValue if the value equals compare value.
     // The function returns true if the exchange happened.
     bool CompareExchange(WebRtc_Word32 newValue, WebRtc_Word32 compareValue);
+    // Reads the value with a full barrier, so memory accessed after the call
+    // is not accessed before the read.
     WebRtc_Word32 Value() const;
 private:
     // Disable the + and - operator since it's unclear what these operations
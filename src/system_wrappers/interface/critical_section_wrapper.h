@@ -29,6 +29,10 @@ public:
     // lock to become available if the grab failed.
     virtual void Enter() = 0;
 
+    // Grabs the lock only if it is available, without waiting. Returns true
+    // if the lock was grabbed, in which case Leave() must be called.
+    virtual bool TryEnter() = 0;
+
     // Returns a grabbed lock, end of critical section.
     virtual void Leave() = 0;
 };
@@ -112,7 +112,9 @@ inline bool Atomic32Impl::CompareExchange(WebRtc_Word32 newValue,
 
 inline WebRtc_Word32 Atomic32Impl::Value() const
 {
-    return *_value;
+    // Adding zero reads the value with a full barrier, like the other
+    // operations, instead of a plain volatile load.
+    return __sync_fetch_and_add(_value, 0);
 }
 } // namespace webrtc
 
@@ -111,7 +111,9 @@ inline bool Atomic32Impl::CompareExchange(WebRtc_Word32 newValue,
 
 inline WebRtc_Word32 Atomic32Impl::Value() const
 {
-    return *_value;
+    // Adding zero reads the value with a full barrier, like the other
+    // operations, instead of a plain volatile load.
+    return OSAtomicAdd32Barrier(0, reinterpret_cast<volatile int32_t*>(_value));
 }
 } // namespace webrtc
 #endif // WEBRTC_SYSTEM_WRAPPERS_SOURCE_ATOMIC32_MAC_H_
@@ -30,6 +30,12 @@ CriticalSectionLinux::Enter()
     pthread_mutex_lock(&_mutex);
 }
 
+bool
+CriticalSectionLinux::TryEnter()
+{
+    return pthread_mutex_trylock(&_mutex) == 0;
+}
+
 void
 CriticalSectionLinux::Leave()
 {
@@ -24,6 +24,7 @@ public:
     virtual ~CriticalSectionLinux();
 
     virtual void Enter();
+    virtual bool TryEnter();
     virtual void Leave();
 
 private:
@@ -17,7 +17,7 @@
 /* Reserved words definitions */
 #define WEBRTC_EXTERN extern
 #define G_CONST const
-#define WEBRTC_INLINE extern __inline
+#define WEBRTC_INLINE static __inline
 
 #ifndef WEBRTC_TYPEDEFS_H
 #define WEBRTC_TYPEDEFS_H